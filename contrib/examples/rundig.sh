@@ -71,6 +71,11 @@ cp $DBDIR/db.excerpts.work $DBDIR/db.excerpts
 cp $DBDIR/db.words.db.work $DBDIR/db.words.db
 test -f $DBDIR/db.words.db.work_weakcmpr &&
   cp $DBDIR/db.words.db.work_weakcmpr $DBDIR/db.words.db_weakcmpr
+if test -f $DBDIR/db.words.db.work_extent; then
+  cp $DBDIR/db.words.db.work_extent $DBDIR/db.words.db_extent
+else
+  rm -f $DBDIR/db.words.db_extent
+fi
 
 END=`date`
 echo End time: $END
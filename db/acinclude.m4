@@ -602,6 +602,28 @@ if test "$db_cv_int32" != yes; then
 	int32_decl="typedef $db_cv_int32 int32_t;"
 fi
 ])dnl
+
+dnl Check for io_uring, used by the memory pool to batch its writes and its
+dnl readahead advice.  IORING_OP_FADVISE is an enum constant, which the
+dnl preprocessor can't see: the headers must be compiled against.
+AC_DEFUN([AM_CHECK_IO_URING], [dnl
+AC_CACHE_CHECK([for io_uring], db_cv_io_uring, [dnl
+AC_TRY_COMPILE([#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>], [
+#if !defined(__NR_io_uring_setup) || !defined(__NR_io_uring_enter) || \
+    !defined(O_DIRECT) || !defined(POSIX_FADV_WILLNEED)
+choke me
+#endif
+int op = IORING_OP_FADVISE;],
+	[db_cv_io_uring=yes], [db_cv_io_uring=no])])
+if test "$db_cv_io_uring" = yes; then
+	AC_DEFINE(HAVE_IO_URING, 1,
+	    [Define to 1 if the system headers describe io_uring and IORING_OP_FADVISE.])
+fi
+])dnl
 dnl @synopsis CHECK_ZLIB()
 dnl
 dnl This macro searches for an installed zlib library. If nothing
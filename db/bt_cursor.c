@@ -24,6 +24,7 @@ static const char sccsid[] = "@(#)bt_cursor.c  11.21 (Sleepycat) 11/10/99";
 #include "db_shash.h"
 #include "btree.h"
 #include "lock.h"
+#include "mp.h"
 #include "qam.h"
 
 static int CDB___bam_c_close __P ((DBC *));
@@ -42,6 +43,7 @@ static int CDB___bam_c_rget __P ((DBC *, DBT *, u_int32_t));
 static int CDB___bam_c_search __P ((DBC *, const DBT *, u_int32_t, int *));
 static int CDB___bam_dsearch __P ((DBC *, DBT *, u_int32_t *));
 static int CDB___bam_dup __P ((DBC *, u_int32_t, int));
+static void CDB___bam_readahead __P ((DBC *));
 
 /*
  * Acquire a new page/lock for the cursor.  If we hold a page/lock, discard
@@ -160,6 +162,9 @@ CDB___bam_c_reset (cp)
   cp->lock.off = LOCK_INVALID;
   cp->lock_mode = DB_LOCK_NG;
   cp->recno = RECNO_OOB;
+  cp->ra_pgno = PGNO_INVALID;
+  cp->ra_seq = 0;
+  cp->ra_start = cp->ra_end = PGNO_INVALID;
   cp->flags = 0;
 }
 
@@ -249,6 +254,12 @@ CDB___bam_c_dup (orig_dbc, new_dbc)
 
   new->recno = orig->recno;
 
+  /* A cursor that keeps moving on is dup'd at each step. */
+  new->ra_pgno = orig->ra_pgno;
+  new->ra_seq = orig->ra_seq;
+  new->ra_start = orig->ra_start;
+  new->ra_end = orig->ra_end;
+
   new->lock_mode = orig->lock_mode;
 
   if (orig->lock.off == LOCK_INVALID)
@@ -1288,7 +1299,7 @@ CDB___bam_c_next (dbc, initial_move)
   db_indx_t adjust, indx;
   db_lockmode_t lock_mode;
   db_pgno_t pgno;
-  int ret;
+  int next, ret;
 
   dbp = dbc->dbp;
   cp = dbc->internal;
@@ -1355,13 +1366,23 @@ CDB___bam_c_next (dbc, initial_move)
         pgno = cp->pgno;
         indx = cp->indx + P_INDX;
         lock_mode = F_ISSET (dbc, DBC_RMW) ? DB_LOCK_WRITE : DB_LOCK_READ;
+        next = 0;
       }
       else
+      {
         indx = 0;
+        next = 1;
+
+        /* Count the moves from one page to the next in a row. */
+        cp->ra_seq = cp->ra_pgno == cp->page->pgno ? cp->ra_seq + 1 : 1;
+        cp->ra_pgno = pgno;
+      }
 
       ACQUIRE (dbc, pgno, lock_mode, ret);
       if (ret != 0)
         return (ret);
+      if (next && cp->ra_seq >= BT_RA_SEQ)
+        CDB___bam_readahead (dbc);
       continue;
     }
 
@@ -1401,6 +1422,51 @@ CDB___bam_c_next (dbc, initial_move)
   return (0);
 }
 
+/*
+ * CDB___bam_readahead --
+ *  Ask the memory pool to read the pages after the cursor page in the
+ *  background, for a cursor that keeps moving on to the next page.
+ */
+static void
+CDB___bam_readahead (dbc)
+     DBC *dbc;
+{
+  BTREE_CURSOR *cp;
+  PAGE *h;
+  db_pgno_t pgno;
+  u_int32_t n;
+
+  cp = dbc->internal;
+  h = cp->page;
+
+  /* Nothing to do at the end of the chain, or if already asked. */
+  pgno = NEXT_PGNO (h);
+  if (pgno == PGNO_INVALID || (pgno >= cp->ra_start && pgno < cp->ra_end))
+    return;
+
+  /*
+   * Pages filled in key order usually follow each other in the file too,
+   * give or take the pages a compressed page overflows into.  As long as
+   * they do, read twice as many pages each time, as the system does for
+   * files read sequentially.  Otherwise, the next page is the only one we
+   * know about.
+   */
+  if (pgno > PGNO (h) && pgno - PGNO (h) <= BT_RA_GAP)
+  {
+    n = 2 * (cp->ra_end - cp->ra_start);
+    if (n < 2 * BT_RA_SEQ)
+      n = 2 * BT_RA_SEQ;
+    if (n > BT_RA_MAX)
+      n = BT_RA_MAX;
+  }
+  else
+    n = 1;
+
+  CDB___memp_prefetch (dbc->dbp->mpf, pgno, n);
+  cp->ra_start = pgno;
+  cp->ra_end = pgno + n;
+}
+
 /*
  * CDB___bam_c_prev --
  *  Move to the previous record.
@@ -54,6 +54,16 @@ typedef struct __recno RECNO;
 
 #define  DEFMINKEYPAGE   (2)
 
+/*
+ * A cursor moving forward from page to page starts reading the pages ahead
+ * after BT_RA_SEQ moves in a row, and never more than BT_RA_MAX at once.
+ * The next page is taken to follow the current one in the file if it is
+ * at most BT_RA_GAP pages further.
+ */
+#define  BT_RA_SEQ  2
+#define  BT_RA_MAX  32
+#define  BT_RA_GAP  8
+
 #define  ISINTERNAL(p)  (TYPE(p) == P_IBTREE || TYPE(p) == P_IRECNO)
 #define  ISLEAF(p)  (TYPE(p) == P_LBTREE || TYPE(p) == P_LRECNO)
 
@@ -179,6 +189,16 @@ struct __cursor
   DB_LOCK lock;                 /* Cursor lock. */
   db_lockmode_t lock_mode;      /* Lock mode. */
 
+  /*
+   * Readahead: the page the cursor last moved to from the page before it
+   * in the chain, how many such moves it made in a row, and the pages
+   * the memory pool was last asked to read in advance.
+   */
+  db_pgno_t ra_pgno;            /* Page reached by the last move. */
+  u_int32_t ra_seq;             /* Consecutive moves to the next page. */
+  db_pgno_t ra_start;           /* First page read in advance. */
+  db_pgno_t ra_end;             /* Page after the last one. */
+
   /* Per-thread information: recno private. */
   db_recno_t recno;             /* Current record number. */
 
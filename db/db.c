@@ -180,6 +180,14 @@ CDB___db_open (dbp, name, subdb, type, flags, mode)
     return (EINVAL);
   }
 
+  /* Nothing may change in a read-only snapshot environment. */
+  if (!LF_ISSET (DB_RDONLY) && F_ISSET (dbenv, DB_ENV_SNAPSHOT))
+  {
+    CDB___db_err (dbenv,
+                  "databases must be opened DB_RDONLY in a snapshot environment");
+    return (EINVAL);
+  }
+
   /* DB_TRUNCATE is not transaction recoverable. */
   if (LF_ISSET (DB_TRUNCATE) && F_ISSET (dbenv, DB_ENV_TXN))
   {
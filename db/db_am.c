@@ -81,12 +81,12 @@ CDB___db_cursor (dbp, txn, dbcp, flags)
     if (F_ISSET (dbp->dbenv, DB_ENV_CDB | DB_ENV_LOCKING))
     {
       /*
-       * If we are not threaded, then there is no need to
-       * create new locker ids.  We know that no one else
+       * If the handle is not threaded, then there is no need
+       * to create new locker ids.  We know that no one else
        * is running concurrently using this DB, so we can
        * take a peek at any cursors on the active queue.
        */
-      if (!F_ISSET (dbp->dbenv, DB_ENV_THREAD) &&
+      if (dbp->mutexp == NULL &&
           (adbc = TAILQ_FIRST (&dbp->active_queue)) != NULL)
         dbc->lid = adbc->lid;
       else if ((ret = CDB_lock_id (dbp->dbenv, &dbc->lid)) != 0)
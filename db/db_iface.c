@@ -528,7 +528,11 @@ CDB___dbt_ferr (dbp, name, dbt, check_thread)
     return (CDB___db_ferr (dbenv, name, 1));
   }
 
-  if (check_thread && F_ISSET (dbenv, DB_ENV_THREAD) &&
+  /*
+   * Only handles opened DB_THREAD are shared by threads: the others may
+   * return data in the handle's own buffer.
+   */
+  if (check_thread && dbp->mutexp != NULL &&
       !F_ISSET (dbt, DB_DBT_MALLOC | DB_DBT_REALLOC | DB_DBT_USERMEM))
   {
     CDB___db_err (dbenv, "missing flag thread flag for %s DBT", name);
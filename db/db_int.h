@@ -146,6 +146,7 @@ typedef struct __fn
 #define  DB_OSO_SEQ  0x010      /* Expected sequential access. */
 #define  DB_OSO_TEMP  0x020     /* Remove after last close. */
 #define  DB_OSO_TRUNC  0x040    /* POSIX: O_TRUNC */
+#define  DB_OSO_DIRECT  0x080   /* Bypass the system's buffers. */
 
 /*
  * Seek options understood by CDB___os_seek.
@@ -85,8 +85,9 @@ CDB___dbenv_open (dbenv, db_home, db_config, flags, mode)
 #define  OKFLAGS                \
   DB_CREATE | DB_INIT_CDB | DB_INIT_LOCK | DB_INIT_LOG |    \
   DB_INIT_MPOOL | DB_INIT_TXN | DB_LOCKDOWN | DB_NOMMAP |    \
-  DB_PRIVATE | DB_RECOVER | DB_RECOVER_FATAL | DB_SYSTEM_MEM |  \
-  DB_THREAD | DB_TXN_NOSYNC | DB_USE_ENVIRON | DB_USE_ENVIRON_ROOT
+  DB_PRIVATE | DB_RDONLY_SNAPSHOT | DB_RECOVER | DB_RECOVER_FATAL |  \
+  DB_SYSTEM_MEM | DB_THREAD | DB_TXN_NOSYNC | DB_USE_ENVIRON |    \
+  DB_USE_ENVIRON_ROOT
 #undef  OKFLAGS_CDB
 #define  OKFLAGS_CDB              \
   DB_CREATE | DB_INIT_CDB | DB_INIT_MPOOL | DB_LOCKDOWN |    \
@@ -103,6 +104,15 @@ CDB___dbenv_open (dbenv, db_home, db_config, flags, mode)
                              DB_SYSTEM_MEM)) != 0)
     return (ret);
 
+  /*
+   * Nothing changes in a read-only snapshot, so there is nothing to lock,
+   * log or recover.
+   */
+  if (LF_ISSET (DB_RDONLY_SNAPSHOT) &&
+      LF_ISSET (DB_INIT_CDB | DB_INIT_LOCK | DB_INIT_LOG | DB_INIT_TXN |
+                DB_RECOVER | DB_RECOVER_FATAL))
+    return (CDB___db_ferr (dbenv, "DBENV->open", 1));
+
   /*
    * If we're doing recovery, destroy the environment so that we create
    * all the regions from scratch.  I'd like to reuse already created
@@ -142,6 +152,8 @@ CDB___dbenv_open (dbenv, db_home, db_config, flags, mode)
     F_SET (dbenv, DB_ENV_NOMMAP);
   if (LF_ISSET (DB_PRIVATE))
     F_SET (dbenv, DB_ENV_PRIVATE);
+  if (LF_ISSET (DB_RDONLY_SNAPSHOT))
+    F_SET (dbenv, DB_ENV_SNAPSHOT);
   if (LF_ISSET (DB_SYSTEM_MEM))
     F_SET (dbenv, DB_ENV_SYSTEM_MEM);
   if (LF_ISSET (DB_THREAD))
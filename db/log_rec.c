@@ -52,6 +52,8 @@ static const char sccsid[] = "@(#)log_rec.c  11.16 (Sleepycat) 10/19/99";
 #include "db_dispatch.h"
 #include "db_page.h"
 #include "db_ext.h"
+#include "mp.h"
+#include "mp_ext.h"
 
 static int CDB___log_do_open
 __P ((DB_LOG *, u_int8_t *, char *, DBTYPE, u_int32_t));
@@ -234,12 +236,16 @@ CDB___log_do_open (lp, uid, name, ftype, ndx)
      u_int32_t ndx;
 {
   DB *dbp;
+  u_int32_t flags;
   int ret;
   u_int8_t zeroid[DB_FILE_ID_LEN];
 
+  flags = 0;
+  if ((ret = CDB___memp_cmpr_recover (lp->dbenv, name, &flags)) != 0)
+    return (ret);
   if ((ret = CDB_db_create (&dbp, lp->dbenv, 0)) != 0)
     return (ret);
-  if ((ret = dbp->open (dbp, name, NULL, ftype, 0, 0600)) == 0)
+  if ((ret = dbp->open (dbp, name, NULL, ftype, flags, 0600)) == 0)
   {
     /*
      * Verify that we are opening the same file that we were
@@ -23,6 +23,10 @@ struct __cmpr;
 typedef struct __cmpr CMPR;
 struct __cmpr_context;
 typedef struct __cmpr_context CMPR_CONTEXT;
+struct __cmpr_extent;
+typedef struct __cmpr_extent CMPR_EXTENT;
+struct __cmpr_slot;
+typedef struct __cmpr_slot CMPR_SLOT;
 
 /* We require at least 20K of cache. */
 #define  DB_CACHESIZE_MIN  ( 20 * 1024)
@@ -32,6 +36,21 @@ typedef struct __cmpr_context CMPR_CONTEXT;
  */
 #define  DB_MPOOLFILE_DEF  500
 
+/*
+ * By default, the background flusher wakes up four times a second.
+ */
+#define  MP_FLUSH_USECS  250000
+
+/*
+ * Size of the rings the I/O goes through with DB_MPIO_URING.
+ */
+#define  MP_IORING_SIZE  64
+
+/*
+ * Most runs of pages advised at once by CDB___memp_prefetch.
+ */
+#define  MP_PREFETCH_RUNS  16
+
 /*
  * DB_MPOOL --
  *  Per-process memory pool structure.
@@ -58,6 +77,22 @@ struct __db_mpool
   /* I'm not sure if these need to be thread-protected... */
   int recursion_level;          /* limit recur'n from weak compr'n */
 
+  /*
+   * The background flusher, if any (see mp_trickle.c).  Set before the
+   * thread starts and cleared after it exits.
+   */
+  void *flusher;
+
+  /*
+   * The rings that batch the writes of sync and trickle passes and the
+   * readahead advice, if DB_MPIO_URING is set and the system has them.
+   * They're separate so that advice never waits for writes.
+   */
+  DB_IORING *wring;             /* Ring for writes. */
+  MUTEX *wring_mutexp;          /* Its thread lock. */
+  DB_IORING *rring;             /* Ring for readahead advice. */
+  MUTEX *rring_mutexp;          /* Its thread lock. */
+
 };
 
 /*
@@ -74,6 +109,43 @@ struct __db_mpreg
   int (*pgout) __P ((db_pgno_t, void *, DBT *));
 };
 
+/*
+ * CMPR_SLOT --
+ *  Where a page of a packed compressed file is in its extent.
+ */
+struct __cmpr_slot
+{
+  u_int32_t offset;             /* Record offset, in DB_CMPR_ALIGN units. */
+  u_int32_t length;             /* Compressed length, 0 if never written. */
+};
+
+/*
+ * CMPR_EXTENT --
+ *  The extent of a packed compressed file: an append-only file of
+ *  compressed pages, and the map of where the current copy of each page
+ *  is.  See mp_cmpr.c.
+ */
+struct __cmpr_extent
+{
+#define DB_CMPR_EXTENT_SUFFIX  "_extent"
+#define DB_CMPR_ALIGN    16     /* Records start on 16 byte boundaries. */
+  MUTEX *mutexp;                /* Thread lock: all the fields. */
+
+  DB_FH fh;                     /* Extent file. */
+  char *path;                   /* Its name. */
+  int mode;                     /* Its permissions. */
+  int readonly;                 /* Opened DB_RDONLY. */
+
+  CMPR_SLOT *map;               /* Pages, indexed by page number. */
+  db_pgno_t npages;             /* Pages in the map. */
+  db_pgno_t nalloc;             /* Slots allocated in the map. */
+  int dirty;                    /* The map changed since it was written. */
+
+  u_int32_t end;                /* Where the next record goes. */
+  u_int32_t live;               /* Units used by the current records. */
+  int compacting;               /* Being copied into a new extent. */
+};
+
 /*
  * CMPR_CONTEXT --
  *  Shared compresssion information.
@@ -82,6 +154,7 @@ struct __cmpr_context
 {
 #define DB_CMPR_SUFFIX  "_weakcmpr"
   DB *weakcmpr;                 /* Free weakcmpr pages pool. */
+  CMPR_EXTENT *extent;          /* Packed layout: the extent. */
 };
 
 /*
@@ -99,13 +172,14 @@ struct __db_mpoolfile
 
   /*
    * !!!
-   * This field is a special case -- it's protected by the region lock
-   * NOT the thread lock.  The reason for this is that we always have
-   * the region lock immediately before or after we modify the field,
-   * and we don't want to use the structure lock to protect it because
-   * then I/O (which is done with the structure lock held because of
-   * the race between the seek and write of the file descriptor) will
-   * block any other put/get calls using this DB_MPOOLFILE structure.
+   * This field is a special case -- it's updated with the MP_ATOMIC_INC
+   * and MP_ATOMIC_DEC macros, NOT under the thread lock.  Gets and puts
+   * on different pages hold different cache locks, so no single lock
+   * covers every modification, and we don't want to use the structure
+   * lock to protect it because then I/O (which is done with the
+   * structure lock held because of the race between the seek and write
+   * of the file descriptor) will block any other put/get calls using
+   * this DB_MPOOLFILE structure.
    */
   u_int32_t pinref;             /* Pinned block reference count. */
 
@@ -128,18 +202,73 @@ struct __db_mpoolfile
 #define  MP_UPGRADE  0x02       /* File descriptor is readwrite. */
 #define  MP_UPGRADE_FAIL  0x04  /* Upgrade wasn't possible. */
 #define  MP_CMPR    0x08        /* Transparent I/O compression. */
+#define  MP_SNAPSHOT  0x10      /* Read-only snapshot, see CDB_memp_fget. */
   u_int32_t flags;
 
+  /*
+   * !!!
+   * In a read-only snapshot, the internal and meta-data pages every
+   * lookup goes through are published here, indexed by page number, and
+   * stay pinned until the handle is closed.  Threads read the directory
+   * without any lock and pin the pages they find with MP_ATOMIC_INC.
+   * Entries are only set, under the lock of the cache holding the page.
+   */
+  BH *volatile *snap;           /* Pinned pages, by page number. */
+  db_pgno_t snap_npages;        /* Pages in the directory. */
+
   CMPR_CONTEXT cmpr_context;    /* Shared compression information */
 
 };
 
+/*
+ * MP_ATOMIC_INC, MP_ATOMIC_DEC --
+ *  Adjust a counter that is shared by threads holding different cache
+ *  locks.  Fall back to plain arithmetic where we don't know how to do
+ *  it atomically; such builds are not expected to share handles among
+ *  threads anyway.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define  MP_ATOMIC_INC(v)  ((void)__sync_add_and_fetch(&(v), 1))
+#define  MP_ATOMIC_DEC(v)  ((void)__sync_sub_and_fetch(&(v), 1))
+#elif defined(_WIN32)
+#define  MP_ATOMIC_INC(v)  ((void)(sizeof(v) == 2 ?        \
+    InterlockedIncrement16((SHORT volatile *)&(v)) :      \
+    InterlockedIncrement((LONG volatile *)&(v))))
+#define  MP_ATOMIC_DEC(v)  ((void)(sizeof(v) == 2 ?        \
+    InterlockedDecrement16((SHORT volatile *)&(v)) :      \
+    InterlockedDecrement((LONG volatile *)&(v))))
+#else
+#define  MP_ATOMIC_INC(v)  ((void)++(v))
+#define  MP_ATOMIC_DEC(v)  ((void)--(v))
+#endif
+
+/*
+ * MP_PUBLISH --
+ *  Store a pointer that other threads read without a lock, once what it
+ *  points to is complete.
+ */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define  MP_PUBLISH(p, v)  do { __sync_synchronize(); (p) = (v); } while (0)
+#elif defined(_WIN32)
+#define  MP_PUBLISH(p, v)  do { MemoryBarrier(); (p) = (v); } while (0)
+#else
+#define  MP_PUBLISH(p, v)  ((p) = (v))
+#endif
+
 /*
  * NCACHE --
  *  Select a cache based on the page number.  This assumes accesses are
  *  uniform across pages, which is probably OK -- what we really want to
  *  avoid is anything that puts all the pages for any single file in the
  *  same cache, as we expect that file access will be bursty.
+ *
+ *  Each cache is its own region with its own lock, which protects the
+ *  cache's hash table, its LRU list, its statistics and the buffer
+ *  headers it holds.  The main region lock protects the MPOOL and the
+ *  MPOOLFILE structures.  A thread may acquire the main region lock
+ *  while holding a cache lock, never the other way around, and only
+ *  CDB_memp_sync holds more than one cache lock at a time, taking them
+ *  in increasing order.
  */
 #define  NCACHE(mp, pgno)            \
   ((pgno) % ((MPOOL *)mp)->nc_reg)
@@ -185,6 +314,8 @@ struct __mpool
 #define  MP_LSN_RETRY  0x01     /* Retry all BH_WRITE buffers. */
   u_int32_t flags;
 
+  u_int32_t mp_policy;          /* Buffer replacement policy. */
+
   /* HACK!! */
   /* a pointers allocated for this structure is (erroneously?) used */
   /* in CDB___memp_alloc() to refer to a MCACHE structure.  Make sure */
@@ -205,6 +336,21 @@ struct __mcache
 {
   SH_TAILQ_HEAD (__bhq) bhq;    /* LRU list of buffer headers. */
 
+  /*
+   * With the DB_MPOOL_2Q policy, a page read into the cache is first put
+   * on a FIFO probation list, and only moves to the LRU list when it is
+   * referenced again after at least one other page has been read into
+   * this cache.  Repeated gets of the same page by a single operation
+   * therefore don't count, and a scan that touches each page once can
+   * only evict other probation pages, as long as the probation list is
+   * above its target size.  With DB_MPOOL_LRU the list is always empty.
+   */
+  struct __bhq bhq_in;          /* Probation FIFO of buffer headers. */
+  u_int32_t in_cnt;             /* Buffers on the probation list. */
+  u_int32_t bh_cnt;             /* Buffers in the cache. */
+  u_int32_t clock;              /* Buffers read into the cache. */
+  u_int32_t snap_cnt;           /* Buffers pinned by snapshots. */
+
   int htab_buckets;             /* Number of hash table entries. */
   roff_t htab;                  /* Hash table offset. */
 
@@ -250,6 +396,50 @@ struct __mpoolfile
 #define  BH_TO_CACHE(dbmp, bhp)            \
   (dbmp)->c_reginfo[NCACHE((dbmp)->reginfo.primary, (bhp)->pgno)].primary
 
+/*
+ * MP_2Q_TARGET --
+ *  The number of buffers the probation list may hold before its pages are
+ *  evicted in preference to the ones on the LRU list.
+ */
+#define  MP_2Q_TARGET(mc)  ((mc)->bh_cnt / 4)
+
+/*
+ * MP_SNAP_TARGET --
+ *  The number of buffers read-only snapshots may keep pinned in a cache,
+ *  so that other pages can still be read into it.
+ */
+#define  MP_SNAP_TARGET(mc)  ((mc)->bh_cnt / 4)
+
+/*
+ * BH_TO_QUEUE --
+ *  Return the list of the cache that holds the specified buffer header.
+ */
+#define  BH_TO_QUEUE(mc, bhp)            \
+  (F_ISSET(bhp, BH_PROBATION) ? &(mc)->bhq_in : &(mc)->bhq)
+
+/*
+ * MC_FIRST, MC_NEXT --
+ *  Walk every buffer header of a cache: the LRU list, then the probation
+ *  list.  The lists must not change during the walk.
+ */
+#define  MC_FIRST(mc)              \
+  (SH_TAILQ_FIRST(&(mc)->bhq, __bh) != NULL ?        \
+      SH_TAILQ_FIRST(&(mc)->bhq, __bh) :          \
+      SH_TAILQ_FIRST(&(mc)->bhq_in, __bh))
+#define  MC_NEXT(mc, bhp)            \
+  (SH_TAILQ_NEXT(bhp, q, __bh) != NULL ?          \
+      SH_TAILQ_NEXT(bhp, q, __bh) :            \
+      F_ISSET(bhp, BH_PROBATION) ? NULL :          \
+      SH_TAILQ_FIRST(&(mc)->bhq_in, __bh))
+
+/*
+ * BH_TO_REGINFO --
+ *  Return the region, and so the lock, of the cache holding the
+ *  specified buffer header.
+ */
+#define  BH_TO_REGINFO(dbmp, bhp)          \
+  (&(dbmp)->c_reginfo[NCACHE((dbmp)->reginfo.primary, (bhp)->pgno)])
+
 /*
  * DB_CMPR --
  *      Page compression information
@@ -303,6 +493,12 @@ struct __bh
 {
   MUTEX mutex;                  /* Buffer thread/process lock. */
 
+  /*
+   * !!!
+   * Once BH_SNAP is set, threads pin and unpin the buffer without the
+   * cache lock, so the reference count is only changed with the
+   * MP_ATOMIC_INC and MP_ATOMIC_DEC macros, even under the lock.
+   */
   u_int16_t ref;                /* Reference count. */
 
 #define  BH_CALLPGIN  0x001     /* Page needs to be reworked... */
@@ -314,11 +510,24 @@ struct __bh
 #define  BH_CMPR    0x040       /* Chain contains valid data. */
 #define  BH_CMPR_POOL  0x080    /* Chain allocated in pool. */
 #define  BH_CMPR_OS  0x100      /* Chain allocate with malloc. */
+#define  BH_PROBATION  0x200    /* Page is on the probation list. */
+#define  BH_DEFLATED  0x400     /* Deflated may hold the page compressed. */
+#define  BH_SNAP    0x800       /* Pinned by a snapshot: atomic ref. */
   u_int16_t flags;
 
   db_pgno_t *chain;             /* Compression chain. */
 
-  SH_TAILQ_ENTRY q;             /* LRU queue. */
+  /*
+   * A batch of writes may compress its pages ahead of time, on several
+   * threads (see CDB___memp_cmpr_prepare).  The copy is malloc'd, like a
+   * BH_CMPR_OS chain, and is forgotten as soon as the page is handed out
+   * again.
+   */
+  u_int8_t *deflated;           /* Compressed copy of the page. */
+  u_int32_t deflated_len;       /* Length of the compressed copy. */
+
+  SH_TAILQ_ENTRY q;             /* LRU or probation queue. */
+  u_int32_t clock;              /* Cache clock when read in. */
   SH_TAILQ_ENTRY hq;            /* MPOOL hash bucket queue. */
 
   db_pgno_t pgno;               /* Underlying MPOOLFILE page number. */
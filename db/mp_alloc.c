@@ -36,10 +36,11 @@ CDB___memp_alloc (dbmp, memreg, mfp, len, offsetp, retp)
 {
   BH *bhp, *nbhp;
   MCACHE *mc;
+  struct __bhq *bhq, *first, *second;
   MPOOL *mp;
   MPOOLFILE *bh_mfp;
   size_t total;
-  int nomore, restart, ret, wrote;
+  int kicked, nomore, restart, ret, skipdirty, wrote;
   void *p;
 
   mp = dbmp->reginfo.primary;
@@ -55,7 +56,13 @@ CDB___memp_alloc (dbmp, memreg, mfp, len, offsetp, retp)
   if (mfp != NULL)
     len = (sizeof (BH) - sizeof (u_int8_t)) + mfp->stat.st_pagesize;
 
-  nomore = 0;
+  /*
+   * With a background flusher, leave the dirty buffers to it as long as
+   * there are clean ones to take, and only write them ourselves if there
+   * aren't, or if it died.
+   */
+  nomore = kicked = 0;
+  skipdirty = CDB___memp_flusher_alive (dbmp);
 alloc:if ((ret =
        CDB___db_shalloc (memreg->addr, len, MUTEX_ALIGN, &p)) == 0)
   {
@@ -72,9 +79,31 @@ alloc:if ((ret =
     return (ret);
   }
 
-retry:                         /* Find a buffer we can flush; pure LRU. */
+retry:                         /* Find a buffer we can flush. */
   restart = total = 0;
-  for (bhp = SH_TAILQ_FIRST (&mc->bhq, __bh); bhp != NULL; bhp = nbhp)
+
+  /*
+   * Pages on probation are evicted first, in FIFO order, while there are
+   * more of them than the target, and after the LRU list otherwise.  The
+   * main region isn't a cache (see the comment in MPOOL), and only has
+   * the one list.
+   */
+  first = &mc->bhq;
+  second = NULL;
+  if (memreg != &dbmp->reginfo)
+  {
+    if (mc->in_cnt > MP_2Q_TARGET (mc))
+    {
+      first = &mc->bhq_in;
+      second = &mc->bhq;
+    }
+    else
+      second = &mc->bhq_in;
+  }
+  bhq = first;
+
+walk:
+  for (bhp = SH_TAILQ_FIRST (bhq, __bh); bhp != NULL; bhp = nbhp)
   {
     nbhp = SH_TAILQ_NEXT (bhp, q, __bh);
 
@@ -88,6 +117,15 @@ retry:                         /* Find a buffer we can flush; pure LRU. */
     /* Write the page if it's dirty. */
     if (F_ISSET (bhp, BH_DIRTY))
     {
+      if (skipdirty)
+      {
+        if (!kicked)
+        {
+          CDB___memp_flusher_kick (dbmp);
+          kicked = 1;
+        }
+        continue;
+      }
       ++bhp->ref;
       if ((ret = CDB___memp_bhwrite (dbmp,
                                      bh_mfp, bhp, &restart, &wrote)) != 0)
@@ -155,6 +193,16 @@ retry:                         /* Find a buffer we can flush; pure LRU. */
     if (restart)
       goto retry;
   }
+  if (bhq == first && second != NULL)
+  {
+    bhq = second;
+    goto walk;
+  }
+  if (skipdirty)
+  {
+    skipdirty = 0;
+    goto alloc;
+  }
   nomore = 1;
   goto alloc;
 }
@@ -31,6 +31,10 @@ static const char sccsid[] = "@(#)mp_bh.c  11.5 (Sleepycat) 9/21/99";
 #include "db_page.h"
 #endif /* DEBUG */
 
+static DB_MPOOLFILE *CDB___memp_batch_hold __P ((DB_MPOOL *, MPOOLFILE *));
+static void CDB___memp_batch_release __P ((DB_MPOOL *, DB_MPOOLFILE *));
+static void CDB___memp_pgwrite_done
+__P ((DB_MPOOL *, DB_MPOOLFILE *, BH *, int));
 static int CDB___memp_upgrade __P ((DB_MPOOL *, DB_MPOOLFILE *, MPOOLFILE *));
 
 /*
@@ -142,9 +146,15 @@ CDB___memp_bhwrite (dbmp, mfp, bhp, restartp, wrotep)
    * XXX
    * There's no negative cache, so we may repeatedly try and open files
    * that we have previously tried (and failed) to open.
+   *
+   * We hold the buffer's cache lock; the open expects the main region
+   * lock as well, since it updates the MPOOLFILE.
    */
-  if (CDB___memp_fopen (dbmp, mfp, R_ADDR (&dbmp->reginfo, mfp->path_off),
-                        0, 0, mfp->stat.st_pagesize, 0, NULL, &dbmfp) != 0)
+  R_LOCK (dbmp->dbenv, &dbmp->reginfo);
+  ret = CDB___memp_fopen (dbmp, mfp, R_ADDR (&dbmp->reginfo, mfp->path_off),
+                          0, 0, mfp->stat.st_pagesize, 0, NULL, &dbmfp);
+  R_UNLOCK (dbmp->dbenv, &dbmp->reginfo);
+  if (ret != 0)
     return (0);
 
 found:ret = CDB___memp_pgwrite (dbmp, dbmfp, bhp, restartp, wrotep);
@@ -159,6 +169,192 @@ found:ret = CDB___memp_pgwrite (dbmp, dbmfp, bhp, restartp, wrotep);
   return (ret);
 }
 
+/*
+ * CDB___memp_bhwrite_batch --
+ *  Write the pages of plain files among a batch of buffers about to be
+ *  written together, through the ring DB_MPIO_URING sets up.  The pages
+ *  written are clean by the time the caller gets to them, the others are
+ *  left to CDB___memp_bhwrite, which also reports any error.  If wrotep
+ *  is not NULL, wrotep[i] is set to whether bharray[i] was written.  The
+ *  buffers are pinned by the caller, who holds no cache lock.
+ *
+ * PUBLIC: void CDB___memp_bhwrite_batch __P((DB_MPOOL *, BH **, int, int *));
+ */
+void
+CDB___memp_bhwrite_batch (dbmp, bharray, ar_cnt, wrotep)
+     DB_MPOOL *dbmp;
+     BH **bharray;
+     int ar_cnt, *wrotep;
+{
+  BH *bhp;
+  DB_ENV *dbenv;
+  DB_IO *db_io;
+  DB_LSN lsn;
+  DB_MPOOLFILE *dbmfp, **dbmfps;
+  MPOOLFILE *mfp, *last_mfp;
+  REGINFO *c_reginfo;
+  ssize_t *nw;
+  int i, n, *idx;
+
+  dbenv = dbmp->dbenv;
+  if (wrotep != NULL)
+    for (i = 0; i < ar_cnt; ++i)
+      wrotep[i] = 0;
+  if (dbmp->wring == NULL || ar_cnt < 2)
+    return;
+
+  idx = NULL;
+  dbmfps = NULL;
+  db_io = NULL;
+  nw = NULL;
+  if (CDB___os_malloc (ar_cnt * sizeof (int), NULL, &idx) != 0 ||
+      CDB___os_malloc (ar_cnt * sizeof (DB_MPOOLFILE *), NULL, &dbmfps) != 0 ||
+      CDB___os_malloc (ar_cnt * sizeof (DB_IO), NULL, &db_io) != 0 ||
+      CDB___os_malloc (ar_cnt * sizeof (ssize_t), NULL, &nw) != 0)
+    goto done;
+
+  /*
+   * List the pages that nobody else is using and that go to the file as
+   * they are: pgout functions and compression are left to the usual
+   * path.  They are locked for I/O as CDB___memp_pgwrite would.  The
+   * array is sorted by file, each file is held while its pages are.
+   */
+  last_mfp = NULL;
+  dbmfp = NULL;
+  for (n = i = 0; i < ar_cnt; ++i)
+  {
+    bhp = bharray[i];
+    mfp = R_ADDR (&dbmp->reginfo, bhp->mf_offset);
+    if (mfp != last_mfp)
+    {
+      if (dbmfp != NULL && (n == 0 || dbmfps[n - 1] != dbmfp))
+        CDB___memp_batch_release (dbmp, dbmfp);
+      last_mfp = mfp;
+      dbmfp = CDB___memp_batch_hold (dbmp, mfp);
+    }
+    if (dbmfp == NULL)
+      continue;
+
+    c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+    R_LOCK (dbenv, c_reginfo);
+    if (bhp->ref != 1 || !F_ISSET (bhp, BH_DIRTY) ||
+        F_ISSET (bhp, BH_LOCKED))
+    {
+      R_UNLOCK (dbenv, c_reginfo);
+      continue;
+    }
+    MUTEX_LOCK (&bhp->mutex, dbenv->lockfhp);
+    F_SET (bhp, BH_LOCKED);
+    R_UNLOCK (dbenv, c_reginfo);
+
+    /* Ensure the appropriate log records are on disk. */
+    if (F_ISSET (dbenv, DB_ENV_LOGGING))
+    {
+      memcpy (&lsn, bhp->buf + mfp->lsn_off, sizeof (DB_LSN));
+      if (CDB_log_flush (dbenv, &lsn) != 0)
+      {
+        MUTEX_UNLOCK (&bhp->mutex);
+        R_LOCK (dbenv, c_reginfo);
+        F_CLR (bhp, BH_LOCKED);
+        R_UNLOCK (dbenv, c_reginfo);
+        continue;
+      }
+    }
+
+    idx[n] = i;
+    dbmfps[n] = dbmfp;
+    db_io[n].fhp = &dbmfp->fh;
+    db_io[n].mutexp = dbmfp->mutexp;
+    db_io[n].pagesize = db_io[n].bytes = mfp->stat.st_pagesize;
+    db_io[n].pgno = bhp->pgno;
+    db_io[n].buf = bhp->buf;
+    nw[n] = 0;
+    ++n;
+  }
+  if (dbmfp != NULL && (n == 0 || dbmfps[n - 1] != dbmfp))
+    CDB___memp_batch_release (dbmp, dbmfp);
+  if (n == 0)
+    goto done;
+
+  (void) CDB___os_iobatch (dbmp->wring, db_io, n, DB_IO_WRITE, nw);
+
+  /* Mark the pages written clean, unlock the others. */
+  for (i = 0; i < n; ++i)
+  {
+    bhp = bharray[idx[i]];
+    c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+    if (nw[i] == (ssize_t) db_io[i].bytes)
+    {
+      CDB___memp_pgwrite_done (dbmp, dbmfps[i], bhp, 0);
+      if (wrotep != NULL)
+        wrotep[idx[i]] = 1;
+    }
+    else
+    {
+      MUTEX_UNLOCK (&bhp->mutex);
+      R_LOCK (dbenv, c_reginfo);
+      F_CLR (bhp, BH_LOCKED);
+    }
+    R_UNLOCK (dbenv, c_reginfo);
+    if (i == n - 1 || dbmfps[i + 1] != dbmfps[i])
+      CDB___memp_batch_release (dbmp, dbmfps[i]);
+  }
+
+done:
+  if (idx != NULL)
+    CDB___os_free (idx, ar_cnt * sizeof (int));
+  if (dbmfps != NULL)
+    CDB___os_free (dbmfps, ar_cnt * sizeof (DB_MPOOLFILE *));
+  if (db_io != NULL)
+    CDB___os_free (db_io, ar_cnt * sizeof (DB_IO));
+  if (nw != NULL)
+    CDB___os_free (nw, ar_cnt * sizeof (ssize_t));
+}
+
+/*
+ * CDB___memp_batch_hold --
+ *  Find this process' handle on a file whose pages can be written by
+ *  CDB___memp_bhwrite_batch, and hold it.
+ */
+static DB_MPOOLFILE *
+CDB___memp_batch_hold (dbmp, mfp)
+     DB_MPOOL *dbmp;
+     MPOOLFILE *mfp;
+{
+  DB_MPOOLFILE *dbmfp;
+
+  if (mfp->ftype != 0 || F_ISSET (mfp, MP_REMOVED | MP_TEMP))
+    return (NULL);
+
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  for (dbmfp = TAILQ_FIRST (&dbmp->dbmfq);
+       dbmfp != NULL; dbmfp = TAILQ_NEXT (dbmfp, q))
+    if (dbmfp->mfp == mfp)
+      break;
+  if (dbmfp != NULL &&
+      (F_ISSET (dbmfp, MP_CMPR) || !F_ISSET (&dbmfp->fh, DB_FH_VALID) ||
+       (F_ISSET (dbmfp, MP_READONLY) && !F_ISSET (dbmfp, MP_UPGRADE))))
+    dbmfp = NULL;
+  if (dbmfp != NULL)
+    ++dbmfp->ref;
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+  return (dbmfp);
+}
+
+/*
+ * CDB___memp_batch_release --
+ *  Release a handle held by CDB___memp_batch_hold.
+ */
+static void
+CDB___memp_batch_release (dbmp, dbmfp)
+     DB_MPOOL *dbmp;
+     DB_MPOOLFILE *dbmfp;
+{
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  --dbmfp->ref;
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+}
+
 /*
  * CDB___memp_pgread --
  *  Read a page from a file.
@@ -175,6 +371,7 @@ CDB___memp_pgread (dbmfp, bhp, can_create)
   DB_ENV *dbenv;
   DB_MPOOL *dbmp;
   MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
   size_t len, pagesize;
   ssize_t nr;
   int created, ret;
@@ -183,10 +380,11 @@ CDB___memp_pgread (dbmfp, bhp, can_create)
   dbenv = dbmp->dbenv;
   mfp = dbmfp->mfp;
   pagesize = mfp->stat.st_pagesize;
+  c_reginfo = BH_TO_REGINFO (dbmp, bhp);
 
   F_SET (bhp, BH_LOCKED | BH_TRASH);
   MUTEX_LOCK (&bhp->mutex, dbenv->lockfhp);
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  R_UNLOCK (dbenv, c_reginfo);
 
   /*
    * Temporary files may not yet have been created.  We don't create
@@ -290,9 +488,9 @@ CDB___memp_pgread (dbmfp, bhp, can_create)
   /* Call any pgin function. */
   ret = mfp->ftype == 0 ? 0 : CDB___memp_pg (dbmfp, bhp, 1);
 
-  /* Unlock the buffer and reacquire the region lock. */
+  /* Unlock the buffer and reacquire the cache lock. */
 err:MUTEX_UNLOCK (&bhp->mutex);
-  R_LOCK (dbenv, &dbmp->reginfo);
+  R_LOCK (dbenv, c_reginfo);
 
   /*
    * If no errors occurred, the data is now valid, clear the BH_TRASH
@@ -330,16 +528,15 @@ CDB___memp_pgwrite (dbmp, dbmfp, bhp, restartp, wrotep)
   DB_ENV *dbenv;
   DB_IO db_io;
   DB_LSN lsn;
-  MCACHE *mc;
-  MPOOL *mp;
   MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
   ssize_t nw;
-  int callpgin, dosync, ret, syncfail;
+  int callpgin, ret;
   const char *fail;
 
   dbenv = dbmp->dbenv;
-  mp = dbmp->reginfo.primary;
   mfp = dbmfp == NULL ? NULL : dbmfp->mfp;
+  c_reginfo = BH_TO_REGINFO (dbmp, bhp);
 
   if (restartp != NULL)
     *restartp = 0;
@@ -375,7 +572,7 @@ CDB___memp_pgwrite (dbmp, dbmfp, bhp, restartp, wrotep)
   }
 
   F_SET (bhp, BH_LOCKED);
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  R_UNLOCK (dbenv, c_reginfo);
 
   if (restartp != NULL)
     *restartp = 1;
@@ -487,10 +684,61 @@ file_removed:
    * Once we pass this point, dbmfp and mfp may be NULL, we may not have
    * a valid file reference.
    *
-   * Unlock the buffer and reacquire the region lock.
+   * Unlock the buffer and reacquire the cache lock.
    */
+  CDB___memp_pgwrite_done (dbmp, dbmfp, bhp, callpgin);
+
+  if (wrotep != NULL)
+    *wrotep = 1;
+
+  return (0);
+
+syserr:CDB___db_err (dbenv, "%s: %s failed for page %lu",
+                CDB___memp_fn (dbmfp), fail, (u_long) bhp->pgno);
+
+err:                           /* Unlock the buffer and reacquire the cache lock. */
   MUTEX_UNLOCK (&bhp->mutex);
-  R_LOCK (dbenv, &dbmp->reginfo);
+  R_LOCK (dbenv, c_reginfo);
+
+  /*
+   * Clean up the flags based on a failure.
+   *
+   * The page remains dirty but we remove our lock.  If we rewrote the
+   * page, it will need processing by the pgin routine before reuse.
+   */
+  if (callpgin)
+    F_SET (bhp, BH_CALLPGIN);
+  F_CLR (bhp, BH_LOCKED);
+
+  return (ret);
+}
+
+/*
+ * CDB___memp_pgwrite_done --
+ *  Finish the write of a page: unlock the buffer, reacquire the cache
+ *  lock and account for the buffer being clean.
+ */
+static void
+CDB___memp_pgwrite_done (dbmp, dbmfp, bhp, callpgin)
+     DB_MPOOL *dbmp;
+     DB_MPOOLFILE *dbmfp;
+     BH *bhp;
+     int callpgin;
+{
+  DB_ENV *dbenv;
+  MCACHE *mc;
+  MPOOL *mp;
+  MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
+  int dosync, syncfail;
+
+  dbenv = dbmp->dbenv;
+  mp = dbmp->reginfo.primary;
+  mfp = dbmfp == NULL ? NULL : dbmfp->mfp;
+  c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+
+  MUTEX_UNLOCK (&bhp->mutex);
+  R_LOCK (dbenv, c_reginfo);
 
   /*
    * Clean up the flags based on a successful write.
@@ -506,16 +754,18 @@ file_removed:
    * If we write a buffer for which a checkpoint is waiting, update
    * the count of pending buffers (both in the mpool as a whole and
    * for this file).  If the count for this file goes to zero, set a
-   * flag so we flush the writes.
+   * flag so we flush the writes.  The counts are in the main region.
    */
   dosync = 0;
   if (F_ISSET (bhp, BH_WRITE))
   {
     F_CLR (bhp, BH_WRITE);
 
+    R_LOCK (dbenv, &dbmp->reginfo);
     --mp->lsn_cnt;
     if (mfp != NULL)
       dosync = --mfp->lsn_cnt == 0 ? 1 : 0;
+    R_UNLOCK (dbenv, &dbmp->reginfo);
   }
 
   /* Update the page clean/dirty statistics. */
@@ -532,7 +782,7 @@ file_removed:
    * checkpoint doesn't see inconsistent information.
    *
    * XXX:
-   * Don't lock the region around the sync, fsync(2) has no atomicity
+   * Don't lock the cache around the sync, fsync(2) has no atomicity
    * issues.
    *
    * XXX:
@@ -544,36 +794,17 @@ file_removed:
    */
   if (dosync)
   {
-    R_UNLOCK (dbenv, &dbmp->reginfo);
+    R_UNLOCK (dbenv, c_reginfo);
     syncfail = CDB___os_fsync (&dbmfp->fh) != 0;
-    R_LOCK (dbenv, &dbmp->reginfo);
+    R_LOCK (dbenv, c_reginfo);
     if (syncfail)
+    {
+      R_LOCK (dbenv, &dbmp->reginfo);
       F_SET (mp, MP_LSN_RETRY);
+      R_UNLOCK (dbenv, &dbmp->reginfo);
+    }
   }
 
-  if (wrotep != NULL)
-    *wrotep = 1;
-
-  return (0);
-
-syserr:CDB___db_err (dbenv, "%s: %s failed for page %lu",
-                CDB___memp_fn (dbmfp), fail, (u_long) bhp->pgno);
-
-err:                           /* Unlock the buffer and reacquire the region lock. */
-  MUTEX_UNLOCK (&bhp->mutex);
-  R_LOCK (dbenv, &dbmp->reginfo);
-
-  /*
-   * Clean up the flags based on a failure.
-   *
-   * The page remains dirty but we remove our lock.  If we rewrote the
-   * page, it will need processing by the pgin routine before reuse.
-   */
-  if (callpgin)
-    F_SET (bhp, BH_CALLPGIN);
-  F_CLR (bhp, BH_LOCKED);
-
-  return (ret);
 }
 
 /*
@@ -668,8 +899,11 @@ CDB___memp_bhfree (dbmp, bhp, free_mem)
   /* Delete the buffer header from the hash bucket queue. */
   SH_TAILQ_REMOVE (&dbht[n_bucket], bhp, hq, __bh);
 
-  /* Delete the buffer header from the LRU queue. */
-  SH_TAILQ_REMOVE (&mc->bhq, bhp, q, __bh);
+  /* Delete the buffer header from the LRU or probation queue. */
+  SH_TAILQ_REMOVE (BH_TO_QUEUE (mc, bhp), bhp, q, __bh);
+  if (F_ISSET (bhp, BH_PROBATION))
+    --mc->in_cnt;
+  --mc->bh_cnt;
 
   DB_ASSERT (mc->stat.st_page_clean != 0);
   --mc->stat.st_page_clean;
@@ -679,6 +913,8 @@ CDB___memp_bhfree (dbmp, bhp, free_mem)
    * and data for real.
    */
   CDB___memp_cmpr_free_chain (dbmp, bhp);
+  if (F_ISSET (bhp, BH_DEFLATED))
+    CDB___memp_cmpr_forget (bhp);
   if (free_mem)
   {
     CDB___db_shalloc_free (dbmp->c_reginfo[n_cache].addr, bhp);
@@ -721,7 +957,9 @@ CDB___memp_upgrade (dbmp, dbmfp, mfp)
                                NULL, R_ADDR (&dbmp->reginfo, mfp->path_off),
                                0, NULL, &rpath)) != 0)
     return (ret);
-  if (CDB___os_open (rpath, 0, 0, &fh) != 0)
+  if (CDB___os_open (rpath,
+                     dbmp->dbenv->mp_io & DB_MPIO_DIRECT ? DB_OSO_DIRECT : 0,
+                     0, &fh) != 0)
   {
     F_SET (dbmfp, MP_UPGRADE_FAIL);
     ret = 1;
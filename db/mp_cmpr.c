@@ -101,6 +101,18 @@ static int memp_cmpr_zlib_level = -1;
  */
 static int CDB___memp_cmpr_page
 __P ((DB_MPOOLFILE *, CMPR *, DB_IO *, ssize_t *));
+static void CDB___memp_cmpr_zlib_init __P ((DB_CMPR_INFO *));
+static int CDB___memp_cmpr_compress
+__P ((DB_ENV *, u_int8_t *, int, u_int8_t **, int *));
+static int CDB___memp_cmpr_take
+__P ((DB_ENV *, BH *, u_int8_t *, int, u_int8_t **, int *));
+static int CDB___memp_cmpr_read_packed
+__P ((DB_MPOOLFILE *, DB_IO *, ssize_t *));
+static int CDB___memp_cmpr_write_packed
+__P ((DB_MPOOLFILE *, BH *, DB_IO *, ssize_t *));
+static int CDB___memp_cmpr_extent_open
+__P ((DB_ENV *, const char *, int, int, int, CMPR_EXTENT **));
+static int CDB___memp_cmpr_extent_close __P ((DB_ENV *, CMPR_EXTENT *));
 
 /*
  * Maximum chain length
@@ -160,14 +172,7 @@ CDB___memp_cmpr (dbmfp, bhp, db_io, flag, niop)
   db_io->pagesize = CMPR_DIVIDE (db_io->pagesize);
   db_io->bytes = CMPR_DIVIDE (db_io->bytes);
 
-#ifdef HAVE_LIBZ
-  if (memp_cmpr_zlib_level == -1)
-  {
-    memp_cmpr_zlib_level = cmpr_info->zlib_flags;
-    if (memp_cmpr_zlib_level == -1)
-      memp_cmpr_zlib_level = Z_DEFAULT_COMPRESSION;
-  }
-#endif
+  CDB___memp_cmpr_zlib_init (cmpr_info);
 
   /*
    * Page 0 is a special case. It contains the metadata information (at most 512 bytes)
@@ -181,6 +186,8 @@ CDB___memp_cmpr (dbmfp, bhp, db_io, flag, niop)
       ret = CDB___os_io (db_io, DB_IO_READ, niop);
       *niop = CMPR_MULTIPLY (*niop);
     }
+    else if (dbmfp->cmpr_context.extent != NULL)
+      ret = CDB___memp_cmpr_read_packed (dbmfp, db_io, niop);
     else
       ret = CDB___memp_cmpr_read (dbmfp, bhp, db_io, niop);
     break;
@@ -191,7 +198,15 @@ CDB___memp_cmpr (dbmfp, bhp, db_io, flag, niop)
       *niop = CMPR_MULTIPLY (*niop);
     }
     else
-      ret = CDB___memp_cmpr_write (dbmfp, bhp, db_io, niop);
+    {
+      /* The weak compression database may be shared with the flusher. */
+      CDB___memp_flusher_lock (dbmfp->dbmp);
+      if (dbmfp->cmpr_context.extent != NULL)
+        ret = CDB___memp_cmpr_write_packed (dbmfp, bhp, db_io, niop);
+      else
+        ret = CDB___memp_cmpr_write (dbmfp, bhp, db_io, niop);
+      CDB___memp_flusher_unlock (dbmfp->dbmp);
+    }
     break;
   }
 
@@ -247,6 +262,17 @@ CDB___memp_cmpr_read (dbmfp, bhp, db_io, niop)
    */
   memcpy (&cmpr, db_io->buf, sizeof (CMPR));
 
+  /*
+   * A slot the file was extended over but that was never written, because
+   * the process went away first, reads as nothing, like a page past the
+   * end of the file.  Recovery rewrites it.
+   */
+  if (cmpr.flags == 0)
+  {
+    *niop = 0;
+    goto err;
+  }
+
   /*
    * If not at the beginning of compressed page chain, build
    * a fake page.
@@ -432,7 +458,6 @@ CDB___memp_cmpr_write (dbmfp, bhp, db_io, niop)
   unsigned int buffcmpr_length;
   u_int8_t *orig_buff = db_io->buf;
   DB_ENV *dbenv = dbmfp->dbmp->dbenv;
-  DB_CMPR_INFO *cmpr_info = dbenv->mp_cmpr_info;
 
   if ((ret =
        CDB___os_malloc (CMPR_MULTIPLY (db_io->bytes), NULL,
@@ -440,17 +465,9 @@ CDB___memp_cmpr_write (dbmfp, bhp, db_io, niop)
     goto err;
 
 
-  if (cmpr_info->zlib_flags != 0)
-    ret =
-      CDB___memp_cmpr_deflate (orig_buff, CMPR_MULTIPLY (db_io->pagesize),
-                               &buffcmpr, &buffcmpr_length,
-                               cmpr_info->user_data);
-  else
-    ret =
-      (*cmpr_info->compress) (orig_buff, CMPR_MULTIPLY (db_io->pagesize),
-                              &buffcmpr, &buffcmpr_length,
-                              cmpr_info->user_data);
-
+  ret = CDB___memp_cmpr_take (dbenv, bhp, orig_buff,
+                              CMPR_MULTIPLY (db_io->pagesize), &buffcmpr,
+                              (int *) &buffcmpr_length);
   if (ret != 0)
   {
     CDB___db_err (dbmfp->dbmp->dbenv,
@@ -583,7 +600,19 @@ CDB___memp_cmpr_write (dbmfp, bhp, db_io, niop)
     }
   }
 
-  CDB___memp_cmpr_free_chain (dbmfp->dbmp, bhp);
+  /*
+   * A chain allocated when the page was read lives in the cache, and
+   * the cache lock was let go for the write.
+   */
+  if (F_ISSET (bhp, BH_CMPR_POOL))
+  {
+    REGINFO *c_reginfo = BH_TO_REGINFO (dbmfp->dbmp, bhp);
+    R_LOCK (dbmfp->dbmp->dbenv, c_reginfo);
+    CDB___memp_cmpr_free_chain (dbmfp->dbmp, bhp);
+    R_UNLOCK (dbmfp->dbmp->dbenv, c_reginfo);
+  }
+  else
+    CDB___memp_cmpr_free_chain (dbmfp->dbmp, bhp);
 
   /*
    * In case of success, always pretend that we exactly wrote the
@@ -643,6 +672,74 @@ err:
   return ret;
 }
 
+/*
+ * CDB___memp_cmpr_zlib_init --
+ *  Set the zlib compression level from the compression information, once.
+ */
+static void
+CDB___memp_cmpr_zlib_init (cmpr_info)
+     DB_CMPR_INFO *cmpr_info;
+{
+#ifdef HAVE_LIBZ
+  if (memp_cmpr_zlib_level == -1)
+  {
+    memp_cmpr_zlib_level = cmpr_info->zlib_flags;
+    if (memp_cmpr_zlib_level == -1)
+      memp_cmpr_zlib_level = Z_DEFAULT_COMPRESSION;
+  }
+#else
+  COMPQUIET (cmpr_info, NULL);
+#endif
+}
+
+/*
+ * CDB___memp_cmpr_compress --
+ *  Compress a page with the compression function of the environment.
+ *  This function is a CDB___memp_cmpr_write helper.
+ */
+static int
+CDB___memp_cmpr_compress (dbenv, page, length, buffcmprp, buffcmpr_lengthp)
+     DB_ENV *dbenv;
+     u_int8_t *page;
+     int length;
+     u_int8_t **buffcmprp;
+     int *buffcmpr_lengthp;
+{
+  DB_CMPR_INFO *cmpr_info = dbenv->mp_cmpr_info;
+
+  if (cmpr_info->zlib_flags != 0)
+    return CDB___memp_cmpr_deflate (page, length, buffcmprp,
+                                    buffcmpr_lengthp, cmpr_info->user_data);
+  else
+    return (*cmpr_info->compress) (page, length, buffcmprp,
+                                   buffcmpr_lengthp, cmpr_info->user_data);
+}
+
+/*
+ * CDB___memp_cmpr_take --
+ *  Compress a page about to be written, unless CDB___memp_cmpr_prepare
+ *  did already and the page wasn't handed out since.
+ */
+static int
+CDB___memp_cmpr_take (dbenv, bhp, page, length, buffcmprp, buffcmpr_lengthp)
+     DB_ENV *dbenv;
+     BH *bhp;
+     u_int8_t *page;
+     int length;
+     u_int8_t **buffcmprp;
+     int *buffcmpr_lengthp;
+{
+  if (F_ISSET (bhp, BH_DEFLATED) && bhp->deflated != NULL)
+  {
+    *buffcmprp = bhp->deflated;
+    *buffcmpr_lengthp = (int) bhp->deflated_len;
+    bhp->deflated = NULL;
+    return (0);
+  }
+  return (CDB___memp_cmpr_compress (dbenv, page, length, buffcmprp,
+                                    buffcmpr_lengthp));
+}
+
 /*
  * CDB___memp_cmpr_inflate --
  *  Decompress buffer
@@ -879,26 +976,42 @@ CDB___memp_cmpr_coefficient (dbenv)
 
 /*
  * CDB___memp_cmpr_open --
- *  Open the db that contains the free compression pages.
+ *  Open the extent of a packed file, or the db that contains the free
+ *  compression pages of a chained one.  The file, path, is at rpath and
+ *  is empty if created is set.
  *
- * PUBLIC: int CDB___memp_cmpr_open __P((const char *, DB_ENV *, CMPR_CONTEXT *));
+ * PUBLIC: int CDB___memp_cmpr_open __P((DB_ENV *, const char *,
+ * PUBLIC:    const char *, int, int, int, CMPR_CONTEXT *));
  */
 int
-CDB___memp_cmpr_open (dbenv, path, flags, mode, cmpr_context)
+CDB___memp_cmpr_open (dbenv, path, rpath, flags, mode, created, cmpr_context)
      DB_ENV *dbenv;
      const char *path;
+     const char *rpath;
      int flags;
      int mode;
+     int created;
      CMPR_CONTEXT *cmpr_context;
 {
   int ret;
   char *tmp = 0;
   int tmp_length = strlen (path) + strlen (DB_CMPR_SUFFIX) + 1;
 
+  /*
+   * Packed files are the ones that have an extent.  A new file gets one if
+   * the environment asks for it, an extent left over by a file that was
+   * since truncated or removed is discarded.
+   */
+  if ((ret = CDB___memp_cmpr_extent_open (dbenv, rpath, flags, mode,
+                                          created,
+                                          &cmpr_context->extent)) != 0)
+    goto err;
+
   /*
    * Management of pages containing data when the compression does not achieve
    * the expected compression ratio.
    */
+  if (cmpr_context->extent == NULL)
   {
     DB *dbp;
     if ((ret = CDB___os_malloc (tmp_length, NULL, &tmp)) != 0)
@@ -949,30 +1062,92 @@ err:
 
 /*
  * CDB___memp_cmpr_close --
- *  Close the db that contains the free compression pages.
+ *  Close the extent or the db that contains the free compression pages.
  *
- * PUBLIC: int CDB___memp_cmpr_close __P((CMPR_CONTEXT *));
+ * PUBLIC: int CDB___memp_cmpr_close __P((DB_ENV *, CMPR_CONTEXT *));
  */
 int
-CDB___memp_cmpr_close (cmpr_context)
+CDB___memp_cmpr_close (dbenv, cmpr_context)
+     DB_ENV *dbenv;
      CMPR_CONTEXT *cmpr_context;
 {
   int ret = 0;
 
-  if (cmpr_context->weakcmpr == 0)
+  if (cmpr_context->extent != NULL)
+  {
+    ret = CDB___memp_cmpr_extent_close (dbenv, cmpr_context->extent);
+    cmpr_context->extent = NULL;
+  }
+  else if (cmpr_context->weakcmpr == 0)
   {
     ret = EINVAL;
     goto err;
   }
-
-  if ((ret = cmpr_context->weakcmpr->close (cmpr_context->weakcmpr, 0)) != 0)
-    goto err;
-  cmpr_context->weakcmpr = 0;
+  else
+  {
+    if ((ret =
+         cmpr_context->weakcmpr->close (cmpr_context->weakcmpr, 0)) != 0)
+      goto err;
+    cmpr_context->weakcmpr = 0;
+  }
 
 err:
   return ret;
 }
 
+/*
+ * CDB___memp_cmpr_recover --
+ *  Set DB_COMPRESS in *flagsp if the file name, referenced in the log, is
+ *  compressed: recovery must open it the way it was written.  The free
+ *  pages of a chained file were saved whenever the process got to it and
+ *  may be in use by now, so they are forgotten: the pages are lost, not
+ *  used twice.  The extent of a packed file is rebuilt from its records
+ *  when it is opened, see CDB___memp_cmpr_extent_load.
+ *
+ * PUBLIC: int CDB___memp_cmpr_recover __P((DB_ENV *, const char *,
+ * PUBLIC:    u_int32_t *));
+ */
+int
+CDB___memp_cmpr_recover (dbenv, name, flagsp)
+     DB_ENV *dbenv;
+     const char *name;
+     u_int32_t *flagsp;
+{
+  char *rpath, *path;
+  size_t length;
+  int ret;
+
+  if ((ret = CDB___db_appname (dbenv,
+                               DB_APP_DATA, NULL, name, 0, NULL,
+                               &rpath)) != 0)
+    return (ret);
+  length = strlen (rpath) + strlen (name) +
+    strlen (DB_CMPR_EXTENT_SUFFIX) + strlen (DB_CMPR_SUFFIX) + 1;
+  if ((ret = CDB___os_malloc (length, NULL, &path)) != 0)
+  {
+    CDB___os_freestr (rpath);
+    return (ret);
+  }
+
+  sprintf (path, "%s%s", rpath, DB_CMPR_EXTENT_SUFFIX);
+  if (CDB___os_exists (path, NULL) == 0)
+    *flagsp |= DB_COMPRESS;
+  else
+  {
+    /* The free pages db is named after path, see CDB___memp_cmpr_open. */
+    sprintf (path, "%s%s", name, DB_CMPR_SUFFIX);
+    if (CDB___os_exists (path, NULL) == 0)
+    {
+      *flagsp |= DB_COMPRESS;
+      (void) CDB___os_unlink (path);
+    }
+  }
+
+  CDB___os_free (path, length);
+  CDB___os_freestr (rpath);
+  return (0);
+}
+
 /*
  * CDB___memp_cmpr_alloc --
  *  Get a new free page to store weak compression data.
@@ -1195,11 +1370,17 @@ CDB___memp_cmpr_alloc_chain (dbmp, bhp, alloc_type)
     {
     case BH_CMPR_POOL:
       {
-        MPOOL *mp = dbmp->reginfo.primary;
-        int n_cache = NCACHE (mp, bhp->pgno);
+        /*
+         * We're called while the page is being read, without
+         * the cache lock; the buffer is locked and pinned, so
+         * it can't go away while we wait for the lock.
+         */
+        REGINFO *c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+        R_LOCK (dbenv, c_reginfo);
         alloc_ret =
-          CDB___memp_alloc (dbmp, &dbmp->c_reginfo[n_cache], NULL,
+          CDB___memp_alloc (dbmp, c_reginfo, NULL,
                             alloc_length, NULL, (void *) (&bhp->chain));
+        R_UNLOCK (dbenv, c_reginfo);
         F_SET (bhp, BH_CMPR_POOL);
       }
       break;
@@ -1306,3 +1487,1111 @@ CDB___memp_cmpr_free_chain (dbmp, bhp)
 
   return 0;
 }
+
+/*
+ * CDB___memp_cmpr_forget --
+ *  Forget the compressed copy of a page, which is about to change.  The
+ *  buffer's cache is locked.
+ *
+ * PUBLIC: void CDB___memp_cmpr_forget __P((BH *));
+ */
+void
+CDB___memp_cmpr_forget (bhp)
+     BH *bhp;
+{
+  if (bhp->deflated != NULL)
+  {
+    CDB___os_free (bhp->deflated, 0);
+    bhp->deflated = NULL;
+  }
+  F_CLR (bhp, BH_DEFLATED);
+}
+
+#ifdef HAVE_MUTEX_PTHREADS
+/*
+ * CMPR_JOB, CMPR_BATCH --
+ *  The pages compressed ahead of time by CDB___memp_cmpr_prepare, and the
+ *  state its threads share.
+ */
+typedef struct __cmpr_job
+{
+  BH *bhp;                      /* Buffer to compress. */
+  int pagesize;                 /* Size of its page. */
+  u_int8_t *buff;               /* Compressed copy. */
+  int length;                   /* Length of the compressed copy. */
+  int ret;                      /* Compression error. */
+} CMPR_JOB;
+
+typedef struct __cmpr_batch
+{
+  DB_ENV *dbenv;
+  CMPR_JOB *jobs;
+  int njobs;
+  int next;                     /* Next job to take. */
+  pthread_mutex_t mutex;        /* Protects next. */
+} CMPR_BATCH;
+
+static void *CDB___memp_cmpr_worker __P ((void *));
+static int CDB___memp_cmpr_file __P ((DB_MPOOL *, MPOOLFILE *));
+#endif /* HAVE_MUTEX_PTHREADS */
+
+/*
+ * CDB___memp_cmpr_prepare --
+ *  Compress the pages of compressed files among a batch of buffers about
+ *  to be written, on DB_ENV->mp_cmpr_threads threads.  Each page keeps
+ *  its compressed copy until it is written, unless it is handed out again
+ *  in the meantime.  The buffers are pinned by the caller, who holds no
+ *  cache lock.
+ *
+ * The copies are malloc'd and so only make sense to this process: nothing
+ * is done unless the environment is private.
+ *
+ * PUBLIC: void CDB___memp_cmpr_prepare __P((DB_MPOOL *, BH **, int));
+ */
+void
+CDB___memp_cmpr_prepare (dbmp, bharray, ar_cnt)
+     DB_MPOOL *dbmp;
+     BH **bharray;
+     int ar_cnt;
+{
+#ifdef HAVE_MUTEX_PTHREADS
+  BH *bhp;
+  CMPR_BATCH batch;
+  CMPR_JOB *job;
+  DB_ENV *dbenv;
+  MPOOLFILE *mfp, *last_mfp;
+  REGINFO *c_reginfo;
+  pthread_t *threads;
+  int cmpr, i, nthreads;
+
+  dbenv = dbmp->dbenv;
+  if (dbenv->mp_cmpr_threads < 2 || ar_cnt < 2 ||
+      !F_ISSET (dbenv, DB_ENV_PRIVATE))
+    return;
+
+  if (CDB___os_malloc (ar_cnt * sizeof (CMPR_JOB), NULL, &batch.jobs) != 0)
+    return;
+  batch.dbenv = dbenv;
+  batch.njobs = batch.next = 0;
+
+  /*
+   * List the pages that will go through CDB___memp_cmpr_write unchanged
+   * (page 0 isn't compressed, pgout functions would change the page
+   * first) and that nobody else is using.  They are locked as for I/O
+   * while they are compressed, compression may clear their free space.
+   */
+  last_mfp = NULL;
+  cmpr = 0;
+  for (i = 0; i < ar_cnt; ++i)
+  {
+    bhp = bharray[i];
+    mfp = R_ADDR (&dbmp->reginfo, bhp->mf_offset);
+    if (mfp != last_mfp)
+    {
+      last_mfp = mfp;
+      cmpr = mfp->ftype == 0 && CDB___memp_cmpr_file (dbmp, mfp);
+    }
+    if (!cmpr || bhp->pgno == 0)
+      continue;
+
+    c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+    R_LOCK (dbenv, c_reginfo);
+    if (bhp->ref == 1 && F_ISSET (bhp, BH_DIRTY) &&
+        !F_ISSET (bhp, BH_LOCKED) && bhp->deflated == NULL)
+    {
+      F_SET (bhp, BH_DEFLATED | BH_LOCKED);
+      MUTEX_LOCK (&bhp->mutex, dbenv->lockfhp);
+      job = &batch.jobs[batch.njobs++];
+      job->bhp = bhp;
+      job->pagesize = mfp->stat.st_pagesize;
+      job->buff = NULL;
+    }
+    R_UNLOCK (dbenv, c_reginfo);
+  }
+  if (batch.njobs == 0)
+    goto done;
+
+  /* This thread is one of the workers. */
+  CDB___memp_cmpr_zlib_init (dbenv->mp_cmpr_info);
+  nthreads = dbenv->mp_cmpr_threads;
+  if (nthreads > batch.njobs)
+    nthreads = batch.njobs;
+  threads = NULL;
+  if (pthread_mutex_init (&batch.mutex, NULL) != 0)
+    nthreads = 0;
+  else if (nthreads > 1 &&
+           CDB___os_malloc ((nthreads - 1) * sizeof (pthread_t), NULL,
+                            &threads) != 0)
+    nthreads = 1;
+  for (i = 0; i < nthreads - 1; ++i)
+    if (pthread_create (&threads[i], NULL, CDB___memp_cmpr_worker,
+                        &batch) != 0)
+      break;
+  if (nthreads > 0)
+  {
+    nthreads = i;
+    (void) CDB___memp_cmpr_worker (&batch);
+    for (i = 0; i < nthreads; ++i)
+      (void) pthread_join (threads[i], NULL);
+    (void) pthread_mutex_destroy (&batch.mutex);
+  }
+  else
+    for (i = 0; i < batch.njobs; ++i)
+      batch.jobs[i].ret = ENOMEM;
+  if (threads != NULL)
+    CDB___os_free (threads, 0);
+
+  /*
+   * Unlock the pages and keep their copies.  Compression errors are left
+   * for CDB___memp_cmpr_write to report.
+   */
+  for (i = 0; i < batch.njobs; ++i)
+  {
+    job = &batch.jobs[i];
+    bhp = job->bhp;
+    c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+    R_LOCK (dbenv, c_reginfo);
+    if (job->ret == 0)
+    {
+      bhp->deflated = job->buff;
+      bhp->deflated_len = job->length;
+    }
+    else
+    {
+      F_CLR (bhp, BH_DEFLATED);
+      if (job->buff != NULL)
+        CDB___os_free (job->buff, 0);
+    }
+    F_CLR (bhp, BH_LOCKED);
+    MUTEX_UNLOCK (&bhp->mutex);
+    R_UNLOCK (dbenv, c_reginfo);
+  }
+
+done:
+  CDB___os_free (batch.jobs, 0);
+#else
+  COMPQUIET (dbmp, NULL);
+  COMPQUIET (bharray, NULL);
+  COMPQUIET (ar_cnt, 0);
+#endif /* HAVE_MUTEX_PTHREADS */
+}
+
+#ifdef HAVE_MUTEX_PTHREADS
+/*
+ * CDB___memp_cmpr_worker --
+ *  Compress pages of a batch until there are none left.
+ */
+static void *
+CDB___memp_cmpr_worker (arg)
+     void *arg;
+{
+  CMPR_BATCH *batch = arg;
+  CMPR_JOB *job;
+  int i;
+
+  for (;;)
+  {
+    pthread_mutex_lock (&batch->mutex);
+    i = batch->next++;
+    pthread_mutex_unlock (&batch->mutex);
+    if (i >= batch->njobs)
+      break;
+
+    job = &batch->jobs[i];
+    job->ret = CDB___memp_cmpr_compress (batch->dbenv, job->bhp->buf,
+                                         job->pagesize, &job->buff,
+                                         &job->length);
+  }
+
+  return (NULL);
+}
+
+/*
+ * CDB___memp_cmpr_file --
+ *  Return if the file's pages are written compressed by this process.
+ */
+static int
+CDB___memp_cmpr_file (dbmp, mfp)
+     DB_MPOOL *dbmp;
+     MPOOLFILE *mfp;
+{
+  DB_MPOOLFILE *dbmfp;
+  int cmpr;
+
+  cmpr = 0;
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  for (dbmfp = TAILQ_FIRST (&dbmp->dbmfq);
+       dbmfp != NULL; dbmfp = TAILQ_NEXT (dbmfp, q))
+    if (dbmfp->mfp == mfp)
+    {
+      cmpr = F_ISSET (dbmfp, MP_CMPR) ? 1 : 0;
+      break;
+    }
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+
+  return (cmpr);
+}
+#endif /* HAVE_MUTEX_PTHREADS */
+
+/*
+ * Packed layout
+ *
+ * A packed file only holds page 0, the other pages are appended to its
+ * extent, the file named after it with DB_CMPR_EXTENT_SUFFIX.  Each copy
+ * of a page is a record: a CMPR_RECORD header and the compressed page,
+ * padded to DB_CMPR_ALIGN bytes.  Pages take no more room than they
+ * compress to, there are no chains, and reading a page is a single read
+ * since the map of the extent (the CMPR_SLOT of each page) is in memory.
+ *
+ * The map is written when the file is synced or closed: a record of page
+ * 0 holding the slots, followed by a trailer (another record of page 0)
+ * pointing to it.  The next record written overwrites the trailer.  When
+ * the file is opened, the map is read back from the trailer at the end of
+ * the extent or, if there is none because the process didn't close the
+ * file, rebuilt by reading the records from the start.
+ *
+ * The previous copies of the pages stay in the extent until it is
+ * compacted, which happens once they take more room than the current
+ * ones: the current records are copied, in page order, into a new extent
+ * that replaces the old one.  The file is compacted when it is synced or
+ * closed and, if there is one, by the background flusher of the memory
+ * pool (see mp_trickle.c).  Pages go on being read and written while the
+ * records are copied: those written meanwhile are copied last.
+ *
+ * The extent is private to the DB_MPOOLFILE: a packed file must not be
+ * written by two processes at the same time.  Its mutex protects the map,
+ * the file handle and the offsets.
+ */
+typedef struct __cmpr_record
+{
+  u_int32_t pgno;               /* Page number, 0 for the map. */
+  u_int32_t length;             /* Length of the data that follows. */
+} CMPR_RECORD;
+
+typedef struct __cmpr_trailer
+{
+  CMPR_RECORD hdr;              /* Page 0, 8 bytes. */
+  u_int32_t magic;              /* CMPR_EXTENT_MAGIC. */
+  u_int32_t map;                /* Offset of the map record. */
+} CMPR_TRAILER;
+
+#define CMPR_EXTENT_MAGIC  0x0cafe0ed
+
+/*
+ * Units of DB_CMPR_ALIGN bytes taken by a record with n bytes of data.
+ */
+#define CMPR_UNITS(n) \
+  ((u_int32_t) (sizeof (CMPR_RECORD) + (n) + DB_CMPR_ALIGN - 1) / DB_CMPR_ALIGN)
+
+/*
+ * Extents smaller than this many units are never compacted.
+ */
+#define CMPR_COMPACT_MIN  ((256 * 1024) / DB_CMPR_ALIGN)
+
+#define CMPR_COMPACTABLE(ext) \
+  ((ext)->end >= CMPR_COMPACT_MIN && (ext)->end - (ext)->live > (ext)->live)
+
+static int CDB___memp_cmpr_extent_io
+__P ((DB_FH *, u_int32_t, void *, size_t, int));
+static int CDB___memp_cmpr_extent_grow __P ((CMPR_EXTENT *, db_pgno_t));
+static void CDB___memp_cmpr_extent_set
+__P ((CMPR_EXTENT *, db_pgno_t, u_int32_t, u_int32_t));
+static int CDB___memp_cmpr_extent_save
+__P ((CMPR_EXTENT *, DB_FH *, CMPR_SLOT *, u_int32_t *));
+static int CDB___memp_cmpr_extent_load __P ((DB_ENV *, CMPR_EXTENT *));
+static int CDB___memp_cmpr_extent_scan
+__P ((DB_ENV *, CMPR_EXTENT *, u_int32_t));
+static int CDB___memp_cmpr_extent_rewrite __P ((DB_ENV *, CMPR_EXTENT *));
+static int CDB___memp_cmpr_extent_copy
+__P ((DB_ENV *, CMPR_EXTENT *, DB_FH *, db_pgno_t, CMPR_SLOT *, u_int32_t *,
+      u_int8_t **, size_t *));
+
+/*
+ * CDB___memp_cmpr_read_packed --
+ *  Read a page of a packed file.  Pages that were never written read as
+ *  nothing, like the pages past the end of a file.
+ */
+static int
+CDB___memp_cmpr_read_packed (dbmfp, db_io, niop)
+     DB_MPOOLFILE *dbmfp;
+     DB_IO *db_io;
+     ssize_t *niop;
+{
+  CMPR_EXTENT *ext;
+  CMPR_RECORD *hdr;
+  CMPR_SLOT slot;
+  DB_ENV *dbenv;
+  DB_CMPR_INFO *cmpr_info;
+  u_int8_t *buff;
+  size_t length;
+  int ret;
+
+  dbenv = dbmfp->dbmp->dbenv;
+  cmpr_info = dbenv->mp_cmpr_info;
+  ext = dbmfp->cmpr_context.extent;
+  buff = NULL;
+  length = 0;
+  *niop = 0;
+
+  MUTEX_THREAD_LOCK (ext->mutexp);
+  if (db_io->pgno >= ext->npages || ext->map[db_io->pgno].length == 0)
+  {
+    MUTEX_THREAD_UNLOCK (ext->mutexp);
+    return (0);
+  }
+  slot = ext->map[db_io->pgno];
+  length = sizeof (CMPR_RECORD) + slot.length;
+  if ((ret = CDB___os_malloc (length, NULL, &buff)) == 0)
+    ret = CDB___memp_cmpr_extent_io (&ext->fh, slot.offset, buff, length,
+                                     DB_IO_READ);
+  MUTEX_THREAD_UNLOCK (ext->mutexp);
+  if (ret != 0)
+    goto err;
+
+  hdr = (CMPR_RECORD *) buff;
+  if (hdr->pgno != db_io->pgno || hdr->length != slot.length)
+  {
+    CDB___db_err (dbenv,
+                  "CDB___memp_cmpr_read_packed: record of page %lu found at pgno = %ld",
+                  (u_long) hdr->pgno, db_io->pgno);
+    ret = CDB___db_panic (dbenv, EINVAL);
+    goto err;
+  }
+
+  if (cmpr_info->zlib_flags != 0)
+    ret =
+      CDB___memp_cmpr_inflate (buff + sizeof (CMPR_RECORD), slot.length,
+                               db_io->buf, CMPR_MULTIPLY (db_io->pagesize),
+                               cmpr_info->user_data);
+  else
+    ret =
+      (*cmpr_info->uncompress) (buff + sizeof (CMPR_RECORD), slot.length,
+                                db_io->buf, CMPR_MULTIPLY (db_io->pagesize),
+                                cmpr_info->user_data);
+  if (ret != 0)
+  {
+    CDB___db_err (dbenv,
+                  "CDB___memp_cmpr_read_packed: unable to uncompress page at pgno = %ld",
+                  db_io->pgno);
+    ret = CDB___db_panic (dbenv, ret);
+    goto err;
+  }
+
+  *niop = CMPR_MULTIPLY (db_io->pagesize);
+
+err:
+  if (buff != NULL)
+    CDB___os_free (buff, length);
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_write_packed --
+ *  Append a page of a packed file to its extent.
+ */
+static int
+CDB___memp_cmpr_write_packed (dbmfp, bhp, db_io, niop)
+     DB_MPOOLFILE *dbmfp;
+     BH *bhp;
+     DB_IO *db_io;
+     ssize_t *niop;
+{
+  CMPR_EXTENT *ext;
+  CMPR_RECORD *hdr;
+  DB_ENV *dbenv;
+  u_int8_t *buffcmpr, *record;
+  size_t length;
+  int buffcmpr_length, ret;
+
+  dbenv = dbmfp->dbmp->dbenv;
+  ext = dbmfp->cmpr_context.extent;
+  record = NULL;
+
+  if ((ret = CDB___memp_cmpr_take (dbenv, bhp, db_io->buf,
+                                   CMPR_MULTIPLY (db_io->pagesize),
+                                   &buffcmpr, &buffcmpr_length)) != 0)
+  {
+    CDB___db_err (dbenv,
+                  "CDB___memp_cmpr_write_packed: unable to compress page at pgno = %ld",
+                  db_io->pgno);
+    return (CDB___db_panic (dbenv, ret));
+  }
+
+  /*
+   * The padding is written too, so that no stale trailer is left behind
+   * a short record.
+   */
+  length = CMPR_UNITS (buffcmpr_length) * DB_CMPR_ALIGN;
+  if ((ret = CDB___os_malloc (length, NULL, &record)) != 0)
+    goto err;
+  hdr = (CMPR_RECORD *) record;
+  hdr->pgno = db_io->pgno;
+  hdr->length = buffcmpr_length;
+  memcpy (record + sizeof (CMPR_RECORD), buffcmpr, buffcmpr_length);
+  memset (record + sizeof (CMPR_RECORD) + buffcmpr_length, 0,
+          length - sizeof (CMPR_RECORD) - buffcmpr_length);
+
+  MUTEX_THREAD_LOCK (ext->mutexp);
+  if ((ret = CDB___memp_cmpr_extent_grow (ext, db_io->pgno)) == 0 &&
+      (ret = CDB___memp_cmpr_extent_io (&ext->fh, ext->end, record, length,
+                                        DB_IO_WRITE)) == 0)
+  {
+    CDB___memp_cmpr_extent_set (ext, db_io->pgno, ext->end,
+                                (u_int32_t) buffcmpr_length);
+    ext->end += length / DB_CMPR_ALIGN;
+    ext->dirty = 1;
+  }
+  MUTEX_THREAD_UNLOCK (ext->mutexp);
+  if (ret != 0)
+    goto err;
+
+#ifdef DEBUG
+  {
+    int ratio = buffcmpr_length > 0 ?
+      (CMPR_MULTIPLY (db_io->pagesize) / buffcmpr_length) : 0;
+    if (ratio > 10)
+      ratio = 10;
+    word_monitor_add (WORD_MONITOR_COMPRESS_01 + ratio, 1);
+  }
+#endif /* DEBUG */
+
+  *niop = CMPR_MULTIPLY (db_io->pagesize);
+
+err:
+  if (record != NULL)
+    CDB___os_free (record, length);
+  CDB___os_free (buffcmpr, 0);
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_sync --
+ *  Write the map of a packed file, or compact it, so that the extent can
+ *  be opened again without being scanned.
+ *
+ * PUBLIC: int CDB___memp_cmpr_sync __P((DB_MPOOLFILE *));
+ */
+int
+CDB___memp_cmpr_sync (dbmfp)
+     DB_MPOOLFILE *dbmfp;
+{
+  CMPR_EXTENT *ext;
+  int ret;
+
+  ext = dbmfp->cmpr_context.extent;
+  if (ext == NULL || ext->readonly)
+    return (0);
+
+  ret = 0;
+  MUTEX_THREAD_LOCK (ext->mutexp);
+  if (CMPR_COMPACTABLE (ext) && !ext->compacting)
+    ret = CDB___memp_cmpr_extent_rewrite (dbmfp->dbmp->dbenv, ext);
+  else if (ext->dirty)
+    ret = CDB___memp_cmpr_extent_save (ext, &ext->fh, ext->map, &ext->end);
+  MUTEX_THREAD_UNLOCK (ext->mutexp);
+
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_compactable --
+ *  Return if a packed file has more old copies of pages than current ones.
+ *  The answer is a hint: the extent isn't locked.
+ *
+ * PUBLIC: int CDB___memp_cmpr_compactable __P((DB_MPOOLFILE *));
+ */
+int
+CDB___memp_cmpr_compactable (dbmfp)
+     DB_MPOOLFILE *dbmfp;
+{
+  CMPR_EXTENT *ext;
+
+  ext = dbmfp->cmpr_context.extent;
+  return (ext != NULL && !ext->readonly && !ext->compacting &&
+          CMPR_COMPACTABLE (ext));
+}
+
+/*
+ * CDB___memp_cmpr_compact --
+ *  Compact a packed file if it has more old copies of pages than current
+ *  ones.
+ *
+ * PUBLIC: int CDB___memp_cmpr_compact __P((DB_MPOOLFILE *));
+ */
+int
+CDB___memp_cmpr_compact (dbmfp)
+     DB_MPOOLFILE *dbmfp;
+{
+  CMPR_EXTENT *ext;
+  int ret;
+
+  ext = dbmfp->cmpr_context.extent;
+  if (ext == NULL || ext->readonly)
+    return (0);
+
+  ret = 0;
+  MUTEX_THREAD_LOCK (ext->mutexp);
+  if (CMPR_COMPACTABLE (ext) && !ext->compacting)
+    ret = CDB___memp_cmpr_extent_rewrite (dbmfp->dbmp->dbenv, ext);
+  MUTEX_THREAD_UNLOCK (ext->mutexp);
+
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_extent_open --
+ *  Open the extent of the compressed file at rpath, if it is packed, see
+ *  CDB___memp_cmpr_open.  *extentp is left NULL otherwise.
+ */
+static int
+CDB___memp_cmpr_extent_open (dbenv, rpath, flags, mode, created, extentp)
+     DB_ENV *dbenv;
+     const char *rpath;
+     int flags, mode, created;
+     CMPR_EXTENT **extentp;
+{
+  CMPR_EXTENT *ext;
+  DB_MPOOL *dbmp;
+  u_int32_t oflags;
+  char *path;
+  int exists, ret;
+
+  *extentp = NULL;
+
+  if ((ret = CDB___os_malloc (strlen (rpath) +
+                              strlen (DB_CMPR_EXTENT_SUFFIX) + 1, NULL,
+                              &path)) != 0)
+    return (ret);
+  sprintf (path, "%s%s", rpath, DB_CMPR_EXTENT_SUFFIX);
+  exists = CDB___os_exists (path, NULL) == 0;
+
+  if (created)
+  {
+    if (dbenv->mp_cmpr_layout != DB_CMPR_PACKED || LF_ISSET (DB_RDONLY))
+    {
+      if (exists && !LF_ISSET (DB_RDONLY))
+        (void) CDB___os_unlink (path);
+      CDB___os_freestr (path);
+      return (0);
+    }
+    oflags = DB_OSO_CREATE | DB_OSO_TRUNC;
+  }
+  else
+  {
+    if (!exists)
+    {
+      CDB___os_freestr (path);
+      return (0);
+    }
+    oflags = LF_ISSET (DB_RDONLY) ? DB_OSO_RDONLY : 0;
+  }
+
+  if ((ret = CDB___os_calloc (1, sizeof (CMPR_EXTENT), &ext)) != 0)
+  {
+    CDB___os_freestr (path);
+    return (ret);
+  }
+  ext->path = path;
+  ext->mode = mode;
+  ext->readonly = LF_ISSET (DB_RDONLY) ? 1 : 0;
+
+  if ((ret = CDB___os_open (path, oflags, mode, &ext->fh)) != 0)
+  {
+    CDB___db_err (dbenv, "%s: %s", path, CDB_db_strerror (ret));
+    goto err;
+  }
+
+  if (F_ISSET (dbenv, DB_ENV_THREAD))
+  {
+    dbmp = dbenv->mp_handle;
+    if ((ret =
+         CDB___db_mutex_alloc (dbenv, &dbmp->reginfo, &ext->mutexp)) != 0)
+      goto err;
+    if ((ret = __db_mutex_init (dbenv, ext->mutexp, 0, MUTEX_THREAD)) != 0)
+      goto err;
+  }
+
+  /*
+   * An extent that had to be scanned may end with a partly written
+   * record: start afresh.
+   */
+  if (!created && (ret = CDB___memp_cmpr_extent_load (dbenv, ext)) != 0)
+    goto err;
+  if (ext->dirty && !ext->readonly &&
+      (ret = CDB___memp_cmpr_extent_rewrite (dbenv, ext)) != 0)
+    goto err;
+
+  *extentp = ext;
+  return (0);
+
+err:
+  ext->readonly = 1;
+  (void) CDB___memp_cmpr_extent_close (dbenv, ext);
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_extent_close --
+ *  Write the map of an extent, compacting it if need be, and close it.
+ */
+static int
+CDB___memp_cmpr_extent_close (dbenv, ext)
+     DB_ENV *dbenv;
+     CMPR_EXTENT *ext;
+{
+  DB_MPOOL *dbmp;
+  int ret, t_ret;
+
+  ret = 0;
+  if (F_ISSET (&ext->fh, DB_FH_VALID))
+  {
+    if (!ext->readonly)
+    {
+      if (CMPR_COMPACTABLE (ext))
+        ret = CDB___memp_cmpr_extent_rewrite (dbenv, ext);
+      else if (ext->dirty)
+        ret = CDB___memp_cmpr_extent_save (ext, &ext->fh, ext->map,
+                                           &ext->end);
+    }
+    if ((t_ret = CDB___os_closehandle (&ext->fh)) != 0 && ret == 0)
+      ret = t_ret;
+  }
+
+  if (ext->mutexp != NULL)
+  {
+    dbmp = dbenv->mp_handle;
+    CDB___db_mutex_free (dbenv, &dbmp->reginfo, ext->mutexp);
+  }
+  if (ext->map != NULL)
+    CDB___os_free (ext->map, ext->nalloc * sizeof (CMPR_SLOT));
+  CDB___os_freestr (ext->path);
+  CDB___os_free (ext, sizeof (CMPR_EXTENT));
+
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_extent_io --
+ *  Read or write len bytes at offset (in DB_CMPR_ALIGN units) of an
+ *  extent.  The extent is locked.
+ */
+static int
+CDB___memp_cmpr_extent_io (fhp, offset, buf, len, op)
+     DB_FH *fhp;
+     u_int32_t offset;
+     void *buf;
+     size_t len;
+     int op;
+{
+  DB_IO db_io;
+  ssize_t nio;
+  int ret;
+
+  db_io.fhp = fhp;
+  db_io.mutexp = NULL;
+  db_io.pagesize = DB_CMPR_ALIGN;
+  db_io.pgno = offset;
+  db_io.buf = buf;
+  db_io.bytes = len;
+  if ((ret = CDB___os_io (&db_io, op, &nio)) != 0)
+    return (ret);
+  return (nio == (ssize_t) len ? 0 : EIO);
+}
+
+/*
+ * CDB___memp_cmpr_extent_grow --
+ *  Make room in the map for page pgno.
+ */
+static int
+CDB___memp_cmpr_extent_grow (ext, pgno)
+     CMPR_EXTENT *ext;
+     db_pgno_t pgno;
+{
+  db_pgno_t nalloc;
+  int ret;
+
+  if (pgno < ext->nalloc)
+    return (0);
+
+  for (nalloc = ext->nalloc == 0 ? 1024 : ext->nalloc; nalloc <= pgno;)
+    nalloc *= 2;
+  if ((ret =
+       CDB___os_realloc (nalloc * sizeof (CMPR_SLOT), NULL, &ext->map)) != 0)
+    return (ret);
+  memset (ext->map + ext->nalloc, 0,
+          (nalloc - ext->nalloc) * sizeof (CMPR_SLOT));
+  ext->nalloc = nalloc;
+
+  return (0);
+}
+
+/*
+ * CDB___memp_cmpr_extent_set --
+ *  Record that the current copy of page pgno is at offset.
+ */
+static void
+CDB___memp_cmpr_extent_set (ext, pgno, offset, length)
+     CMPR_EXTENT *ext;
+     db_pgno_t pgno;
+     u_int32_t offset, length;
+{
+  CMPR_SLOT *slot;
+
+  slot = &ext->map[pgno];
+  if (slot->length != 0)
+    ext->live -= CMPR_UNITS (slot->length);
+  slot->offset = offset;
+  slot->length = length;
+  ext->live += CMPR_UNITS (length);
+  if (pgno >= ext->npages)
+    ext->npages = pgno + 1;
+}
+
+/*
+ * CDB___memp_cmpr_extent_save --
+ *  Write map, the ext->npages slots of an extent, at *endp of file fhp,
+ *  followed by the trailer.  *endp is set to the offset of the trailer.
+ */
+static int
+CDB___memp_cmpr_extent_save (ext, fhp, map, endp)
+     CMPR_EXTENT *ext;
+     DB_FH *fhp;
+     CMPR_SLOT *map;
+     u_int32_t *endp;
+{
+  CMPR_RECORD *hdr;
+  CMPR_TRAILER trailer;
+  u_int8_t *buf;
+  size_t length, maplen;
+  int ret;
+
+  maplen = ext->npages * sizeof (CMPR_SLOT);
+  length = CMPR_UNITS (maplen) * DB_CMPR_ALIGN;
+  if ((ret = CDB___os_calloc (1, length, &buf)) != 0)
+    return (ret);
+  hdr = (CMPR_RECORD *) buf;
+  hdr->pgno = 0;
+  hdr->length = maplen;
+  if (maplen != 0)
+    memcpy (buf + sizeof (CMPR_RECORD), map, maplen);
+  ret = CDB___memp_cmpr_extent_io (fhp, *endp, buf, length, DB_IO_WRITE);
+  CDB___os_free (buf, length);
+  if (ret != 0)
+    return (ret);
+
+  trailer.hdr.pgno = 0;
+  trailer.hdr.length = sizeof (CMPR_TRAILER) - sizeof (CMPR_RECORD);
+  trailer.magic = CMPR_EXTENT_MAGIC;
+  trailer.map = *endp;
+  if ((ret = CDB___memp_cmpr_extent_io (fhp, *endp + length / DB_CMPR_ALIGN,
+                                        &trailer, sizeof (CMPR_TRAILER),
+                                        DB_IO_WRITE)) != 0)
+    return (ret);
+  if ((ret = CDB___os_fsync (fhp)) != 0)
+    return (ret);
+
+  *endp += length / DB_CMPR_ALIGN;
+  if (fhp == &ext->fh)
+    ext->dirty = 0;
+  return (0);
+}
+
+/*
+ * CDB___memp_cmpr_extent_load --
+ *  Read the map of an extent back from its trailer, or rebuild it from
+ *  the records if there is no valid trailer.  ext->dirty is set in the
+ *  latter case.
+ */
+static int
+CDB___memp_cmpr_extent_load (dbenv, ext)
+     DB_ENV *dbenv;
+     CMPR_EXTENT *ext;
+{
+  CMPR_RECORD *hdr;
+  CMPR_SLOT *slot;
+  CMPR_TRAILER trailer;
+  db_pgno_t npages, pgno;
+  u_int32_t mbytes, bytes, total;
+  u_int8_t *buf;
+  size_t length;
+  int ret;
+
+  if ((ret = CDB___os_ioinfo (ext->path, &ext->fh, &mbytes, &bytes,
+                              NULL)) != 0)
+  {
+    CDB___db_err (dbenv, "%s: %s", ext->path, CDB_db_strerror (ret));
+    return (ret);
+  }
+  if (mbytes >= (u_int32_t) (0xffffffff / (MEGABYTE / DB_CMPR_ALIGN)))
+  {
+    CDB___db_err (dbenv, "%s: extent too large", ext->path);
+    return (EINVAL);
+  }
+  total = mbytes * (MEGABYTE / DB_CMPR_ALIGN) + bytes / DB_CMPR_ALIGN;
+  if (total == 0)
+    return (0);
+  if (bytes % DB_CMPR_ALIGN != 0)
+    return (CDB___memp_cmpr_extent_scan (dbenv, ext, total));
+
+  /* The trailer and the map record just before it. */
+  if (CDB___memp_cmpr_extent_io (&ext->fh, total - 1, &trailer,
+                                 sizeof (CMPR_TRAILER), DB_IO_READ) != 0 ||
+      trailer.hdr.pgno != 0 ||
+      trailer.hdr.length != sizeof (CMPR_TRAILER) - sizeof (CMPR_RECORD) ||
+      trailer.magic != CMPR_EXTENT_MAGIC || trailer.map >= total - 1)
+    return (CDB___memp_cmpr_extent_scan (dbenv, ext, total));
+
+  length = (total - 1 - trailer.map) * DB_CMPR_ALIGN;
+  if ((ret = CDB___os_malloc (length, NULL, &buf)) != 0)
+    return (ret);
+  hdr = (CMPR_RECORD *) buf;
+  if (CDB___memp_cmpr_extent_io (&ext->fh, trailer.map, buf, length,
+                                 DB_IO_READ) != 0 ||
+      hdr->pgno != 0 || hdr->length % sizeof (CMPR_SLOT) != 0 ||
+      CMPR_UNITS (hdr->length) * DB_CMPR_ALIGN != length)
+  {
+    CDB___os_free (buf, length);
+    return (CDB___memp_cmpr_extent_scan (dbenv, ext, total));
+  }
+
+  npages = hdr->length / sizeof (CMPR_SLOT);
+  if (npages != 0 &&
+      (ret = CDB___memp_cmpr_extent_grow (ext, npages - 1)) != 0)
+  {
+    CDB___os_free (buf, length);
+    return (ret);
+  }
+  slot = (CMPR_SLOT *) (buf + sizeof (CMPR_RECORD));
+  for (pgno = 1; pgno < npages; ++pgno)
+  {
+    if (slot[pgno].length == 0)
+      continue;
+    if (slot[pgno].offset + CMPR_UNITS (slot[pgno].length) > trailer.map)
+    {
+      CDB___os_free (buf, length);
+      return (CDB___memp_cmpr_extent_scan (dbenv, ext, total));
+    }
+    CDB___memp_cmpr_extent_set (ext, pgno, slot[pgno].offset,
+                                slot[pgno].length);
+  }
+  ext->npages = npages;
+  ext->end = total - 1;
+  CDB___os_free (buf, length);
+
+  return (0);
+}
+
+/*
+ * CDB___memp_cmpr_extent_scan --
+ *  Rebuild the map of an extent of total units from its records.
+ */
+static int
+CDB___memp_cmpr_extent_scan (dbenv, ext, total)
+     DB_ENV *dbenv;
+     CMPR_EXTENT *ext;
+     u_int32_t total;
+{
+  CMPR_RECORD hdr;
+  u_int32_t next, offset;
+  int ret;
+
+  if (ext->map != NULL)
+    memset (ext->map, 0, ext->nalloc * sizeof (CMPR_SLOT));
+  ext->npages = 0;
+  ext->live = 0;
+
+  for (offset = 0; offset < total; offset = next)
+  {
+    if (CDB___memp_cmpr_extent_io (&ext->fh, offset, &hdr,
+                                   sizeof (CMPR_RECORD), DB_IO_READ) != 0)
+      break;
+    if (hdr.length / DB_CMPR_ALIGN >= total - offset ||
+        (next = offset + CMPR_UNITS (hdr.length)) > total)
+      break;
+    if (hdr.pgno != 0)
+    {
+      if ((ret = CDB___memp_cmpr_extent_grow (ext, hdr.pgno)) != 0)
+        return (ret);
+      CDB___memp_cmpr_extent_set (ext, hdr.pgno, offset, hdr.length);
+    }
+  }
+
+  CDB___db_err (dbenv, "%s: not closed properly, recovered %lu pages",
+                ext->path, (u_long) (ext->npages == 0 ? 0 : ext->npages - 1));
+  ext->end = offset;
+  ext->dirty = 1;
+  return (0);
+}
+
+/*
+ * CDB___memp_cmpr_extent_rewrite --
+ *  Compact an extent: copy its current records into a new extent, in page
+ *  order, and replace it.  The extent is locked by the caller, but only
+ *  held while each record is copied, so that the file can be read and
+ *  written meanwhile.  The records appended since the copy started are
+ *  copied last, with the extent held, and the new extent replaces the
+ *  old one then.
+ */
+static int
+CDB___memp_cmpr_extent_rewrite (dbenv, ext)
+     DB_ENV *dbenv;
+     CMPR_EXTENT *ext;
+{
+  CMPR_SLOT *map;
+  DB_FH fh;
+  db_pgno_t nalloc, npages, pgno;
+  u_int32_t live, offset, start;
+  u_int8_t *buf;
+  size_t buflen;
+  char *tmp;
+  int ret;
+
+  map = NULL;
+  buf = NULL;
+  buflen = 0;
+  nalloc = 0;
+  memset (&fh, 0, sizeof (fh));
+
+  if ((ret = CDB___os_malloc (strlen (ext->path) + 5, NULL, &tmp)) != 0)
+    return (ret);
+  sprintf (tmp, "%s.tmp", ext->path);
+  if ((ret = CDB___os_open (tmp, DB_OSO_CREATE | DB_OSO_TRUNC, ext->mode,
+                            &fh)) != 0)
+  {
+    CDB___db_err (dbenv, "%s: %s", tmp, CDB_db_strerror (ret));
+    goto err;
+  }
+
+  /*
+   * Copy the pages as the map has them now.  The records before start
+   * stay where they are: records are only ever appended.
+   */
+  nalloc = ext->nalloc;
+  npages = ext->npages;
+  start = ext->end;
+  if (nalloc != 0)
+  {
+    if ((ret = CDB___os_calloc (nalloc, sizeof (CMPR_SLOT), &map)) != 0)
+      goto err;
+    memcpy (map, ext->map, npages * sizeof (CMPR_SLOT));
+  }
+  ext->compacting = 1;
+  MUTEX_THREAD_UNLOCK (ext->mutexp);
+
+  for (ret = 0, offset = 0, pgno = 1; pgno < npages && ret == 0; ++pgno)
+    if (map[pgno].length != 0)
+    {
+      MUTEX_THREAD_LOCK (ext->mutexp);
+      ret = CDB___memp_cmpr_extent_copy (dbenv, ext, &fh, pgno,
+                                         &map[pgno], &offset, &buf, &buflen);
+      MUTEX_THREAD_UNLOCK (ext->mutexp);
+    }
+
+  MUTEX_THREAD_LOCK (ext->mutexp);
+  ext->compacting = 0;
+  if (ret != 0)
+    goto err;
+
+  /* Then the pages written since. */
+  if (ext->nalloc > nalloc)
+  {
+    if ((ret = CDB___os_realloc (ext->nalloc * sizeof (CMPR_SLOT), NULL,
+                                 &map)) != 0)
+      goto err;
+    memset (map + nalloc, 0, (ext->nalloc - nalloc) * sizeof (CMPR_SLOT));
+    nalloc = ext->nalloc;
+  }
+  for (pgno = 1; pgno < ext->npages; ++pgno)
+    if (ext->map[pgno].length != 0 && ext->map[pgno].offset >= start)
+    {
+      map[pgno] = ext->map[pgno];
+      if ((ret = CDB___memp_cmpr_extent_copy (dbenv, ext, &fh, pgno,
+                                              &map[pgno], &offset, &buf,
+                                              &buflen)) != 0)
+        goto err;
+    }
+
+  /* Their first copies are left behind. */
+  for (live = 0, pgno = 1; pgno < ext->npages; ++pgno)
+    if (map[pgno].length != 0)
+      live += CMPR_UNITS (map[pgno].length);
+  if ((ret = CDB___memp_cmpr_extent_save (ext, &fh, map, &offset)) != 0)
+    goto err;
+
+  if ((ret = CDB___os_rename (tmp, ext->path)) != 0)
+  {
+    CDB___db_err (dbenv, "rename %s %s: %s", tmp, ext->path,
+                  CDB_db_strerror (ret));
+    goto err;
+  }
+  (void) CDB___os_closehandle (&ext->fh);
+  ext->fh = fh;
+  if (ext->map != NULL)
+    CDB___os_free (ext->map, ext->nalloc * sizeof (CMPR_SLOT));
+  ext->map = map;
+  ext->end = offset;
+  ext->live = live;
+  ext->dirty = 0;
+  map = NULL;
+
+err:
+  if (ret != 0 && F_ISSET (&fh, DB_FH_VALID))
+  {
+    (void) CDB___os_closehandle (&fh);
+    (void) CDB___os_unlink (tmp);
+  }
+  if (map != NULL)
+    CDB___os_free (map, nalloc * sizeof (CMPR_SLOT));
+  if (buf != NULL)
+    CDB___os_free (buf, buflen);
+  CDB___os_freestr (tmp);
+  return (ret);
+}
+
+/*
+ * CDB___memp_cmpr_extent_copy --
+ *  Copy the record of page pgno, which slotp locates in an extent, to
+ *  *offsetp of file fhp, and make slotp locate the copy.  *offsetp is
+ *  moved past it.  *bufp, of *buflenp bytes, is grown as needed.  The
+ *  extent is locked.
+ */
+static int
+CDB___memp_cmpr_extent_copy (dbenv, ext, fhp, pgno, slotp, offsetp, bufp,
+                             buflenp)
+     DB_ENV *dbenv;
+     CMPR_EXTENT *ext;
+     DB_FH *fhp;
+     db_pgno_t pgno;
+     CMPR_SLOT *slotp;
+     u_int32_t *offsetp;
+     u_int8_t **bufp;
+     size_t *buflenp;
+{
+  CMPR_RECORD *hdr;
+  size_t length;
+  int ret;
+
+  length = CMPR_UNITS (slotp->length) * DB_CMPR_ALIGN;
+  if (length > *buflenp)
+  {
+    if ((ret = CDB___os_realloc (length, NULL, bufp)) != 0)
+      return (ret);
+    *buflenp = length;
+  }
+  if ((ret = CDB___memp_cmpr_extent_io (&ext->fh, slotp->offset, *bufp,
+                                        length, DB_IO_READ)) != 0)
+    return (ret);
+  hdr = (CMPR_RECORD *) * bufp;
+  if (hdr->pgno != pgno || hdr->length != slotp->length)
+  {
+    CDB___db_err (dbenv, "%s: record of page %lu found for page %lu",
+                  ext->path, (u_long) hdr->pgno, (u_long) pgno);
+    return (CDB___db_panic (dbenv, EINVAL));
+  }
+  if ((ret = CDB___memp_cmpr_extent_io (fhp, *offsetp, *bufp, length,
+                                        DB_IO_WRITE)) != 0)
+    return (ret);
+  slotp->offset = *offsetp;
+  *offsetp += length / DB_CMPR_ALIGN;
+  return (0);
+}
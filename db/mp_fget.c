@@ -26,6 +26,9 @@ static const char sccsid[] = "@(#)mp_fget.c  11.8 (Sleepycat) 10/16/99";
 #include "WordMonitor.h"
 #endif /* DEBUG */
 
+static void CDB___memp_snap_publish __P ((DB_MPOOLFILE *, MCACHE *, BH *));
+static void CDB___memp_typestat __P ((MCACHE *, BH *, int));
+
 /*
  * CDB_memp_fget --
  *  Get a page from the file.
@@ -44,6 +47,7 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
   MCACHE *mc;
   MPOOL *mp;
   MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
   size_t n_bucket, n_cache, mf_offset;
   u_int32_t st_hsearch;
   int b_incr, first, ret;
@@ -104,7 +108,37 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
   st_hsearch = 0;
   b_incr = ret = 0;
 
-  R_LOCK (dbenv, &dbmp->reginfo);
+  /*
+   * Nothing changes in a read-only snapshot: a mapped page can be handed
+   * out without looking at the cache, and so can a page published in the
+   * handle's directory, which stays in the cache until the handle is
+   * closed and which we pin with an atomic increment.  This is how query
+   * threads go through the pages at the top of the trees without taking
+   * any lock.
+   */
+  if (flags == 0 && F_ISSET (dbmfp, MP_SNAPSHOT))
+  {
+    if (dbmfp->addr != NULL)
+    {
+      if (*pgnoaddr <= mfp->orig_last_pgno)
+      {
+        *(void **) addrp = R_ADDR (dbmfp, *pgnoaddr * mfp->stat.st_pagesize);
+        MP_ATOMIC_INC (mfp->stat.st_map);
+        MP_ATOMIC_INC (dbmfp->pinref);
+        return (0);
+      }
+    }
+    else if (*pgnoaddr < dbmfp->snap_npages &&
+             (bhp = dbmfp->snap[*pgnoaddr]) != NULL)
+    {
+      MP_ATOMIC_INC (bhp->ref);
+      mc = dbmp->c_reginfo[NCACHE (mp, *pgnoaddr)].primary;
+      MP_ATOMIC_INC (mc->stat.st_snap_hit);
+      MP_ATOMIC_INC (dbmfp->pinref);
+      *(void **) addrp = bhp->buf;
+      return (0);
+    }
+  }
 
   /*
    * Check for the new, last or last + 1 page requests.
@@ -114,7 +148,9 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
    * at this instant in time, the value is correct.  We do increment the
    * current last_pgno value if the thread is asking for a new page,
    * however, to ensure that two threads creating pages don't get the
-   * same one.
+   * same one.  The value lives in the main region, so we do this under
+   * the main region lock, and let it go before we lock the cache the
+   * page belongs to.
    *
    * If we create a page, there is the potential that a page after it
    * in the file will be written before it will be written.  Recovery
@@ -131,6 +167,7 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
    */
   if (LF_ISSET (DB_MPOOL_LAST | DB_MPOOL_NEW | DB_MPOOL_NEW_GROUP))
   {
+    R_LOCK (dbenv, &dbmp->reginfo);
     if (LF_ISSET (DB_MPOOL_NEW))
     {
       if ((ret = CDB___os_fpinit (&dbmfp->fh, mfp->last_pgno + 1,
@@ -156,17 +193,28 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
       mfp->last_pgno += *pgnoaddr;
     }
     *pgnoaddr = mfp->last_pgno;
+    R_UNLOCK (dbenv, &dbmp->reginfo);
   }
 
   /*
-   * Determine the hash bucket where this page will live, and get local
-   * pointers to the cache and its hash table.
+   * Determine the hash bucket where this page will live, get local
+   * pointers to the cache and its hash table, and lock the cache.
    */
   n_cache = NCACHE (mp, *pgnoaddr);
-  mc = dbmp->c_reginfo[n_cache].primary;
+  c_reginfo = &dbmp->c_reginfo[n_cache];
+  mc = c_reginfo->primary;
   n_bucket = NBUCKET (mc, mf_offset, *pgnoaddr);
-  dbht = R_ADDR (&dbmp->c_reginfo[n_cache], mc->htab);
+  dbht = R_ADDR (c_reginfo, mc->htab);
+
+  R_LOCK (dbenv, c_reginfo);
 
+  /*
+   * !!!
+   * A page we just created can't be in the cache: nobody else can know
+   * its number until we return it, short of a DB_MPOOL_LAST request
+   * racing with us, which only the statistics and verification code
+   * make.
+   */
   if (LF_ISSET (DB_MPOOL_NEW | DB_MPOOL_NEW_GROUP))
     goto alloc;
 
@@ -235,12 +283,15 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
     }
 
     /*
-     * Increment the reference count.  We may discard the region
+     * Increment the reference count.  We may discard the cache
      * lock as we evaluate and/or read the buffer, so we need to
      * ensure that it doesn't move and that its contents remain
      * unchanged.
      */
-    ++bhp->ref;
+    if (F_ISSET (bhp, BH_SNAP))
+      MP_ATOMIC_INC (bhp->ref);
+    else
+      ++bhp->ref;
     b_incr = 1;
 
     /*
@@ -249,12 +300,12 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
      * BH_LOCKED --
      * I/O is in progress.  Because we've incremented the buffer
      * reference count, we know the buffer can't move.  Unlock
-     * the region lock, wait for the I/O to complete, and reacquire
-     * the region.
+     * the cache lock, wait for the I/O to complete, and reacquire
+     * the cache.
      */
     for (first = 1; F_ISSET (bhp, BH_LOCKED); first = 0)
     {
-      R_UNLOCK (dbenv, &dbmp->reginfo);
+      R_UNLOCK (dbenv, c_reginfo);
 
       /*
        * Explicitly yield the processor if it's not the first
@@ -268,7 +319,7 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
       MUTEX_LOCK (&bhp->mutex, dbenv->lockfhp);
       /* Wait for I/O to finish... */
       MUTEX_UNLOCK (&bhp->mutex);
-      R_LOCK (dbenv, &dbmp->reginfo);
+      R_LOCK (dbenv, c_reginfo);
     }
 
     /*
@@ -291,15 +342,36 @@ CDB_memp_fget (dbmfp, pgnoaddr, flags, addrp)
       F_CLR (bhp, BH_CALLPGIN);
     }
 
+    /*
+     * BH_DEFLATED --
+     * The page was compressed ahead of a write, the caller may change it.
+     */
+    if (F_ISSET (bhp, BH_DEFLATED))
+      CDB___memp_cmpr_forget (bhp);
+
+    /*
+     * A page on probation is promoted to the LRU list if another page
+     * was read into the cache since it was, that is, if this is not
+     * just the same operation coming back for it.
+     */
+    if (F_ISSET (bhp, BH_PROBATION) && bhp->clock != mc->clock)
+    {
+      SH_TAILQ_REMOVE (&mc->bhq_in, bhp, q, __bh);
+      SH_TAILQ_INSERT_TAIL (&mc->bhq, bhp, q);
+      F_CLR (bhp, BH_PROBATION);
+      --mc->in_cnt;
+      ++mc->stat.st_page_promote;
+    }
+
     ++mfp->stat.st_cache_hit;
+    CDB___memp_typestat (mc, bhp, 1);
+    CDB___memp_snap_publish (dbmfp, mc, bhp);
     *(void **) addrp = bhp->buf;
     goto done;
   }
 
 alloc:                         /* Allocate new buffer header and data space. */
-  if ((ret = CDB___memp_alloc (dbmp,
-                               &dbmp->c_reginfo[n_cache], mfp, 0, NULL,
-                               &bhp)) != 0)
+  if ((ret = CDB___memp_alloc (dbmp, c_reginfo, mfp, 0, NULL, &bhp)) != 0)
     goto err;
 
   ++mc->stat.st_page_clean;
@@ -316,10 +388,20 @@ alloc:                         /* Allocate new buffer header and data space. */
   /*
    * Prepend the bucket header to the head of the appropriate MPOOL
    * bucket hash list.  Append the bucket header to the tail of the
-   * MPOOL LRU chain.
+   * MPOOL LRU chain, or of the probation list if the replacement policy
+   * wants the page to prove itself first.
    */
   SH_TAILQ_INSERT_HEAD (&dbht[n_bucket], bhp, hq, __bh);
-  SH_TAILQ_INSERT_TAIL (&mc->bhq, bhp, q);
+  ++mc->bh_cnt;
+  if (mp->mp_policy == DB_MPOOL_2Q)
+  {
+    F_SET (bhp, BH_PROBATION);
+    bhp->clock = ++mc->clock;
+    ++mc->in_cnt;
+    SH_TAILQ_INSERT_TAIL (&mc->bhq_in, bhp, q);
+  }
+  else
+    SH_TAILQ_INSERT_TAIL (&mc->bhq, bhp, q);
 
 #ifdef DIAGNOSTIC
   if ((ALIGNTYPE) bhp->buf & (sizeof (size_t) - 1))
@@ -372,7 +454,7 @@ alloc:                         /* Allocate new buffer header and data space. */
     /*
      * It's possible for the read function to fail, which means
      * that we fail as well.  Note, the CDB___memp_pgread() function
-     * discards the region lock, so the buffer must be pinned
+     * discards the cache lock, so the buffer must be pinned
      * down so that it cannot move and its contents are unchanged.
      */
   reread:if ((ret =
@@ -391,15 +473,24 @@ alloc:                         /* Allocate new buffer header and data space. */
     }
 
     ++mfp->stat.st_cache_miss;
+    CDB___memp_typestat (mc, bhp, 0);
+    CDB___memp_snap_publish (dbmfp, mc, bhp);
   }
 
   /*
    * If we're returning a page after our current notion of the last-page,
    * update our information.  Note, there's no way to un-instantiate this
    * page, it's going to exist whether it's returned to us dirty or not.
+   * The value only ever grows, so there is no need to take the main
+   * region lock unless it looks like we have something to do.
    */
   if (bhp->pgno > mfp->last_pgno)
-    mfp->last_pgno = bhp->pgno;
+  {
+    R_LOCK (dbenv, &dbmp->reginfo);
+    if (bhp->pgno > mfp->last_pgno)
+      mfp->last_pgno = bhp->pgno;
+    R_UNLOCK (dbenv, &dbmp->reginfo);
+  }
 
   *(void **) addrp = bhp->buf;
 
@@ -412,17 +503,197 @@ done:                          /* Update the chain search statistics. */
     mc->stat.st_hash_examined += st_hsearch;
   }
 
-  ++dbmfp->pinref;
+  MP_ATOMIC_INC (dbmfp->pinref);
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  R_UNLOCK (dbenv, c_reginfo);
 
   return (0);
 
 err:                           /* Discard our reference. */
   if (b_incr)
-    --bhp->ref;
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  {
+    if (F_ISSET (bhp, BH_SNAP))
+      MP_ATOMIC_DEC (bhp->ref);
+    else
+      --bhp->ref;
+  }
+  R_UNLOCK (dbenv, c_reginfo);
 
   *(void **) addrp = NULL;
   return (ret);
 }
+
+/*
+ * CDB___memp_prefetch --
+ *  Ask the system to start reading npages pages of the file, from pgno
+ *  on, that the cache doesn't hold, so that a later CDB_memp_fget finds
+ *  them in the system's buffers.  Nothing is read into the cache itself.
+ *
+ * PUBLIC: void CDB___memp_prefetch __P((DB_MPOOLFILE *, db_pgno_t, u_int32_t));
+ */
+void
+CDB___memp_prefetch (dbmfp, pgno, npages)
+     DB_MPOOLFILE *dbmfp;
+     db_pgno_t pgno;
+     u_int32_t npages;
+{
+  BH *bhp;
+  DB_ENV *dbenv;
+  DB_HASHTAB *dbht;
+  DB_IO db_io, runs[MP_PREFETCH_RUNS];
+  DB_MPOOL *dbmp;
+  MCACHE *mc;
+  MPOOL *mp;
+  MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
+  db_pgno_t last_pgno;
+  size_t mf_offset;
+  u_int32_t run;
+  int nruns;
+
+  dbmp = dbmfp->dbmp;
+  dbenv = dbmp->dbenv;
+  mp = dbmp->reginfo.primary;
+  mfp = dbmfp->mfp;
+
+  /*
+   * Mapped files are never read, and temporary files may not have been
+   * created yet.  Don't go past the end of the file: we don't care if
+   * last_pgno changes under us, it only ever grows.
+   */
+  if (dbmfp->addr != NULL || !F_ISSET (&dbmfp->fh, DB_FH_VALID))
+    return;
+  last_pgno = mfp->last_pgno;
+  if (pgno > last_pgno)
+    return;
+  if (npages > last_pgno - pgno + 1)
+    npages = last_pgno - pgno + 1;
+
+  /*
+   * A compressed page starts with a page of the smaller size on disk;
+   * the rest of its chain, if any, is read when the page is.
+   */
+  db_io.fhp = &dbmfp->fh;
+  db_io.mutexp = dbmfp->mutexp;
+  db_io.pagesize = mfp->stat.st_pagesize;
+  if (F_ISSET (dbmfp, MP_CMPR))
+    db_io.pagesize = DB_CMPR_DIVIDE (dbenv, db_io.pagesize);
+  db_io.buf = NULL;
+  db_io.pgno = pgno;
+
+  /*
+   * List the runs of pages the cache doesn't hold, and advise them all
+   * at once.
+   */
+  mf_offset = R_OFFSET (&dbmp->reginfo, mfp);
+  for (nruns = run = 0; npages > 0; --npages, ++pgno)
+  {
+    c_reginfo = &dbmp->c_reginfo[NCACHE (mp, pgno)];
+    mc = c_reginfo->primary;
+    dbht = R_ADDR (c_reginfo, mc->htab);
+
+    R_LOCK (dbenv, c_reginfo);
+    for (bhp = SH_TAILQ_FIRST (&dbht[NBUCKET (mc, mf_offset, pgno)], __bh);
+         bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, hq, __bh))
+      if (bhp->pgno == pgno && bhp->mf_offset == mf_offset)
+        break;
+    R_UNLOCK (dbenv, c_reginfo);
+
+    if (bhp == NULL)
+    {
+      if (run++ == 0)
+        db_io.pgno = pgno;
+      continue;
+    }
+    if (run != 0)
+    {
+      db_io.bytes = run * db_io.pagesize;
+      runs[nruns++] = db_io;
+      run = 0;
+      if (nruns == MP_PREFETCH_RUNS)
+      {
+        CDB___os_readahead (dbmp->rring, runs, nruns);
+        nruns = 0;
+      }
+    }
+  }
+  if (run != 0)
+  {
+    db_io.bytes = run * db_io.pagesize;
+    runs[nruns++] = db_io;
+  }
+  if (nruns != 0)
+    CDB___os_readahead (dbmp->rring, runs, nruns);
+}
+
+/*
+ * CDB___memp_snap_publish --
+ *  Publish a page of a read-only snapshot in the directory of the handle,
+ *  if every lookup is likely to go through it: the internal pages of the
+ *  trees and the meta-data pages.  The page is pinned until the handle is
+ *  closed, with a reference of its own, so only as many pages as the
+ *  cache can spare are published.  Called with the cache lock held.
+ */
+static void
+CDB___memp_snap_publish (dbmfp, mc, bhp)
+     DB_MPOOLFILE *dbmfp;
+     MCACHE *mc;
+     BH *bhp;
+{
+  if (dbmfp->snap == NULL ||
+      bhp->pgno >= dbmfp->snap_npages || dbmfp->snap[bhp->pgno] != NULL)
+    return;
+  if (F_ISSET (bhp, BH_CALLPGIN | BH_DEFLATED | BH_DIRTY |
+               BH_LOCKED | BH_TRASH))
+    return;
+  switch (TYPE (bhp->buf))
+  {
+  case P_IBTREE:
+  case P_IRECNO:
+  case P_BTREEMETA:
+  case P_HASHMETA:
+    break;
+  default:
+    return;
+  }
+  if (mc->snap_cnt >= MP_SNAP_TARGET (mc))
+    return;
+
+  F_SET (bhp, BH_SNAP);
+  MP_ATOMIC_INC (bhp->ref);
+  ++mc->snap_cnt;
+  MP_PUBLISH (dbmfp->snap[bhp->pgno], bhp);
+}
+
+/*
+ * CDB___memp_typestat --
+ *  Count a cache hit or miss against the type of the page, so that the
+ *  cache can be sized for the internal pages of the trees it holds.
+ */
+static void
+CDB___memp_typestat (mc, bhp, hit)
+     MCACHE *mc;
+     BH *bhp;
+     int hit;
+{
+  switch (TYPE (bhp->buf))
+  {
+  case P_IBTREE:
+  case P_IRECNO:
+    if (hit)
+      ++mc->stat.st_internal_hit;
+    else
+      ++mc->stat.st_internal_miss;
+    break;
+  case P_DUPLICATE:
+  case P_LBTREE:
+  case P_LRECNO:
+    if (hit)
+      ++mc->stat.st_leaf_hit;
+    else
+      ++mc->stat.st_leaf_miss;
+    break;
+  default:
+    break;
+  }
+}
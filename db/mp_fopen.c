@@ -22,6 +22,7 @@ static const char sccsid[] = "@(#)mp_fopen.c  11.7 (Sleepycat) 10/27/99";
 #include "mp.h"
 
 static int CDB___memp_mf_close __P ((DB_MPOOL *, DB_MPOOLFILE *));
+static void CDB___memp_snap_close __P ((DB_MPOOL *, DB_MPOOLFILE *));
 static int CDB___memp_mf_open __P ((DB_MPOOL *,
                                     const char *, size_t, db_pgno_t,
                                     DB_MPOOL_FINFO *, MPOOLFILE **));
@@ -179,6 +180,8 @@ CDB___memp_fopen (dbmp, mfp, path, flags, mode, pagesize, needlock, finfop,
       oflags |= DB_OSO_CREATE;
     if (LF_ISSET (DB_RDONLY))
       oflags |= DB_OSO_RDONLY;
+    if (dbenv->mp_io & DB_MPIO_DIRECT)
+      oflags |= DB_OSO_DIRECT;
     if ((ret = CDB___os_open (rpath, oflags, mode, &dbmfp->fh)) != 0)
     {
       CDB___db_err (dbenv, "%s: %s", rpath, CDB_db_strerror (ret));
@@ -205,21 +208,40 @@ CDB___memp_fopen (dbmp, mfp, path, flags, mode, pagesize, needlock, finfop,
       goto err;
     }
 
-    /* Page sizes have to be a power-of-two, ignore mbytes. */
-    if (bytes % disk_pagesize != 0)
+    /*
+     * The pages of a packed compressed file are in its extent, the file
+     * itself only holds page 0.
+     */
+    if (LF_ISSET (DB_COMPRESS))
     {
-      CDB___db_err (dbenv,
-                    "%s: file size not a multiple of the pagesize", rpath);
-      ret = EINVAL;
-      goto err;
+      if ((ret =
+           CDB___memp_cmpr_open (dbenv, path, rpath, flags, mode,
+                                 mbytes == 0 && bytes == 0,
+                                 &dbmfp->cmpr_context)) != 0)
+        goto err;
     }
 
-    last_pgno = mbytes * (MEGABYTE / disk_pagesize);
-    last_pgno += bytes / disk_pagesize;
+    if (dbmfp->cmpr_context.extent != NULL)
+      last_pgno = dbmfp->cmpr_context.extent->npages == 0 ?
+        0 : dbmfp->cmpr_context.extent->npages - 1;
+    else
+    {
+      /* Page sizes have to be a power-of-two, ignore mbytes. */
+      if (bytes % disk_pagesize != 0)
+      {
+        CDB___db_err (dbenv,
+                      "%s: file size not a multiple of the pagesize", rpath);
+        ret = EINVAL;
+        goto err;
+      }
 
-    /* Correction: page numbers are zero-based, not 1-based. */
-    if (last_pgno != 0)
-      --last_pgno;
+      last_pgno = mbytes * (MEGABYTE / disk_pagesize);
+      last_pgno += bytes / disk_pagesize;
+
+      /* Correction: page numbers are zero-based, not 1-based. */
+      if (last_pgno != 0)
+        --last_pgno;
+    }
 
     /*
      * Get the file id if we weren't given one.  Generated file id's
@@ -232,13 +254,6 @@ CDB___memp_fopen (dbmp, mfp, path, flags, mode, pagesize, needlock, finfop,
         goto err;
       finfop->fileid = idbuf;
     }
-    if (LF_ISSET (DB_COMPRESS))
-    {
-      if ((ret =
-           CDB___memp_cmpr_open (dbenv, path, flags, mode,
-                                 &dbmfp->cmpr_context)) != 0)
-        goto err;
-    }
   }
 
   /*
@@ -321,6 +336,22 @@ CDB___memp_fopen (dbmp, mfp, path, flags, mode, pagesize, needlock, finfop,
   if (rpath != NULL)
     CDB___os_freestr (rpath);
 
+  /*
+   * Files read in a read-only snapshot environment never change.  Unless
+   * they are mapped, the pages that every lookup goes through are pinned
+   * in a directory of the handle as they are read; see CDB_memp_fget.  If
+   * we can't allocate the directory, the pages are found in the cache as
+   * usual.
+   */
+  if (F_ISSET (dbenv, DB_ENV_SNAPSHOT) &&
+      F_ISSET (dbmfp, MP_READONLY) && path != NULL)
+  {
+    F_SET (dbmfp, MP_SNAPSHOT);
+    if (dbmfp->addr == NULL &&
+        CDB___os_calloc (last_pgno + 1, sizeof (BH *), &dbmfp->snap) == 0)
+      dbmfp->snap_npages = last_pgno + 1;
+  }
+
   MUTEX_THREAD_LOCK (dbmp->mutexp);
   TAILQ_INSERT_TAIL (&dbmp->dbmfq, dbmfp, q);
   MUTEX_THREAD_UNLOCK (dbmp->mutexp);
@@ -336,6 +367,9 @@ err:                           /*
     CDB___os_freestr (rpath);
   if (F_ISSET (&dbmfp->fh, DB_FH_VALID))
     (void) CDB___os_closehandle (&dbmfp->fh);
+  if (dbmfp != NULL && (dbmfp->cmpr_context.weakcmpr != NULL ||
+                        dbmfp->cmpr_context.extent != NULL))
+    (void) CDB___memp_cmpr_close (dbenv, &dbmfp->cmpr_context);
   if (dbmfp != NULL)
     CDB___os_free (dbmfp, sizeof (DB_MPOOLFILE));
   return (ret);
@@ -538,6 +572,10 @@ CDB_memp_fclose (dbmfp)
     CDB___db_err (dbenv, "%s: close: %lu blocks left pinned",
                   CDB___memp_fn (dbmfp), (u_long) dbmfp->pinref);
 
+  /* Unpin the pages of a read-only snapshot. */
+  if (dbmfp->snap != NULL)
+    CDB___memp_snap_close (dbmp, dbmfp);
+
   /* Close the underlying MPOOLFILE. */
   (void) CDB___memp_mf_close (dbmp, dbmfp);
 
@@ -559,7 +597,7 @@ CDB_memp_fclose (dbmfp)
 
   if (F_ISSET (dbmfp, MP_CMPR))
   {
-    if ((ret = CDB___memp_cmpr_close (&dbmfp->cmpr_context)) != 0)
+    if ((ret = CDB___memp_cmpr_close (dbenv, &dbmfp->cmpr_context)) != 0)
       CDB___db_err (dbmp->dbenv,
                     "%s: %s", CDB___memp_fn (dbmfp), strerror (ret));
     F_CLR (dbmfp, MP_CMPR);
@@ -575,6 +613,41 @@ CDB_memp_fclose (dbmfp)
   return (ret);
 }
 
+/*
+ * CDB___memp_snap_close --
+ *  Drop the references the directory of a read-only snapshot holds on
+ *  its pages, and discard it.
+ */
+static void
+CDB___memp_snap_close (dbmp, dbmfp)
+     DB_MPOOL *dbmp;
+     DB_MPOOLFILE *dbmfp;
+{
+  BH *bhp;
+  DB_ENV *dbenv;
+  MCACHE *mc;
+  REGINFO *c_reginfo;
+  db_pgno_t pgno;
+
+  dbenv = dbmp->dbenv;
+
+  for (pgno = 0; pgno < dbmfp->snap_npages; ++pgno)
+  {
+    if ((bhp = dbmfp->snap[pgno]) == NULL)
+      continue;
+    mc = BH_TO_CACHE (dbmp, bhp);
+    c_reginfo = BH_TO_REGINFO (dbmp, bhp);
+    R_LOCK (dbenv, c_reginfo);
+    MP_ATOMIC_DEC (bhp->ref);
+    --mc->snap_cnt;
+    R_UNLOCK (dbenv, c_reginfo);
+  }
+
+  CDB___os_free ((void *) dbmfp->snap, dbmfp->snap_npages * sizeof (BH *));
+  dbmfp->snap = NULL;
+  dbmfp->snap_npages = 0;
+}
+
 /*
  * CDB___memp_mf_close --
  *  Close down an MPOOLFILE.
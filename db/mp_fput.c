@@ -35,6 +35,7 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
   DB_MPOOL *dbmp;
   MCACHE *mc;
   MPOOL *mp;
+  REGINFO *c_reginfo;
   int ret, wrote;
 
   dbmp = dbmfp->dbmp;
@@ -63,14 +64,12 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
     }
   }
 
-  R_LOCK (dbenv, &dbmp->reginfo);
-
   /* Decrement the pinned reference count. */
   if (dbmfp->pinref == 0)
     CDB___db_err (dbenv, "%s: put: more blocks returned than retrieved",
                   CDB___memp_fn (dbmfp));
   else
-    --dbmfp->pinref;
+    MP_ATOMIC_DEC (dbmfp->pinref);
 
   /*
    * If we're mapping the file, there's nothing to do.  Because we can
@@ -80,18 +79,35 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
    */
   if (dbmfp->addr != NULL && pgaddr >= dbmfp->addr &&
       (u_int8_t *) pgaddr <= (u_int8_t *) dbmfp->addr + dbmfp->len)
-  {
-    R_UNLOCK (dbenv, &dbmp->reginfo);
     return (0);
-  }
 
   /* Convert the page address to a buffer header. */
   bhp = (BH *) ((u_int8_t *) pgaddr - SSZA (BH, buf));
 
-  /* Convert the buffer header to a cache. */
+  /*
+   * A page pinned by a read-only snapshot stays where it is until the
+   * snapshot is closed, there's nothing to do but drop our reference.
+   * The page may have been pinned since we got it, check again under
+   * the cache lock if it doesn't look like it.
+   */
+  if (F_ISSET (bhp, BH_SNAP))
+  {
+    MP_ATOMIC_DEC (bhp->ref);
+    return (0);
+  }
+
+  /* Convert the buffer header to a cache, and lock it. */
   mc = BH_TO_CACHE (dbmp, bhp);
+  c_reginfo = BH_TO_REGINFO (dbmp, bhp);
 
-/* UNLOCK THE REGION, LOCK THE CACHE. */
+  R_LOCK (dbenv, c_reginfo);
+
+  if (F_ISSET (bhp, BH_SNAP))
+  {
+    MP_ATOMIC_DEC (bhp->ref);
+    R_UNLOCK (dbenv, c_reginfo);
+    return (0);
+  }
 
   /* Set/clear the page bits. */
   if (LF_ISSET (DB_MPOOL_CLEAN) && F_ISSET (bhp, BH_DIRTY))
@@ -117,7 +133,7 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
   {
     CDB___db_err (dbenv, "%s: page %lu: unpinned page returned",
                   CDB___memp_fn (dbmfp), (u_long) bhp->pgno);
-    R_UNLOCK (dbenv, &dbmp->reginfo);
+    R_UNLOCK (dbenv, c_reginfo);
     return (EINVAL);
   }
 
@@ -128,22 +144,28 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
    */
   if (--bhp->ref > 0)
   {
-    R_UNLOCK (dbenv, &dbmp->reginfo);
+    R_UNLOCK (dbenv, c_reginfo);
     return (0);
   }
 
   /*
    * Move the buffer to the head/tail of the LRU chain.  We do this
    * before writing the buffer for checkpoint purposes, as the write
-   * can discard the region lock and allow another process to acquire
+   * can discard the cache lock and allow another process to acquire
    * buffer.  We could keep that from happening, but there seems no
-   * reason to do so.
+   * reason to do so.  A buffer on the probation list keeps its place
+   * in the FIFO unless it is discarded.
    */
-  SH_TAILQ_REMOVE (&mc->bhq, bhp, q, __bh);
   if (F_ISSET (bhp, BH_DISCARD))
-    SH_TAILQ_INSERT_HEAD (&mc->bhq, bhp, q, __bh);
-  else
+  {
+    SH_TAILQ_REMOVE (BH_TO_QUEUE (mc, bhp), bhp, q, __bh);
+    SH_TAILQ_INSERT_HEAD (BH_TO_QUEUE (mc, bhp), bhp, q, __bh);
+  }
+  else if (!F_ISSET (bhp, BH_PROBATION))
+  {
+    SH_TAILQ_REMOVE (&mc->bhq, bhp, q, __bh);
     SH_TAILQ_INSERT_TAIL (&mc->bhq, bhp, q);
+  }
 
   /*
    * If this buffer is scheduled for writing because of a checkpoint, we
@@ -153,7 +175,8 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
    * application have permission to write the underlying file, but set a
    * flag so that the next time the CDB_memp_sync function is called we try
    * writing it there, as the checkpoint thread of control better be able
-   * to write all of the files.
+   * to write all of the files.  The checkpoint counters and flags are in
+   * the main region, and need its lock as well.
    */
   if (F_ISSET (bhp, BH_WRITE))
   {
@@ -161,17 +184,23 @@ CDB_memp_fput (dbmfp, pgaddr, flags)
     {
       if (CDB___memp_bhwrite (dbmp,
                               dbmfp->mfp, bhp, NULL, &wrote) != 0 || !wrote)
+      {
+        R_LOCK (dbenv, &dbmp->reginfo);
         F_SET (mp, MP_LSN_RETRY);
+        R_UNLOCK (dbenv, &dbmp->reginfo);
+      }
     }
     else
     {
       F_CLR (bhp, BH_WRITE);
 
+      R_LOCK (dbenv, &dbmp->reginfo);
       --mp->lsn_cnt;
       --dbmfp->mfp->lsn_cnt;
+      R_UNLOCK (dbenv, &dbmp->reginfo);
     }
   }
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  R_UNLOCK (dbenv, c_reginfo);
   return (0);
 }
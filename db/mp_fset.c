@@ -35,6 +35,7 @@ CDB_memp_fset (dbmfp, pgaddr, flags)
   DB_MPOOL *dbmp;
   MCACHE *mc;
   MPOOL *mp;
+  REGINFO *c_reginfo;
   int ret;
 
   dbmp = dbmfp->dbmp;
@@ -65,10 +66,11 @@ CDB_memp_fset (dbmfp, pgaddr, flags)
   /* Convert the page address to a buffer header. */
   bhp = (BH *) ((u_int8_t *) pgaddr - SSZA (BH, buf));
 
-  /* Convert the buffer header to a cache. */
+  /* Convert the buffer header to a cache, and lock it. */
   mc = BH_TO_CACHE (dbmp, bhp);
+  c_reginfo = BH_TO_REGINFO (dbmp, bhp);
 
-  R_LOCK (dbenv, &dbmp->reginfo);
+  R_LOCK (dbenv, c_reginfo);
 
   if (LF_ISSET (DB_MPOOL_CLEAN) && F_ISSET (bhp, BH_DIRTY))
   {
@@ -85,6 +87,6 @@ CDB_memp_fset (dbmfp, pgaddr, flags)
   if (LF_ISSET (DB_MPOOL_DISCARD))
     F_SET (bhp, BH_DISCARD);
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  R_UNLOCK (dbenv, c_reginfo);
   return (0);
 }
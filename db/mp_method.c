@@ -21,6 +21,11 @@ static const char sccsid[] = "@(#)mp_method.c  11.2 (Sleepycat) 10/6/99";
 static int CDB___memp_set_cachesize
 __P ((DB_ENV *, u_int32_t, u_int32_t, int));
 static int CDB___memp_set_mp_mmapsize __P ((DB_ENV *, size_t));
+static int CDB___memp_set_mp_policy __P ((DB_ENV *, u_int32_t));
+static int CDB___memp_set_mp_flusher __P ((DB_ENV *, u_int32_t, u_int32_t));
+static int CDB___memp_set_mp_cmpr_threads __P ((DB_ENV *, u_int32_t));
+static int CDB___memp_set_mp_cmpr_layout __P ((DB_ENV *, u_int32_t));
+static int CDB___memp_set_mp_io __P ((DB_ENV *, u_int32_t));
 
 /*
  * CDB___memp_dbenv_create --
@@ -43,6 +48,11 @@ CDB___memp_dbenv_create (dbenv)
   dbenv->mp_ncache = 1;
 
   dbenv->set_mp_mmapsize = CDB___memp_set_mp_mmapsize;
+  dbenv->set_mp_policy = CDB___memp_set_mp_policy;
+  dbenv->set_mp_flusher = CDB___memp_set_mp_flusher;
+  dbenv->set_mp_cmpr_threads = CDB___memp_set_mp_cmpr_threads;
+  dbenv->set_mp_cmpr_layout = CDB___memp_set_mp_cmpr_layout;
+  dbenv->set_mp_io = CDB___memp_set_mp_io;
   dbenv->set_cachesize = CDB___memp_set_cachesize;
 }
 
@@ -94,3 +104,116 @@ CDB___memp_set_mp_mmapsize (dbenv, mp_mmapsize)
   dbenv->mp_mmapsize = mp_mmapsize;
   return (0);
 }
+
+/*
+ * CDB___memp_set_mp_policy --
+ *  Set the buffer replacement policy.
+ */
+static int
+CDB___memp_set_mp_policy (dbenv, mp_policy)
+     DB_ENV *dbenv;
+     u_int32_t mp_policy;
+{
+  ENV_ILLEGAL_AFTER_OPEN (dbenv, "set_mp_policy");
+
+  switch (mp_policy)
+  {
+  case DB_MPOOL_LRU:
+  case DB_MPOOL_2Q:
+    break;
+  default:
+    return (CDB___db_ferr (dbenv, "DB_ENV->set_mp_policy", 0));
+  }
+
+  dbenv->mp_policy = mp_policy;
+  return (0);
+}
+
+/*
+ * CDB___memp_set_mp_flusher --
+ *  Configure the background flusher: a thread that keeps pct percent
+ *  of each cache clean, waking up every usecs microseconds.  A pct of
+ *  0 (the default) means no flusher.
+ */
+static int
+CDB___memp_set_mp_flusher (dbenv, pct, usecs)
+     DB_ENV *dbenv;
+     u_int32_t pct, usecs;
+{
+  ENV_ILLEGAL_AFTER_OPEN (dbenv, "set_mp_flusher");
+
+  if (pct > 100)
+    return (CDB___db_ferr (dbenv, "DB_ENV->set_mp_flusher", 0));
+
+  dbenv->mp_flush_pct = pct;
+  dbenv->mp_flush_usecs = usecs == 0 ? MP_FLUSH_USECS : usecs;
+  return (0);
+}
+
+/*
+ * CDB___memp_set_mp_cmpr_threads --
+ *  Set the number of threads compressing the pages of a batch of writes
+ *  to compressed files.  0 or 1 (the default) compress each page as it is
+ *  written.
+ */
+static int
+CDB___memp_set_mp_cmpr_threads (dbenv, nthreads)
+     DB_ENV *dbenv;
+     u_int32_t nthreads;
+{
+  ENV_ILLEGAL_AFTER_OPEN (dbenv, "set_mp_cmpr_threads");
+
+  dbenv->mp_cmpr_threads = nthreads;
+  return (0);
+}
+
+/*
+ * CDB___memp_set_mp_cmpr_layout --
+ *  Set the layout of the compressed files created from now on.  Existing
+ *  files keep the layout they were created with, see mp_cmpr.c.
+ */
+static int
+CDB___memp_set_mp_cmpr_layout (dbenv, layout)
+     DB_ENV *dbenv;
+     u_int32_t layout;
+{
+  ENV_ILLEGAL_AFTER_OPEN (dbenv, "set_mp_cmpr_layout");
+
+  switch (layout)
+  {
+  case DB_CMPR_CHAINED:
+  case DB_CMPR_PACKED:
+    break;
+  default:
+    return (CDB___db_ferr (dbenv, "DB_ENV->set_mp_cmpr_layout", 0));
+  }
+
+  dbenv->mp_cmpr_layout = layout;
+  return (0);
+}
+
+/*
+ * CDB___memp_set_mp_io --
+ *  Choose how the files are read and written: DB_MPIO_URING batches the
+ *  writes of sync and trickle passes and the readahead advice through an
+ *  io_uring, where the system has one.  DB_MPIO_DIRECT opens the files so
+ *  that their pages bypass the system's buffers, which is only sensible
+ *  if the cache is sized to hold the working set.  Either falls back to
+ *  the usual I/O where it can't be had.
+ */
+static int
+CDB___memp_set_mp_io (dbenv, flags)
+     DB_ENV *dbenv;
+     u_int32_t flags;
+{
+  int ret;
+
+  ENV_ILLEGAL_AFTER_OPEN (dbenv, "set_mp_io");
+
+  if ((ret = CDB___db_fchk (dbenv, "DB_ENV->set_mp_io",
+                            flags, DB_MPIO_URING | DB_MPIO_DIRECT)) != 0)
+    return (ret);
+
+  dbenv->mp_io = flags;
+  return (0);
+}
@@ -23,6 +23,10 @@ static const char sccsid[] = "@(#)mp_region.c  11.4 (Sleepycat) 10/19/99";
 
 static int CDB___mcache_init __P ((DB_ENV *, DB_MPOOL *, int, int));
 static int CDB___mpool_init __P ((DB_ENV *, DB_MPOOL *, int));
+static int CDB___memp_ioring_open __P ((DB_ENV *,
+                                        DB_MPOOL *, MUTEX **, DB_IORING **));
+static void CDB___memp_ioring_close __P ((DB_ENV *,
+                                          DB_MPOOL *, MUTEX *, DB_IORING *));
 
 /*
  * CDB___memp_open --
@@ -40,8 +44,9 @@ CDB___memp_open (dbenv)
   int i, htab_buckets, ret;
 
   /* Figure out how big each cache region is. */
-  reg_size = dbenv->mp_gbytes / dbenv->mp_ncache;
-  reg_size += (dbenv->mp_gbytes % dbenv->mp_ncache) / dbenv->mp_ncache;
+  reg_size = (dbenv->mp_gbytes / dbenv->mp_ncache) * GIGABYTE;
+  reg_size += ((dbenv->mp_gbytes % dbenv->mp_ncache) * GIGABYTE) /
+    dbenv->mp_ncache;
   reg_size += dbenv->mp_bytes / dbenv->mp_ncache;
 
   /*
@@ -180,6 +185,25 @@ CDB___memp_open (dbenv)
   }
 
   dbenv->mp_handle = dbmp;
+
+  /*
+   * Set up the rings the I/O goes through, if asked to.  Then start the
+   * background flusher, it finds the pool through the handle.
+   */
+  if (((dbenv->mp_io & DB_MPIO_URING) &&
+       ((ret = CDB___memp_ioring_open (dbenv, dbmp,
+                                       &dbmp->wring_mutexp,
+                                       &dbmp->wring)) != 0 ||
+        (ret = CDB___memp_ioring_open (dbenv, dbmp,
+                                       &dbmp->rring_mutexp,
+                                       &dbmp->rring)) != 0)) ||
+      (dbenv->mp_flush_pct != 0 &&
+       (ret = CDB___memp_flusher_start (dbenv)) != 0))
+  {
+    (void) CDB___memp_close (dbenv);
+    dbenv->mp_handle = NULL;
+    return (ret);
+  }
   return (0);
 
 err:if (dbmp->reginfo.addr != NULL)
@@ -200,6 +224,48 @@ err:if (dbmp->reginfo.addr != NULL)
   return (ret);
 }
 
+/*
+ * CDB___memp_ioring_open --
+ *  Set up a ring, and the thread lock it needs if the region is threaded.
+ *  The ring is left NULL if the system can't provide one.
+ */
+static int
+CDB___memp_ioring_open (dbenv, dbmp, mutexpp, ringpp)
+     DB_ENV *dbenv;
+     DB_MPOOL *dbmp;
+     MUTEX **mutexpp;
+     DB_IORING **ringpp;
+{
+  int ret;
+
+  if (F_ISSET (dbenv, DB_ENV_THREAD))
+  {
+    if ((ret =
+         CDB___db_mutex_alloc (dbenv, &dbmp->reginfo, mutexpp)) != 0)
+      return (ret);
+    if ((ret = __db_mutex_init (dbenv, *mutexpp, 0, MUTEX_THREAD)) != 0)
+      return (ret);
+  }
+  return (CDB___os_ioring_open (MP_IORING_SIZE, *mutexpp, ringpp));
+}
+
+/*
+ * CDB___memp_ioring_close --
+ *  Discard a ring and its thread lock.
+ */
+static void
+CDB___memp_ioring_close (dbenv, dbmp, mutexp, ringp)
+     DB_ENV *dbenv;
+     DB_MPOOL *dbmp;
+     MUTEX *mutexp;
+     DB_IORING *ringp;
+{
+  if (ringp != NULL)
+    CDB___os_ioring_close (ringp);
+  if (mutexp != NULL)
+    CDB___db_mutex_free (dbenv, &dbmp->reginfo, mutexp);
+}
+
 /*
  * CDB___mpool_init --
  *  Initialize a MPOOL structure in shared memory.
@@ -232,6 +298,8 @@ CDB___mpool_init (dbenv, dbmp, nc_reg)
   ZERO_LSN (mp->lsn);
   mp->lsn_cnt = 0;
 
+  mp->mp_policy = dbenv->mp_policy;
+
   mp->nc_reg = nc_reg;
   if ((ret =
        CDB___db_shalloc (dbmp->reginfo.addr, nc_reg * sizeof (int), 0,
@@ -274,6 +342,7 @@ CDB___mcache_init (dbenv, dbmp, htab_buckets, reginfo_off)
   memset (mc, 0, sizeof (*mc));
 
   SH_TAILQ_INIT (&mc->bhq);
+  SH_TAILQ_INIT (&mc->bhq_in);
 
   /* Allocate hash table space and initialize it. */
   if ((ret = CDB___db_shalloc (reginfo->addr,
@@ -308,6 +377,9 @@ CDB___memp_close (dbenv)
   ret = 0;
   dbmp = dbenv->mp_handle;
 
+  /* Stop the background flusher before the files go away. */
+  CDB___memp_flusher_stop (dbenv);
+
   /* Discard DB_MPREGs. */
   while ((mpreg = LIST_FIRST (&dbmp->dbregq)) != NULL)
   {
@@ -321,12 +393,17 @@ CDB___memp_close (dbenv)
     if (F_ISSET (dbmfp, MP_CMPR))
     {
       dbmfp->cmpr_context.weakcmpr = 0;
-      F_CLR (dbmfp, MP_CMPR);
+      if (dbmfp->cmpr_context.extent == NULL)
+        F_CLR (dbmfp, MP_CMPR);
     }
     if ((t_ret = CDB_memp_fclose (dbmfp)) != 0 && ret == 0)
       ret = t_ret;
   }
 
+  /* Discard the rings, the files have been flushed. */
+  CDB___memp_ioring_close (dbenv, dbmp, dbmp->wring_mutexp, dbmp->wring);
+  CDB___memp_ioring_close (dbenv, dbmp, dbmp->rring_mutexp, dbmp->rring);
+
   /* Discard the thread mutex. */
   if (dbmp->mutexp != NULL)
     CDB___db_mutex_free (dbenv, &dbmp->reginfo, dbmp->mutexp);
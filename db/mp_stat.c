@@ -82,12 +82,14 @@ CDB_memp_stat (dbenv, gspp, fspp, db_malloc)
     sp->st_gbytes = dbenv->mp_gbytes;
     sp->st_bytes = dbenv->mp_bytes;
 
-    R_LOCK (dbenv, &dbmp->reginfo);
-
-    /* Walk the cache list and accumulate the global information. */
+    /*
+     * Walk the cache list and accumulate the global information.  Each
+     * cache has its own lock, whose contention is part of the region's.
+     */
     for (i = 0; i < mp->nc_reg; ++i)
     {
       mc = dbmp->c_reginfo[i].primary;
+      R_LOCK (dbenv, &dbmp->c_reginfo[i]);
       sp->st_cache_hit += mc->stat.st_cache_hit;
       sp->st_cache_miss += mc->stat.st_cache_miss;
       sp->st_map += mc->stat.st_map;
@@ -106,9 +108,18 @@ CDB_memp_stat (dbenv, gspp, fspp, db_malloc)
       sp->st_page_trickle += mc->stat.st_page_trickle;
       sp->st_region_wait += mc->stat.st_region_wait;
       sp->st_region_nowait += mc->stat.st_region_nowait;
+      sp->st_internal_hit += mc->stat.st_internal_hit;
+      sp->st_internal_miss += mc->stat.st_internal_miss;
+      sp->st_leaf_hit += mc->stat.st_leaf_hit;
+      sp->st_leaf_miss += mc->stat.st_leaf_miss;
+      sp->st_page_probation += mc->in_cnt;
+      sp->st_page_promote += mc->stat.st_page_promote;
+      sp->st_snap_hit += mc->stat.st_snap_hit;
+      R_UNLOCK (dbenv, &dbmp->c_reginfo[i]);
+
+      sp->st_region_wait += dbmp->c_reginfo[i].rp->mutex.mutex_set_wait;
+      sp->st_region_nowait += dbmp->c_reginfo[i].rp->mutex.mutex_set_nowait;
     }
-
-    R_UNLOCK (dbenv, &dbmp->reginfo);
   }
 
   /* Per-file statistics. */
@@ -269,17 +280,23 @@ CDB___memp_dump_region (dbenv, area, fp)
   else
     fmap[FMAP_ENTRIES] = INVALID_ROFF;
 
-  /* Dump each cache. */
+  R_UNLOCK (dbenv, &dbmp->reginfo);
+
+  /* Dump each cache, under its own lock. */
   for (i = 0; i < mp->nc_reg; ++i)
   {
     (void) fprintf (fp, "%s\nCache #%d:\n", DB_LINE, i + 1);
+    R_LOCK (dbenv, &dbmp->c_reginfo[i]);
     CDB___memp_dumpcache (dbmp, &dbmp->c_reginfo[i], fmap, fp, flags);
+    R_UNLOCK (dbenv, &dbmp->c_reginfo[i]);
   }
 
   if (LF_ISSET (MPOOL_DUMP_MEM))
+  {
+    R_LOCK (dbenv, &dbmp->reginfo);
     CDB___db_shalloc_dump (dbmp->reginfo.addr, fp);
-
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+    R_UNLOCK (dbenv, &dbmp->reginfo);
+  }
 
   /* Flush in case we're debugging. */
   (void) fflush (fp);
@@ -329,6 +346,14 @@ CDB___memp_dumpcache (dbmp, reginfo, fmap, fp, flags)
     for (bhp = SH_TAILQ_FIRST (&mc->bhq, __bh);
          bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, q, __bh))
       CDB___memp_pbh (dbmp, bhp, fmap, fp);
+    if (SH_TAILQ_FIRST (&mc->bhq_in, __bh) != NULL)
+    {
+      (void) fprintf (fp, "%s\nBH probation list\n", DB_LINE);
+      (void) fprintf (fp, "pageno, file, ref, address\n");
+      for (bhp = SH_TAILQ_FIRST (&mc->bhq_in, __bh);
+           bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, q, __bh))
+        CDB___memp_pbh (dbmp, bhp, fmap, fp);
+    }
   }
 }
 
@@ -348,6 +373,7 @@ CDB___memp_pbh (dbmp, bhp, fmap, fp)
     {BH_DIRTY, "dirty"},
     {BH_DISCARD, "discard"},
     {BH_LOCKED, "locked"},
+    {BH_PROBATION, "probation"},
     {BH_TRASH, "trash"},
     {BH_WRITE, "write"},
     {0, NULL}
@@ -21,9 +21,12 @@ static const char sccsid[] = "@(#)mp_sync.c  11.10 (Sleepycat) 10/29/99";
 #include "db_shash.h"
 #include "mp.h"
 
-static int CDB___bhcmp __P ((const void *, const void *));
 static int CDB___memp_fsync __P ((DB_MPOOLFILE *));
 static int CDB___memp_sballoc __P ((DB_ENV *, BH ***, u_int32_t *));
+static void CDB___memp_lock_all __P ((DB_MPOOL *));
+static void CDB___memp_unlock_all __P ((DB_MPOOL *));
+static void CDB___memp_sbrelease __P ((DB_MPOOL *, BH **, u_int32_t));
+static int CDB___memp_sync_compact __P ((DB_MPOOL *));
 
 /*
  * CDB_memp_sync --
@@ -40,6 +43,7 @@ CDB_memp_sync (dbenv, lsnp)
   MCACHE *mc;
   MPOOL *mp;
   MPOOLFILE *mfp;
+  REGINFO *c_reginfo;
   u_int32_t ar_cnt, i, ndirty;
   int ret, retry_done, retry_need, wrote;
 
@@ -104,14 +108,11 @@ CDB_memp_sync (dbenv, lsnp)
     MUTEX_UNLOCK (&mp->sync_mutex);
     return (ret);
   }
+  R_UNLOCK (dbenv, &dbmp->reginfo);
 
   /*
    * Allocate room for a list of buffers, and decide how many buffers
    * we can pin down.
-   *
-   * !!!
-   * Note: CDB___memp_sballoc has released the region lock if we're not
-   * continuing forward.
    */
   if ((ret =
        CDB___memp_sballoc (dbenv, &bharray, &ndirty)) != 0 || ndirty == 0)
@@ -122,6 +123,15 @@ CDB_memp_sync (dbenv, lsnp)
 
   retry_done = 0;
 retry:retry_need = 0;
+
+  /*
+   * Lock every cache, and then the main region, for the length of the
+   * marking pass below.  It's the one place we hold more than one cache
+   * lock, and it's what keeps the checkpoint counters consistent with
+   * the buffers' BH_WRITE flags.
+   */
+  CDB___memp_lock_all (dbmp);
+
   /*
    * Start a new checkpoint.
    *
@@ -156,7 +166,7 @@ retry:retry_need = 0;
    * Walk each cache's list of buffers and mark all dirty buffers to be
    * written and all pinned buffers to be potentially written (we can't
    * know if they'll need to be written until the holder returns them to
-   * the cache).  We do this in one pass while holding the region locked
+   * the cache).  We do this in one pass while holding the caches locked
    * so that processes can't make new buffers dirty, causing us to never
    * finish.  Since the application may have restarted the sync using a
    * different LSN value, clear any BH_WRITE flags that appear leftover
@@ -169,8 +179,7 @@ retry:retry_need = 0;
   {
     mc = dbmp->c_reginfo[i].primary;
 
-    for (bhp = SH_TAILQ_FIRST (&mc->bhq, __bh);
-         bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, q, __bh))
+    for (bhp = MC_FIRST (mc); bhp != NULL; bhp = MC_NEXT (mc, bhp))
     {
       if (F_ISSET (bhp, BH_DIRTY) || bhp->ref != 0)
       {
@@ -215,10 +224,11 @@ retry:retry_need = 0;
   if (ar_cnt == 0)
   {
     ret = mp->lsn_cnt ? DB_INCOMPLETE : 0;
+    CDB___memp_unlock_all (dbmp);
     goto done;
   }
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
+  CDB___memp_unlock_all (dbmp);
 
   /*
    * Sort the buffers we're going to write immediately.
@@ -229,12 +239,15 @@ retry:retry_need = 0;
    */
   if (ar_cnt > 1)
     qsort (bharray, ar_cnt, sizeof (BH *), CDB___bhcmp);
+  CDB___memp_cmpr_prepare (dbmp, bharray, ar_cnt);
+  CDB___memp_bhwrite_batch (dbmp, bharray, ar_cnt, NULL);
 
-  R_LOCK (dbenv, &dbmp->reginfo);
-
-  /* Walk the array, writing buffers. */
+  /* Walk the array, writing buffers, each under its own cache's lock. */
   for (i = 0; i < ar_cnt; ++i)
   {
+    c_reginfo = BH_TO_REGINFO (dbmp, bharray[i]);
+    R_LOCK (dbenv, c_reginfo);
+
     /*
      * It's possible for a thread to have gotten the buffer since
      * we listed it for writing.  If the reference count is still
@@ -245,6 +258,7 @@ retry:retry_need = 0;
     if (bharray[i]->ref > 1)
     {
       --bharray[i]->ref;
+      R_UNLOCK (dbenv, c_reginfo);
       continue;
     }
 
@@ -254,6 +268,7 @@ retry:retry_need = 0;
 
     /* Release the buffer. */
     --bharray[i]->ref;
+    R_UNLOCK (dbenv, c_reginfo);
 
     if (ret == 0 && wrote)
       continue;
@@ -281,16 +296,18 @@ retry:retry_need = 0;
      *
      * they don't make any difference.
      */
+    R_LOCK (dbenv, &dbmp->reginfo);
     ZERO_LSN (mp->lsn);
     F_SET (mp, MP_LSN_RETRY);
+    R_UNLOCK (dbenv, &dbmp->reginfo);
 
     /* Release any buffers we're still pinning down. */
-    while (++i < ar_cnt)
-      --bharray[i]->ref;
+    CDB___memp_sbrelease (dbmp, bharray + i + 1, ar_cnt - i - 1);
 
     goto done;
   }
 
+  R_LOCK (dbenv, &dbmp->reginfo);
   ret = mp->lsn_cnt != 0 ? DB_INCOMPLETE : 0;
 
   /*
@@ -311,16 +328,51 @@ retry:retry_need = 0;
     }
     else
     {
+      R_UNLOCK (dbenv, &dbmp->reginfo);
       retry_done = 1;
       goto retry;
     }
   }
+  R_UNLOCK (dbenv, &dbmp->reginfo);
 
-done:R_UNLOCK (dbenv, &dbmp->reginfo);
-  MUTEX_UNLOCK (&mp->sync_mutex);
+done:MUTEX_UNLOCK (&mp->sync_mutex);
 
   CDB___os_free (bharray, ndirty * sizeof (BH *));
 
+  if (ret == 0)
+    ret = CDB___memp_sync_compact (dbmp);
+
+  return (ret);
+}
+
+/*
+ * CDB___memp_sync_compact --
+ *  Compact the extents of the packed compressed files that need it.  The
+ *  pages a checkpoint writes keep changing, and their old copies would
+ *  otherwise pile up until the file is synced or closed.
+ */
+static int
+CDB___memp_sync_compact (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPOOLFILE *dbmfp;
+  int ret;
+
+  ret = 0;
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  for (dbmfp = TAILQ_FIRST (&dbmp->dbmfq);
+       dbmfp != NULL && ret == 0; dbmfp = TAILQ_NEXT (dbmfp, q))
+  {
+    if (!F_ISSET (dbmfp, MP_CMPR) || !CDB___memp_cmpr_compactable (dbmfp))
+      continue;
+    ++dbmfp->ref;
+    MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+    ret = CDB___memp_cmpr_compact (dbmfp);
+    MUTEX_THREAD_LOCK (dbmp->mutexp);
+    --dbmfp->ref;
+  }
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+
   return (ret);
 }
 
@@ -400,6 +452,7 @@ CDB___memp_fsync (dbmfp)
   DB_MPOOL *dbmp;
   MCACHE *mc;
   MPOOL *mp;
+  REGINFO *c_reginfo;
   size_t mf_offset;
   u_int32_t ar_cnt, i, ndirty;
   int incomplete, ret, retry_done, retry_need, wrote;
@@ -408,15 +461,9 @@ CDB___memp_fsync (dbmfp)
   dbenv = dbmp->dbenv;
   mp = dbmp->reginfo.primary;
 
-  R_LOCK (dbenv, &dbmp->reginfo);
-
   /*
    * Allocate room for a list of buffers, and decide how many buffers
    * we can pin down.
-   *
-   * !!!
-   * Note: CDB___memp_sballoc has released our region lock if we're not
-   * continuing forward.
    */
   if ((ret =
        CDB___memp_sballoc (dbenv, &bharray, &ndirty)) != 0 || ndirty == 0)
@@ -428,17 +475,19 @@ retry:retry_need = 0;
    * Walk each cache's list of buffers and mark all dirty buffers to be
    * written and all pinned buffers to be potentially written (we can't
    * know if they'll need to be written until the holder returns them to
-   * the cache).  We do this in one pass while holding the region locked
-   * so that processes can't make new buffers dirty, causing us to never
-   * finish.
+   * the cache).  We do this in one pass over each cache while holding it
+   * locked so that processes can't make new buffers dirty, causing us to
+   * never finish.
    */
   mf_offset = R_OFFSET (&dbmp->reginfo, dbmfp->mfp);
   for (ar_cnt = 0, incomplete = 0, i = 0; i < mp->nc_reg; ++i)
   {
-    mc = dbmp->c_reginfo[i].primary;
+    c_reginfo = &dbmp->c_reginfo[i];
+    mc = c_reginfo->primary;
 
-    for (bhp = SH_TAILQ_FIRST (&mc->bhq, __bh);
-         bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, q, __bh))
+    R_LOCK (dbenv, c_reginfo);
+
+    for (bhp = MC_FIRST (mc); bhp != NULL; bhp = MC_NEXT (mc, bhp))
     {
       if (!F_ISSET (bhp, BH_DIRTY) || bhp->mf_offset != mf_offset)
         continue;
@@ -467,6 +516,9 @@ retry:retry_need = 0;
         break;
       }
     }
+
+    R_UNLOCK (dbenv, c_reginfo);
+
     if (ar_cnt >= ndirty)
       break;
   }
@@ -478,17 +530,18 @@ retry:retry_need = 0;
     goto done;
   }
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
-
   /* Sort the buffers we're going to write. */
   if (ar_cnt > 1)
     qsort (bharray, ar_cnt, sizeof (BH *), CDB___bhcmp);
+  CDB___memp_cmpr_prepare (dbmp, bharray, ar_cnt);
+  CDB___memp_bhwrite_batch (dbmp, bharray, ar_cnt, NULL);
 
-  R_LOCK (dbenv, &dbmp->reginfo);
-
-  /* Walk the array, writing buffers. */
+  /* Walk the array, writing buffers, each under its own cache's lock. */
   for (i = 0; i < ar_cnt;)
   {
+    c_reginfo = BH_TO_REGINFO (dbmp, bharray[i]);
+    R_LOCK (dbenv, c_reginfo);
+
     /*
      * It's possible for a thread to have gotten the buffer since
      * we listed it for writing.  If the reference count is still
@@ -500,6 +553,7 @@ retry:retry_need = 0;
     {
       incomplete = 1;
       --bharray[i++]->ref;
+      R_UNLOCK (dbenv, c_reginfo);
       continue;
     }
 
@@ -508,6 +562,7 @@ retry:retry_need = 0;
 
     /* Release the buffer. */
     --bharray[i++]->ref;
+    R_UNLOCK (dbenv, c_reginfo);
 
     if (ret == 0)
     {
@@ -521,8 +576,7 @@ retry:retry_need = 0;
      *
      * Release any buffers we're still pinning down.
      */
-    while (i < ar_cnt)
-      --bharray[i++]->ref;
+    CDB___memp_sbrelease (dbmp, bharray + i, ar_cnt - i);
     break;
   }
 
@@ -544,9 +598,7 @@ retry:retry_need = 0;
     }
   }
 
-done:R_UNLOCK (dbenv, &dbmp->reginfo);
-
-  CDB___os_free (bharray, ndirty * sizeof (BH *));
+done:CDB___os_free (bharray, ndirty * sizeof (BH *));
 
   /*
    * Sync the underlying file as the last thing we do, so that the OS
@@ -556,6 +608,8 @@ done:R_UNLOCK (dbenv, &dbmp->reginfo);
    * Don't lock the region around the sync, fsync(2) has no atomicity
    * issues.
    */
+  if (ret == 0 && !incomplete && F_ISSET (dbmfp, MP_CMPR))
+    ret = CDB___memp_cmpr_sync (dbmfp);
   if (ret == 0)
     ret = incomplete ? DB_INCOMPLETE : CDB___os_fsync (&dbmfp->fh);
 
@@ -582,22 +636,25 @@ CDB___memp_sballoc (dbenv, bharrayp, ndirtyp)
   mp = dbmp->reginfo.primary;
 
   /*
-   * We don't want to hold the region lock while we write the buffers,
-   * so only lock it while we create a list.
+   * We don't want to hold the cache locks while we write the buffers,
+   * so only lock them while we create a list.
    *
    * Walk through the list of caches, figuring out how many buffers
-   * we're going to need.
+   * we're going to need.  The caller will walk them again, so this is
+   * only an estimate, and there's no point in holding more than one
+   * cache lock at a time for it.
    *
-   * Make a point of not holding the region lock across the library
-   * allocation call.
+   * Make a point of not holding any lock across the library allocation
+   * call.
    */
   for (nclean = ndirty = 0, i = 0; i < mp->nc_reg; ++i)
   {
     mc = dbmp->c_reginfo[i].primary;
+    R_LOCK (dbenv, &dbmp->c_reginfo[i]);
     ndirty += mc->stat.st_page_dirty;
     nclean += mc->stat.st_page_clean;
+    R_UNLOCK (dbenv, &dbmp->c_reginfo[i]);
   }
-  R_UNLOCK (dbenv, &dbmp->reginfo);
   if (ndirty == 0)
   {
     *ndirtyp = 0;
@@ -627,12 +684,68 @@ CDB___memp_sballoc (dbenv, bharrayp, ndirtyp)
 
   *ndirtyp = ndirty;
 
-  R_LOCK (dbenv, &dbmp->reginfo);
-
   return (0);
 }
 
-static int
+/*
+ * CDB___memp_sbrelease --
+ *  Release buffers pinned for writing that we won't write after all.
+ */
+static void
+CDB___memp_sbrelease (dbmp, bharray, cnt)
+     DB_MPOOL *dbmp;
+     BH **bharray;
+     u_int32_t cnt;
+{
+  REGINFO *c_reginfo;
+  u_int32_t i;
+
+  for (i = 0; i < cnt; ++i)
+  {
+    c_reginfo = BH_TO_REGINFO (dbmp, bharray[i]);
+    R_LOCK (dbmp->dbenv, c_reginfo);
+    --bharray[i]->ref;
+    R_UNLOCK (dbmp->dbenv, c_reginfo);
+  }
+}
+
+/*
+ * CDB___memp_lock_all --
+ *  Lock every cache, in order, and then the main region.
+ */
+static void
+CDB___memp_lock_all (dbmp)
+     DB_MPOOL *dbmp;
+{
+  int i;
+
+  for (i = 0; i < dbmp->nc_reg; ++i)
+    R_LOCK (dbmp->dbenv, &dbmp->c_reginfo[i]);
+  R_LOCK (dbmp->dbenv, &dbmp->reginfo);
+}
+
+/*
+ * CDB___memp_unlock_all --
+ *  Release the locks acquired by CDB___memp_lock_all.
+ */
+static void
+CDB___memp_unlock_all (dbmp)
+     DB_MPOOL *dbmp;
+{
+  int i;
+
+  R_UNLOCK (dbmp->dbenv, &dbmp->reginfo);
+  for (i = dbmp->nc_reg - 1; i >= 0; --i)
+    R_UNLOCK (dbmp->dbenv, &dbmp->c_reginfo[i]);
+}
+
+/*
+ * CDB___bhcmp --
+ *  Sort buffer headers by file and page.
+ *
+ * PUBLIC: int CDB___bhcmp __P((const void *, const void *));
+ */
+int
 CDB___bhcmp (p1, p2)
      const void *p1, *p2;
 {
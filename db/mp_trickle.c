@@ -13,6 +13,17 @@ static const char sccsid[] = "@(#)mp_trickle.c  11.3 (Sleepycat) 9/16/99";
 #ifndef NO_SYSTEM_INCLUDES
 #include <sys/types.h>
 
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else
+#include <time.h>
+#endif
+#endif
+
 #include <errno.h>
 #include <stdlib.h>
 #endif
@@ -21,7 +32,15 @@ static const char sccsid[] = "@(#)mp_trickle.c  11.3 (Sleepycat) 9/16/99";
 #include "db_shash.h"
 #include "mp.h"
 
-static int CDB___memp_trick __P ((DB_ENV *, int, int, int *));
+/*
+ * The most buffers written by one pass of CDB___memp_trick; they are
+ * pinned for the duration of the pass.
+ */
+#define  MP_TRICKLE_MAX  64
+
+static int CDB___memp_trickle_caches __P ((DB_ENV *, int, int, int *));
+static int CDB___memp_trick __P ((DB_ENV *, int, int, int, int *));
+static DB_MPOOLFILE *CDB___memp_trick_hold __P ((DB_MPOOL *, MPOOLFILE *));
 
 /*
  * CDB_memp_trickle --
@@ -32,50 +51,69 @@ CDB_memp_trickle (dbenv, pct, nwrotep)
      DB_ENV *dbenv;
      int pct, *nwrotep;
 {
-  DB_MPOOL *dbmp;
-  MPOOL *mp;
-  u_int32_t i;
-  int ret;
-
   PANIC_CHECK (dbenv);
   ENV_REQUIRES_CONFIG (dbenv, dbenv->mp_handle, DB_INIT_MPOOL);
 
-  dbmp = dbenv->mp_handle;
-  mp = dbmp->reginfo.primary;
-
   if (nwrotep != NULL)
     *nwrotep = 0;
 
   if (pct < 1 || pct > 100)
     return (EINVAL);
 
-  R_LOCK (dbenv, &dbmp->reginfo);
+  return (CDB___memp_trickle_caches (dbenv, pct, 0, nwrotep));
+}
 
-  /* Loop through the caches... */
+/*
+ * CDB___memp_trickle_caches --
+ *  Trickle every cache.  If ownfiles is set, only write the pages of files
+ *  this process has open.
+ */
+static int
+CDB___memp_trickle_caches (dbenv, pct, ownfiles, nwrotep)
+     DB_ENV *dbenv;
+     int pct, ownfiles, *nwrotep;
+{
+  DB_MPOOL *dbmp;
+  MPOOL *mp;
+  u_int32_t i;
+  int ret;
+
+  dbmp = dbenv->mp_handle;
+  mp = dbmp->reginfo.primary;
+
+  /* Loop through the caches, locking each one in turn... */
   for (ret = 0, i = 0; i < mp->nc_reg; ++i)
-    if ((ret = CDB___memp_trick (dbenv, i, pct, nwrotep)) != 0)
+  {
+    R_LOCK (dbenv, &dbmp->c_reginfo[i]);
+    ret = CDB___memp_trick (dbenv, i, pct, ownfiles, nwrotep);
+    R_UNLOCK (dbenv, &dbmp->c_reginfo[i]);
+    if (ret != 0)
       break;
+  }
 
-  R_UNLOCK (dbenv, &dbmp->reginfo);
   return (ret);
 }
 
 /*
  * CDB___memp_trick --
  *  Trickle a single cache.
+ *
+ * The buffers are written in batches sorted by file and page, so that
+ * neighbouring dirty pages go out as sequential writes.
  */
 static int
-CDB___memp_trick (dbenv, ncache, pct, nwrotep)
+CDB___memp_trick (dbenv, ncache, pct, ownfiles, nwrotep)
      DB_ENV *dbenv;
-     int ncache, pct, *nwrotep;
+     int ncache, pct, ownfiles, *nwrotep;
 {
-  BH *bhp;
+  BH *bhp, *bharray[MP_TRICKLE_MAX];
   DB_MPOOL *dbmp;
+  DB_MPOOLFILE *dbmfp;
   MCACHE *mc;
   MPOOLFILE *mfp;
   db_pgno_t pgno;
-  u_long total;
-  int ret, wrote;
+  u_long need, total;
+  int ar_cnt, batched[MP_TRICKLE_MAX], i, ret, wrote, written;
 
   dbmp = dbenv->mp_handle;
   mc = dbmp->c_reginfo[ncache].primary;
@@ -95,9 +133,18 @@ loop:total = mc->stat.st_page_clean + mc->stat.st_page_dirty;
       (mc->stat.st_page_clean * 100) / total >= (u_long) pct)
     return (0);
 
-  /* Loop until we write a buffer. */
-  for (bhp = SH_TAILQ_FIRST (&mc->bhq, __bh);
-       bhp != NULL; bhp = SH_TAILQ_NEXT (bhp, q, __bh))
+  /* The number of buffers to write to get there, in batches. */
+  need = (total * pct + 99) / 100 - mc->stat.st_page_clean;
+  if (need > MP_TRICKLE_MAX)
+    need = MP_TRICKLE_MAX;
+
+  /*
+   * Pin down the dirty buffers we can write, least recently used first.
+   * We keep the cache locked while listing them, so they can't change.
+   */
+  ar_cnt = 0;
+  for (bhp = MC_FIRST (mc);
+       bhp != NULL && (u_long) ar_cnt < need; bhp = MC_NEXT (mc, bhp))
   {
     if (bhp->ref != 0 || !F_ISSET (bhp, BH_DIRTY) || F_ISSET (bhp, BH_LOCKED))
       continue;
@@ -111,27 +158,451 @@ loop:total = mc->stat.st_page_clean + mc->stat.st_page_dirty;
     if (F_ISSET (mfp, MP_TEMP))
       continue;
 
+    ++bhp->ref;
+    bharray[ar_cnt++] = bhp;
+  }
+  if (ar_cnt == 0)
+    return (0);
+
+  if (ar_cnt > 1)
+    qsort (bharray, ar_cnt, sizeof (BH *), CDB___bhcmp);
+  R_UNLOCK (dbenv, &dbmp->c_reginfo[ncache]);
+  CDB___memp_cmpr_prepare (dbmp, bharray, ar_cnt);
+  CDB___memp_bhwrite_batch (dbmp, bharray, ar_cnt, batched);
+  R_LOCK (dbenv, &dbmp->c_reginfo[ncache]);
+
+  for (ret = written = 0, i = 0; i < ar_cnt; ++i)
+  {
+    bhp = bharray[i];
+
+    /* Written along with the batch, which left it clean. */
+    if (batched[i])
+    {
+      --bhp->ref;
+      ++written;
+      ++mc->stat.st_page_trickle;
+      if (nwrotep != NULL)
+        ++ * nwrotep;
+      continue;
+    }
+
+    /*
+     * The cache lock is released while a buffer is written, another
+     * thread may have gotten or written one of ours since we listed it.
+     */
+    if (bhp->ref > 1 || !F_ISSET (bhp, BH_DIRTY))
+    {
+      --bhp->ref;
+      continue;
+    }
+
+    mfp = R_ADDR (&dbmp->reginfo, bhp->mf_offset);
+    dbmfp = NULL;
+    if (ownfiles && (dbmfp = CDB___memp_trick_hold (dbmp, mfp)) == NULL)
+    {
+      --bhp->ref;
+      continue;
+    }
+
     pgno = bhp->pgno;
-    if ((ret = CDB___memp_bhwrite (dbmp, mfp, bhp, NULL, &wrote)) != 0)
-      return (ret);
+    ret = CDB___memp_bhwrite (dbmp, mfp, bhp, NULL, &wrote);
+    --bhp->ref;
+
+    if (dbmfp != NULL)
+    {
+      MUTEX_THREAD_LOCK (dbmp->mutexp);
+      --dbmfp->ref;
+      MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+    }
 
     /*
      * Any process syncing the shared memory buffer pool had better
      * be able to write to any underlying file.  Be understanding,
      * but firm, on this point.
      */
-    if (!wrote)
+    if (ret == 0 && !wrote)
     {
       CDB___db_err (dbenv, "%s: unable to flush page: %lu",
                     CDB___memp_fns (dbmp, mfp), (u_long) pgno);
-      return (EPERM);
+      ret = EPERM;
+    }
+    if (ret != 0)
+    {
+      /* Release any buffers we're still pinning down. */
+      while (++i < ar_cnt)
+        --bharray[i]->ref;
+      return (ret);
     }
 
+    ++written;
     ++mc->stat.st_page_trickle;
     if (nwrotep != NULL)
       ++ * nwrotep;
-    goto loop;
   }
 
+  /* Give up if other threads got every buffer we listed. */
+  if (written == 0)
+    return (0);
+  goto loop;
+}
+
+/*
+ * CDB___memp_trick_hold --
+ *  Find this process' handle on a file and hold it open, see the comment
+ *  in CDB_memp_fclose().  The background flusher only writes the pages of
+ *  such files: opening a file behind the back of a thread that has just
+ *  closed it would lose its compression settings.
+ */
+static DB_MPOOLFILE *
+CDB___memp_trick_hold (dbmp, mfp)
+     DB_MPOOL *dbmp;
+     MPOOLFILE *mfp;
+{
+  DB_MPOOLFILE *dbmfp;
+
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  for (dbmfp = TAILQ_FIRST (&dbmp->dbmfq);
+       dbmfp != NULL; dbmfp = TAILQ_NEXT (dbmfp, q))
+    if (dbmfp->mfp == mfp)
+    {
+      ++dbmfp->ref;
+      break;
+    }
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+
+  return (dbmfp);
+}
+
+#ifdef HAVE_MUTEX_PTHREADS
+/*
+ * DB_MPFLUSH --
+ *  The background flusher of a DB_MPOOL handle.
+ *
+ * The thread wakes up every DB_ENV->mp_flush_usecs, or when a thread
+ * allocating a buffer had to pass over dirty ones, and trickles the
+ * caches until DB_ENV->mp_flush_pct percent of their buffers are clean.
+ * Buffer allocation then finds clean buffers to reuse and seldom has to
+ * compress and write pages itself.  After each pass it compacts the
+ * extent of a packed compressed file, if one has grown mostly garbage.
+ * If a pass fails, the thread logs the error and exits, and is dead from
+ * then on: allocation no longer leaves dirty buffers to it.
+ *
+ * The weak compression databases aren't opened DB_THREAD (see the comment
+ * in mp_cmpr.c), so compressed page writes are serialized by the cmpr
+ * mutex.  It is recursive: writing a compressed page may allocate a
+ * buffer for the weak compression database, which may write another
+ * compressed page.
+ */
+typedef struct __db_mpflush
+{
+  pthread_t tid;                /* Flusher thread. */
+  pthread_mutex_t mutex;        /* Protects the fields below. */
+  pthread_cond_t cond;          /* Signaled to wake the flusher up. */
+  int kicked;                   /* Woken up before the period. */
+  int stop;                     /* Exit. */
+  int dead;                     /* Exited on an error. */
+
+  pthread_mutex_t cmpr;         /* Compressed page writes. */
+} DB_MPFLUSH;
+
+static void *CDB___memp_flusher __P ((void *));
+static int CDB___memp_flusher_compact __P ((DB_MPOOL *));
+
+/*
+ * CDB___memp_flusher_start --
+ *  Start the background flusher of the environment's memory pool.
+ *
+ * PUBLIC: int CDB___memp_flusher_start __P((DB_ENV *));
+ */
+int
+CDB___memp_flusher_start (dbenv)
+     DB_ENV *dbenv;
+{
+  DB_MPFLUSH *flusher;
+  DB_MPOOL *dbmp;
+  pthread_mutexattr_t attr;
+  int ret;
+
+  dbmp = dbenv->mp_handle;
+
+  /* The caches are shared with the flusher: their locks must be real. */
+  if (!F_ISSET (dbenv, DB_ENV_THREAD))
+  {
+    CDB___db_err (dbenv,
+                  "the background flusher requires an environment opened with DB_THREAD");
+    return (EINVAL);
+  }
+
+  if ((ret = CDB___os_calloc (1, sizeof (DB_MPFLUSH), &flusher)) != 0)
+    return (ret);
+  if ((ret = pthread_mutexattr_init (&attr)) != 0)
+    goto err;
+  if ((ret = pthread_mutexattr_settype (&attr,
+                                        PTHREAD_MUTEX_RECURSIVE)) == 0 &&
+      (ret = pthread_mutex_init (&flusher->cmpr, &attr)) == 0)
+    ret = pthread_mutex_init (&flusher->mutex, NULL);
+  (void) pthread_mutexattr_destroy (&attr);
+  if (ret != 0)
+    goto err;
+  if ((ret = pthread_cond_init (&flusher->cond, NULL)) != 0)
+    goto err;
+
+  dbmp->flusher = flusher;
+  if ((ret =
+       pthread_create (&flusher->tid, NULL, CDB___memp_flusher, dbenv)) != 0)
+  {
+    dbmp->flusher = NULL;
+    goto err;
+  }
   return (0);
+
+err:CDB___db_err (dbenv, "unable to start the background flusher: %s",
+                CDB_db_strerror (ret));
+  CDB___os_free (flusher, sizeof (DB_MPFLUSH));
+  return (ret);
+}
+
+/*
+ * CDB___memp_flusher_stop --
+ *  Stop the background flusher, if any, and wait for it to exit.
+ *
+ * PUBLIC: void CDB___memp_flusher_stop __P((DB_ENV *));
+ */
+void
+CDB___memp_flusher_stop (dbenv)
+     DB_ENV *dbenv;
+{
+  DB_MPFLUSH *flusher;
+  DB_MPOOL *dbmp;
+
+  dbmp = dbenv->mp_handle;
+  if ((flusher = dbmp->flusher) == NULL)
+    return;
+
+  pthread_mutex_lock (&flusher->mutex);
+  flusher->stop = 1;
+  pthread_cond_signal (&flusher->cond);
+  pthread_mutex_unlock (&flusher->mutex);
+  (void) pthread_join (flusher->tid, NULL);
+
+  dbmp->flusher = NULL;
+  (void) pthread_cond_destroy (&flusher->cond);
+  (void) pthread_mutex_destroy (&flusher->mutex);
+  (void) pthread_mutex_destroy (&flusher->cmpr);
+  CDB___os_free (flusher, sizeof (DB_MPFLUSH));
+}
+
+/*
+ * CDB___memp_flusher_kick --
+ *  Wake the background flusher up, if any.
+ *
+ * PUBLIC: void CDB___memp_flusher_kick __P((DB_MPOOL *));
+ */
+void
+CDB___memp_flusher_kick (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPFLUSH *flusher;
+
+  if ((flusher = dbmp->flusher) == NULL)
+    return;
+
+  pthread_mutex_lock (&flusher->mutex);
+  if (!flusher->kicked && !flusher->dead)
+  {
+    flusher->kicked = 1;
+    pthread_cond_signal (&flusher->cond);
+  }
+  pthread_mutex_unlock (&flusher->mutex);
+}
+
+/*
+ * CDB___memp_flusher_alive --
+ *  Return whether a background flusher is running.
+ *
+ * PUBLIC: int CDB___memp_flusher_alive __P((DB_MPOOL *));
+ */
+int
+CDB___memp_flusher_alive (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPFLUSH *flusher;
+  int alive;
+
+  if ((flusher = dbmp->flusher) == NULL)
+    return (0);
+
+  pthread_mutex_lock (&flusher->mutex);
+  alive = !flusher->dead;
+  pthread_mutex_unlock (&flusher->mutex);
+  return (alive);
+}
+
+/*
+ * CDB___memp_flusher_lock --
+ *  Serialize a compressed page write with the background flusher.
+ *
+ * PUBLIC: void CDB___memp_flusher_lock __P((DB_MPOOL *));
+ */
+void
+CDB___memp_flusher_lock (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPFLUSH *flusher;
+
+  if ((flusher = dbmp->flusher) != NULL)
+    pthread_mutex_lock (&flusher->cmpr);
+}
+
+/*
+ * CDB___memp_flusher_unlock --
+ *  Release the lock acquired by CDB___memp_flusher_lock.
+ *
+ * PUBLIC: void CDB___memp_flusher_unlock __P((DB_MPOOL *));
+ */
+void
+CDB___memp_flusher_unlock (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPFLUSH *flusher;
+
+  if ((flusher = dbmp->flusher) != NULL)
+    pthread_mutex_unlock (&flusher->cmpr);
+}
+
+/*
+ * CDB___memp_flusher --
+ *  The background flusher thread.
+ */
+static void *
+CDB___memp_flusher (arg)
+     void *arg;
+{
+  DB_ENV *dbenv;
+  DB_MPFLUSH *flusher;
+  DB_MPOOL *dbmp;
+  struct timespec ts;
+  struct timeval tv;
+  int ret;
+
+  dbenv = arg;
+  dbmp = dbenv->mp_handle;
+  flusher = dbmp->flusher;
+
+  pthread_mutex_lock (&flusher->mutex);
+  while (!flusher->stop)
+  {
+    if (!flusher->kicked)
+    {
+      (void) gettimeofday (&tv, NULL);
+      ts.tv_sec = tv.tv_sec + dbenv->mp_flush_usecs / 1000000;
+      ts.tv_nsec = (tv.tv_usec + dbenv->mp_flush_usecs % 1000000) * 1000;
+      if (ts.tv_nsec >= 1000000000)
+      {
+        ++ts.tv_sec;
+        ts.tv_nsec -= 1000000000;
+      }
+      (void) pthread_cond_timedwait (&flusher->cond, &flusher->mutex, &ts);
+      if (flusher->stop)
+        break;
+    }
+    flusher->kicked = 0;
+    pthread_mutex_unlock (&flusher->mutex);
+
+    ret = CDB___memp_trickle_caches (dbenv,
+                                     (int) dbenv->mp_flush_pct, 1, NULL);
+    if (ret == 0)
+      ret = CDB___memp_flusher_compact (dbmp);
+
+    pthread_mutex_lock (&flusher->mutex);
+    if (ret != 0)
+    {
+      CDB___db_err (dbenv, "background flusher: %s", CDB_db_strerror (ret));
+      flusher->dead = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&flusher->mutex);
+
+  return (NULL);
+}
+
+/*
+ * CDB___memp_flusher_compact --
+ *  Compact the extent of a packed compressed file, if one needs it.
+ */
+static int
+CDB___memp_flusher_compact (dbmp)
+     DB_MPOOL *dbmp;
+{
+  DB_MPOOLFILE *dbmfp;
+  int ret;
+
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  for (dbmfp = TAILQ_FIRST (&dbmp->dbmfq);
+       dbmfp != NULL; dbmfp = TAILQ_NEXT (dbmfp, q))
+    if (F_ISSET (dbmfp, MP_CMPR) && CDB___memp_cmpr_compactable (dbmfp))
+    {
+      ++dbmfp->ref;
+      break;
+    }
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+  if (dbmfp == NULL)
+    return (0);
+
+  ret = CDB___memp_cmpr_compact (dbmfp);
+
+  MUTEX_THREAD_LOCK (dbmp->mutexp);
+  --dbmfp->ref;
+  MUTEX_THREAD_UNLOCK (dbmp->mutexp);
+
+  return (ret);
+}
+#else
+/*
+ * Without POSIX threads there is no background flusher.
+ */
+int
+CDB___memp_flusher_start (dbenv)
+     DB_ENV *dbenv;
+{
+  CDB___db_err (dbenv, "the background flusher requires POSIX threads");
+  return (EINVAL);
+}
+
+void
+CDB___memp_flusher_stop (dbenv)
+     DB_ENV *dbenv;
+{
+  COMPQUIET (dbenv, NULL);
+}
+
+void
+CDB___memp_flusher_kick (dbmp)
+     DB_MPOOL *dbmp;
+{
+  COMPQUIET (dbmp, NULL);
+}
+
+int
+CDB___memp_flusher_alive (dbmp)
+     DB_MPOOL *dbmp;
+{
+  COMPQUIET (dbmp, NULL);
+  return (0);
+}
+
+void
+CDB___memp_flusher_lock (dbmp)
+     DB_MPOOL *dbmp;
+{
+  COMPQUIET (dbmp, NULL);
+}
+
+void
+CDB___memp_flusher_unlock (dbmp)
+     DB_MPOOL *dbmp;
+{
+  COMPQUIET (dbmp, NULL);
 }
+#endif /* HAVE_MUTEX_PTHREADS */
@@ -25,6 +25,7 @@ struct __fh_t
 
 #define  DB_FH_NOSYNC  0x01     /* Handle doesn't need to be sync'd. */
 #define  DB_FH_VALID  0x02      /* Handle is valid. */
+#define  DB_FH_DIRECT  0x04     /* Handle bypasses the system's buffers. */
   u_int8_t flags;
 };
 
@@ -43,3 +44,16 @@ typedef struct __io_t
   u_int8_t *buf;                /* Buffer. */
   size_t bytes;                 /* Bytes read/written. */
 } DB_IO;
+
+/*
+ * Direct I/O wants file offsets and lengths that are multiples of the
+ * device block size, and buffers aligned the same way.
+ */
+#define  DB_DIRECT_ALIGN  512
+
+/*
+ * DB_IORING --
+ *  A queue of I/Os handed to the system together (see os_uring.c).
+ */
+struct __db_ioring;
+typedef struct __db_ioring DB_IORING;
@@ -33,6 +33,9 @@ int CDB___os_rename __P ((const char *, const char *));
 int CDB___os_isroot __P ((void));
 char *CDB___db_rpath __P ((const char *));
 int CDB___os_io __P ((DB_IO *, int, ssize_t *));
+int CDB___os_direct_ok __P ((DB_IO *));
+void CDB___os_direct_off __P ((DB_FH *));
+void CDB___os_readahead __P ((DB_IORING *, DB_IO *, int));
 int CDB___os_read __P ((DB_FH *, void *, size_t, ssize_t *));
 int CDB___os_write __P ((DB_FH *, void *, size_t, ssize_t *));
 int CDB___os_seek
@@ -45,6 +48,10 @@ int CDB___os_ioinfo __P ((const char *,
                           DB_FH *, u_int32_t *, u_int32_t *, u_int32_t *));
 int CDB___os_tmpdir __P ((DB_ENV *, u_int32_t));
 int CDB___os_unlink __P ((const char *));
+int CDB___os_ioring_open __P ((u_int32_t, MUTEX *, DB_IORING **));
+void CDB___os_ioring_close __P ((DB_IORING *));
+int CDB___os_iobatch __P ((DB_IORING *, DB_IO *, int, int, ssize_t *));
+int CDB___os_ioring_advise __P ((DB_IORING *, DB_IO *, int));
 #if defined(_WIN32)
 int __os_win32_errno __P ((void));
 #endif
@@ -5,6 +5,7 @@
  *  Sleepycat Software.  All rights reserved.
  */
 
+#define _GNU_SOURCE             /* O_DIRECT */
 #include "db_config.h"
 
 #ifndef lint
@@ -14,11 +15,13 @@ static const char sccsid[] = "@(#)os_open.c  11.1 (Sleepycat) 7/25/99";
 #ifndef NO_SYSTEM_INCLUDES
 #include <sys/types.h>
 
+#include <errno.h>
 #include <fcntl.h>
 #include <signal.h>
 #endif
 
 #include "db_int.h"
+#include "os_jump.h"
 
 /*
  * CDB___os_open --
@@ -72,6 +75,16 @@ CDB___os_open (name, flags, mode, fhp)
   if (LF_ISSET (DB_OSO_TRUNC))
     oflags |= O_TRUNC;
 
+#if defined(O_DIRECT)
+  /*
+   * Direct I/O is done with pread(2)/pwrite(2) on the descriptor, the
+   * replacement I/O functions can't be asked for it.
+   */
+  if (LF_ISSET (DB_OSO_DIRECT) &&
+      CDB___db_jump.j_read == NULL && CDB___db_jump.j_write == NULL)
+    oflags |= O_DIRECT;
+#endif
+
 #if defined(HAVE_SIGFILLSET)
   /*
    * We block every signal we can get our hands on so that the temporary
@@ -86,8 +99,21 @@ CDB___os_open (name, flags, mode, fhp)
   }
 #endif
 
-  /* Open the file. */
-  if ((ret = CDB___os_openhandle (name, oflags, mode, fhp)) != 0)
+  /*
+   * Open the file.  Some filesystems refuse direct I/O, the file is then
+   * used through the system's buffers as usual.
+   */
+  ret = CDB___os_openhandle (name, oflags, mode, fhp);
+#if defined(O_DIRECT)
+  if (ret == EINVAL && (oflags & O_DIRECT))
+  {
+    oflags &= ~O_DIRECT;
+    ret = CDB___os_openhandle (name, oflags, mode, fhp);
+  }
+  if (ret == 0 && (oflags & O_DIRECT))
+    F_SET (fhp, DB_FH_DIRECT);
+#endif
+  if (ret != 0)
     return (ret);
 
   /* Delete any temporary file. */
@@ -5,7 +5,8 @@
  *  Sleepycat Software.  All rights reserved.
  */
 
-#define _XOPEN_SOURCE 500
+#define _XOPEN_SOURCE 600
+#define _GNU_SOURCE             /* O_DIRECT */
 #include <sys/types.h>
 #include <unistd.h>
 #ifndef u_long
@@ -21,6 +22,11 @@ static const char sccsid[] = "@(#)os_rw.c  11.2 (Sleepycat) 9/20/99";
 #ifndef NO_SYSTEM_INCLUDES
 #include <sys/types.h>
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
 #ifndef _MSC_VER                /* _WIN32 */
 #include <unistd.h>
 #endif
@@ -29,6 +35,10 @@ static const char sccsid[] = "@(#)os_rw.c  11.2 (Sleepycat) 9/20/99";
 #include "db_int.h"
 #include "os_jump.h"
 
+#if defined(O_DIRECT)
+static int CDB___os_io_direct __P ((DB_IO *, int, ssize_t *));
+#endif
+
 /*
  * CDB___os_io --
  *  Do an I/O.
@@ -43,6 +53,20 @@ CDB___os_io (db_iop, op, niop)
 {
   int ret;
 
+#if defined(O_DIRECT)
+  /*
+   * Direct I/O goes through an aligned copy of the buffer.  If the system
+   * won't do it for this I/O, the handle goes back to buffered I/O.
+   */
+  if (F_ISSET (db_iop->fhp, DB_FH_DIRECT))
+  {
+    if (CDB___os_direct_ok (db_iop) &&
+        (ret = CDB___os_io_direct (db_iop, op, niop)) != EINVAL)
+      return (ret);
+    CDB___os_direct_off (db_iop->fhp);
+  }
+#endif
+
   /* HACK to debug where the O_BINARY mode of the file gets fouled up */
   /*
      printf("\n[CDB___os_io]");
@@ -99,6 +123,109 @@ err:MUTEX_THREAD_UNLOCK (db_iop->mutexp);
 
 }
 
+#if defined(O_DIRECT)
+/*
+ * CDB___os_io_direct --
+ *  Do an I/O on a handle opened for direct I/O.
+ */
+static int
+CDB___os_io_direct (db_iop, op, niop)
+     DB_IO *db_iop;
+     int op;
+     ssize_t *niop;
+{
+  off_t offset;
+  void *buf;
+  int ret;
+
+  if ((ret = posix_memalign (&buf, DB_DIRECT_ALIGN, db_iop->bytes)) != 0)
+    return (ret);
+  offset = (off_t) db_iop->pgno * db_iop->pagesize;
+  if (op == DB_IO_WRITE)
+  {
+    memcpy (buf, db_iop->buf, db_iop->bytes);
+    *niop = pwrite (db_iop->fhp->fd, buf, db_iop->bytes, offset);
+  }
+  else
+  {
+    *niop = pread (db_iop->fhp->fd, buf, db_iop->bytes, offset);
+    if (*niop > 0)
+      memcpy (db_iop->buf, buf, *niop);
+  }
+  ret = *niop < 0 ? CDB___os_get_errno () : 0;
+  free (buf);
+  return (ret);
+}
+#endif /* O_DIRECT */
+
+/*
+ * CDB___os_direct_ok --
+ *  Return if an I/O can be done on a handle opened for direct I/O: the
+ *  offset and the length must be aligned, the buffer is copied anyway.
+ *
+ * PUBLIC: int CDB___os_direct_ok __P((DB_IO *));
+ */
+int
+CDB___os_direct_ok (db_iop)
+     DB_IO *db_iop;
+{
+  return (db_iop->pagesize % DB_DIRECT_ALIGN == 0 &&
+          db_iop->bytes % DB_DIRECT_ALIGN == 0);
+}
+
+/*
+ * CDB___os_direct_off --
+ *  Go back to I/O through the system's buffers on a handle.
+ *
+ * PUBLIC: void CDB___os_direct_off __P((DB_FH *));
+ */
+void
+CDB___os_direct_off (fhp)
+     DB_FH *fhp;
+{
+#if defined(O_DIRECT)
+  int flags;
+
+  if ((flags = fcntl (fhp->fd, F_GETFL)) != -1)
+    (void) fcntl (fhp->fd, F_SETFL, flags & ~O_DIRECT);
+#endif
+  F_CLR (fhp, DB_FH_DIRECT);
+}
+
+/*
+ * CDB___os_readahead --
+ *  Tell the system that the runs of pages described by the DB_IO
+ *  structures will be read soon, so that it can start reading them in
+ *  the background.  The advice goes through the ring if there is one.
+ *  This is only a hint, and a no-op where there is no way to give it or
+ *  for handles that bypass the system's buffers.
+ *
+ * PUBLIC: void CDB___os_readahead __P((DB_IORING *, DB_IO *, int));
+ */
+void
+CDB___os_readahead (ringp, db_iop, n)
+     DB_IORING *ringp;
+     DB_IO *db_iop;
+     int n;
+{
+#ifdef POSIX_FADV_WILLNEED
+  /* The replacement I/O functions may not read from this descriptor. */
+  if (CDB___db_jump.j_read != NULL)
+    return;
+  if (ringp != NULL && CDB___os_ioring_advise (ringp, db_iop, n) == 0)
+    return;
+  for (; n > 0; --n, ++db_iop)
+    if (!F_ISSET (db_iop->fhp, DB_FH_DIRECT))
+      (void) posix_fadvise (db_iop->fhp->fd,
+                            (off_t) db_iop->pgno * db_iop->pagesize,
+                            (off_t) db_iop->bytes, POSIX_FADV_WILLNEED);
+#else
+  COMPQUIET (ringp, NULL);
+  COMPQUIET (db_iop, NULL);
+  COMPQUIET (n, 0);
+#endif
+}
+
 /*
  * CDB___os_read --
  *  Read from a file handle.
@@ -0,0 +1,504 @@
+/*-
+ * See the file LICENSE for redistribution information.
+ *
+ * Batched I/O through the Linux io_uring interface.
+ *
+ * A ring is a pair of queues shared with the kernel: I/Os are described in
+ * the submission queue, handed to the kernel together with a single system
+ * call, and their results are collected from the completion queue.  The
+ * memory pool uses one to write the buffers of a sync or trickle pass, and
+ * another to give readahead advice without waiting for it.
+ *
+ * The ring is used where configure found it, and its readahead advice
+ * operation, in the system headers (HAVE_IO_URING).  Whether the running
+ * kernel knows about it is found out when it is set up.  Everywhere else,
+ * and whenever the ring can't be used, the I/Os are done one at a time by
+ * CDB___os_io, which is also what the ring falls back to for any I/O it
+ * didn't complete in full.
+ */
+
+#define _GNU_SOURCE             /* O_DIRECT */
+#include "db_config.h"
+
+#ifndef NO_SYSTEM_INCLUDES
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _MSC_VER                /* _WIN32 */
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+#endif
+#endif
+
+#include "db_int.h"
+#include "os_jump.h"
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+#ifdef HAVE_IO_URING
+struct __db_ioring
+{
+  MUTEX *mutexp;                /* Ring thread lock. */
+  int fd;                       /* Ring file descriptor. */
+  u_int32_t entries;            /* Submission queue size. */
+  u_int32_t advised;            /* Advice submitted and not yet reaped. */
+  int disabled;                 /* Kernel can't do what we ask. */
+
+  void *sq_ring;                /* Mapped submission queue. */
+  size_t sq_len;
+  u_int32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+  struct io_uring_sqe *sqes;    /* Mapped submission entries. */
+  size_t sqes_len;
+
+  void *cq_ring;                /* Mapped completion queue. */
+  size_t cq_len;
+  u_int32_t *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  ssize_t *res;                 /* Results of the batch in progress. */
+  void **bounce;                /* Aligned copies for direct I/O. */
+};
+
+static int CDB___os_ioring_enter __P ((DB_IORING *, u_int32_t, u_int32_t));
+static void CDB___os_ioring_prep __P ((DB_IORING *,
+                                       int, DB_IO *, void *, u_int64_t));
+static void CDB___os_ioring_reap __P ((DB_IORING *, u_int32_t));
+static u_int32_t CDB___os_ioring_room __P ((DB_IORING *));
+static u_int32_t CDB___os_ioring_submit __P ((DB_IORING *, int));
+#endif /* HAVE_IO_URING */
+
+/*
+ * CDB___os_ioring_open --
+ *  Set up a ring of the given size, protected by the given thread mutex.
+ *  Returns successfully with a NULL ring if the system can't provide one,
+ *  the caller then does its I/O as usual.
+ *
+ * PUBLIC: int CDB___os_ioring_open __P((u_int32_t, MUTEX *, DB_IORING **));
+ */
+int
+CDB___os_ioring_open (entries, mutexp, ringpp)
+     u_int32_t entries;
+     MUTEX *mutexp;
+     DB_IORING **ringpp;
+{
+#ifdef HAVE_IO_URING
+  DB_IORING *ringp;
+  struct io_uring_params p;
+  u_int8_t *sq, *cq;
+  int ret;
+
+  *ringpp = NULL;
+
+  /* The replacement I/O functions must see all the I/O. */
+  if (CDB___db_jump.j_read != NULL || CDB___db_jump.j_write != NULL)
+    return (0);
+
+  if ((ret = CDB___os_calloc (1, sizeof (DB_IORING), &ringp)) != 0)
+    return (ret);
+  ringp->mutexp = mutexp;
+  ringp->sq_ring = ringp->cq_ring = ringp->sqes = MAP_FAILED;
+
+  memset (&p, 0, sizeof (p));
+  if ((ringp->fd = syscall (__NR_io_uring_setup, entries, &p)) < 0)
+    goto fallback;
+  ringp->entries = p.sq_entries;
+
+  ringp->sq_len = p.sq_off.array + p.sq_entries * sizeof (u_int32_t);
+  ringp->cq_len = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  ringp->sqes_len = p.sq_entries * sizeof (struct io_uring_sqe);
+  if ((ringp->sq_ring = mmap (NULL, ringp->sq_len, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ringp->fd,
+                              IORING_OFF_SQ_RING)) == MAP_FAILED ||
+      (ringp->cq_ring = mmap (NULL, ringp->cq_len, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ringp->fd,
+                              IORING_OFF_CQ_RING)) == MAP_FAILED ||
+      (ringp->sqes = mmap (NULL, ringp->sqes_len, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, ringp->fd,
+                           IORING_OFF_SQES)) == MAP_FAILED)
+    goto fallback;
+
+  sq = ringp->sq_ring;
+  ringp->sq_head = (u_int32_t *) (sq + p.sq_off.head);
+  ringp->sq_tail = (u_int32_t *) (sq + p.sq_off.tail);
+  ringp->sq_mask = (u_int32_t *) (sq + p.sq_off.ring_mask);
+  ringp->sq_array = (u_int32_t *) (sq + p.sq_off.array);
+  cq = ringp->cq_ring;
+  ringp->cq_head = (u_int32_t *) (cq + p.cq_off.head);
+  ringp->cq_tail = (u_int32_t *) (cq + p.cq_off.tail);
+  ringp->cq_mask = (u_int32_t *) (cq + p.cq_off.ring_mask);
+  ringp->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+
+  if ((ret = CDB___os_calloc (ringp->entries,
+                              sizeof (ssize_t), &ringp->res)) != 0 ||
+      (ret = CDB___os_calloc (ringp->entries,
+                              sizeof (void *), &ringp->bounce)) != 0)
+  {
+    CDB___os_ioring_close (ringp);
+    return (ret);
+  }
+
+  *ringpp = ringp;
+  return (0);
+
+fallback:
+  CDB___os_ioring_close (ringp);
+  return (0);
+#else
+  COMPQUIET (entries, 0);
+  COMPQUIET (mutexp, NULL);
+  *ringpp = NULL;
+  return (0);
+#endif /* HAVE_IO_URING */
+}
+
+/*
+ * CDB___os_ioring_close --
+ *  Release a ring.  Nothing may be in progress but readahead advice.
+ *
+ * PUBLIC: void CDB___os_ioring_close __P((DB_IORING *));
+ */
+void
+CDB___os_ioring_close (ringp)
+     DB_IORING *ringp;
+{
+#ifdef HAVE_IO_URING
+  if (ringp->sqes != MAP_FAILED)
+    (void) munmap (ringp->sqes, ringp->sqes_len);
+  if (ringp->cq_ring != MAP_FAILED)
+    (void) munmap (ringp->cq_ring, ringp->cq_len);
+  if (ringp->sq_ring != MAP_FAILED)
+    (void) munmap (ringp->sq_ring, ringp->sq_len);
+  if (ringp->fd >= 0)
+    (void) close (ringp->fd);
+  if (ringp->res != NULL)
+    CDB___os_free (ringp->res, ringp->entries * sizeof (ssize_t));
+  if (ringp->bounce != NULL)
+    CDB___os_free (ringp->bounce, ringp->entries * sizeof (void *));
+  CDB___os_free (ringp, sizeof (DB_IORING));
+#else
+  COMPQUIET (ringp, NULL);
+#endif /* HAVE_IO_URING */
+}
+
+/*
+ * CDB___os_iobatch --
+ *  Do a batch of reads or writes, and wait for all of them.  The number
+ *  of bytes each I/O transferred is returned in the niop array, as
+ *  CDB___os_io would, and the first error is returned.
+ *
+ * PUBLIC: int CDB___os_iobatch __P((DB_IORING *, DB_IO *, int, int, ssize_t *));
+ */
+int
+CDB___os_iobatch (ringp, db_iop, n, op, niop)
+     DB_IORING *ringp;
+     DB_IO *db_iop;
+     int n, op;
+     ssize_t *niop;
+{
+  int i, ret, t_ret;
+#ifdef HAVE_IO_URING
+  DB_IO *iop;
+  u_int32_t j, nqueued, nsubmitted, room;
+  int next;
+
+  ret = 0;
+  next = 0;
+  if (ringp == NULL || CDB___db_jump.j_read != NULL ||
+      CDB___db_jump.j_write != NULL)
+    goto sync;
+
+  MUTEX_THREAD_LOCK (ringp->mutexp);
+  while (next < n && !ringp->disabled)
+  {
+    if ((room = CDB___os_ioring_room (ringp)) == 0)
+    {
+      (void) CDB___os_ioring_enter (ringp, 0, 1);
+      CDB___os_ioring_reap (ringp, 0);
+      continue;
+    }
+
+    /*
+     * Queue as many I/Os as there's room for.  Those the ring can't do
+     * as they are, because the handle wants aligned I/O that this one
+     * isn't, are left for CDB___os_io.
+     */
+    for (nqueued = 0; nqueued < room && next + nqueued < (u_int32_t) n;
+         ++nqueued)
+    {
+      iop = &db_iop[next + nqueued];
+      ringp->res[nqueued] = -1;
+      ringp->bounce[nqueued] = NULL;
+      if (F_ISSET (iop->fhp, DB_FH_DIRECT))
+      {
+        if (!CDB___os_direct_ok (iop) ||
+            posix_memalign (&ringp->bounce[nqueued],
+                            DB_DIRECT_ALIGN, iop->bytes) != 0)
+        {
+          ringp->bounce[nqueued] = NULL;
+          ringp->res[nqueued] = -EINVAL;
+          continue;
+        }
+        if (op == DB_IO_WRITE)
+          memcpy (ringp->bounce[nqueued], iop->buf, iop->bytes);
+      }
+      CDB___os_ioring_prep (ringp,
+                            op == DB_IO_WRITE ? IORING_OP_WRITE :
+                            IORING_OP_READ, iop,
+                            ringp->bounce[nqueued] != NULL ?
+                            ringp->bounce[nqueued] : iop->buf, nqueued + 1);
+    }
+    nsubmitted = CDB___os_ioring_submit (ringp, 0);
+    CDB___os_ioring_reap (ringp, nsubmitted);
+
+    /*
+     * Collect the results.  Anything short of the full transfer is done
+     * again the usual way, which also reports errors the usual way.  A
+     * kernel that doesn't know the operations rejects all of them, the
+     * ring isn't used again.
+     */
+    for (j = 0; j < nqueued; ++j, ++next)
+    {
+      iop = &db_iop[next];
+      if (ringp->bounce[j] != NULL)
+      {
+        if (op == DB_IO_READ && ringp->res[j] > 0)
+          memcpy (iop->buf, ringp->bounce[j], ringp->res[j]);
+        free (ringp->bounce[j]);
+      }
+      if (ringp->res[j] == (ssize_t) iop->bytes)
+      {
+        niop[next] = ringp->res[j];
+        continue;
+      }
+      if (ringp->res[j] == -EINVAL || ringp->res[j] == -EOPNOTSUPP)
+      {
+        if (F_ISSET (iop->fhp, DB_FH_DIRECT))
+          CDB___os_direct_off (iop->fhp);
+        else
+          ringp->disabled = 1;
+      }
+      if ((t_ret = CDB___os_io (iop, op, &niop[next])) != 0 && ret == 0)
+        ret = t_ret;
+    }
+  }
+  MUTEX_THREAD_UNLOCK (ringp->mutexp);
+
+sync:
+  for (i = next; i < n; ++i)
+    if ((t_ret = CDB___os_io (&db_iop[i], op, &niop[i])) != 0 && ret == 0)
+      ret = t_ret;
+  return (ret);
+#else
+  COMPQUIET (ringp, NULL);
+  for (ret = 0, i = 0; i < n; ++i)
+    if ((t_ret = CDB___os_io (&db_iop[i], op, &niop[i])) != 0 && ret == 0)
+      ret = t_ret;
+  return (ret);
+#endif /* HAVE_IO_URING */
+}
+
+/*
+ * CDB___os_ioring_advise --
+ *  Give readahead advice for a list of runs of pages through the ring,
+ *  without waiting for it to be taken.  Returns non-zero if the advice
+ *  couldn't be given this way.
+ *
+ * PUBLIC: int CDB___os_ioring_advise __P((DB_IORING *, DB_IO *, int));
+ */
+int
+CDB___os_ioring_advise (ringp, db_iop, n)
+     DB_IORING *ringp;
+     DB_IO *db_iop;
+     int n;
+{
+#ifdef HAVE_IO_URING
+  u_int32_t nqueued;
+  int i, ret;
+
+  MUTEX_THREAD_LOCK (ringp->mutexp);
+  CDB___os_ioring_reap (ringp, 0);
+  if (ringp->disabled || CDB___os_ioring_room (ringp) < (u_int32_t) n)
+  {
+    MUTEX_THREAD_UNLOCK (ringp->mutexp);
+    return (EAGAIN);
+  }
+
+  /* There's no page cache to fill for handles that bypass it. */
+  for (nqueued = 0, i = 0; i < n; ++i)
+    if (!F_ISSET (db_iop[i].fhp, DB_FH_DIRECT))
+    {
+      CDB___os_ioring_prep (ringp, IORING_OP_FADVISE, &db_iop[i], NULL, 0);
+      ++nqueued;
+    }
+  ret = nqueued == 0 ||
+    CDB___os_ioring_submit (ringp, 1) == nqueued ? 0 : EAGAIN;
+  MUTEX_THREAD_UNLOCK (ringp->mutexp);
+  return (ret);
+#else
+  COMPQUIET (ringp, NULL);
+  COMPQUIET (db_iop, NULL);
+  COMPQUIET (n, 0);
+  return (EINVAL);
+#endif /* HAVE_IO_URING */
+}
+
+#ifdef HAVE_IO_URING
+/*
+ * CDB___os_ioring_room --
+ *  Return how many more I/Os can be queued without risking to overflow
+ *  the completion queue, which is at least as large as the submission
+ *  queue.
+ */
+static u_int32_t
+CDB___os_ioring_room (ringp)
+     DB_IORING *ringp;
+{
+  return (ringp->entries - ringp->advised);
+}
+
+/*
+ * CDB___os_ioring_prep --
+ *  Queue an I/O.  The user data is the index of its result in the batch
+ *  plus one, or 0 for advice.
+ */
+static void
+CDB___os_ioring_prep (ringp, opcode, db_iop, buf, data)
+     DB_IORING *ringp;
+     int opcode;
+     DB_IO *db_iop;
+     void *buf;
+     u_int64_t data;
+{
+  struct io_uring_sqe *sqe;
+  u_int32_t idx, tail;
+
+  tail = *ringp->sq_tail;
+  idx = tail & *ringp->sq_mask;
+  sqe = &ringp->sqes[idx];
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = db_iop->fhp->fd;
+  sqe->off = (u_int64_t) db_iop->pgno * db_iop->pagesize;
+  sqe->addr = (u_int64_t) (uintptr_t) buf;
+  sqe->len = db_iop->bytes;
+  if (opcode == IORING_OP_FADVISE)
+    sqe->fadvise_advice = POSIX_FADV_WILLNEED;
+  sqe->user_data = data;
+  ringp->sq_array[idx] = idx;
+
+  /* The kernel must see the entry before the new tail. */
+  __atomic_store_n (ringp->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * CDB___os_ioring_submit --
+ *  Hand the queued I/Os to the kernel, and return how many it took.  The
+ *  ones it didn't take are taken back: their results stay at -1, and the
+ *  ring isn't used again.
+ */
+static u_int32_t
+CDB___os_ioring_submit (ringp, advice)
+     DB_IORING *ringp;
+     int advice;
+{
+  u_int32_t queued, submitted;
+  int ret;
+
+  queued = *ringp->sq_tail - __atomic_load_n (ringp->sq_head,
+                                              __ATOMIC_ACQUIRE);
+  for (submitted = 0; submitted < queued;)
+  {
+    ret = syscall (__NR_io_uring_enter,
+                   ringp->fd, queued - submitted, 0, 0, NULL, 0);
+    if (ret > 0)
+      submitted += ret;
+    else if (ret == 0 || CDB___os_get_errno () != EINTR)
+      break;
+  }
+  if (submitted < queued)
+  {
+    __atomic_store_n (ringp->sq_tail,
+                      *ringp->sq_tail - (queued - submitted),
+                      __ATOMIC_RELEASE);
+    ringp->disabled = 1;
+  }
+  if (advice)
+    ringp->advised += submitted;
+  return (submitted);
+}
+
+/*
+ * CDB___os_ioring_reap --
+ *  Collect completions until n results of the batch in progress are in,
+ *  and whatever advice has been taken in the meantime.
+ */
+static void
+CDB___os_ioring_reap (ringp, n)
+     DB_IORING *ringp;
+     u_int32_t n;
+{
+  struct io_uring_cqe *cqe;
+  u_int32_t head;
+
+  for (head = *ringp->cq_head;;)
+  {
+    if (head == __atomic_load_n (ringp->cq_tail, __ATOMIC_ACQUIRE))
+    {
+      if (n == 0)
+        break;
+      /*
+       * The I/Os are in the kernel's hands and write into our buffers,
+       * there's no giving up on them.
+       */
+      (void) CDB___os_ioring_enter (ringp, 0, 1);
+      continue;
+    }
+    cqe = &ringp->cqes[head & *ringp->cq_mask];
+    if (cqe->user_data == 0)
+    {
+      /*
+       * Advice the kernel turned down, because it doesn't know the
+       * operation or for any other reason, is given with posix_fadvise
+       * from then on.
+       */
+      --ringp->advised;
+      if (cqe->res < 0)
+        ringp->disabled = 1;
+    }
+    else
+    {
+      ringp->res[cqe->user_data - 1] = cqe->res;
+      --n;
+    }
+    __atomic_store_n (ringp->cq_head, ++head, __ATOMIC_RELEASE);
+  }
+}
+
+/*
+ * CDB___os_ioring_enter --
+ *  Submit and wait for I/Os.
+ */
+static int
+CDB___os_ioring_enter (ringp, submit, wait)
+     DB_IORING *ringp;
+     u_int32_t submit, wait;
+{
+  int ret;
+
+  if ((ret = syscall (__NR_io_uring_enter, ringp->fd, submit, wait,
+                      wait == 0 ? 0 : IORING_ENTER_GETEVENTS, NULL, 0)) < 0)
+    return (CDB___os_get_errno ());
+  return (0);
+}
+#endif /* HAVE_IO_URING */
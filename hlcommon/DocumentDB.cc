@@ -193,13 +193,7 @@ DocumentDB::Close ()
     return OK;
 
   if (!isread)
-  {
-    int specialRecordNumber = NEXT_DOC_ID_RECORD;
-    String key ((char *) &specialRecordNumber, sizeof specialRecordNumber);
-    String data ((char *) &nextDocID, sizeof nextDocID);
-
-    dbf->Put (key, data);
-  }
+    putNextDocID ();
 
   if (i_dbf)
   {
@@ -238,6 +232,14 @@ DocumentDB::Add (DocumentRef & doc)
   String key ((char *) &docID, sizeof docID);
   dbf->Put (key, temp);
 
+  //
+  // Recovery would take nextDocID back to what it was when the database
+  // was last closed, and the numbers handed out since would be handed out
+  // again: in a transaction, it is stored with each document.
+  //
+  if (Database::InTransaction ())
+    putNextDocID ();
+
   if (h_dbf)
   {
     if (doc.DocHeadIsSet ())
@@ -262,6 +264,21 @@ DocumentDB::Add (DocumentRef & doc)
 }
 
 
+//*****************************************************************************
+// int DocumentDB::putNextDocID()
+//   Update the special record which keeps track of nextDocID.
+//
+int
+DocumentDB::putNextDocID ()
+{
+  int specialRecordNumber = NEXT_DOC_ID_RECORD;
+  String key ((char *) &specialRecordNumber, sizeof specialRecordNumber);
+  String data ((char *) &nextDocID, sizeof nextDocID);
+
+  return dbf->Put (key, data);
+}
+
+
 //*****************************************************************************
 // int DocumentDB::ReadExcerpt(DocumentRef &ref)
 // We will attempt to access the excerpt for this ref
@@ -443,6 +460,9 @@ DocumentDB::DumpDB (const String & filename, int verbose)
       fprintf (fl, "\te:%s", ref->DocEmail ());
       fprintf (fl, "\tn:%s", ref->DocNotification ());
       fprintf (fl, "\tS:%s", ref->DocSubject ());
+      fprintf (fl, "\tC:%d", (int) ref->DocChanged ());
+      fprintf (fl, "\tU:%d", ref->DocUnchanged ());
+      fprintf (fl, "\tE:%s", ref->DocETag ());
       fprintf (fl, "\td:");
       descriptions = ref->Descriptions ();
       String *description;
@@ -566,6 +586,15 @@ DocumentDB::LoadDB (const String & filename, int verbose)
       case 'S':                // Subject
         ref.DocSubject (token);
         break;
+      case 'C':                // Changed
+        ref.DocChanged (atoi (token));
+        break;
+      case 'U':                // Unchanged revisits
+        ref.DocUnchanged (atoi (token));
+        break;
+      case 'E':                // Entity tag
+        ref.DocETag (token);
+        break;
       case 'd':                // Descriptions
         descriptions.Create (token, '\001');
         ref.Descriptions (descriptions);
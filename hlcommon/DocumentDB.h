@@ -97,6 +97,8 @@ private:
   int isopen;
   int isread;
   int nextDocID;
+
+  int putNextDocID ();
 };
 
 #endif
@@ -81,6 +81,9 @@ DocumentRef::Clear ()
   docEmail = 0;
   docNotification = 0;
   docSubject = 0;
+  docChanged = 0;
+  docUnchanged = 0;
+  docETag = 0;
   docScore = 0;
   docAnchor = 0;
 }
@@ -131,7 +134,10 @@ enum
   DOC_STRING,                   // 16
   DOC_METADSC,                  // 17
   DOC_BACKLINKS,                // 18
-  DOC_SIG                       // 19
+  DOC_SIG,                      // 19
+  DOC_CHANGED,                  // 20
+  DOC_UNCHANGED,                // 21
+  DOC_ETAG                      // 22
 };
 
 // Must be powers of two never reached by the DOC_... enums.
@@ -268,6 +274,8 @@ DocumentRef::Serialize (String & s)
   addnum (DOC_BACKLINKS, s, docBackLinks);
   addnum (DOC_HOPCOUNT, s, docHopCount);
   addnum (DOC_SIG, s, docSig);
+  addnum (DOC_CHANGED, s, docChanged);
+  addnum (DOC_UNCHANGED, s, docUnchanged);
 
   // Use a temporary since the addstring macro will evaluate
   // this multiple times.
@@ -284,6 +292,7 @@ DocumentRef::Serialize (String & s)
   addstring (DOC_EMAIL, s, docEmail);
   addstring (DOC_NOTIFICATION, s, docNotification);
   addstring (DOC_SUBJECT, s, docSubject);
+  addstring (DOC_ETAG, s, docETag);
 }
 
 
@@ -422,6 +431,12 @@ DocumentRef::Deserialize (String & stream)
     case DOC_SIG:
       getnum (x, s, docSig);
       break;
+    case DOC_CHANGED:
+      getnum (x, s, docChanged);
+      break;
+    case DOC_UNCHANGED:
+      getnum (x, s, docUnchanged);
+      break;
     case DOC_URL:
       {
         // Use a temporary since the addstring macro will evaluate
@@ -457,6 +472,9 @@ DocumentRef::Deserialize (String & stream)
     case DOC_SUBJECT:
       getstring (x, s, docSubject);
       break;
+    case DOC_ETAG:
+      getstring (x, s, docETag);
+      break;
     case DOC_STRING:
       // This is just a debugging string. Ignore it.
       break;
@@ -138,6 +138,18 @@ public:
   {
     return docSubject;
   }
+  time_t DocChanged ()
+  {
+    return docChanged;
+  }
+  int DocUnchanged ()
+  {
+    return docUnchanged;
+  }
+  char *DocETag ()
+  {
+    return docETag;
+  }
 
   void DocID (int d)
   {
@@ -227,6 +239,18 @@ public:
   {
     docSubject = s;
   }
+  void DocChanged (time_t t)
+  {
+    docChanged = t;
+  }
+  void DocUnchanged (int u)
+  {
+    docUnchanged = u;
+  }
+  void DocETag (const char *e)
+  {
+    docETag = e;
+  }
 
   void Clear ();                // Reset everything
 
@@ -285,6 +309,17 @@ protected:
   // This is the subject of the email sent out by htnotify.
   String docSubject;
 
+  //
+  // The following values are for scheduling the revisits
+  //
+
+  // This is the time of the retrieval that last found the document changed.
+  time_t docChanged;
+  // This is a count of the revisits since, which found it unchanged.
+  int docUnchanged;
+  // This is the entity tag the server last gave for the document.
+  String docETag;
+
   //
   // This is used for searching and is not stored in the database
   //
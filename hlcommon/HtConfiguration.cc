@@ -77,7 +77,7 @@ HtConfiguration::Add (const char *name, const char *value,
 }
 
 //*********************************************************************
-const String
+String
 HtConfiguration::Find (const char *blockName, const char *name,
                        const char *value) const
 {
@@ -131,7 +131,7 @@ HtConfiguration::Find (const char *blockName, const char *name,
 
 //*********************************************************************
 //
-const String
+String
 HtConfiguration::Find (URL * aUrl, const char *value) const
 {
   if (!aUrl)
@@ -25,7 +25,7 @@
 class HtConfiguration:public Configuration
 {
 public:
-  const String Find (const String & name) const
+  String Find (const String & name) const
   {
     return (Configuration::Find (name));
   }
@@ -55,8 +55,8 @@ public:
   }
 
   void Add (const char *name, const char *value, Configuration * aList);
-  const String Find (URL * aUrl, const char *value) const;
-  const String Find (const char *blockName, const char *name,
+  String Find (URL * aUrl, const char *value) const;
+  String Find (const char *blockName, const char *name,
                      const char *value) const;
   int Value (const char *blockName, const char *name, const char *value,
              int default_value = 0);
@@ -0,0 +1,478 @@
+//
+// HtGeneration.cc
+//
+// HtGeneration: Versioned generations of the index databases.  When
+//               database_generations is set, a build writes a new
+//               generation directory and switches the manifest to it when
+//               it is complete, searches use the generation the manifest
+//               names, and generations nobody uses any longer are removed.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifdef HAVE_CONFIG_H
+#include "hlconfig.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "HtGeneration.h"
+#include "lib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+//
+// The databases that make up an index, and so a generation.  The
+// dictionaries of the fuzzy algorithms are built separately and stay
+// where they are.
+//
+static const char *generation_databases[] = {
+  "word_db",
+  "doc_db",
+  "doc_index",
+  "doc_excerpt",
+  "md5_db",
+  "simhash_db",
+  "url_log",
+  0
+};
+
+#define GENERATION_LOCK    "lock"
+#define GENERATION_SUFFIX  ".generation"
+
+//
+// How many times a reader looks for the current generation if it keeps
+// being replaced while the reader gets to it.
+//
+#define GENERATION_TRIES  10
+
+//*****************************************************************************
+//
+HtGeneration::HtGeneration ()
+{
+  number = 0;
+  lock_fd = -1;
+  created = 0;
+}
+
+//*****************************************************************************
+//
+HtGeneration::~HtGeneration ()
+{
+  Release ();
+}
+
+//*****************************************************************************
+// int HtGeneration::Use(HtConfiguration &config)
+//
+int
+HtGeneration::Use (HtConfiguration & config)
+{
+  if (!config.Boolean ("database_generations"))
+    return 0;
+
+  Release ();
+  if (base.empty ())
+  {
+    base = config.Find ("database_base");
+    manifest = base;
+    manifest << GENERATION_SUFFIX;
+  }
+
+  //
+  // The generation may be replaced, and removed, between the time we
+  // read the manifest and the time we lock it.  It can't once we hold the
+  // lock and the manifest still names it.
+  //
+  for (int tries = 0; tries < GENERATION_TRIES; tries++)
+  {
+    int current = Current ();
+    if (current == 0)
+      return 0;
+    if (Lock (current, 0) != OK)
+      continue;
+    if (Current () == current)
+    {
+      number = current;
+      Rebase (config);
+      return number;
+    }
+    Release ();
+  }
+
+  fprintf (stderr, "HtGeneration: %s keeps changing\n", manifest.get ());
+  return NOTOK;
+}
+
+//*****************************************************************************
+// int HtGeneration::Stale()
+//
+int
+HtGeneration::Stale () const
+{
+  return number > 0 && Current () != number;
+}
+
+//*****************************************************************************
+// void HtGeneration::Release()
+//
+void
+HtGeneration::Release ()
+{
+  if (lock_fd >= 0)
+    close (lock_fd);
+  lock_fd = -1;
+  number = 0;
+  created = 0;
+}
+
+//*****************************************************************************
+// int HtGeneration::Create(HtConfiguration &config, int initial)
+//
+int
+HtGeneration::Create (HtConfiguration & config, int initial)
+{
+  if (!config.Boolean ("database_generations"))
+    return 0;
+
+  Release ();
+  base = config.Find ("database_base");
+  manifest = base;
+  manifest << GENERATION_SUFFIX;
+
+  //
+  // Keep the generation we start from while we copy it.
+  //
+  HtGeneration from;
+  int current = 0;
+  from.base = base;
+  from.manifest = manifest;
+  for (int tries = 0; tries < GENERATION_TRIES; tries++)
+  {
+    if ((current = from.Current ()) == 0)
+      break;
+    if (from.Lock (current, 0) == OK && from.Current () == current)
+      break;
+    from.Release ();
+    current = -1;
+  }
+  if (current < 0)
+  {
+    fprintf (stderr, "HtGeneration: %s keeps changing\n", manifest.get ());
+    return NOTOK;
+  }
+
+  //
+  // Another build may be creating the next generation, or have left an
+  // unfinished one behind: take the first number that is free.
+  //
+  int n;
+  for (n = current + 1;; n++)
+  {
+    if (mkdir (Directory (n).get (), 0777) == 0)
+      break;
+    if (errno != EEXIST)
+    {
+      perror (Directory (n).get ());
+      return NOTOK;
+    }
+  }
+
+  if (Lock (n, 1) != OK)
+  {
+    perror (Directory (n).get ());
+    return NOTOK;
+  }
+  number = n;
+  created = 1;
+
+  if (!initial && current > 0 && Copy (current) != OK)
+  {
+    Release ();
+    return NOTOK;
+  }
+
+  Rebase (config);
+  return number;
+}
+
+//*****************************************************************************
+// int HtGeneration::Commit()
+//
+int
+HtGeneration::Commit ()
+{
+  if (!created)
+    return OK;
+
+  //
+  // The files of the generation must be on disk before the manifest
+  // names it.
+  //
+  String directory = Directory (number);
+  DIR *dir = opendir (directory.get ());
+  if (dir == 0)
+  {
+    perror (directory.get ());
+    return NOTOK;
+  }
+  struct dirent *entry;
+  while ((entry = readdir (dir)) != 0)
+  {
+    String path = directory;
+    path << "/" << entry->d_name;
+    int fd = open (path.get (), O_RDONLY);
+    if (fd < 0)
+      continue;
+    (void) fsync (fd);
+    close (fd);
+  }
+  closedir (dir);
+
+  String tmp = manifest;
+  tmp << ".new." << (int) getpid ();
+  FILE *f = fopen (tmp.get (), "w");
+  if (f == 0)
+  {
+    perror (tmp.get ());
+    return NOTOK;
+  }
+  fprintf (f, "%d\n", number);
+  if (fflush (f) != 0 || fsync (fileno (f)) != 0)
+  {
+    perror (tmp.get ());
+    fclose (f);
+    unlink (tmp.get ());
+    return NOTOK;
+  }
+  fclose (f);
+  if (rename (tmp.get (), manifest.get ()) < 0)
+  {
+    perror (manifest.get ());
+    unlink (tmp.get ());
+    return NOTOK;
+  }
+
+  Reclaim ();
+  return OK;
+}
+
+//*****************************************************************************
+// int HtGeneration::Current()
+//   Number of the generation the manifest names, 0 if none.
+//
+int
+HtGeneration::Current () const
+{
+  FILE *f = fopen (manifest.get (), "r");
+  int n = 0;
+
+  if (f == 0)
+    return 0;
+  if (fscanf (f, "%d", &n) != 1 || n < 0)
+    n = 0;
+  fclose (f);
+  return n;
+}
+
+//*****************************************************************************
+// void HtGeneration::Rebase(HtConfiguration &config)
+//   Move the databases of the index into the directory of the generation.
+//
+void
+HtGeneration::Rebase (HtConfiguration & config) const
+{
+  String directory = Directory (number);
+
+  for (int i = 0; generation_databases[i]; i++)
+  {
+    String path = config.Find (generation_databases[i]);
+    if (path.empty ())
+      continue;
+    int slash = path.lastIndexOf ('/');
+    String rebased = directory;
+    rebased << "/" << (slash >= 0 ? path.sub (slash + 1) : path);
+    config.Add (generation_databases[i], rebased);
+  }
+}
+
+//*****************************************************************************
+// int HtGeneration::Lock(int generation, int create)
+//   Hold a shared lock on the lock file of <generation>, creating it
+//   if <create>.
+//
+int
+HtGeneration::Lock (int generation, int create)
+{
+  String path = Directory (generation);
+  path << "/" << GENERATION_LOCK;
+
+  int fd = open (path.get (), create ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if (fd < 0)
+    return NOTOK;
+  if (flock (fd, LOCK_SH) < 0)
+  {
+    close (fd);
+    return NOTOK;
+  }
+  lock_fd = fd;
+  return OK;
+}
+
+//*****************************************************************************
+// int HtGeneration::Copy(int from)
+//   Copy the files of generation <from> into the one being created.
+//
+int
+HtGeneration::Copy (int from) const
+{
+  String source = Directory (from);
+  String target = Directory (number);
+  DIR *dir = opendir (source.get ());
+  struct dirent *entry;
+  char buffer[64 * 1024];
+  int ret = OK;
+
+  if (dir == 0)
+  {
+    perror (source.get ());
+    return NOTOK;
+  }
+  while (ret == OK && (entry = readdir (dir)) != 0)
+  {
+    if (!strcmp (entry->d_name, ".") || !strcmp (entry->d_name, "..") ||
+        !strcmp (entry->d_name, GENERATION_LOCK))
+      continue;
+
+    String from_path = source;
+    from_path << "/" << entry->d_name;
+    String to_path = target;
+    to_path << "/" << entry->d_name;
+
+    struct stat st;
+    int in = open (from_path.get (), O_RDONLY);
+    if (in < 0 || fstat (in, &st) < 0 || !S_ISREG (st.st_mode))
+    {
+      if (in >= 0)
+        close (in);
+      continue;
+    }
+    int out = open (to_path.get (), O_WRONLY | O_CREAT | O_TRUNC,
+                    st.st_mode & 0777);
+    if (out < 0)
+    {
+      perror (to_path.get ());
+      close (in);
+      ret = NOTOK;
+      break;
+    }
+
+    ssize_t n;
+    while ((n = read (in, buffer, sizeof (buffer))) > 0)
+    {
+      if (write (out, buffer, n) != n)
+      {
+        n = -1;
+        break;
+      }
+    }
+    if (n < 0)
+    {
+      perror (to_path.get ());
+      ret = NOTOK;
+    }
+    close (in);
+    close (out);
+  }
+  closedir (dir);
+  return ret;
+}
+
+//*****************************************************************************
+// void HtGeneration::Reclaim()
+//   Remove the generations, other than the current one, that nobody
+//   holds a lock on.  A generation that is not current when we hold its
+//   lock exclusively can't become current: its build holds a lock on it
+//   until it commits.
+//
+void
+HtGeneration::Reclaim () const
+{
+  int slash = base.lastIndexOf ('/');
+  String parent = slash >= 0 ? base.sub (0, slash + 1) : String ("./");
+  String prefix = slash >= 0 ? base.sub (slash + 1) : base;
+  prefix << ".";
+
+  DIR *dir = opendir (parent.get ());
+  if (dir == 0)
+    return;
+
+  struct dirent *entry;
+  while ((entry = readdir (dir)) != 0)
+  {
+    const char *name = entry->d_name;
+    if (strncmp (name, prefix.get (), prefix.length ()) != 0)
+      continue;
+    const char *digits = name + prefix.length ();
+    if (*digits == '\0' || strspn (digits, "0123456789") != strlen (digits))
+      continue;
+    int generation = atoi (digits);
+    if (generation == number)
+      continue;
+
+    String directory = Directory (generation);
+    String path = directory;
+    path << "/" << GENERATION_LOCK;
+    int fd = open (path.get (), O_RDONLY);
+    if (fd < 0)
+      continue;
+    if (flock (fd, LOCK_EX | LOCK_NB) < 0 || Current () == generation)
+    {
+      close (fd);
+      continue;
+    }
+
+    DIR *gdir = opendir (directory.get ());
+    if (gdir != 0)
+    {
+      struct dirent *gentry;
+      while ((gentry = readdir (gdir)) != 0)
+      {
+        if (!strcmp (gentry->d_name, ".") || !strcmp (gentry->d_name, ".."))
+          continue;
+        String file = directory;
+        file << "/" << gentry->d_name;
+        unlink (file.get ());
+      }
+      closedir (gdir);
+    }
+    rmdir (directory.get ());
+    close (fd);
+  }
+  closedir (dir);
+}
+
+//*****************************************************************************
+// String HtGeneration::Directory(int generation)
+//
+String
+HtGeneration::Directory (int generation) const
+{
+  String directory = base;
+  directory << "." << generation;
+  return directory;
+}
@@ -0,0 +1,92 @@
+//
+// HtGeneration.h
+//
+// HtGeneration: Versioned generations of the index databases.  When
+//               database_generations is set, a build writes a new
+//               generation directory and switches the manifest to it when
+//               it is complete, searches use the generation the manifest
+//               names, and generations nobody uses any longer are removed.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifndef _HtGeneration_h_
+#define _HtGeneration_h_
+
+#include "Object.h"
+#include "htString.h"
+#include "HtConfiguration.h"
+
+//
+// Generation <n> of the databases named after ${database_base} lives in
+// the directory ${database_base}.<n>, and the manifest
+// ${database_base}.generation holds the number of the current one.  The
+// manifest is only ever replaced with rename(2), so a reader sees either
+// the previous generation or the new one, complete.
+//
+// Whoever uses a generation holds a shared lock on its lock file, which
+// is how Commit() knows that a generation can be removed.
+//
+class HtGeneration:public Object
+{
+public:
+  HtGeneration ();
+  ~HtGeneration ();
+
+  //
+  // Point the index databases of <config> at the current generation and
+  // keep it from being removed until Release().  Returns the number of the
+  // generation, 0 if generations are not enabled or none was committed
+  // yet, in which case <config> is unchanged, or NOTOK.
+  //
+  int Use (HtConfiguration & config);
+
+  //
+  // True if another generation was committed since Use().
+  //
+  int Stale () const;
+
+  void Release ();
+
+  //
+  // Point the index databases of <config> at a new generation.  Unless
+  // <initial>, it starts as a copy of the current generation.  Returns
+  // the number of the new generation, 0 if generations are not enabled,
+  // or NOTOK.
+  //
+  int Create (HtConfiguration & config, int initial);
+
+  //
+  // Make the generation created by Create() the current one, and remove
+  // the generations nobody uses.  Returns OK or NOTOK.
+  //
+  int Commit ();
+
+  int Number () const
+  {
+    return number;
+  }
+
+protected:
+  int Current () const;
+  void Rebase (HtConfiguration & config) const;
+  int Lock (int generation, int create);
+  int Copy (int from) const;
+  void Reclaim () const;
+
+  String Directory (int generation) const;
+
+  String base;                  // ${database_base} as configured
+  String manifest;              // File naming the current generation
+  int number;                   // Generation used or created
+  int lock_fd;                  // Its lock file, shared lock held
+  int created;                  // Create() was called
+};
+
+#endif
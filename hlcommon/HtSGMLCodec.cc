@@ -99,6 +99,14 @@ HtSGMLCodec::HtSGMLCodec ()
   myToList->Add (">");
   myNumFromList->Add ("&#62;");
 
+  for (int i = 0; i < myToList->Count (); i++)
+  {
+    myEntities.Add (*(String *) myTextFromList->Nth (i),
+                    new String (*(String *) myToList->Nth (i)));
+    myEntities.Add (*(String *) myNumFromList->Nth (i),
+                    new String (*(String *) myToList->Nth (i)));
+  }
+
   myTextWordCodec = new HtWordCodec (myTextFromList, myToList, '|');
   myNumWordCodec = new HtWordCodec (myNumFromList, myToList, '|');
 }
@@ -16,6 +16,7 @@
 #define __HtSGMLCodec_h
 
 #include "HtWordCodec.h"
+#include "HtHash.h"
 
 // Container for a HtWordCodec (not subclassed from it due to
 // portability-problems using initializers).
@@ -34,6 +35,14 @@ public:
     return myTextWordCodec->encode (myNumWordCodec->encode (uncoded));
   }
 
+  // The same for a string holding exactly one entity, "&foo;" or
+  // "&#nnn;", looked up directly instead of being run through the
+  // codecs.  Returns what the entity stands for, or 0 if it is unknown.
+  const String *encodeEntity (const char *entity, int length) const
+  {
+    return (const String *) myEntities.Find (entity, length);
+  }
+
   // But we only want to decode into one form i.e. &foo; NOT &#nnn;
   String decode (const String & coded) const
   {
@@ -61,6 +70,7 @@ private:
 
   HtWordCodec *myTextWordCodec; // For &foo;
   HtWordCodec *myNumWordCodec;  // For &#foo;
+  HtStringHash myEntities;      // Both forms, for encodeEntity()
   String myErrMsg;
 };
 
@@ -68,6 +68,28 @@ HtWordList::Replace (const WordReference & arg)
   words->Add (new WordReference (arg));
 }
 
+//
+// A word waiting in Flush(), with its place in the list
+//
+struct PendingWord
+{
+  HtWordReference *wordRef;
+  int index;
+  int ok;
+};
+
+static int
+compare_pending (const void *a, const void *b)
+{
+  const PendingWord *pa = (const PendingWord *) a;
+  const PendingWord *pb = (const PendingWord *) b;
+  int result =
+    pa->wordRef->Key ().GetWord ().compare (pb->wordRef->Key ().GetWord ());
+  if (result == 0)
+    result = pa->index - pb->index;
+  return result;
+}
+
 //*****************************************************************************
 // void HtWordList::Flush()
 //   Dump the current list of words to the database.  After
@@ -83,17 +105,60 @@ HtWordList::Flush ()
   if (!isopen)
     Open (config["word_db"], O_RDWR);
 
+  int count = 0;
+  PendingWord *pending = new PendingWord[words->Count ()];
   words->Start_Get ();
   while ((wordRef = (HtWordReference *) words->Get_Next ()))
   {
-    if (wordRef->Word ().length () == 0)
+    if (wordRef->Key ().GetWord ().length () == 0)
     {
       cerr << "HtWordList::Flush: unexpected empty word\n";
       continue;
     }
+    if (!wordRef->Key ().Filled ())
+    {
+      cerr << "HtWordList::Flush: key is not fully defined for " <<
+        wordRef->Key ().GetWord () << "\n";
+      continue;
+    }
+    pending[count].wordRef = wordRef;
+    pending[count].index = count;
+    pending[count].ok = 1;
+    count++;
+  }
 
-    Override (*wordRef);
+  //
+  // A document repeats the same words over and over: sorting them
+  // lets each distinct word be normalized only once, and sorting them
+  // again afterwards stores them word by word.  Both sorts keep
+  // references to the same word in the order they were added, so that
+  // the last one still wins when several have the same key.
+  //
+  qsort (pending, count, sizeof (PendingWord), compare_pending);
+  String original, word;
+  int status = 0;
+  for (int i = 0; i < count; i++)
+  {
+    WordKey & key = pending[i].wordRef->Key ();
+    if (i == 0 || key.GetWord ().compare (original) != 0)
+    {
+      original = key.GetWord ();
+      word = original;
+      status = wtype.Normalize (word);
+    }
+    if (status & WORD_NORMALIZE_NOTOK)
+      pending[i].ok = 0;
+    else
+      key.SetWord (word);
+  }
+  qsort (pending, count, sizeof (PendingWord), compare_pending);
+
+  for (int i = 0; i < count; i++)
+  {
+    if (pending[i].ok)
+      PutNormalized (*pending[i].wordRef, 0);
   }
+  delete[]pending;
 
   // Cleanup
   words->Destroy ();
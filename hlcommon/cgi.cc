@@ -52,9 +52,9 @@ cgi::cgi ()
 
 
 //*****************************************************************************
-// cgi::cgi(char *s)
+// cgi::cgi(const char *s)
 //
-cgi::cgi (char *s)
+cgi::cgi (const char *s)
 {
   init (s);
 }
@@ -21,7 +21,7 @@ class cgi
 {
 public:
   cgi ();
-  cgi (char *s);
+  cgi (const char *s);
    ~cgi ();
 
   const char *operator [] (const char *);
@@ -380,6 +380,23 @@ ConfigDefaults defaults[] = {
   are all still case sensitive, and \
   <a href=\"#server_aliases\">server_aliases</a> \
   is still case insensitive. \
+"}
+  ,
+  {"check_near_duplicates", "false",
+   "boolean", "hldig", "", "0.4.0", "Indexing:What",
+   "check_near_duplicates: true", " \
+  Compares the words of each document with those of the documents \
+  already indexed, and leaves out of the index the documents that \
+  are nearly the same as one of them, such as copies of a page that \
+  differ only by a date or a session id. Their links are still \
+  followed. An update dig indexes such a document again once the \
+  one it was a copy of is gone or has changed; when the server only \
+  tells it is unchanged, that takes one more dig. Documents are compared through a 64 bit SimHash of \
+  their words, kept in <a href=\"#simhash_db\">simhash_db</a>; see \
+  <a href=\"#near_duplicate_distance\">near_duplicate_distance</a> \
+  for how close they have to be. Unlike \
+  <a href=\"#check_unique_md5\">check_unique_md5</a>, this \
+  takes a document's words, not its bytes. \
 "}
   ,
   {"check_unique_date", "false",
@@ -534,6 +551,46 @@ http://www.htdig.org/",
   The default value of this attribute is determined at \
   compile time. \
   </p> \
+"}
+  ,
+  {"database_generations", "false",
+   "boolean", "hldig hlmerge hlpurge hlload hlsearch hlfuzzy", "", "0.4.0", "File Layout",
+   "database_generations: true", " \
+  If true, the databases of an index live in generations: \
+  <a href=\"hldig.html\">hldig</a>, \
+  <a href=\"hlmerge.html\">hlmerge</a>, \
+  <a href=\"hlpurge.html\">hlpurge</a> and \
+  <a href=\"hlload.html\">hlload</a> write them in a new \
+  directory, ${<a href=\"#database_base\">database_base</a>}.<em>n</em>, \
+  and only when they are done replace the file \
+  ${database_base}.generation, which names the current generation. \
+  Searches, and <a href=\"hlfuzzy.html\">hlfuzzy</a>, started \
+  afterwards use the new generation while those \
+  already running finish with the previous one, which is removed once \
+  nobody uses it any longer. Unless hldig is run with -i, the new \
+  generation starts as a copy of the current one. The \
+  <a href=\"#alt_work_area\">alt_work_area</a> attribute is ignored. \
+"}
+  ,
+  {"database_transactions", "false",
+   "boolean", "hldig", "", "0.4.0", "File Layout",
+   "database_transactions: true", " \
+  If true, <a href=\"hldig.html\">hldig</a> logs its changes to the \
+  word and document databases and commits those of each document, its \
+  words and its DocumentRef, at once. After a crash, the next run \
+  recovers the databases from the log to the last document committed \
+  and flushed to disk, and a dig without -i retrieves the documents \
+  that were lost. The log is \
+  flushed once every <a href=\"#wordlist_txn_group\">wordlist_txn_group</a> \
+  documents, so that many more documents may be lost than when each is \
+  flushed on its own, but little time is spent waiting for the disk. \
+  The log files are kept in <a href=\"#wordlist_env_dir\">wordlist_env_dir</a>, \
+  by default <a href=\"#database_dir\">database_dir</a>, and removed at \
+  each checkpoint, see <a href=\"#wordlist_txn_checkpoint\">wordlist_txn_checkpoint</a>. \
+  Compressed word databases created with transactions use the \
+  <em>packed</em> <a href=\"#wordlist_compress_layout\">wordlist_compress_layout</a>, \
+  whose pages are written in one piece. Only hldig uses transactions: \
+  <a href=\"hlmerge.html\">hlmerge</a> and the other programs don't. \
 "}
   ,
   {"date_factor", "0",
@@ -996,6 +1053,23 @@ http://www.htdig.org/",
   </table> \
   <p><em>See also FAQ questions <a href=\"FAQ.html#q4.8\">4.8</a> and \
   <a href=\"FAQ.html#q4.9\">4.9</a> for more examples.</em></p> \
+"}
+  ,
+  {"external_parsers_persistent", "false",
+   "boolean", "hldig", "", "0.4.0", "External:Parsers",
+   "external_parsers_persistent: true", " \
+  If set to true, each of the <a href=\"#external_parsers\">external_parsers</a> \
+  is started once and then handed one document after the other, which \
+  saves a temporary file and a new process for every document. \
+  The parser is then given the configuration file as its only \
+  argument and reads the documents from its standard input. Each \
+  document comes as a line with three decimal lengths separated by \
+  spaces, for the contents, the content-type and the URL, followed by \
+  these three fields. For each document the parser writes a line with \
+  the length of its output, followed by the output itself, which has \
+  the same format as for a parser run once per document. The parser \
+  must read the whole document before it answers, and should exit at \
+  the end of its input. A parser which dies is started again. \
 "}
   ,
   {"external_protocols", "",
@@ -1125,6 +1199,23 @@ http://www.htdig.org/",
     </td> \
     </tr> \
       </table>     \
+"}
+  ,
+  {"external_protocols_persistent", "false",
+   "boolean", "hldig", "", "0.4.0", "External:Protocols",
+   "external_protocols_persistent: true", " \
+  If set to true, each of the <a href=\"#external_protocols\">external_protocols</a> \
+  handlers is started once and then asked for one URL after the other, \
+  instead of being started anew for every URL. \
+  The handler is then given the configuration file as its only \
+  argument and reads the requests from its standard input. Each \
+  request comes as a line with two decimal lengths separated by a \
+  space, for the protocol and the URL, followed by these two fields. \
+  For each request the handler writes a line with the length of its \
+  output, followed by the output itself: the same header lines, blank \
+  line and document as for a handler run once per URL. The handler \
+  should exit at the end of its input. A handler which dies is started \
+  again. \
 "}
   ,
   {"extra_word_characters", "",
@@ -1233,6 +1324,39 @@ http://www.htdig.org/",
    "hlnotify_webmaster: Notification Service", " \
   This provides a name for the From field, in addition to the email \
   address for the email messages sent out by hlnotify. \
+"}
+  ,
+  {"http_compression", "true",
+   "boolean", "hldig", "Server", "0.4.0", "Indexing:Connection",
+   "http_compression: false", " \
+  If set to true, hldig asks HTTP servers for gzip or deflate encoded \
+  documents and decodes them while they are read, so that less data has \
+  to travel over the network. The <a href=\"#max_doc_size\">max_doc_size</a> \
+  limit applies to the decoded document. Documents sent with an encoding \
+  hldig cannot decode are not indexed. This has no effect if hl://Dig \
+  was built without zlib. \
+"}
+  ,
+  {"http_pipeline_depth", "1",
+   "integer", "hldig", "Server", "0.4.0", "Indexing:Connection",
+   "http_pipeline_depth: 4", " \
+  The number of requests hldig may have sent to a server over a \
+  persistent connection before it reads their responses (HTTP \
+  pipelining). With a value above 1, the URLs to be retrieved next \
+  from the same server are asked for along with the current one, so \
+  that documents follow each other without waiting a network round \
+  trip for every request; this pays off with distant or slow servers. \
+  The URLs are taken from the queue a few at a time, which may change \
+  the order in which they are retrieved. Pipelining only takes place \
+  when <a href=\"#persistent_connections\">persistent_connections</a> \
+  is set and <a href=\"#head_before_get\">head_before_get</a> and \
+  <a href=\"#server_wait_time\">server_wait_time</a> are not, \
+  and never beyond \
+  <a href=\"#max_connection_requests\">max_connection_requests</a>. \
+  Should the server close the connection, the requests are sent again \
+  on their own; should it do so before answering any of them, or answer \
+  them with something that is not HTTP, pipelining is turned off for \
+  that server. \
 "}
   ,
   {"http_proxy", "",
@@ -1610,7 +1734,11 @@ http://www.htdig.org/",
   for documents (in bytes). This is mainly used to prevent \
   unreasonable memory consumption since each document \
   will be read into memory by <a href=\"hldig.html\"> \
-  hldig</a>. \
+  hldig</a>. Documents fetched by \
+  <a href=\"#external_protocols\">external_protocols</a> and \
+  documents converted by \
+  <a href=\"#external_parsers\">external_parsers</a> are cut to this \
+  size as well. The words an external parser writes are not bounded. \
 "}
   ,
   {"max_excerpts", "1",
@@ -1681,6 +1809,18 @@ http://www.htdig.org/",
    " \
    This option set the maximum number of retries when retrieving a document \
    fails (mainly for reasons of connection). \
+"}
+  ,
+  {"max_revisits", "-1",
+   "integer", "hldig", "", "0.4.0", "Indexing:Connection",
+   "max_revisits: 5000", " \
+  The largest number of the documents already in the database that \
+  an update dig retrieves again. Those which changed the most \
+  recently, then those left alone the longest, are taken first; the \
+  others are kept as they are until a later dig. Documents found \
+  through links for the first time do not count. A value of -1 \
+  specifies no limit. See also \
+  <a href=\"#revisit_interval\">revisit_interval</a>. \
 "}
   ,
   {"max_stars", "4",
@@ -1813,6 +1953,16 @@ http://www.htdig.org/",
   In version 3.1.6, the matching words' combined scores were multiplied \
   by this factor for each additional matching word.  Currently, this \
   multiplier is applied at most once. \
+"}
+  ,
+  {"near_duplicate_distance", "3",
+   "integer", "hldig", "", "0.4.0", "Indexing:What",
+   "near_duplicate_distance: 2", " \
+  When <a href=\"#check_near_duplicates\">check_near_duplicates</a> \
+  is set, the number of bits, out of 64, by which the SimHash of two \
+  documents may differ for them to count as near duplicates. 0 only \
+  catches documents with the same words, in any order; values up to \
+  7 are accepted, each one making the check slower and more eager. \
 "}
   ,
   {"next_page_text", "[next]",
@@ -2122,6 +2272,30 @@ http://www.htdig.org/",
   in both lists it is still excluded from the search results. \
   <br>To restrict URLs in hldig, use \
   <a href=\"#limit_urls_to\">limit_urls_to</a>. \
+"}
+  ,
+  {"revisit_interval", "0",
+   "integer", "hldig", "", "0.4.0", "Indexing:Connection",
+   "revisit_interval: 72000", " \
+  The time, in seconds, after which an update dig retrieves again a \
+  document it already has. Each visit that finds the document \
+  unchanged doubles that time for it, up to \
+  <a href=\"#revisit_max_interval\">revisit_max_interval</a>; a change \
+  brings it back to this value. Documents that are not due are left \
+  as they are, even when linked from documents that are retrieved. \
+  To make a daily dig revisit the busiest documents every time, use \
+  a little less than a day. A value of 0 revisits every document, \
+  as before. Documents that are retrieved again are asked for with \
+  the ETag and modification time they had, so that an unchanged one \
+  costs the server a short \"not modified\" answer. \
+"}
+  ,
+  {"revisit_max_interval", "2592000",
+   "integer", "hldig", "", "0.4.0", "Indexing:Connection",
+   "revisit_max_interval: 604800", " \
+  The longest time, in seconds, that an update dig leaves a document \
+  alone when <a href=\"#revisit_interval\">revisit_interval</a> \
+  is set, however long it has not changed. \
 "}
   ,
   {"robotstxt_name", "hldig",
@@ -2469,6 +2643,18 @@ http://www.htdig.org/",
   if no matches were found. In this case the \
   <a href=\"#nothing_found_file\">nothing_found_file</a> \
   attribute is used instead. \
+"}
+  ,
+  {"search_parallel_collections", "true",
+   "boolean", "hlsearch", "", "0.4.0", "Searching:Method",
+   "search_parallel_collections: false", " \
+  When a search covers several collections (more than one \
+  <code>config</code> input parameter), each collection is searched \
+  by its own hlsearch process at the same time, so the search takes \
+  about as long as the slowest collection rather than the sum of \
+  all of them. It is not used when \
+  <code>wordlist_env_share</code> is set, nor \
+  in server mode, whose workers already answer queries concurrently. \
 "}
   ,
   {"search_rewrite_rules", "",
@@ -2490,6 +2676,26 @@ http://www.htdig.org/",
   URLs to be of one form during indexing and translated for results, \
   and <a href=\"#url_rewrite_rules\">url_rewrite_rules</a> which allows \
   URLs to be rewritten while indexing. \
+"}
+  ,
+  {"search_server_max_requests", "0",
+   "integer", "hlsearch", "", "0.4.0", "Searching:UI",
+   "search_server_max_requests: 10000", " \
+  When hlsearch runs as a server (<code>hlsearch -S</code>), each \
+  worker process is replaced by a fresh one after serving this many \
+  queries. Zero means workers are never recycled. \
+"}
+  ,
+  {"search_server_workers", "4",
+   "integer", "hlsearch", "", "0.4.0", "Searching:UI",
+   "search_server_workers: 16", " \
+  Number of worker processes started by <code>hlsearch -S</code>. \
+  Each worker serves one query at a time and keeps its collections, \
+  word databases and fuzzy indexes open between queries, so this is \
+  also the number of queries that can be answered concurrently. \
+  A collection is opened again once its databases are rebuilt or \
+  updated. The word databases of a worker are opened again when a \
+  query reads another configuration file than the previous one. \
 "}
   ,
   {"server_aliases", "",
@@ -2533,7 +2739,18 @@ http://www.htdig.org/",
   to 10-30 (seconds) when indexing servers that you don't \
   monitor yourself. Additionally, this attribute can slow \
   down local indexing if set, which may or may not be what \
-  you intended. \
+  you intended. When it is set, requests are not pipelined \
+  (see <a href=\"#http_pipeline_depth\">http_pipeline_depth</a>). \
+"}
+  ,
+  {"simhash_db", "${database_base}.simhash.db",
+   "string", "hldig", "", "0.4.0", "File Layout",
+   "simhash_db: ${database_base}.simhash.db", " \
+  This file holds the SimHash of the documents indexed, by which \
+  <a href=\"#check_near_duplicates\">check_near_duplicates</a> \
+  finds the near duplicates of a document. A document indexed again \
+  replaces its SimHash, and those of documents no longer indexed are \
+  dropped when they are come across. \
 "}
   ,
   {"sort", "score",
@@ -3126,6 +3343,27 @@ form during indexing and translated for results. \
   only use is to have a human readable database of all \
   words. The file is easy to parse with tools like \
   perl or tcl. \
+"}
+  ,
+  {"wordlist_cache_flush", "0",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_cache_flush: 20", " \
+  Percentage of the Berkeley DB cache that a background thread keeps \
+  clean while indexing. When the cache is full, each page read must first \
+  evict another, and evicting a modified page means compressing and \
+  writing it. With a background flusher the indexer takes clean pages \
+  instead, and the flusher writes the modified ones, sorted by page number, \
+  in the meantime. Zero disables the flusher. See also \
+  <a href=\"#wordlist_cache_flush_period\">wordlist_cache_flush_period</a>. \
+"}
+  ,
+  {"wordlist_cache_flush_period", "250",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_cache_flush_period: 100", " \
+  Number of milliseconds the background flusher of \
+  <a href=\"#wordlist_cache_flush\">wordlist_cache_flush</a> sleeps \
+  between two passes over the cache. It also wakes up as soon as the \
+  indexer has to pass over modified pages to find one to evict. \
 "}
   ,
   {"wordlist_cache_inserts", "false",
@@ -3133,6 +3371,28 @@ form during indexing and translated for results. \
    "wordlist_cache_inserts: true", " \
    If true, create a cache of size  wordlist_cache_size/2  for class \
    WordListOne. <em>I don't know what this is for.  Does anyone?</em> \
+"}
+  ,
+  {"wordlist_cache_partitions", "1",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_cache_partitions: 8", " \
+  Number of pieces the Berkeley DB cache of \
+  <a href=\"#wordlist_cache_size\">wordlist_cache_size</a> bytes is split \
+  into. Pages are spread over the pieces by page number and each piece has \
+  its own lock and its own least recently used list, so threads working on \
+  different pages of the word database do not wait for each other. A \
+  single process has nothing to gain from more than one. \
+"}
+  ,
+  {"wordlist_cache_policy", "lru",
+   "string", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_cache_policy: 2q", " \
+  Page replacement policy of the Berkeley DB cache. With <em>lru</em> the \
+  least recently used page is evicted. With <em>2q</em> a page read into \
+  the cache is kept on a probation list until it is used again, and pages \
+  on probation are evicted first. A long scan of the word database, for \
+  instance a dump or a prefix search on a short prefix, then no longer \
+  pushes the internal pages of the tree out of the cache. \
 "}
   ,
   {"wordlist_cache_size", "10000000",
@@ -3151,6 +3411,30 @@ form during indexing and translated for results. \
   Enables or disables the default compression system for the indexer. \
   This currently attempts to compress the index by a factor of 8. If the \
   Zlib library is not found on the system, the default is false. \
+"}
+  ,
+  {"wordlist_compress_layout", "chained",
+   "string", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_compress_layout: packed", " \
+  Layout of the compressed word databases created from now on. With \
+  <em>chained</em> each page is stored in a fixed size slot of the file, \
+  and the pages that don't compress enough are continued in overflow \
+  pages listed in a companion <em>_weakcmpr</em> database. With \
+  <em>packed</em> the pages are appended, whatever their compressed size, \
+  to a companion <em>_extent</em> file that is compacted when most of it \
+  is old copies of pages. The files are smaller and reading a page is a \
+  single read. Existing databases keep the layout they were created with. \
+"}
+  ,
+  {"wordlist_compress_threads", "1",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_compress_threads: 4", " \
+  Number of threads compressing pages when a batch of them is written \
+  out of the cache, by a sync or by the background flusher of \
+  <a href=\"#wordlist_cache_flush\">wordlist_cache_flush</a>. Only \
+  used for a private environment, see \
+  <a href=\"#wordlist_env_share\">wordlist_env_share</a>. One \
+  compresses each page in the thread that writes it. \
 "}
   ,
   {"wordlist_compress_zlib", "true",
@@ -3160,6 +3444,45 @@ form during indexing and translated for results. \
   Both <a href=\"#wordlist_compress\">wordlist_compress</a> and \
   <a href=\"#compression_level\">compression_level</a> must be true \
   (non-zero) to use this option!\
+"}
+  ,
+  {"wordlist_direct_io", "false",
+   "boolean", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_direct_io: true", " \
+  If true, the word database is read and written without going through \
+  the buffers of the operating system, so that its pages are not cached \
+  twice. Only worth it when \
+  <a href=\"#wordlist_cache_size\">wordlist_cache_size</a> is large \
+  enough to hold the pages that are used over and over, since nothing \
+  else keeps them in memory. Ignored where the system or the filesystem \
+  does not support it. \
+"}
+  ,
+  {"wordlist_io_uring", "false",
+   "boolean", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_io_uring: true", " \
+  If true, the pages written by a sync or by the background flusher of \
+  <a href=\"#wordlist_cache_flush\">wordlist_cache_flush</a> are handed \
+  to the system together through a Linux io_uring, and so is the \
+  readahead of cursors walking the word database, instead of one system \
+  call per page. Compressed pages are still written one at a time. \
+  Ignored where the system does not provide io_uring. \
+"}
+  ,
+  {"wordlist_mmap_size", "0",
+   "number", "all", "", "0.4.0", "Searching:Method",
+   "wordlist_mmap_size: 32000000000", " \
+  Largest word database (in bytes) that is memory-mapped instead of being \
+  read through the Berkeley DB cache when it is opened read-only, as \
+  <a href=\"hlsearch.html\">hlsearch</a> does. Mapped pages live in the \
+  system page cache, so any number of hlsearch processes share one copy \
+  of the index and pages are used in place rather than copied into the \
+  cache. Zero keeps the Berkeley DB default of 10 megabytes. Only \
+  uncompressed databases can be mapped: hlsearch reports an error when \
+  this is set and <a href=\"#wordlist_compress\">wordlist_compress</a> \
+  is true, or when the word database is larger than this. Keys and \
+  records are still copied out of the mapped pages, and the document \
+  databases are always read through the cache. \
 "}
   ,
   {"wordlist_monitor", "false",
@@ -3186,6 +3509,45 @@ form during indexing and translated for results. \
    "wordlist_page_size: 8192", " \
   Size (in bytes) of pages used by Berkeley DB (DB used by the indexer). \
   Must be a power of two. \
+"}
+  ,
+  {"wordlist_snapshot", "false",
+   "boolean", "hlsearch", "", "0.4.0", "Searching:Method",
+   "wordlist_snapshot: true", " \
+  Opens the databases read by <a href=\"hlsearch.html\">hlsearch</a> \
+  as a read-only snapshot, which must not change while it is open. \
+  No lock is taken to read it, and the internal pages of the trees \
+  stay in the cache, where any number of query threads find them \
+  without locking the cache. The databases can then only be opened \
+  read-only, and <a href=\"#wordlist_env_cdb\">wordlist_env_cdb</a> \
+  is ignored. hlsearch sets this attribute itself when it searches a \
+  generation of the databases (see \
+  <a href=\"#database_generations\">database_generations</a>), as \
+  generations never change once committed. Only set it otherwise when \
+  no hldig, hlmerge or hlpurge updates the databases in place while \
+  they are searched. \
+"}
+  ,
+  {"wordlist_txn_checkpoint", "65536",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_txn_checkpoint: 16384", " \
+  With <a href=\"#database_transactions\">database_transactions</a>, \
+  kilobytes of log after which the pages changed in the cache are \
+  written and the log files that are no longer needed are removed. A \
+  checkpoint bounds how much log a recovery replays, but writes pages \
+  that would otherwise have been changed again first: frequent \
+  checkpoints make the dig slower and the compressed word database \
+  larger until it is compacted. 0 checkpoints after every group of \
+  <a href=\"#wordlist_txn_group\">wordlist_txn_group</a> commits. \
+"}
+  ,
+  {"wordlist_txn_group", "100",
+   "integer", "all", "", "0.4.0", "Indexing:How",
+   "wordlist_txn_group: 1", " \
+  With <a href=\"#database_transactions\">database_transactions</a>, \
+  number of commits made durable by a single flush of the log. A crash \
+  loses at most this many documents, which the next dig retrieves \
+  again. 1 flushes the log after every document. \
 "}
   ,
   {"wordlist_verbose", "",
@@ -680,6 +680,16 @@ mpool_stats (DB_ENV * dbenvp)
       (u_long) gsp->st_map);
   dl ("Requested pages not found in the cache.\n",
       (u_long) gsp->st_cache_miss);
+  dl ("Requested internal pages found in the cache.\n",
+      (u_long) gsp->st_internal_hit);
+  dl ("Requested internal pages not found in the cache.\n",
+      (u_long) gsp->st_internal_miss);
+  dl ("Requested leaf pages found in the cache.\n",
+      (u_long) gsp->st_leaf_hit);
+  dl ("Requested leaf pages not found in the cache.\n",
+      (u_long) gsp->st_leaf_miss);
+  dl ("Requested snapshot pages found without locking the cache.\n",
+      (u_long) gsp->st_snap_hit);
   dl ("Pages created in the cache.\n", (u_long) gsp->st_page_create);
   dl ("Pages read into the cache.\n", (u_long) gsp->st_page_in);
   dl ("Pages written from the cache to the backing file.\n",
@@ -690,6 +700,8 @@ mpool_stats (DB_ENV * dbenvp)
       (u_long) gsp->st_page_trickle);
   dl ("Current clean buffer count.\n", (u_long) gsp->st_page_clean);
   dl ("Current dirty buffer count.\n", (u_long) gsp->st_page_dirty);
+  dl ("Current buffers on probation.\n", (u_long) gsp->st_page_probation);
+  dl ("Buffers promoted from probation.\n", (u_long) gsp->st_page_promote);
   dl ("Number of hash buckets used for page location.\n",
       (u_long) gsp->st_hash_buckets);
   dl ("Total number of times hash chains searched for a page.\n",
@@ -26,6 +26,7 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <ctype.h>
 
 #include "Document.h"
@@ -54,6 +55,23 @@ typedef void (*SIGNAL_HANDLER) (...);
 typedef SIG_PF SIGNAL_HANDLER;
 #endif
 
+//
+// A URL to be retrieved after the current one
+//
+class NextURL:public Object
+{
+public:
+  NextURL (const String & u, const String & r, time_t d,
+           const String & e):url (u), referer (r), date (d), etag (e)
+  {
+  }
+
+  URL url;
+  URL referer;
+  HtDateTime date;
+  String etag;
+};
+
 //*****************************************************************************
 // Document::Document(char *u)
 //   Initialize with the given url as the location for this document.
@@ -170,6 +188,9 @@ Document::Reset ()
   contents = 0;
   document_length = 0;
   redirected_to = 0;
+  request_etag = 0;
+  etag = 0;
+  next_urls.Destroy ();
 
 }
 
@@ -250,6 +271,20 @@ Document::UseProxy ()
 }
 
 
+//*****************************************************************************
+// void Document::AddNextURL(const String &u, const String &r, time_t date,
+//                           const String &e)
+//   The URL, referring URL, modification time and entity tag are taken
+//   the way Url(), Referer(), Retrieve() and RequestETag() take them
+//
+void
+Document::AddNextURL (const String & u, const String & r, time_t date,
+                      const String & e)
+{
+  next_urls.Add (new NextURL (u, r, date, e));
+}
+
+
 //*****************************************************************************
 // DocStatus Document::Retrieve(HtDateTime date)
 //   Attempt to retrieve the document pointed to by our internal URL
@@ -313,6 +348,9 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
       if (referer)
         HTTPSConnect->SetRefererURL (*referer);
 
+      // Set the entity tag of the copy we own
+      HTTPSConnect->SetRequestETag (request_etag);
+
       // Let's disable the cookies if we decided that in the config file
       if (server->DisableCookies ())
         HTTPSConnect->DisableCookies ();
@@ -334,6 +372,12 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
       else
         HTTPSConnect->DisableHeadBeforeGet ();
 
+      // Compressed documents option control
+      if (server->HttpCompression ())
+        HTTPSConnect->EnableCompression ();
+      else
+        HTTPSConnect->DisableCompression ();
+
       // http->SetRequestMethod(HtHTTP::Method_GET);
       if (debug > 2)
       {
@@ -380,6 +424,9 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
       if (referer)
         HTTPConnect->SetRefererURL (*referer);
 
+      // Set the entity tag of the copy we own
+      HTTPConnect->SetRequestETag (request_etag);
+
       // Let's disable the cookies if we decided that in the config file
       if (server->DisableCookies ())
         HTTPConnect->DisableCookies ();
@@ -401,6 +448,12 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
       else
         HTTPConnect->DisableHeadBeforeGet ();
 
+      // Compressed documents option control
+      if (server->HttpCompression ())
+        HTTPConnect->EnableCompression ();
+      else
+        HTTPConnect->DisableCompression ();
+
       // http->SetRequestMethod(HtHTTP::Method_GET);
       if (debug > 2)
       {
@@ -552,6 +605,19 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
     // document we already have)
     transportConnect->SetRequestModificationTime (date);
 
+    // The requests which are to follow this one may go along with it
+    if (transportConnect == HTTPConnect || transportConnect == HTTPSConnect)
+    {
+      HtHTTP *http = (HtHTTP *) transportConnect;
+      NextURL *next;
+
+      http->ClearNextRequests ();
+      next_urls.Start_Get ();
+      while ((next = (NextURL *) next_urls.Get_Next ()))
+        http->AddNextRequest (next->url, next->referer, next->date,
+                              next->etag);
+    }
+
     // Make the request
     // Here is the main operation ... Let's make the request !!!
     // We now perform a loop until we want to retry the request
@@ -569,6 +635,16 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
     }
     while (ShouldWeRetry (status) && NumRetries < num_retries);
 
+    // A server answering pipelined requests with garbage gets them
+    // one at a time from now on
+    if ((transportConnect == HTTPConnect || transportConnect == HTTPSConnect)
+        && ((HtHTTP *) transportConnect)->PipelineFailed ())
+    {
+      if (debug > 0)
+        cout << "! Pipelining turned off for " << server->host () << endl;
+      server->AvoidPipelining ();
+    }
+
 
     // Let's get out the info we need
     response = transportConnect->GetResponse ();
@@ -577,7 +653,8 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
     {
       // We got the response
 
-      contents = response->GetContents ();
+      // Take the contents over rather than copy them
+      response->SwapContents (contents);
       contentType = response->GetContentType ();
       contentLength = response->GetContentLength ();
       ptrdatetime = response->GetModificationTime ();
@@ -590,6 +667,9 @@ Transport::DocStatus Document::Retrieve (Server * server, HtDateTime date)
           || transportConnect == externalConnect)
         redirected_to = ((HtHTTP_Response *) response)->GetLocation ();
 
+      if (transportConnect == HTTPConnect || transportConnect == HTTPSConnect)
+        etag = ((HtHTTP_Response *) response)->GetETag ();
+
       if (ptrdatetime)
       {
         // We got the modification date/time
@@ -680,29 +760,19 @@ Transport::DocStatus
     contentType = *type;
 
   // Open it
-  FILE *f = fopen ((char *) *filename, "r");
-  if (f == NULL)
+  int fd = open ((char *) *filename, O_RDONLY);
+  if (fd < 0)
     return Transport::Document_not_local;
 
   //
-  // Read in the document itself
+  // Read in the document itself, straight into the contents
   //
   max_doc_size = config->Value (url, "max_doc_size");
   contents = 0;
-  char docBuffer[8192];
-  int bytesRead;
-
-  while ((bytesRead = fread (docBuffer, 1, sizeof (docBuffer), f)) > 0)
-  {
-    if (debug > 2)
-      cout << "Read " << bytesRead << " from document\n";
-    if (contents.length () + bytesRead > max_doc_size)
-      bytesRead = max_doc_size - contents.length ();
-    contents.append (docBuffer, bytesRead);
-    if (contents.length () >= max_doc_size)
-      break;
-  }
-  fclose (f);
+  contents.allocate (stat_buf.st_size < max_doc_size ?
+                     (int) stat_buf.st_size : max_doc_size);
+  contents.Read (fd, max_doc_size);
+  close (fd);
   document_length = contents.length ();
   contentLength = stat_buf.st_size;
 
@@ -720,7 +790,8 @@ Transport::DocStatus
 //   Given the content-type of a document, returns a document parser.
 //   This will first look through the list of user supplied parsers and
 //   then at our (limited) builtin list of parsers.  The user supplied
-//   parsers are external programs that will be used.
+//   parsers are external programs that will be used.  The contents are
+//   handed over to the parser, which leaves the document without them.
 //
 Parsable *
 Document::getParsable ()
@@ -776,7 +847,7 @@ Document::getParsable ()
     return NULL;
   }
 
-  parsable->setContents (contents.get (), contents.length ());
+  parsable->takeContents (contents);
   return parsable;
 }
 
@@ -97,6 +97,26 @@ public:
     return modtime.GetTime_t ();
   }
 
+  //
+  // The entity tag of the copy we own, sent to have the document only
+  // if it changed, and the one the server gave us this time
+  //
+  void RequestETag (const String & etag)
+  {
+    request_etag = etag;
+  }
+  const String & ETag () const
+  {
+    return etag;
+  }
+
+  //
+  // The URLs to be retrieved right after this one, in order. Their
+  // requests may be pipelined with ours over a persistent connection.
+  //
+  void AddNextURL (const String & url, const String & referer,
+                   time_t date, const String & etag);
+
   Transport::DocStatus Retrieve (Server * server, HtDateTime date);
   Transport::DocStatus RetrieveLocal (HtDateTime date,
                                       StringList * filenames);
@@ -140,6 +160,8 @@ private:
   URL *referer;
   String contents;
   String redirected_to;
+  String request_etag;
+  String etag;
   String contentType;
   String authorization;
   String proxy_authorization;
@@ -148,6 +170,7 @@ private:
   HtDateTime modtime;
   int max_doc_size;
   int num_retries;
+  List next_urls;
 
   int UseProxy ();
 
@@ -29,8 +29,11 @@
 #include "URL.h"
 #include "Dictionary.h"
 #include "good_strtok.h"
+#include "StringList.h"
+#include "ExternalProcess.h"
 
 #include <ctype.h>
+#include <fcntl.h>
 #include <stdio.h>
 
 #ifndef _MSC_VER                /* _WIN32 */
@@ -85,41 +88,6 @@ ExternalParser::~ExternalParser ()
 }
 
 
-//*****************************************************************************
-// int ExternalParser::readLine(FILE *in, String &line)
-//
-int
-ExternalParser::readLine (FILE * in, String & line)
-{
-  char buffer[2048];
-  int length;
-
-  line = 0;                     // read(in, buffer, sizeof(buffer)
-  while (fgets (buffer, sizeof (buffer), in))
-  {
-    length = strlen (buffer);
-    if (buffer[length - 1] == '\n')
-    {
-      //
-      // A full line has been read.  Return it.
-      //
-      line << buffer;
-      line.chop ('\n');
-      return 1;
-    }
-    else
-    {
-      //
-      // Only a partial line was read.  Append it to the line
-      // and read some more.
-      //
-      line << buffer;
-    }
-  }
-  return line.length () > 0;
-}
-
-
 //*****************************************************************************
 // int ExternalParser::canParse(char *contentType)
 //
@@ -181,42 +149,6 @@ ExternalParser::parse (Retriever & retriever, URL & base)
     return;
   }
 
-  //
-  // Write the contents to a temporary file.
-  //
-  String path = getenv ("TMPDIR");
-  int fd;
-  if (path.length () == 0)
-    path = "/tmp";
-#ifndef HAVE_MKSTEMP
-  path << "/htdext." << getpid ();      // This is unfortunately predictable
-
-#ifdef O_BINARY
-  fd = open ((char *) path, O_WRONLY | O_CREAT | O_EXCL | O_BINARY);
-#else
-  fd = open ((char *) path, O_WRONLY | O_CREAT | O_EXCL);
-#endif
-#else
-  path << "/htdex.XXXXXX";
-  fd = mkstemp ((char *) path);
-  // can we force binary mode somehow under Cygwin, if it has mkstemp?
-#endif
-  if (fd < 0)
-  {
-    if (debug)
-      cout << "External parser error: Can't create temp file "
-        << (char *) path << endl;
-    return;
-  }
-
-  write (fd, contents->get (), contents->length ());
-  close (fd);
-
-//  unsigned int minimum_word_length = config->Value("minimum_word_length", 3);
-  String line;
-  char *token1, *token2, *token3;
-  int loc = 0, hd = 0;
-  URL url;
   String mime = contentType;
   mime.lowercase ();
   int sep = mime.indexOf (';');
@@ -225,85 +157,34 @@ ExternalParser::parse (Retriever & retriever, URL & base)
   String convertToType = ((String *) toTypes->Find (mime))->get ();
   int get_hdr = (convertToType.nocase_compare ("user-defined") == 0);
   int get_file = (convertToType.length () != 0);
-  String newcontent;
-
-  StringList cpargs (currentParser, " \t");
-  char **parsargs = new char *[cpargs.Count () + 5];
-  int argi;
-  for (argi = 0; argi < cpargs.Count (); argi++)
-    parsargs[argi] = (char *) cpargs[argi];
-  parsargs[argi++] = path.get ();
-  parsargs[argi++] = contentType.get ();
-  parsargs[argi++] = (char *) base.get ().get ();
-  parsargs[argi++] = configFile.get ();
-  parsargs[argi++] = 0;
-
-  int stdout_pipe[2];
-  int fork_result = -1;
-  int fork_try;
-
-  if (pipe (stdout_pipe) == -1)
-  {
-    if (debug)
-      cout << "External parser error: Can't create pipe!" << endl;
-    unlink ((char *) path);
-    delete[]parsargs;
-    return;
-  }
 
-  for (fork_try = 4; --fork_try >= 0;)
+  //
+  // Let the parser have a go at the contents and collect its output.  A
+  // converted document is no larger than any other document; the words
+  // of a parser that does not convert are all taken.
+  //
+  int max_doc_size = config->Value (&base, "max_doc_size");
+  int max_output = get_file ? ExternalProcess::MaxOutput (max_doc_size) : 0;
+  int truncated = 0;
+  String output;
+  if (config->Boolean ("external_parsers_persistent"))
   {
-    fork_result = fork ();      // Fork so we can execute in the child process
-    if (fork_result != -1)
-      break;
-    if (fork_try)
-      sleep (3);
+    if (convertPersistent (base, output, max_output, truncated) == NOTOK)
+      return;
   }
-  if (fork_result == -1)
-  {
-    if (debug)
-      cout << "Fork Failure in ExternalParser" << endl;
-    unlink ((char *) path);
-    delete[]parsargs;
+  else if (convertOnce (base, output, max_output, truncated) == NOTOK)
     return;
-  }
-
-  if (fork_result == 0)         // Child process
-  {
-    close (STDOUT_FILENO);      // Close handle STDOUT to replace with pipe
-    dup (stdout_pipe[1]);
-    close (stdout_pipe[0]);
-    close (stdout_pipe[1]);
-    close (STDIN_FILENO);       // Close STDIN to replace with file
-    open ((char *) path, O_RDONLY);
-
-    // Call External Parser
-    execv (parsargs[0], parsargs);
-
-    perror ("execv");
-    write (STDERR_FILENO, "External parser error: Can't execute ", 37);
-    write (STDERR_FILENO, parsargs[0], strlen (parsargs[0]));
-    write (STDERR_FILENO, "\n", 1);
-    _exit (EXIT_FAILURE);
-  }
 
-  // Parent Process
-  delete[]parsargs;
-  close (stdout_pipe[1]);       // Close STDOUT for writing
-#ifdef O_BINARY
-  FILE *input = fdopen (stdout_pipe[0], "rb");
-#else
-  FILE *input = fdopen (stdout_pipe[0], "r");
-#endif
-  if (input == NULL)
-  {
-    if (debug)
-      cout << "Fdopen Failure in ExternalParser" << endl;
-    unlink ((char *) path);
-    return;
-  }
+//  unsigned int minimum_word_length = config->Value("minimum_word_length", 3);
+  String line;
+  char *token1, *token2, *token3;
+  int loc = 0, hd = 0;
+  URL url;
+  String newcontent;
+  int pos = 0;
 
-  while ((!get_file || get_hdr) && readLine (input, line))
+  while ((!get_file || get_hdr)
+         && ExternalProcess::ReadLine (output, pos, line))
   {
     if (get_hdr)
     {
@@ -572,25 +453,20 @@ ExternalParser::parse (Retriever & retriever, URL & base)
     }
     else
     {
-      char buffer[2048];
-      int length;
-      int nbytes = config->Value ("max_doc_size");
-      while (nbytes > 0 &&
-             (length = fread (buffer, 1, sizeof (buffer), input)) > 0)
+      // The rest of the output is the converted document
+      int length = output.length () - pos;
+      if (length > max_doc_size)
       {
-        nbytes -= length;
-        if (nbytes < 0)
-          length += nbytes;
-        newcontent.append (buffer, length);
+        length = max_doc_size;
+        truncated = 1;
       }
+      if (length > 0)
+        newcontent.append (output.get () + pos, length);
+      if (truncated)
+        cerr << _("External parser warning: converted document truncated to max_doc_size")
+          << "\n" << _(" URL: ") << base.get () << "\n";
     }
   }
-  fclose (input);
-  // close(stdout_pipe[0]); // This is closed for us by the fclose()
-  int rpid, status;
-  while ((rpid = wait (&status)) != fork_result && rpid != -1)
-    ;
-  unlink ((char *) path);
 
   if (newcontent.length () > 0)
   {
@@ -625,8 +501,164 @@ ExternalParser::parse (Retriever & retriever, URL & base)
         cout << "External parser error: \"" << contentType <<
           "\" not a recognized type.  Assuming text/plain\n";
     }
-    parsable->setContents (newcontent.get (), newcontent.length ());
+    parsable->takeContents (newcontent);
     parsable->parse (retriever, base);
   }
 #endif //ifndef _MSC_VER /* _WIN32 */
 }
+
+
+#ifndef _MSC_VER                /* _WIN32 */
+
+//*****************************************************************************
+// int ExternalParser::convertOnce(URL &base, String &output,
+//                                 int max_output, int &truncated)
+//   Run the parser on a temporary file holding the contents, and
+//   collect what it writes on its standard output.
+//
+int
+ExternalParser::convertOnce (URL & base, String & output, int max_output,
+                             int &truncated)
+{
+  //
+  // Write the contents to a temporary file.
+  //
+  String path = getenv ("TMPDIR");
+  int fd;
+  if (path.length () == 0)
+    path = "/tmp";
+#ifndef HAVE_MKSTEMP
+  path << "/htdext." << getpid ();      // This is unfortunately predictable
+
+#ifdef O_BINARY
+  fd = open ((char *) path, O_WRONLY | O_CREAT | O_EXCL | O_BINARY);
+#else
+  fd = open ((char *) path, O_WRONLY | O_CREAT | O_EXCL);
+#endif
+#else
+  path << "/htdex.XXXXXX";
+  fd = mkstemp ((char *) path);
+  // can we force binary mode somehow under Cygwin, if it has mkstemp?
+#endif
+  if (fd < 0)
+  {
+    if (debug)
+      cout << "External parser error: Can't create temp file "
+        << (char *) path << endl;
+    return NOTOK;
+  }
+
+  write (fd, contents->get (), contents->length ());
+  close (fd);
+
+  StringList cpargs (currentParser, " \t");
+  char **parsargs = new char *[cpargs.Count () + 5];
+  int argi;
+  for (argi = 0; argi < cpargs.Count (); argi++)
+    parsargs[argi] = (char *) cpargs[argi];
+  parsargs[argi++] = path.get ();
+  parsargs[argi++] = contentType.get ();
+  parsargs[argi++] = (char *) base.get ().get ();
+  parsargs[argi++] = configFile.get ();
+  parsargs[argi++] = 0;
+
+  int stdout_pipe[2];
+  int fork_result = -1;
+  int fork_try;
+
+  if (pipe (stdout_pipe) == -1)
+  {
+    if (debug)
+      cout << "External parser error: Can't create pipe!" << endl;
+    unlink ((char *) path);
+    delete[]parsargs;
+    return NOTOK;
+  }
+
+  for (fork_try = 4; --fork_try >= 0;)
+  {
+    fork_result = fork ();      // Fork so we can execute in the child process
+    if (fork_result != -1)
+      break;
+    if (fork_try)
+      sleep (3);
+  }
+  if (fork_result == -1)
+  {
+    if (debug)
+      cout << "Fork Failure in ExternalParser" << endl;
+    close (stdout_pipe[0]);
+    close (stdout_pipe[1]);
+    unlink ((char *) path);
+    delete[]parsargs;
+    return NOTOK;
+  }
+
+  if (fork_result == 0)         // Child process
+  {
+    close (STDOUT_FILENO);      // Close handle STDOUT to replace with pipe
+    dup (stdout_pipe[1]);
+    close (stdout_pipe[0]);
+    close (stdout_pipe[1]);
+    close (STDIN_FILENO);       // Close STDIN to replace with file
+    open ((char *) path, O_RDONLY);
+
+    // Call External Parser
+    execv (parsargs[0], parsargs);
+
+    perror ("execv");
+    write (STDERR_FILENO, "External parser error: Can't execute ", 37);
+    write (STDERR_FILENO, parsargs[0], strlen (parsargs[0]));
+    write (STDERR_FILENO, "\n", 1);
+    _exit (EXIT_FAILURE);
+  }
+
+  // Parent Process
+  delete[]parsargs;
+  close (stdout_pipe[1]);       // Close STDOUT for writing
+
+  truncated = ExternalProcess::ReadOutput (stdout_pipe[0], output, max_output);
+  close (stdout_pipe[0]);
+
+  int rpid, status;
+  while ((rpid = wait (&status)) != fork_result && rpid != -1)
+    ;
+  unlink ((char *) path);
+
+  return OK;
+}
+
+
+static Dictionary *processes = 0;
+
+//*****************************************************************************
+// int ExternalParser::convertPersistent(URL &base, String &output,
+//                                       int max_output, int &truncated)
+//   Hand the contents, content-type and URL to the running parser for
+//   this content-type, starting it first if needed.  The reply is the
+//   same output as that of a parser run once.
+//
+int
+ExternalParser::convertPersistent (URL & base, String & output,
+                                   int max_output, int &truncated)
+{
+  if (!processes)
+    processes = new Dictionary ();
+
+  ExternalProcess *process =
+    (ExternalProcess *) processes->Find (currentParser);
+  if (!process)
+  {
+    process = new ExternalProcess (currentParser);
+    processes->Add (currentParser, process);
+  }
+
+  String url = base.get ();
+  const String *fields[] = { contents, &contentType, &url };
+  String request;
+  ExternalProcess::Frame (request, fields, 3);
+
+  return process->Exchange (request, output, max_output, truncated);
+}
+
+#endif //ifndef _MSC_VER /* _WIN32 */
@@ -50,7 +50,16 @@ private:
     String currentParser;
   String contentType;
 
-  int readLine (FILE *, String &);
+  //
+  // Run the parser, either once for this document or as a process
+  // kept running for all the documents, and collect up to max_output
+  // bytes of its output (all of it if max_output is 0).  truncated is
+  // set if some of it was dropped.
+  //
+  int convertOnce (URL & base, String & output, int max_output,
+                   int &truncated);
+  int convertPersistent (URL & base, String & output, int max_output,
+                         int &truncated);
 };
 
 #endif
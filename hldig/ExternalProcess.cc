@@ -0,0 +1,364 @@
+//
+// ExternalProcess.cc
+//
+// ExternalProcess: An external program kept running to serve one
+//                  request after the other, for the persistent modes
+//                  of the external parsers and transports.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifdef HAVE_CONFIG_H
+#include "hlconfig.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "ExternalProcess.h"
+#include "StringList.h"
+#include "hldig.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _MSC_VER                /* _WIN32 */
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_WAIT_H
+#include <wait.h>
+#elif HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+extern String configFile;
+
+// Room left in the output of a program for what is not the document
+#define OUTPUT_SLACK	65536
+
+//*****************************************************************************
+// ExternalProcess::ExternalProcess(const String &command)
+//
+ExternalProcess::ExternalProcess (const String & command)
+{
+  ExternalProcess::command = command;
+  pid = -1;
+  to_process = -1;
+  from_process = -1;
+}
+
+
+//*****************************************************************************
+// ExternalProcess::~ExternalProcess()
+//
+ExternalProcess::~ExternalProcess ()
+{
+  Stop ();
+}
+
+
+//*****************************************************************************
+// void ExternalProcess::Frame(String &request, const String *fields[],
+//                             int count)
+//
+void
+ExternalProcess::Frame (String & request, const String * fields[], int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+  {
+    if (i > 0)
+      request << ' ';
+    request << fields[i]->length ();
+  }
+  request << '\n';
+  for (i = 0; i < count; i++)
+    request << *fields[i];
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::ReadLine(const String &output, int &pos, String &line)
+//
+int
+ExternalProcess::ReadLine (const String & output, int &pos, String & line)
+{
+  const char *start = output.get () + pos;
+  int left = output.length () - pos;
+
+  line = 0;
+  if (left <= 0)
+    return 0;
+
+  const char *end = (const char *) memchr (start, '\n', left);
+  int length = end ? end - start : left;
+
+  line.append (start, length);
+  pos += end ? length + 1 : length;
+  return 1;
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::ReadOutput(int fd, String &output, int max_output)
+//
+int
+ExternalProcess::ReadOutput (int fd, String & output, int max_output)
+{
+  output.Read (fd, max_output > 0 ? max_output : INT_MAX);
+  if (max_output <= 0 || output.length () < max_output)
+    return 0;
+
+  // Whatever follows is dropped, so that the program is not killed by
+  // a broken pipe before it is done.
+  int dropped = 0;
+  char buffer[8192];
+  int result;
+  while ((result = read (fd, buffer, sizeof (buffer))) != 0)
+  {
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result < 0)
+      break;
+    dropped = 1;
+  }
+  return dropped;
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::MaxOutput(int max_doc_size)
+//
+int
+ExternalProcess::MaxOutput (int max_doc_size)
+{
+  if (max_doc_size < 0 || max_doc_size > INT_MAX - OUTPUT_SLACK)
+    return INT_MAX;
+  return max_doc_size + OUTPUT_SLACK;
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::Exchange(const String &request, String &reply,
+//                               int max_reply, int &truncated)
+//
+int
+ExternalProcess::Exchange (const String & request, String & reply,
+                           int max_reply, int &truncated)
+{
+  // A program that died on the previous request is started again, but
+  // one that fails on this very request is not retried forever.
+  for (int attempt = 0; attempt < 2; attempt++)
+  {
+    if (!Running () && Start () == NOTOK)
+      return NOTOK;
+    reply.trunc ();
+    truncated = 0;
+    if (exchange (request, reply, max_reply, truncated) == OK)
+      return OK;
+  }
+  return NOTOK;
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::Start()
+//
+int
+ExternalProcess::Start ()
+{
+#ifndef _MSC_VER                /* _WIN32 */
+  StringList cargs (command, " \t");
+  char **args = new char *[cargs.Count () + 2];
+  int argi;
+  for (argi = 0; argi < cargs.Count (); argi++)
+    args[argi] = (char *) cargs[argi];
+  args[argi++] = configFile.get ();
+  args[argi++] = 0;
+
+  int stdin_pipe[2];
+  int stdout_pipe[2];
+
+  if (pipe (stdin_pipe) == -1)
+  {
+    if (debug)
+      cout << "External process error: Can't create pipe!" << endl;
+    delete[]args;
+    return NOTOK;
+  }
+  if (pipe (stdout_pipe) == -1)
+  {
+    if (debug)
+      cout << "External process error: Can't create pipe!" << endl;
+    close (stdin_pipe[0]);
+    close (stdin_pipe[1]);
+    delete[]args;
+    return NOTOK;
+  }
+
+  // Our ends of the pipes must not leak into the other programs, or
+  // those would never see the end of their input.
+  fcntl (stdin_pipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl (stdout_pipe[0], F_SETFD, FD_CLOEXEC);
+
+  int fork_try;
+  for (fork_try = 4; --fork_try >= 0;)
+  {
+    pid = fork ();
+    if (pid != -1)
+      break;
+    if (fork_try)
+      sleep (3);
+  }
+  if (pid == -1)
+  {
+    if (debug)
+      cout << "Fork Failure in ExternalProcess" << endl;
+    close (stdin_pipe[0]);
+    close (stdin_pipe[1]);
+    close (stdout_pipe[0]);
+    close (stdout_pipe[1]);
+    delete[]args;
+    return NOTOK;
+  }
+
+  if (pid == 0)                 // Child process
+  {
+    dup2 (stdin_pipe[0], STDIN_FILENO);
+    dup2 (stdout_pipe[1], STDOUT_FILENO);
+    close (stdin_pipe[0]);
+    close (stdout_pipe[1]);
+
+    execv (args[0], args);
+
+    perror ("execv");
+    write (STDERR_FILENO, "External process error: Can't execute ", 38);
+    write (STDERR_FILENO, args[0], strlen (args[0]));
+    write (STDERR_FILENO, "\n", 1);
+    _exit (EXIT_FAILURE);
+  }
+
+  // Parent Process
+  delete[]args;
+  close (stdin_pipe[0]);
+  close (stdout_pipe[1]);
+  to_process = stdin_pipe[1];
+  from_process = stdout_pipe[0];
+
+  if (debug > 1)
+    cout << "Started " << command << " (pid " << pid << ")" << endl;
+
+  return OK;
+#else
+  return NOTOK;
+#endif //ifndef _MSC_VER /* _WIN32 */
+}
+
+
+//*****************************************************************************
+// void ExternalProcess::Stop()
+//
+void
+ExternalProcess::Stop ()
+{
+#ifndef _MSC_VER                /* _WIN32 */
+  if (!Running ())
+    return;
+
+  // The end of its input tells the program to exit
+  close (to_process);
+  close (from_process);
+  int status;
+  while (waitpid (pid, &status, 0) == -1 && errno == EINTR)
+    ;
+  pid = -1;
+  to_process = -1;
+  from_process = -1;
+#endif //ifndef _MSC_VER /* _WIN32 */
+}
+
+
+//*****************************************************************************
+// int ExternalProcess::exchange(const String &request, String &reply,
+//                               int max_reply, int &truncated)
+//   A single attempt at Exchange().
+//
+int
+ExternalProcess::exchange (const String & request, String & reply,
+                           int max_reply, int &truncated)
+{
+#ifndef _MSC_VER                /* _WIN32 */
+  if (request.Write (to_process) < 0)
+  {
+    if (debug)
+      cout << "External process error: Can't write to " << command << endl;
+    Stop ();
+    return NOTOK;
+  }
+
+  // The length of the reply...
+  String header;
+  char c = 0;
+  while (header.length () < 32)
+  {
+    int result = read (from_process, &c, 1);
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result != 1 || c == '\n')
+      break;
+    header << c;
+  }
+
+  char *end;
+  long length = strtol (header.get (), &end, 10);
+  if (c != '\n' || header.length () == 0 || *end != '\0' || length < 0)
+  {
+    if (debug)
+      cout << "External process error: No reply from " << command << endl;
+    Stop ();
+    return NOTOK;
+  }
+
+  // ... and the reply itself, of which only so much is kept.  The rest
+  // is read all the same, as the next reply comes after it.
+  long keep = length;
+  if (max_reply <= 0 || max_reply > INT_MAX - 1)
+    max_reply = INT_MAX - 1;
+  if (keep > max_reply)
+    keep = max_reply;
+  reply.allocate ((int) keep);
+  int result = reply.Read (from_process, (int) keep);
+  for (long left = length - keep; result == keep && left > 0;)
+  {
+    char buffer[8192];
+    int n = read (from_process, buffer,
+                  left < (long) sizeof (buffer) ? (int) left :
+                  (int) sizeof (buffer));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      result = -1;
+    else
+      left -= n;
+  }
+  if (result != keep)
+  {
+    if (debug)
+      cout << "External process error: Short reply from " << command << endl;
+    Stop ();
+    return NOTOK;
+  }
+  truncated = keep < length;
+
+  return OK;
+#else
+  return NOTOK;
+#endif //ifndef _MSC_VER /* _WIN32 */
+}
@@ -0,0 +1,94 @@
+//
+// ExternalProcess.h
+//
+// ExternalProcess: An external program kept running to serve one
+//                  request after the other, for the persistent modes
+//                  of the external parsers and transports.
+//
+//                  The program is given the configuration file as its
+//                  last argument.  Requests are written on its standard
+//                  input; for each one it writes on its standard output
+//                  a line holding the length of its reply, followed by
+//                  the reply itself.  It must read a whole request
+//                  before it answers, and should exit at the end of its
+//                  input.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifndef _ExternalProcess_h_
+#define _ExternalProcess_h_
+
+#include "Object.h"
+#include "htString.h"
+
+class ExternalProcess:public Object
+{
+public:
+  //
+  // Construction/Destruction
+  //
+  ExternalProcess (const String & command);
+  ~ExternalProcess ();
+
+  //
+  // Send a request and collect the reply, starting the program first if
+  // it is not running.  If the program dies on the way it is started
+  // again and given the request once more.  A reply longer than
+  // max_reply bytes, unless that is 0, is cut to that length and
+  // truncated is set: the rest is read and dropped, and the program
+  // keeps running.  Returns OK or NOTOK.
+  //
+  int Exchange (const String & request, String & reply, int max_reply,
+                int &truncated);
+
+  //
+  // Append to request a line with the lengths of the fields followed
+  // by the fields themselves: the framing used by the hl://Dig programs.
+  //
+  static void Frame (String & request, const String * fields[], int count);
+
+  //
+  // Get the line of the output of a program starting at pos, and move
+  // pos past it.  Returns 0 at the end of the output.
+  //
+  static int ReadLine (const String & output, int &pos, String & line);
+
+  //
+  // Read the output of a program run once until it ends, keeping up to
+  // max_output bytes of it, or all of it if max_output is 0.  Returns 1
+  // if some of it was dropped, 0 otherwise.
+  //
+  static int ReadOutput (int fd, String & output, int max_output);
+
+  //
+  // The most output worth taking from a program that writes out a
+  // document of at most max_doc_size bytes: the document and room for
+  // the lines that go with it.
+  //
+  static int MaxOutput (int max_doc_size);
+
+  int Start ();
+  void Stop ();
+  int Running () const
+  {
+    return pid > 0;
+  }
+
+private:
+  String command;
+  int pid;
+  int to_process;               // Standard input of the program
+  int from_process;             // Standard output of the program
+
+  int exchange (const String & request, String & reply, int max_reply,
+                int &truncated);
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "URL.h"
 #include "Dictionary.h"
 #include "good_strtok.h"
+#include "ExternalProcess.h"
 
 #include <ctype.h>
 #include <stdio.h>
@@ -132,80 +133,7 @@ Transport::DocStatus ExternalTransport::Request ()
 {
 // NEAL - ENABLE/REWRITE THIS ASAP FOR WIN32
 #ifndef _MSC_VER                /* _WIN32 */
-  //
-  // Start the external handler, passing the protocol, URL and config file
-  // as command arguments
-  //
-  StringList hargs (_Handler);
-  char **
-    handlargs = new char *[hargs.Count () + 5];
-  int
-    argi;
-  for (argi = 0; argi < hargs.Count (); argi++)
-    handlargs[argi] = (char *) hargs[argi];
-  handlargs[argi++] = _Protocol.get ();
-  handlargs[argi++] = (char *) _URL.get ().get ();
-  handlargs[argi++] = configFile.get ();
-  handlargs[argi++] = 0;
-
-  int
-    stdout_pipe[2];
-  int
-    fork_result = -1;
-  int
-    fork_try;
-
-  if (pipe (stdout_pipe) == -1)
-  {
-    if (debug)
-      cerr << "External transport error: Can't create pipe!" << endl;
-    delete[]handlargs;
-    return GetDocumentStatus (_Response);
-  }
-
-  for (fork_try = 4; --fork_try >= 0;)
-  {
-    fork_result = fork ();      // Fork so we can execute in the child process
-    if (fork_result != -1)
-      break;
-    if (fork_try)
-      sleep (3);
-  }
-  if (fork_result == -1)
-  {
-    if (debug)
-      cerr << "Fork Failure in ExternalTransport" << endl;
-    delete[]handlargs;
-    return GetDocumentStatus (_Response);
-  }
-
-  if (fork_result == 0)         // Child process
-  {
-    close (STDOUT_FILENO);      // Close handle STDOUT to replace with pipe
-    dup (stdout_pipe[1]);
-    close (stdout_pipe[0]);
-    close (stdout_pipe[1]);
-    // not really necessary, and may pose Cygwin incompatibility...
-    //close(STDIN_FILENO); // Close STDIN to replace with null dev.
-    //open("/dev/null", O_RDONLY);
-
-    // Call External Transport Handler
-    execv (handlargs[0], handlargs);
-
-    exit (EXIT_FAILURE);
-  }
-
-  // Parent Process
-  delete[]handlargs;
-  close (stdout_pipe[1]);       // Close STDOUT for writing
-  FILE *
-    input = fdopen (stdout_pipe[0], "r");
-  if (input == NULL)
-  {
-    if (debug)
-      cerr << "Fdopen Failure in ExternalTransport" << endl;
-    return GetDocumentStatus (_Response);
-  }
+  HtConfiguration *config = HtConfiguration::config ();
 
   // Set up a response for this request
   _Response->Reset ();
@@ -213,6 +141,20 @@ Transport::DocStatus ExternalTransport::Request ()
   _Response->_access_time = new HtDateTime ();
   _Response->_access_time->SettoNow ();
 
+  //
+  // Let the handler fetch the document and collect its output, no more
+  // of it than a document can hold
+  //
+  int max_output = ExternalProcess::MaxOutput (_max_document_size);
+  int truncated = 0;
+  String output;
+  if (config->Boolean ("external_protocols_persistent"))
+  {
+    if (fetchPersistent (output, max_output, truncated) == NOTOK)
+      return GetDocumentStatus (_Response);
+  }
+  else if (fetchOnce (output, max_output, truncated) == NOTOK)
+    return GetDocumentStatus (_Response);
 
   // OK, now parse the stuff we got back from the handler...
   String line;
@@ -220,8 +162,10 @@ Transport::DocStatus ExternalTransport::Request ()
     token1;
   int
     in_header = 1;
+  int
+    pos = 0;
 
-  while (in_header && readLine (input, line))
+  while (in_header && ExternalProcess::ReadLine (output, pos, line))
   {
     line.chop ('\r');
     if (line.length () > 0 && debug > 2)
@@ -298,26 +242,110 @@ Transport::DocStatus ExternalTransport::Request ()
     }
   }
 
-  // OK, now we read in the rest of the document as contents...
+  // OK, now the rest of the output is the document itself...
+  int
+    length = output.length () - pos;
+  if (length > _max_document_size)
+  {
+    length = _max_document_size;
+    truncated = 1;
+  }
+  if (debug > 2)
+    cout << "Read " << length << " from document\n";
+  if (truncated && debug)
+    cout << "External transport: document truncated to max_doc_size: "
+      << _URL.get () << endl;
+
   _Response->_contents = 0;
-  char
-    docBuffer[8192];
+  if (length > 0)
+    _Response->_contents.append (output.get () + pos, length);
+  _Response->_document_length = _Response->_contents.length ();
+
+#endif
+
+  return GetDocumentStatus (_Response);
+}
+
+
+#ifndef _MSC_VER                /* _WIN32 */
+
+//*****************************************************************************
+// private
+// int ExternalTransport::fetchOnce(String &output, int max_output,
+//                                  int &truncated)
+//   Start the external handler, passing the protocol, URL and config file
+//   as command arguments, and collect what it writes.
+//
+int
+ExternalTransport::fetchOnce (String & output, int max_output, int &truncated)
+{
+  StringList hargs (_Handler);
+  char **
+    handlargs = new char *[hargs.Count () + 5];
   int
-    bytesRead;
+    argi;
+  for (argi = 0; argi < hargs.Count (); argi++)
+    handlargs[argi] = (char *) hargs[argi];
+  handlargs[argi++] = _Protocol.get ();
+  handlargs[argi++] = (char *) _URL.get ().get ();
+  handlargs[argi++] = configFile.get ();
+  handlargs[argi++] = 0;
+
+  int
+    stdout_pipe[2];
+  int
+    fork_result = -1;
+  int
+    fork_try;
+
+  if (pipe (stdout_pipe) == -1)
+  {
+    if (debug)
+      cerr << "External transport error: Can't create pipe!" << endl;
+    delete[]handlargs;
+    return NOTOK;
+  }
 
-  while ((bytesRead = fread (docBuffer, 1, sizeof (docBuffer), input)) > 0)
+  for (fork_try = 4; --fork_try >= 0;)
   {
-    if (debug > 2)
-      cout << "Read " << bytesRead << " from document\n";
-    if (_Response->_contents.length () + bytesRead > _max_document_size)
-      bytesRead = _max_document_size - _Response->_contents.length ();
-    _Response->_contents.append (docBuffer, bytesRead);
-    if (_Response->_contents.length () >= _max_document_size)
+    fork_result = fork ();      // Fork so we can execute in the child process
+    if (fork_result != -1)
       break;
+    if (fork_try)
+      sleep (3);
+  }
+  if (fork_result == -1)
+  {
+    if (debug)
+      cerr << "Fork Failure in ExternalTransport" << endl;
+    close (stdout_pipe[0]);
+    close (stdout_pipe[1]);
+    delete[]handlargs;
+    return NOTOK;
+  }
+
+  if (fork_result == 0)         // Child process
+  {
+    close (STDOUT_FILENO);      // Close handle STDOUT to replace with pipe
+    dup (stdout_pipe[1]);
+    close (stdout_pipe[0]);
+    close (stdout_pipe[1]);
+    // not really necessary, and may pose Cygwin incompatibility...
+    //close(STDIN_FILENO); // Close STDIN to replace with null dev.
+    //open("/dev/null", O_RDONLY);
+
+    // Call External Transport Handler
+    execv (handlargs[0], handlargs);
+
+    exit (EXIT_FAILURE);
   }
-  _Response->_document_length = _Response->_contents.length ();
-  fclose (input);
-  // close(stdout_pipe[0]); // This is closed for us by the fclose()
+
+  // Parent Process
+  delete[]handlargs;
+  close (stdout_pipe[1]);       // Close STDOUT for writing
+
+  truncated = ExternalProcess::ReadOutput (stdout_pipe[0], output, max_output);
+  close (stdout_pipe[0]);
 
   int
     rpid,
@@ -325,11 +353,48 @@ Transport::DocStatus ExternalTransport::Request ()
   while ((rpid = wait (&status)) != fork_result && rpid != -1)
     ;
 
-#endif
+  return OK;
+}
 
-  return GetDocumentStatus (_Response);
+
+static Dictionary *processes = 0;
+
+//*****************************************************************************
+// private
+// int ExternalTransport::fetchPersistent(String &output, int max_output,
+//                                        int &truncated)
+//   Hand the protocol and URL to the running handler for this protocol,
+//   starting it first if needed.  The reply is the same output as that
+//   of a handler run once.
+//
+int
+ExternalTransport::fetchPersistent (String & output, int max_output,
+                                    int &truncated)
+{
+  if (!processes)
+    processes = new Dictionary ();
+
+  ExternalProcess *
+    process = (ExternalProcess *) processes->Find (_Handler);
+  if (!process)
+  {
+    process = new ExternalProcess (_Handler);
+    processes->Add (_Handler, process);
+  }
+
+  String
+    url = _URL.get ();
+  const String *
+    fields[] = { &_Protocol, &url };
+  String
+    request;
+  ExternalProcess::Frame (request, fields, 2);
+
+  return process->Exchange (request, output, max_output, truncated);
 }
 
+#endif //ifndef _MSC_VER /* _WIN32 */
+
 
 //*****************************************************************************
 // private
@@ -361,39 +426,3 @@ Transport::
 
   return returnStatus;
 }
-
-
-//*****************************************************************************
-// private
-// int ExternalTransport::readLine(FILE *in, String &line)
-//
-int
-ExternalTransport::readLine (FILE * in, String & line)
-{
-  char buffer[2048];
-  int length;
-
-  line = 0;
-  while (fgets (buffer, sizeof (buffer), in))
-  {
-    length = strlen (buffer);
-    if (buffer[length - 1] == '\n')
-    {
-      //
-      // A full line has been read.  Return it.
-      //
-      line << buffer;
-      line.chop ('\n');
-      return 1;
-    }
-    else
-    {
-      //
-      // Only a partial line was read.  Append it to the line
-      // and read some more.
-      //
-      line << buffer;
-    }
-  }
-  return line.length () > 0;
-}
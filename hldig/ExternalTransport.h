@@ -85,8 +85,12 @@ private:
 
 
 
-  // Private helper to read in the result from the handler
-  int readLine (FILE *, String &);
+  // Run the handler, either once for this URL or as a process kept
+  // running for all the URLs, and collect up to max_output bytes of its
+  // output.  truncated is set if some of it was dropped.
+  int fetchOnce (String & output, int max_output, int &truncated);
+  int fetchPersistent (String & output, int max_output, int &truncated);
+
   // Work out the DocStatus from the HTTP-style status codes
   DocStatus GetDocumentStatus (ExternalTransport_Response * r);
 };
@@ -180,6 +180,24 @@ skip_end (HtConfiguration::config ()->Find ("noindex_end"), " \t")
     }
   }
 
+  special_chars = "<&";
+  check_every_char = 0;
+  for (int i = 0; i < skip_start.Count (); i++)
+  {
+    unsigned char first = ((String *) skip_start.Nth (i))->get ()[0];
+    if (first == '\0')
+    {
+      check_every_char = 1;
+      continue;
+    }
+    // Every byte the case-insensitive comparison would take for it
+    for (int c = 1; c < 256; c++)
+    {
+      if (tolower (c) == tolower (first) && !strchr (special_chars.get (), c))
+        special_chars << (char) c;
+    }
+  }
+
   word = 0;
   href = 0;
   title = 0;
@@ -225,7 +243,6 @@ HTML::parse (Retriever & retriever, URL & baseURL)
   int wordindex = 1;
   int in_space;
   int in_punct;
-  String scratch, textified;
   unsigned char *q, *start;
   unsigned char *position = (unsigned char *) contents->get ();
   unsigned char *text = (unsigned char *) new char[contents->length () + 1];
@@ -243,8 +260,26 @@ HTML::parse (Retriever & retriever, URL & baseURL)
   in_space = 0;
   in_punct = 0;
 
+  HtSGMLCodec *codec = HtSGMLCodec::instance ();
+  const char *special = special_chars.get ();
+
   while (*position)
   {
+    //
+    // Copy the plain text up to the next byte that needs a closer look
+    // in one go.
+    //
+    if (!check_every_char)
+    {
+      size_t run = strcspn ((char *) position, special);
+      if (run > 0)
+      {
+        memcpy (ptext, position, run);
+        ptext += run;
+        position += run;
+        continue;
+      }
+    }
 
     //
     // Filter out section marked to be ignored for indexing.
@@ -336,47 +371,44 @@ HTML::parse (Retriever & retriever, URL & baseURL)
       //
       q = (unsigned char *) strchr ((char *) position, '>');
       if (q)
-      {                         // copy tag
-        while (position <= q)
-          *ptext++ = *position++;
-      }
-      else
-      {                         // copy rest of text, as tag does not end
-        while (*position)
-          *ptext++ = *position++;
-      }
+        q++;                    // copy tag
+      else                      // copy rest of text, as tag does not end
+        q = position + strlen ((char *) position);
+      memcpy (ptext, position, q - position);
+      ptext += q - position;
+      position = q;
     }
     else if (*position == '&')
     {
-      q = (unsigned char *) strchr ((char *) position, ';');
-      if (q && q <= position + 10)
+      // An entity ends within ten bytes, so there is no need to look
+      // any further for its ';'
+      for (q = position + 1; q <= position + 10 && *q && *q != ';'; q++)
+        ;
+      const String *textified = 0;
+      if (*q == ';' && q <= position + 10)
       {                         // got ending, looks like valid SGML entity
-        scratch = 0;
-        scratch.append ((char *) position, q + 1 - position);
-        textified = HtSGMLCodec::instance ()->encode (scratch);
-        if (textified[0] != '&' || textified.length () == 1)
-        {                       // it was decoded, copy it
-          position = (unsigned char *) textified.get ();
-          while (*position)
-          {
-            if (*position == '<')
-            {                   // got a decoded &lt;, make a fake tag for it
-              // to avoid confusing it with real tag start
-              *ptext++ = '<';
-              *ptext++ = '~';
-              *ptext++ = '>';
-              position++;
-            }
-            else
-              *ptext++ = *position++;
+        textified = codec->encodeEntity ((char *) position,
+                                         q + 1 - position);
+      }
+      if (textified)
+      {                         // it was decoded, copy it
+        const char *decoded = textified->get ();
+        for (i = 0; i < textified->length (); i++)
+        {
+          if (decoded[i] == '<')
+          {                     // got a decoded &lt;, make a fake tag for it
+            // to avoid confusing it with real tag start
+            *ptext++ = '<';
+            *ptext++ = '~';
+            *ptext++ = '>';
           }
-          position = q + 1;
+          else
+            *ptext++ = decoded[i];
         }
-        else                    // it wasn't decoded, copy '&', and rest will follow
-          *ptext++ = *position++;
+        position = q + 1;
       }
-      else                      // not SGML entity, copy bare '&'
-        *ptext++ = *position++;
+      else                      // not a known SGML entity, copy bare '&',
+        *ptext++ = *position++; // and rest will follow
     }
     else
     {
@@ -448,6 +480,11 @@ HTML::parse (Retriever & retriever, URL & baseURL)
         if (strncmp ((char *) position, "<~>", 3) == 0)
           position += 2;        // skip over fake tag for decoded '<'
         position++;
+        // The rest of the word up to a possible tag goes in at once
+        for (q = position; *q && *q != '<' && HtIsWordChar (*q); q++)
+          ;
+        word.append ((char *) position, q - position);
+        position = q;
         if (*position == '<')
         {
           q = position + 1;
@@ -522,6 +559,9 @@ HTML::parse (Retriever & retriever, URL & baseURL)
       {
         ADDSPACE (in_space);
         in_punct = 0;
+        // Nothing more to do for the rest of the whitespace
+        while (isspace (position[1]) && !HtIsStrictWordChar (position[1]))
+          position++;
       }
       else
       {
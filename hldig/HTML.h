@@ -57,6 +57,14 @@ private:
   QuotedStringList skip_start;
   QuotedStringList skip_end;
 
+  //
+  // The bytes that may start a tag, an entity or a noindex_start; all
+  // others are copied without a closer look.  An empty noindex_start
+  // matches anywhere, so then every byte has to be looked at.
+  //
+  String special_chars;
+  int check_every_char;
+
   //
   // Helper functions
   //
@@ -60,6 +60,20 @@ Parsable::setContents (char *data, int length)
   contents = new String (data, length);
 }
 
+//*****************************************************************************
+// void Parsable::takeContents(String &data)
+//   Like setContents(), but the data is taken over rather than copied
+//   and is left empty.
+//
+void
+Parsable::takeContents (String & data)
+{
+  if (!contents)
+    contents = new String;
+  contents->swap (data);
+  data.trunc ();
+}
+
 //*****************************************************************************
 // void Parsable::addString(char *s, int& wordindex, int slot)
 //   Add all words in string s in "heading level" slot, incrementing  wordindex
@@ -40,6 +40,7 @@ public:
   // the data that we contain.
   //
   virtual void setContents (char *data, int length);
+  void takeContents (String & data);
   void addString (Retriever & retriever, char *s, int &wordindex, int slot);
   void addKeywordString (Retriever & retriever, char *s, int &wordindex);
 
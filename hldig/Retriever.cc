@@ -28,6 +28,7 @@
 #include "Retriever.h"
 #include "hldig.h"
 #include "HtWordList.h"
+#include "WordDBInfo.h"
 #include "WordRecord.h"
 #include "URLRef.h"
 #include "Server.h"
@@ -58,13 +59,16 @@ static bool no_store_phrases;
 // Retriever::Retriever()
 //
 Retriever::Retriever (RetrieverLog flags):
-words (*(HtConfiguration::config ())), words_to_add (100, 0.75)
+words (*(HtConfiguration::config ())), words_to_add (100)
 {
   HtConfiguration *config = HtConfiguration::config ();
   FILE *urls_parsed;
 
   currenthopcount = 0;
   max_hop_count = config->Value ("max_hop_count", 999999);
+  revisit_interval = config->Value ("revisit_interval", 0);
+  revisit_max_interval = config->Value ("revisit_max_interval", 2592000);
+  max_revisits = config->Value ("max_revisits", -1);
 
   no_store_phrases = !config->Boolean ("store_phrases");
 
@@ -95,6 +99,9 @@ words (*(HtConfiguration::config ())), words_to_add (100, 0.75)
 
   doc = new Document ();
   minimumWordLength = config->Value ("minimum_word_length", 3);
+  tokens = 0;
+  n_tokens = 0;
+  tokens_allocated = 0;
 
   log = flags;
   // if in restart mode
@@ -134,6 +141,24 @@ words (*(HtConfiguration::config ())), words_to_add (100, 0.75)
     }
   }
 
+  d_simhash = 0;
+  near_duplicate_distance = config->Value ("near_duplicate_distance", 3);
+  if (near_duplicate_distance < 0)
+    near_duplicate_distance = 0;
+  if (near_duplicate_distance > 7)
+    near_duplicate_distance = 7;
+  if (config->Boolean ("check_near_duplicates", 0))
+  {
+    d_simhash = Database::getDatabaseInstance (DB_HASH);
+
+    if (d_simhash->OpenReadWrite (config->Find ("simhash_db"), 0666) != OK)
+    {
+      cerr << "Retriever: unable to open " << config->Find ("simhash_db") <<
+        " " << strerror (errno) << ", near duplicates are not checked\n";
+      delete d_simhash;
+      d_simhash = 0;
+    }
+  }
 }
 
 
@@ -144,7 +169,13 @@ Retriever::~Retriever ()
 {
   if (d_md5)
     d_md5->Close ();
+  if (d_simhash)
+  {
+    d_simhash->Close ();
+    delete d_simhash;
+  }
   delete doc;
+  delete[]tokens;
 }
 
 
@@ -159,7 +190,7 @@ Retriever::setUsernamePassword (const char *credentials)
 
 
 //*****************************************************************************
-// void Retriever::Initial(char *list, int from)
+// void Retriever::Initial(char *list, int from, int priority)
 //   Add a single URL to the list of URLs to visit.
 //   Since URLs are stored on a per server basis, we first need to find the
 //   the correct server to add the URL's path to.
@@ -169,8 +200,11 @@ Retriever::setUsernamePassword (const char *credentials)
 //   from == 2 add url from db.log
 //   from == 3 urls in db.docs and there was a db.log
 //
+//   Among the URLs at the same hopcount, those with a lower priority
+//   are retrieved first.
+//
 void
-Retriever::Initial (const String & list, int from)
+Retriever::Initial (const String & list, int from, int priority)
 {
   //
   // Split the list of urls up into individual urls.
@@ -215,7 +249,7 @@ Retriever::Initial (const String & list, int from)
     {
       if (debug > 2)
         cout << " pushed";
-      server->push (u.get (), 0, 0, IsLocalURL (url.get ()));
+      server->push (u.get (), 0, 0, IsLocalURL (url.get ()), 1, priority);
     }
     if (debug > 2)
       cout << endl;
@@ -257,6 +291,126 @@ Retriever::Initial (List & list, int from)
   }
 }
 
+
+//
+// A document of the database, as seen when deciding whether to revisit it
+//
+struct revisit_entry
+{
+  String *url;
+  int due;
+  int found;
+  int unchanged;
+  time_t changed;
+  time_t accessed;
+};
+
+//
+// Due documents first; among them, those found last time, the ones
+// that changed the most recently (then the ones found unchanged the
+// fewest times since), then the ones left alone the longest
+//
+static int
+compare_revisits (const void *a, const void *b)
+{
+  const revisit_entry *ea = (const revisit_entry *) a;
+  const revisit_entry *eb = (const revisit_entry *) b;
+
+  if (ea->due != eb->due)
+    return eb->due - ea->due;
+  if (ea->found != eb->found)
+    return eb->found - ea->found;
+  if (ea->changed != eb->changed)
+    return ea->changed > eb->changed ? -1 : 1;
+  if (ea->unchanged != eb->unchanged)
+    return ea->unchanged - eb->unchanged;
+  if (ea->accessed != eb->accessed)
+    return ea->accessed < eb->accessed ? -1 : 1;
+  return 0;
+}
+
+//*****************************************************************************
+// void Retriever::Revisit(List &list)
+//   Add the URLs of the documents already in the database.  With
+//   revisit_interval set, a document is only due once that interval,
+//   doubled for each visit which found it unchanged, has passed since
+//   its last visit.  The due documents are ordered so that the most
+//   likely to have changed are retrieved first, and there are never
+//   more than max_revisits of them.  The others are marked as visited,
+//   so that the links to them don't bring them back in this dig.
+//
+void
+Retriever::Revisit (List & list)
+{
+  if (revisit_interval <= 0 && max_revisits < 0)
+  {
+    Initial (list);
+    return;
+  }
+
+  int from = visited.Count () ? 3 : 0;  // As Initial(List &) does
+  time_t now = time (0);
+  revisit_entry *entries = new revisit_entry[list.Count () + 1];
+  int n_entries = 0;
+  int n_due = 0;
+  String *str;
+
+  list.Start_Get ();
+  while ((str = (String *) list.Get_Next ()))
+  {
+    revisit_entry & e = entries[n_entries++];
+    e.url = str;
+    e.due = 1;
+    e.found = 1;
+    e.unchanged = 0;
+    e.changed = 0;
+    e.accessed = 0;
+
+    DocumentRef *ref = docs[str->get ()];
+    if (ref)
+    {
+      e.unchanged = ref->DocUnchanged ();
+      e.changed = ref->DocChanged ();
+      e.accessed = ref->DocAccessed ();
+      e.found = ref->DocState () == Reference_normal;
+      delete ref;
+    }
+    if (e.accessed && revisit_interval > 0)
+    {
+      time_t wait = revisit_interval;
+      for (int i = 0; i < e.unchanged && wait < revisit_max_interval; i++)
+        wait *= 2;
+      if (wait > revisit_max_interval)
+        wait = revisit_max_interval;
+      e.due = now >= e.accessed + wait;
+    }
+    n_due += e.due;
+  }
+
+  qsort (entries, n_entries, sizeof (revisit_entry), compare_revisits);
+
+  int n_revisits = n_due;
+  if (max_revisits >= 0 && n_revisits > max_revisits)
+    n_revisits = max_revisits;
+
+  int i;
+  for (i = 0; i < n_revisits; i++)
+    Initial (entries[i].url->get (), from, i);
+
+  //
+  // Only now that the due ones are pushed: being visited already
+  // would make Initial() skip them
+  //
+  for (; i < n_entries; i++)
+    visited.Add (*entries[i].url, 0);
+
+  if (debug > 0)
+    cout << "Revisiting " << n_revisits << " of " << n_entries
+      << " documents (" << n_due << " due)" << endl;
+
+  delete[]entries;
+}
+
 //*****************************************************************************
 //
 static void
@@ -494,14 +648,24 @@ Retriever::Start ()
 
       count = 0;
 
+      // When requests are pipelined, the URLs to be retrieved next are
+      // taken from the queue ahead of time (never beyond the limit of
+      // requests for this connection), so that their requests can be
+      // sent along with the current one.
+
+      List next_refs;
+      URLRef *next_ref;
+
 #ifdef _MSC_VER                 /* _WIN32 */
       win32_check_messages ();
 #endif
 
 
       while (((max_connection_requests == -1) ||
-              (count < max_connection_requests)) && (ref = server->pop ())
-             && noSignal)
+              (count < max_connection_requests)) &&
+             (ref = next_refs.Count ()?
+              (URLRef *) next_refs.Shift (LIST_REMOVE_RELEASE) :
+              server->pop ()) && noSignal)
       {
         count++;
 
@@ -513,13 +677,27 @@ Retriever::Start ()
 
         more = 1;
 
+        if (server->IsPersistentConnectionAllowed ()
+            && !server->HeadBeforeGet ())
+        {
+          while (next_refs.Count () < server->PipelineDepth () - 1
+                 && (max_connection_requests == -1
+                     || count + next_refs.Count () < max_connection_requests)
+                 && (next_ref = server->pop ()))
+            next_refs.Add (next_ref);
+        }
+
         //
         // Deal with the actual URL.
         // We'll check with the server to see if we need to sleep()
         // before parsing it.
         //
 
-        parse_url (*ref);
+        // With database_transactions, all that a document changes is
+        // committed at once.
+        WordDBInfo::Instance ()->Begin ();
+        parse_url (*ref, &next_refs);
+        WordDBInfo::Instance ()->Commit ();
         delete ref;
 
         // We reached the maximum number of connections (either with
@@ -535,6 +713,15 @@ Retriever::Start ()
 
       }
 
+      // Interrupted: what was taken ahead goes back to the queue
+      while ((next_ref = (URLRef *) next_refs.Shift (LIST_REMOVE_RELEASE)))
+      {
+        server->push (next_ref->GetURL ().get (), next_ref->GetHopCount (),
+                      next_ref->GetReferer ().get (), 1, 0,
+                      next_ref->GetPriority ());
+        delete next_ref;
+      }
+
 #ifdef _MSC_VER                 /* _WIN32 */
       win32_check_messages ();
 #endif
@@ -574,20 +761,23 @@ Retriever::Start ()
     }
   }
   words.Close ();
+  WordDBInfo::Instance ()->Sync ();
 }
 
 
 //*****************************************************************************
-// void Retriever::parse_url(URLRef &urlRef)
+// void Retriever::parse_url(URLRef &urlRef, List *next_refs)
+//   next_refs are the URLs to be retrieved after this one, if known
 //
 void
-Retriever::parse_url (URLRef & urlRef)
+Retriever::parse_url (URLRef & urlRef, List * next_refs)
 {
   HtConfiguration *config = HtConfiguration::config ();
   URL url;
   DocumentRef *ref;
   int old_document;
   time_t date;
+  ReferenceState old_state = Reference_normal;
   static int index = 0;
   static int local_urls_only = config->Boolean ("local_urls_only");
   static int mark_dead_servers = config->Boolean ("ignore_dead_servers");
@@ -613,6 +803,7 @@ Retriever::parse_url (URLRef & urlRef)
       old_document = 0;
     ref->DocBackLinks (ref->DocBackLinks () + 1);       // we had a new link
     ref->DocAccessed (time (0));
+    old_state = ref->DocState ();
     ref->DocState (Reference_normal);
     currenthopcount = ref->DocHopCount ();
   }
@@ -650,6 +841,40 @@ Retriever::parse_url (URLRef & urlRef)
   doc->Reset ();
   doc->Url (url.get ());
   doc->Referer (urlRef.GetReferer ().get ());
+  if (old_document)
+    doc->RequestETag (ref->DocETag ());
+
+  // Those of the next URLs that are to be retrieved from the server
+  // are told to the document, which may ask for them at once
+  if (next_refs && !local_urls_only)
+  {
+    URLRef *next_ref;
+    next_refs->Start_Get ();
+    while ((next_ref = (URLRef *) next_refs->Get_Next ()))
+    {
+      URL next_url;
+      next_url.parse (next_ref->GetURL ().get ());
+
+      StringList *next_local = GetLocal (next_url.get ());
+      if (next_local)
+      {
+        delete next_local;
+        continue;
+      }
+
+      DocumentRef *next_doc = docs[next_url.get ()];
+      time_t next_date = 0;
+      String next_etag;
+      if (next_doc)
+      {
+        next_date = next_doc->DocTime ();
+        next_etag = next_doc->DocETag ();
+        delete next_doc;
+      }
+      doc->AddNextURL (next_url.get (), next_ref->GetReferer ().get (),
+                       next_date, next_etag);
+    }
+  }
 
   base = doc->Url ();
 
@@ -738,12 +963,22 @@ Retriever::parse_url (URLRef & urlRef)
 
     if (old_document)
     {
-      if (doc->ModTime () == ref->DocTime ())
+      // A near duplicate whose original is gone or changed is indexed
+      // again, changed or not
+      if (doc->ModTime () == ref->DocTime ()
+          && (old_state != Reference_noindex
+              || !near_duplicate_stale (ref->DocID ())))
       {
         words.Skip ();
         if (debug)
           cout << " retrieved but not changed" << endl;
         words.Skip ();
+        ref->DocUnchanged (ref->DocUnchanged () + 1);
+        if (doc->ETag ().length ())
+          ref->DocETag (doc->ETag ());
+        // Still left out of the index if it was
+        if (old_state == Reference_noindex)
+          ref->DocState (Reference_noindex);
         break;
       }
       //
@@ -755,6 +990,8 @@ Retriever::parse_url (URLRef & urlRef)
       //
       words.Skip ();
       int backlinks = ref->DocBackLinks ();
+      if (d_simhash)
+        simhash_forget (ref->DocID ());
       ref->DocState (Reference_obsolete);
       docs.Add (*ref);
       delete ref;
@@ -771,6 +1008,10 @@ Retriever::parse_url (URLRef & urlRef)
       if (debug)
         cout << " (changed) ";
     }
+    // The document is new, or has changed since the last visit
+    ref->DocChanged (ref->DocAccessed ());
+    ref->DocUnchanged (0);
+    ref->DocETag (doc->ETag ());
     RetrievedDocument (*doc, url.get (), ref);
     // Hey! If this document is marked noindex, don't even bother
     // adding new words. Mark this as gone and get rid of it!
@@ -797,6 +1038,20 @@ Retriever::parse_url (URLRef & urlRef)
     if (debug)
       cout << " not changed" << endl;
     words.Skip ();
+    ref->DocUnchanged (ref->DocUnchanged () + 1);
+    if (doc->ETag ().length ())
+      ref->DocETag (doc->ETag ());
+    if (old_state == Reference_noindex)
+    {
+      ref->DocState (Reference_noindex);
+      // Without its contents, a near duplicate whose original is gone
+      // or changed can only be retrieved in full next time
+      if (near_duplicate_stale (ref->DocID ()))
+      {
+        ref->DocTime (0);
+        ref->DocETag ("");
+      }
+    }
     break;
 
   case Transport::Document_not_found:
@@ -940,17 +1195,37 @@ Retriever::RetrievedDocument (Document & doc, const String & url,
     return;
   }
 
+  int original = 0;
+  if (d_simhash)
+  {
+    if (ref->DocState () == Reference_normal)
+      original = near_duplicate (url, ref->DocID ());
+    else
+      simhash_forget (ref->DocID ());
+  }
+  if (original)
+  {
+    // Its links are followed all the same, only its words are left out
+    if (debug > 1)
+      cout << " Detected near duplicate of document " << original << endl;
+    ref->DocState (Reference_noindex);
+    token_bytes.trunc ();
+    n_tokens = 0;
+  }
+  else
+    flush_words ();
+
   // If just storing the first occurrence of each word in a document,
   // we must now flush the words we saw in that document
   if (no_store_phrases)
   {
-    DictionaryCursor cursor;
-    char *key;
+    HtHashCursor cursor;
+    const char *key;
     HtWordReference wordRef;
     for (words_to_add.Start_Get (cursor);
          (key = words_to_add.Get_Next (cursor));)
     {
-      word_entry *entry = (word_entry *) (words_to_add[key]);
+      word_entry *entry = (word_entry *) words_to_add.Get_Current (cursor);
 
       wordRef.Location (entry->location);
       wordRef.Flags (entry->flags);
@@ -991,10 +1266,7 @@ Retriever::RetrievedDocument (Document & doc, const String & url,
 int
 Retriever::Need2Get (const String & u)
 {
-  static String url;
-  url = u;
-
-  return !visited.Exists (url);
+  return !visited.Exists (u);
 }
 
 
@@ -1460,52 +1732,81 @@ Retriever::IsLocalURL (const String & url)
 //*****************************************************************************
 // void Retriever::got_word(char *word, int location, int heading)
 //   The location is normalized to be in the range 0 - 1000.
+//   The word is only gathered here; flush_words() does the indexing.
 //
 void
 Retriever::got_word (const char *word, int location, int heading)
 {
   if (debug > 3)
     cout << "word: " << word << '@' << location << endl;
-  if (heading >= (int) (sizeof (factor) / sizeof (factor[0])) || heading < 0)
-    heading = 0;                // Assume it's just normal text
-  if (trackWords && strlen (word) >= (unsigned int) minimumWordLength)
+  if (!trackWords)
+    return;
+  int length = strlen (word);
+  if ((unsigned int) length < (unsigned int) minimumWordLength)
+    return;
+
+  if (n_tokens == tokens_allocated)
   {
-    String w = word;
-    HtWordReference wordRef;
+    tokens_allocated = tokens_allocated ? tokens_allocated * 2 : 1024;
+    word_token *grown = new word_token[tokens_allocated];
+    if (n_tokens)
+      memcpy (grown, tokens, n_tokens * sizeof (word_token));
+    delete[]tokens;
+    tokens = grown;
+  }
+  word_token & token = tokens[n_tokens++];
+  token.offset = token_bytes.length ();
+  token.length = length;
+  token.location = location;
+  token.heading = heading;
+  token.anchor = word_context.Anchor ();
+  token_bytes.append (word, length + 1);
+}
 
-    if (no_store_phrases)
-    {
-      // Add new word, or mark existing word as also being at
-      // this heading level
-      word_entry *entry;
-      if ((entry = (word_entry *) words_to_add.Find (w)) == NULL)
-      {
-        words_to_add.Add (w,
-                          new word_entry (location, factor[heading],
-                                          word_context));
-      }
-      else
-      {
-        entry->flags |= factor[heading];
-      }
-    }
-    else
-    {
-      wordRef.Location (location);
-      wordRef.Flags (factor[heading]);
-      wordRef.Word (w);
-      words.Replace (WordReference::Merge (wordRef, word_context));
-    }
 
-    // Check for compound words...
-    String parts = word;
+//*****************************************************************************
+// void Retriever::flush_words()
+//   Index the words gathered by got_word() for the current document,
+//   along with the parts of its compound words.
+//
+void
+Retriever::flush_words ()
+{
+  int anchor = word_context.Anchor ();
+  char *bytes = token_bytes.get ();
+  String w;
+
+  for (int t = 0; t < n_tokens; t++)
+  {
+    const word_token & token = tokens[t];
+    int heading = token.heading;
+    if (heading >= (int) (sizeof (factor) / sizeof (factor[0]))
+        || heading < 0)
+      heading = 0;              // Assume it's just normal text
+    int flags = factor[heading];
+    int location = token.location;
+    char *word = bytes + token.offset;
+
+    word_context.Anchor (token.anchor);
+    w.trunc ();
+    w.append (word, token.length);
+    add_word (w, location, flags);
+
+    // Check for compound words...  Most words are made only of word
+    // characters and have no parts.
+    char *p = word;
+    while (HtIsStrictWordChar ((unsigned char) *p))
+      p++;
+    if (!*p)
+      continue;
+
     int added;
     int nparts = 1;
     do
     {
       added = 0;
-      char *start = parts.get ();
-      char *punctp = 0, *nextp = 0, *p;
+      char *start = word;
+      char *punctp = 0, *nextp = 0;
       char punct;
       int n;
       while (*start)
@@ -1527,33 +1828,13 @@ Retriever::got_word (const char *word, int location, int heading)
           break;
         punct = *punctp;
         *punctp = '\0';
-        if (*start && (*p || start > parts.get ()))
+        if (*start && (*p || start > word))
         {
           w = start;
           HtStripPunctuation (w);
           if (w.length () >= minimumWordLength)
           {
-            if (no_store_phrases)
-            {
-              // Add new word, or mark existing word as also being at
-              // this heading level
-              word_entry *entry;
-              if ((entry = (word_entry *) words_to_add.Find (w)) == NULL)
-              {
-                words_to_add.Add (w,
-                                  new word_entry (location, factor[heading],
-                                                  word_context));
-              }
-              else
-              {
-                entry->flags |= factor[heading];
-              }
-            }
-            else
-            {
-              wordRef.Word (w);
-              words.Replace (WordReference::Merge (wordRef, word_context));
-            }
+            add_word (w, location, flags);
             if (debug > 3)
               cout << "word part: " << start << '@' << location << endl;
           }
@@ -1566,6 +1847,322 @@ Retriever::got_word (const char *word, int location, int heading)
     }
     while (added > 2);
   }
+
+  word_context.Anchor (anchor);
+  token_bytes.trunc ();
+  n_tokens = 0;
+}
+
+
+
+//
+// The 64 bit FNV-1a hash of a word, one feature of the SimHash
+//
+static simhash_t
+simhash_feature (const char *word, int length)
+{
+  simhash_t h = 14695981039346656037ULL;
+  for (int i = 0; i < length; i++)
+  {
+    h ^= (unsigned char) word[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static int
+simhash_distance (simhash_t a, simhash_t b)
+{
+  simhash_t x = a ^ b;
+  int n = 0;
+  for (; x; n++)
+    x &= x - 1;
+  return n;
+}
+
+//
+// The key of the band values filed under <band> of <bands> for <hash>
+//
+static void
+simhash_band_key (String & key, simhash_t hash, int band, int bands)
+{
+  int first = band * 64 / bands;
+  int width = (band + 1) * 64 / bands - first;
+  simhash_t mask = width == 64 ? ~(simhash_t) 0 :
+    (((simhash_t) 1 << width) - 1) << first;
+  simhash_t value = hash & mask;
+
+  key.trunc ();
+  key << (char) band;
+  key.append ((char *) &value, sizeof value);
+}
+
+//
+// The key of the current SimHash of document <id>.  Band keys are four
+// bytes longer.
+//
+static void
+simhash_doc_key (String & key, int id)
+{
+  key.trunc ();
+  key << 'd';
+  key.append ((char *) &id, sizeof id);
+}
+
+//
+// The key of the SimHash and original of document <id>, when it is left
+// out of the index as a near duplicate
+//
+static void
+simhash_dup_key (String & key, int id)
+{
+  key.trunc ();
+  key << 'n';
+  key.append ((char *) &id, sizeof id);
+}
+
+#define SIMHASH_ENTRY_SIZE  ((int) (sizeof (simhash_t) + sizeof (int)))
+
+//*****************************************************************************
+// int Retriever::simhash_current(int id, simhash_t &hash)
+//   The SimHash document <id> is filed under, if any.
+//
+int
+Retriever::simhash_current (int id, simhash_t & hash)
+{
+  String key;
+  String data;
+
+  simhash_doc_key (key, id);
+  if (d_simhash->Get (key, data) != OK || data.length () != sizeof hash)
+    return NOTOK;
+  memcpy (&hash, data.get (), sizeof hash);
+  return OK;
+}
+
+//*****************************************************************************
+// void Retriever::simhash_forget(int id)
+//   Take document <id> out of the bands it was filed under, when it is
+//   indexed again or no longer indexed.
+//
+void
+Retriever::simhash_forget (int id)
+{
+  simhash_t hash;
+  if (simhash_current (id, hash) != OK)
+    return;
+
+  int bands = near_duplicate_distance + 1;
+  String key;
+  String entries;
+  for (int band = 0; band < bands; band++)
+  {
+    simhash_band_key (key, hash, band, bands);
+    if (d_simhash->Get (key, entries) != OK)
+      continue;
+
+    String kept;
+    const char *entry = entries.get ();
+    for (int i = 0; i + SIMHASH_ENTRY_SIZE <= entries.length ();
+         i += SIMHASH_ENTRY_SIZE)
+    {
+      int other_id;
+      memcpy (&other_id, entry + i + sizeof (simhash_t), sizeof other_id);
+      if (other_id != id)
+        kept.append (entry + i, SIMHASH_ENTRY_SIZE);
+    }
+    if (kept.empty ())
+      d_simhash->Delete (key);
+    else if (kept.length () != entries.length ())
+      d_simhash->Put (key, kept);
+  }
+
+  simhash_doc_key (key, id);
+  d_simhash->Delete (key);
+  simhash_dup_key (key, id);
+  d_simhash->Delete (key);
+}
+
+//*****************************************************************************
+// int Retriever::near_duplicate_stale(int id)
+//   Whether document <id> was left out of the index as a near duplicate
+//   of a document which is no longer indexed, or whose SimHash is no
+//   longer close to its own.  Documents left out for another reason,
+//   such as a robots noindex, are not.
+//
+int
+Retriever::near_duplicate_stale (int id)
+{
+  if (!d_simhash)
+    return 0;
+
+  String key;
+  String data;
+  simhash_dup_key (key, id);
+  if (d_simhash->Get (key, data) != OK || data.length () != SIMHASH_ENTRY_SIZE)
+    return 0;
+
+  simhash_t hash;
+  int original;
+  memcpy (&hash, data.get (), sizeof hash);
+  memcpy (&original, data.get () + sizeof hash, sizeof original);
+
+  simhash_t current;
+  DocumentRef *original_ref = docs[original];
+  int stale = !original_ref
+    || original_ref->DocState () != Reference_normal
+    || simhash_current (original, current) != OK
+    || simhash_distance (hash, current) > near_duplicate_distance;
+  delete original_ref;
+  return stale;
+}
+
+//*****************************************************************************
+// int Retriever::near_duplicate(const String &url, int id)
+//   Compute the SimHash of the words gathered by got_word() for the
+//   current document, and look for an indexed document whose SimHash
+//   differs from it by at most near_duplicate_distance bits.  The 64
+//   bits are split into near_duplicate_distance + 1 bands: two hashes
+//   that close agree on a whole band, so only the documents filed
+//   under one of our band values need to be compared.  Return the ID
+//   of such a document, or 0 after filing ours under its band values.
+//
+//   The current SimHash of each document is kept too: entries left by
+//   an older version of a document, or by one that is gone, are
+//   recognised by it and dropped.  So is the SimHash of a near
+//   duplicate, along with its original, for near_duplicate_stale().
+//
+int
+Retriever::near_duplicate (const String & url, int id)
+{
+  simhash_forget (id);
+
+  if (n_tokens == 0)
+    return 0;
+
+  int weights[64];
+  int b;
+  for (b = 0; b < 64; b++)
+    weights[b] = 0;
+
+  char *bytes = token_bytes.get ();
+  for (int t = 0; t < n_tokens; t++)
+  {
+    simhash_t h = simhash_feature (bytes + tokens[t].offset,
+                                   tokens[t].length);
+    for (b = 0; b < 64; b++)
+      weights[b] += (h >> b) & 1 ? 1 : -1;
+  }
+
+  simhash_t hash = 0;
+  for (b = 0; b < 64; b++)
+    if (weights[b] > 0)
+      hash |= (simhash_t) 1 << b;
+
+  //
+  // Each band value is the key of the (SimHash, DocID) pairs filed
+  // under it
+  //
+  int bands = near_duplicate_distance + 1;
+  String keys[8];
+  String entries[8];
+  int original = 0;
+  for (int band = 0; band < bands && !original; band++)
+  {
+    simhash_band_key (keys[band], hash, band, bands);
+    if (d_simhash->Get (keys[band], entries[band]) != OK)
+      continue;
+
+    String kept;
+    const char *entry = entries[band].get ();
+    for (int i = 0; i + SIMHASH_ENTRY_SIZE <= entries[band].length ();
+         i += SIMHASH_ENTRY_SIZE)
+    {
+      simhash_t other;
+      int other_id;
+      memcpy (&other, entry + i, sizeof other);
+      memcpy (&other_id, entry + i + sizeof other, sizeof other_id);
+
+      //
+      // Only the SimHash a document is currently filed under counts
+      //
+      simhash_t current;
+      if (simhash_current (other_id, current) != OK || current != other)
+        continue;
+      kept.append (entry + i, SIMHASH_ENTRY_SIZE);
+
+      if (original
+          || simhash_distance (hash, current) > near_duplicate_distance)
+        continue;
+
+      // An older version of this very document, or one that is no
+      // longer indexed, doesn't count
+      DocumentRef *other_ref = docs[other_id];
+      if (other_ref
+          && other_ref->DocState () == Reference_normal
+          && strcmp (other_ref->DocURL (), url.get ()) != 0)
+        original = other_id;
+      delete other_ref;
+    }
+    if (kept.length () != entries[band].length ())
+    {
+      if (kept.empty ())
+        d_simhash->Delete (keys[band]);
+      else
+        d_simhash->Put (keys[band], kept);
+    }
+    entries[band] = kept;
+  }
+  String key;
+  if (original)
+  {
+    String data ((char *) &hash, sizeof hash);
+    data.append ((char *) &original, sizeof original);
+    simhash_dup_key (key, id);
+    d_simhash->Put (key, data);
+    return original;
+  }
+
+  for (int band = 0; band < bands; band++)
+  {
+    entries[band].append ((char *) &hash, sizeof hash);
+    entries[band].append ((char *) &id, sizeof id);
+    d_simhash->Put (keys[band], entries[band]);
+  }
+  simhash_doc_key (key, id);
+  d_simhash->Put (key, String ((char *) &hash, sizeof hash));
+  return 0;
+}
+
+
+//*****************************************************************************
+// void Retriever::add_word(const String &word, int location, int flags)
+//
+void
+Retriever::add_word (const String & word, int location, int flags)
+{
+  if (no_store_phrases)
+  {
+    // Add new word, or mark existing word as also being at
+    // this heading level
+    word_entry *entry;
+    if ((entry = (word_entry *) words_to_add.Find (word)) == NULL)
+    {
+      words_to_add.Add (word, new word_entry (location, flags, word_context));
+    }
+    else
+    {
+      entry->flags |= flags;
+    }
+  }
+  else
+  {
+    HtWordReference wordRef;
+    wordRef.Location (location);
+    wordRef.Flags (flags);
+    wordRef.Word (word);
+    words.Replace (WordReference::Merge (wordRef, word_context));
+  }
 }
 
 
@@ -20,6 +20,7 @@
 
 #include "DocumentRef.h"
 #include "Dictionary.h"
+#include "HtHash.h"
 #include "Queue.h"
 #include "HtWordReference.h"
 #include "List.h"
@@ -61,6 +62,11 @@ struct word_entry:public Object
   HtWordReference context;
 };
 
+//
+// The SimHash of a document, see Retriever::near_duplicate
+//
+typedef unsigned long long simhash_t;
+
 class Retriever
 {
 public:
@@ -73,8 +79,9 @@ public:
   //
   // Getting it all started
   //
-  void Initial (const String & url, int checked = 0);
+  void Initial (const String & url, int checked = 0, int priority = 0);
   void Initial (List & list, int checked = 0);
+  void Revisit (List & list);
   void Start ();
 
   //
@@ -116,7 +123,7 @@ private:
   //
   // A hash to keep track of what we've seen
   //
-    Dictionary visited;
+    HtStringHash visited;
 
   URL *base;
   String current_title;
@@ -132,7 +139,24 @@ private:
   HtWordReference word_context;
   HtWordList words;
 
-  Dictionary words_to_add;
+  HtStringHash words_to_add;
+
+  //
+  // The words of the document being parsed.  got_word() only gathers
+  // them, and flush_words() indexes them all once the parser is done.
+  //
+  struct word_token
+  {
+    int offset;                 // In token_bytes, where the words are
+    int length;                 // kept each followed by a '\0'
+    int location;
+    int heading;
+    int anchor;
+  };
+  String token_bytes;
+  word_token *tokens;
+  int n_tokens;
+  int tokens_allocated;
 
   int check_unique_md5;
   int check_unique_date;
@@ -150,6 +174,13 @@ private:
   //
   int max_hop_count;
 
+  //
+  // When to visit again the documents we already have
+  //
+  int revisit_interval;
+  int revisit_max_interval;
+  int max_revisits;
+
   //
   // The list of server-specific information objects is indexed by
   // ip address and port number.  The list contains Server objects.
@@ -164,6 +195,12 @@ private:
 
   Database *d_md5;
 
+  //
+  // The SimHash of each document indexed, to catch near duplicates
+  //
+  Database *d_simhash;
+  int near_duplicate_distance;
+
   String notFound;
 
   // Some useful constants
@@ -175,8 +212,14 @@ private:
   int Need2Get (const String & url);
   int IsValidURL (const String & url);
   void RetrievedDocument (Document &, const String & url, DocumentRef * ref);
-  void parse_url (URLRef & urlRef);
+  void parse_url (URLRef & urlRef, List * next_refs = 0);
   void got_redirect (const char *, DocumentRef *, const char * = 0);
+  void flush_words ();
+  int near_duplicate (const String & url, int id);
+  int simhash_current (int id, simhash_t & hash);
+  void simhash_forget (int id);
+  int near_duplicate_stale (int id);
+  void add_word (const String & word, int location, int flags);
   void recordNotFound (const String & url, const String & referer,
                        int reason);
 };
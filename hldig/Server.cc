@@ -48,10 +48,21 @@ _port (u.port ()), _bad_server (0), _documents (0), _accept_language (0)
     config->Boolean ("server", _host.get (), "persistent_connections");
   _head_before_get =
     config->Boolean ("server", _host.get (), "head_before_get");
+  _http_compression =
+    config->Boolean ("server", _host.get (), "http_compression");
+  _pipeline_depth =
+    config->Value ("server", _host.get (), "http_pipeline_depth");
+  if (_pipeline_depth < 1)
+    _pipeline_depth = 1;
 
   _max_documents = config->Value ("server", _host.get (), "server_max_docs");
   _connection_space =
     config->Value ("server", _host.get (), "server_wait_time");
+
+  // A server we are asked to wait for between requests gets them one
+  // at a time: pipelined requests would be sent without the pause
+  if (_connection_space > 0)
+    _pipeline_depth = 1;
   _user_agent = config->Find ("server", _host.get (), "user_agent");
   _disable_cookies =
     config->Boolean ("server", _host.get (), "disable_cookies");
@@ -89,6 +100,11 @@ _port (u.port ()), _bad_server (0), _documents (0), _accept_language (0)
     cout << " - HEAD before GET: " <<
       (_head_before_get ? "enabled" : "disabled") << endl;
 
+    cout << " - HTTP compression: " <<
+      (_http_compression ? "enabled" : "disabled") << endl;
+
+    cout << " - HTTP pipeline depth: " << _pipeline_depth << endl;
+
     cout << " - Timeout: " << _timeout << endl;
     cout << " - Connection space: " << _connection_space << endl;
     cout << " - Max Documents: " << _max_documents << endl;
@@ -199,6 +215,8 @@ _documents (rhs._documents),
 _max_documents (rhs._max_documents),
 _persistent_connections (rhs._persistent_connections),
 _head_before_get (rhs._head_before_get),
+_http_compression (rhs._http_compression),
+_pipeline_depth (rhs._pipeline_depth),
 _disable_cookies (rhs._disable_cookies),
 _timeout (rhs._timeout),
 _tcp_wait_time (rhs._tcp_wait_time),
@@ -353,11 +371,11 @@ Server::robotstxt (Document & doc)
 
 
 //*****************************************************************************
-// void Server::push(String &path, int hopcount, char *referer, int local, int newDoc)
+// void Server::push(String &path, int hopcount, char *referer, int local, int newDoc, int priority)
 //
 void
 Server::push (const String & path, int hopcount, const String & referer,
-              int local, int newDoc)
+              int local, int newDoc, int priority)
 {
   if (_bad_server && !local)
     return;
@@ -385,6 +403,7 @@ Server::push (const String & path, int hopcount, const String & referer,
   ref->SetURL (path);
   ref->SetHopCount (hopcount);
   ref->SetReferer (referer);
+  ref->SetPriority (priority);
   _paths.Add (ref);
 
   if (newDoc)
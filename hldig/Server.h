@@ -74,7 +74,7 @@ public:
   // if it's down, it simply will not be added
   //
   void push (const String & path, int hopcount, const String & referer,
-             int local = 0, int newDoc = 1);
+             int local = 0, int newDoc = 1, int priority = 0);
 
   //
   // Return the next URL from the queue for this server.
@@ -108,11 +108,27 @@ public:
     return _persistent_connections;
   }
 
+  //
+  // Methods for managing pipelined requests
+  //
+  int PipelineDepth () const
+  {
+    return _pipeline_depth;
+  }
+  void AvoidPipelining ()
+  {
+    _pipeline_depth = 1;
+  }
+
   // Methods for getting info regarding server configuration
   bool HeadBeforeGet () const
   {
     return _head_before_get;
   }
+  bool HttpCompression () const
+  {
+    return _http_compression;
+  }
   unsigned int TimeOut () const
   {
     return _timeout;
@@ -167,6 +183,10 @@ private:
 
   bool _head_before_get;        // HEAD call before a GET?
 
+  bool _http_compression;       // Ask for compressed documents?
+
+  int _pipeline_depth;          // Requests sent before a response is read
+
   bool _disable_cookies;        // Should we send cookies?
 
   int _timeout;                 // Timeout for this server
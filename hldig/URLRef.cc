@@ -25,6 +25,7 @@
 URLRef::URLRef ()
 {
   hopcount = 0;
+  priority = 0;
 }
 
 
@@ -41,5 +42,7 @@ URLRef::~URLRef ()
 int
 URLRef::compare (const URLRef & to) const
 {
-  return hopcount - to.hopcount;
+  if (hopcount != to.hopcount)
+    return hopcount - to.hopcount;
+  return priority - to.priority;
 }
@@ -40,6 +40,10 @@ public:
   {
     return referer;
   }
+  int GetPriority () const
+  {
+    return priority;
+  }
 
   void SetURL (const URL & u)
   {
@@ -53,6 +57,10 @@ public:
   {
     referer = ref;
   }
+  void SetPriority (int p)
+  {
+    priority = p;
+  }
 
   int compare (const Object & to) const
   {
@@ -64,6 +72,7 @@ private:
   URL url;
   URL referer;
   int hopcount;
+  int priority;                 // Among equal hopcounts, lower goes first
 };
 
 #endif
@@ -26,6 +26,7 @@
 #include "WordContext.h"
 #include "HtDateTime.h"
 #include "HtURLRewriter.h"
+#include "HtGeneration.h"
 #include "messages.h"
 
 ////////////////////////////
@@ -207,6 +208,17 @@ main (int ac, char **av)
     reportError (form (_("Invalid url_rewrite_rules: %s"),
                        url_rewrite_rules.get ()));
 
+  //
+  // With database generations, the new databases are built in a
+  // generation of their own rather than in .work files.
+  //
+  HtGeneration generation;
+  int generation_number = generation.Create (*config, initial);
+  if (generation_number == NOTOK)
+    reportError (_("Unable to create a new database generation"));
+  if (generation_number > 0)
+    alt_work_area = 0;
+
   //
   // If indicated, change the database file names to have the .work
   // extension
@@ -248,6 +260,13 @@ main (int ac, char **av)
       configValue << ".work";
       config->Add ("md5_db", configValue);
     }
+
+    configValue = config->Find ("simhash_db");
+    if (configValue.length () != 0)
+    {
+      configValue << ".work";
+      config->Add ("simhash_db", configValue);
+    }
   }
 
   // Imports the cookies file
@@ -317,6 +336,22 @@ main (int ac, char **av)
   limitsn.setEscaped (l, config->Boolean ("case_sensitive"));
   l.Destroy ();
 
+  //
+  // With transactions, what the dig changes is logged, and each document
+  // committed at once, so that a dig that stops half way through one
+  // loses only it.  The document databases share the environment of the
+  // word database, which must be set up first.
+  //
+  if (config->Boolean ("database_transactions"))
+  {
+    config->Add ("wordlist_env_txn", "true");
+    if (config->Find ("wordlist_env_dir").empty ())
+      config->Add ("wordlist_env_dir", config->Find ("database_dir"));
+  }
+
+  // Initialize htword
+  WordContext::Initialize (*config);
+
   //
   // Open the document database
   //
@@ -343,34 +378,33 @@ main (int ac, char **av)
   {
     unlink (word_filename);
     unlink ((word_filename + "_weakcmpr").get ());
+    unlink ((word_filename + "_extent").get ());
 
     // Remove "duplicate detection" database
     unlink (config->Find ("md5_db"));
+    unlink (config->Find ("simhash_db"));
 
     // using  -i,  also ignore seen-but-not-processed URLs from last pass
     unlink (config->Find ("url_log"));
   }
 
-  // Initialize htword
-  WordContext::Initialize (*config);
-
   // Create the Retriever object which we will use to parse all the
   // HTML files.
   // In case this is just an update dig, we will add all existing
   // URLs?
   //
-  Retriever retriever (Retriever_logUrl);
+  Retriever *retriever = new Retriever (Retriever_logUrl);
   if (minimalFile.length () == 0)
   {
     List *list = docs.URLs ();
-    retriever.Initial (*list);
+    retriever->Revisit (*list);
     delete list;
 
     // Add start_url to the initial list of the retriever.
     // Don't check a URL twice!
     // Beware order is important, if this bugs you could change
     // previous line retriever.Initial(*list, 0) to Initial(*list,1)
-    retriever.Initial (config->Find ("start_url"), 1);
+    retriever->Initial (config->Find ("start_url"), 1);
   }
 
   // Handle list of URLs given in a file (stdin, if "-") specified as
@@ -394,7 +428,7 @@ main (int ac, char **av)
       cin >> str;
       str.chop ("\r\n");        // (Why "\r\n" here and "\r\n\t " below?)
       if (str.length () > 0)
-        retriever.Initial (str, 1);
+        retriever->Initial (str, 1);
     }
   }
   else if (minimalFile.length () != 0)
@@ -409,7 +443,7 @@ main (int ac, char **av)
         String str (buffer);
         str.chop ("\r\n\t ");
         if (str.length () > 0)
-          retriever.Initial (str, 1);
+          retriever->Initial (str, 1);
       }
       fclose (input);
     }
@@ -423,7 +457,7 @@ main (int ac, char **av)
   //
   // Go do it!
   //
-  retriever.Start ();
+  retriever->Start ();
 
   //
   // All done with parsing.
@@ -462,7 +496,21 @@ main (int ac, char **av)
   //
   if (report_statistics)
   {
-    retriever.ReportStatistics ("hldig");
+    retriever->ReportStatistics ("hldig");
+  }
+
+  //
+  // The databases must be closed before their generation is made the
+  // current one.  Closing the word environment last also removes the
+  // transaction log of a dig that went through to the end.
+  //
+  delete retriever;
+  docs.Close ();
+  WordContext::Finish ();
+  if (generation_number > 0)
+  {
+    if (generation.Commit () != OK)
+      reportError (_("Unable to commit the new database generation"));
   }
 
   // Shows End Time
@@ -37,6 +37,7 @@
 #include "defaults.h"
 #include "HtWordList.h"
 #include "WordContext.h"
+#include "HtGeneration.h"
 #include "messages.h"
 
 // If we have this, we probably want it.
@@ -133,6 +134,13 @@ main(int ac, char **av)
     }
     config->Read(configFile);
 
+    //
+    // With database generations, the words are those of the current one.
+    //
+    HtGeneration generation;
+    if (generation.Use(*config) == NOTOK)
+  reportError(_("Unable to use the current database generation"));
+
     // Initialize htword library (key description + wordtype...)
     WordContext::Initialize(*config);
 
@@ -218,7 +218,7 @@ Configuration::Remove (const String & name)
 //   Retrieve a variable from the configuration database.  This variable
 //   will be parsed and a new String object will be returned.
 //
-const String
+String
 Configuration::Find (const String & name) const
 {
   ParsedString *ps = (ParsedString *) dcGlobalVars[name];
@@ -295,7 +295,7 @@ Configuration::Boolean (const String & name, int default_value) const
 
 //*********************************************************************
 //
-const String
+String
 Configuration::operator[] (const String & name)
      const
      {
@@ -180,7 +180,7 @@ public:
   // Return the value of configuration attribute <b>name</b> as a
   // <i>String</i>.
   //
-  const String Find (const String & name) const;
+  String Find (const String & name) const;
 
   //-
   // Return 1 if the value of configuration attribute <b>name</b> has
@@ -191,7 +191,7 @@ public:
   //-
   // Alias to the <b>Find</b> method.
   //
-  const String operator[] (const String & name) const;
+  String operator[] (const String & name) const;
 #endif /* SWIG */
   //-
   // Return the value associated with the configuration attribute
@@ -49,6 +49,7 @@ using namespace std;
 DB2_db::DB2_db ()
 {
   isOpen = 0;
+  shared = 0;
   _compare = 0;
   _prefix = 0;
 }
@@ -69,9 +70,14 @@ int
 DB2_db::Open (const char *filename, int flags, int mode)
 {
   //
-  // Initialize the database environment.
+  // Initialize the database environment, unless there is a
+  // transactional one to share.
   //
-  if ((dbenv = db_init ((char *) NULL)) == 0)
+  shared = shared_env != 0 && !(flags & DB_RDONLY);
+  if (shared)
+    dbenv = shared_env;
+  else if ((dbenv = db_init ((char *) NULL,
+                             snapshot && (flags & DB_RDONLY))) == 0)
     return NOTOK;
 
   if (CDB_db_create (&dbp, dbenv, 0) != 0)
@@ -119,7 +125,8 @@ DB2_db::Close ()
     //
     (void) (dbcp->c_close) (dbcp);
     (void) (dbp->close) (dbp, 0);
-    (void) (dbenv->close (dbenv, 0));
+    if (!shared)
+      (void) (dbenv->close (dbenv, 0));
     dbenv = 0;
   }
   isOpen = 0;
@@ -270,7 +277,7 @@ DB2_db::Put (const String & key, const String & data)
   // A 0 in the flags in put means replace, if you didn't specify DB_DUP
   // somewhere else...
   //
-  return (dbp->put) (dbp, NULL, &k, &d, 0) == 0 ? OK : NOTOK;
+  return (dbp->put) (dbp, Txn (), &k, &d, 0) == 0 ? OK : NOTOK;
 }
 
 
@@ -291,7 +298,7 @@ DB2_db::Get (const String & key, String & data)
   k.data = (char *) key.get ();
   k.size = key.length ();
 
-  int rc = dbp->get (dbp, NULL, &k, &d, 0);
+  int rc = dbp->get (dbp, Txn (), &k, &d, 0);
   if (rc)
     return NOTOK;
 
@@ -332,7 +339,7 @@ DB2_db::Delete (const String & key)
   k.data = (char *) key.get ();
   k.size = key.length ();
 
-  return (dbp->del) (dbp, NULL, &k, 0);
+  return (dbp->del) (dbp, Txn (), &k, 0);
 }
 
 
@@ -360,10 +367,11 @@ Error (const char *error_prefix, char *message)
 
 /*
  * db_init --
- *      Initialize the environment. Only returns a pointer
+ *      Initialize the environment. Only returns a pointer.  A read-only
+ *      snapshot takes no locks.
  */
 DB_ENV *
-DB2_db::db_init (char *home)
+DB2_db::db_init (char *home, int rdonly_snapshot)
 {
   DB_ENV *dbenv;
   const char *progname = "DB2 problem...";
@@ -379,10 +387,13 @@ DB2_db::db_init (char *home)
   dbenv->set_errpfx (dbenv, progname);
   dbenv->set_errcall (dbenv, &Error);
 
-  if ((error =
-       dbenv->open (dbenv, (const char *) home, NULL,
-                    DB_CREATE | DB_PRIVATE | DB_INIT_LOCK | DB_INIT_MPOOL,
-                    0666)) != 0)
+  int flags = DB_CREATE | DB_PRIVATE | DB_INIT_MPOOL;
+  if (rdonly_snapshot)
+    flags |= DB_RDONLY_SNAPSHOT;
+  else
+    flags |= DB_INIT_LOCK;
+
+  if ((error = dbenv->open (dbenv, (const char *) home, NULL, flags, 0666)) != 0)
   {
     dbenv->err (dbenv, error, "open %s", (home ? home : ""));
     return 0;
@@ -51,7 +51,7 @@ public:
   virtual void Start_Seq (const String & key);
 
 private:
-  DB_ENV * db_init (char *);
+  DB_ENV * db_init (char *, int);
 
   int Open (const char *filename, int flags, int mode);
 };
@@ -20,6 +20,10 @@
 #include "Database.h"
 #include "DB2_db.h"
 
+DB_ENV *Database::shared_env = 0;
+DB_TXN **Database::shared_txn = 0;
+int Database::snapshot = 0;
+
 //*****************************************************************************
 // Database::Database()
 //
@@ -88,7 +88,44 @@ public:
     return Get_Next ();
   }
 
+  //
+  // While a transactional environment is set, the databases opened
+  // read/write share it and make their changes in its current
+  // transaction, *<txn>, if there is one.
+  //
+  static void SetEnvironment (DB_ENV * env, DB_TXN ** txn)
+  {
+    shared_env = env;
+    shared_txn = txn;
+  }
+
+  //
+  // True while there is a current transaction.
+  //
+  static int InTransaction ()
+  {
+    return shared_txn && *shared_txn;
+  }
+
+  //
+  // While set, the databases opened read-only are read as a snapshot,
+  // without locking: their files must not change while they are open.
+  //
+  static void SetSnapshot (int on)
+  {
+    snapshot = on;
+  }
+
 protected:
+  DB_TXN *Txn () const
+  {
+    return shared && shared_txn ? *shared_txn : 0;
+  }
+
+  static DB_ENV *shared_env;
+  static DB_TXN **shared_txn;
+  static int snapshot;
+
   int isOpen;
   DB *dbp;                      // database
   DBC *dbcp;                    // cursor
@@ -98,6 +135,7 @@ protected:
   String lkey;                  // Contains the last key returned by iterator
 
   DB_ENV *dbenv;                // database enviroment
+  int shared;                   // dbenv is shared_env
   int (*_compare) (const DBT * a, const DBT * b);       // Key comparison
   size_t (*_prefix) (const DBT * a, const DBT * b);     // Key reduction
 
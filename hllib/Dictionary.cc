@@ -169,24 +169,19 @@ Dictionary::hashCode (const char *key) const
   if (key && *key && !*test)    // Conversion succeeded
     return conv_key;
 
-  char *base = (char *) malloc (strlen (key) + 2);
-  char *tmp_key = base;
-  strcpy (tmp_key, key);
-
   unsigned int h = 0;
-  int length = strlen (tmp_key);
+  int length = strlen (key);
 
   if (length >= 16)
   {
-    tmp_key += strlen (tmp_key) - 15;
-    length = strlen (tmp_key);
+    key += length - 15;
+    length = 15;
   }
   for (int i = length; i > 0; i--)
   {
-    h = (h * 37) + *tmp_key++;
+    h = (h * 37) + *key++;
   }
 
-  free (base);
   return h;
 }
 
@@ -0,0 +1,537 @@
+//
+// HtHash.cc
+//
+// HtHash: Open-addressing hash tables for hot lookups.  HtIntHash is
+//         indexed with an integer (typically a DocID) and HtStringHash
+//         with a string.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifdef HAVE_CONFIG_H
+#include "hlconfig.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "HtHash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//
+// Both tables use linear probing in a power of two sized table that is
+// kept at most three quarters full.
+//
+#define HT_HASH_MIN_CAPACITY 16
+
+typedef unsigned long long hthash_u64;
+
+#define HT_HASH_P1 0x9E3779B97F4A7C15ULL
+#define HT_HASH_P2 0xC2B2AE3D27D4EB4FULL
+#define HT_HASH_P3 0x165667B19E3779F9ULL
+
+static inline hthash_u64
+rotl64 (hthash_u64 x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+//*****************************************************************************
+// unsigned int HtHashBytes(const char *key, int length)
+//   Multiply-rotate rounds over eight byte words in the spirit of xxHash,
+//   followed by a full avalanche.  Only used for in-memory tables, so the
+//   result need not be the same on machines of different byte order.
+//
+unsigned int
+HtHashBytes (const char *key, int length)
+{
+  const unsigned char *p = (const unsigned char *) key;
+  hthash_u64 h = HT_HASH_P3 ^ ((hthash_u64) length * HT_HASH_P1);
+  hthash_u64 k;
+
+  while (length >= 8)
+  {
+    memcpy (&k, p, 8);
+    k *= HT_HASH_P2;
+    k = rotl64 (k, 31);
+    k *= HT_HASH_P1;
+    h ^= k;
+    h = rotl64 (h, 27) * HT_HASH_P1 + HT_HASH_P3;
+    p += 8;
+    length -= 8;
+  }
+  if (length > 0)
+  {
+    k = 0;
+    memcpy (&k, p, length);
+    h ^= k * HT_HASH_P1;
+    h = rotl64 (h, 23) * HT_HASH_P2;
+  }
+
+  h ^= h >> 33;
+  h *= HT_HASH_P2;
+  h ^= h >> 29;
+  h *= HT_HASH_P3;
+  h ^= h >> 32;
+  return (unsigned int) h;
+}
+
+//
+// Integer keys: a Fibonacci multiply spreads consecutive DocIDs over the
+// whole table.
+//
+static inline unsigned int
+int_hash (int key)
+{
+  unsigned int h = (unsigned int) key * 2654435769U;
+  return h ^ (h >> 16);
+}
+
+//
+// Number of slots needed to hold n entries.
+//
+static unsigned int
+capacity_for (int n)
+{
+  unsigned int capacity = HT_HASH_MIN_CAPACITY;
+  while ((unsigned int) n * 4 > capacity * 3)
+    capacity <<= 1;
+  return capacity;
+}
+
+//
+// Backward shift deletion: after emptying slot i, walk the rest of the
+// cluster and move back every entry whose home slot is not in (i, j].
+// home(j) returns the home slot of the entry at j, used(j) whether slot j
+// holds an entry.
+//
+#define HT_HASH_SHIFT_BACK(i, used, home, move)                         \
+  do                                                                    \
+  {                                                                     \
+    unsigned int j = (i);                                               \
+    for (;;)                                                            \
+    {                                                                   \
+      j = (j + 1) & mask;                                               \
+      if (!(used))                                                      \
+        break;                                                          \
+      unsigned int k = (home);                                          \
+      if ((i) <= j ? ((i) < k && k <= j) : ((i) < k || k <= j))         \
+        continue;                                                       \
+      move;                                                             \
+      (i) = j;                                                          \
+    }                                                                   \
+  }                                                                     \
+  while (0)
+
+
+//*****************************************************************************
+// HtIntHash::HtIntHash(int initialCapacity)
+//
+HtIntHash::HtIntHash (int initialCapacity)
+{
+  init (initialCapacity);
+}
+
+//*****************************************************************************
+// HtIntHash::HtIntHash(const HtIntHash &other)
+//   Like Dictionary, the copy shares the values of the original.
+//
+HtIntHash::HtIntHash (const HtIntHash & other)
+{
+  init (other.count);
+
+  HtHashCursor c;
+  int key;
+  for (other.Start_Get (c); other.Get_Next (c, key);)
+    Add (key, other.table[c.index].value);
+}
+
+//*****************************************************************************
+//
+HtIntHash::~HtIntHash ()
+{
+  Destroy ();
+  delete[]table;
+}
+
+//*****************************************************************************
+//
+void
+HtIntHash::init (int initialCapacity)
+{
+  unsigned int capacity = capacity_for (initialCapacity);
+
+  table = new Entry[capacity];
+  memset (table, 0, capacity * sizeof (Entry));
+  mask = capacity - 1;
+  count = 0;
+}
+
+//*****************************************************************************
+// int HtIntHash::slot(int key)
+//   Index of the entry for key, or of the empty slot where it belongs.
+//
+int
+HtIntHash::slot (int key) const
+{
+  unsigned int i = int_hash (key) & mask;
+
+  while (table[i].used && table[i].key != key)
+    i = (i + 1) & mask;
+  return i;
+}
+
+//*****************************************************************************
+//
+void
+HtIntHash::grow ()
+{
+  Entry *old = table;
+  unsigned int old_capacity = mask + 1;
+  unsigned int capacity = old_capacity * 2;
+
+  table = new Entry[capacity];
+  memset (table, 0, capacity * sizeof (Entry));
+  mask = capacity - 1;
+
+  for (unsigned int i = 0; i < old_capacity; i++)
+    if (old[i].used)
+      table[slot (old[i].key)] = old[i];
+  delete[]old;
+}
+
+//*****************************************************************************
+// void HtIntHash::Add(int key, Object *obj)
+//   Replaces (and deletes) the value of an existing key.
+//
+void
+HtIntHash::Add (int key, Object * obj)
+{
+  int i = slot (key);
+
+  if (table[i].used)
+  {
+    if (table[i].value != obj)
+      delete table[i].value;
+    table[i].value = obj;
+    return;
+  }
+
+  if ((unsigned int) (count + 1) * 4 > (mask + 1) * 3)
+  {
+    grow ();
+    i = slot (key);
+  }
+  table[i].key = key;
+  table[i].used = 1;
+  table[i].value = obj;
+  count++;
+}
+
+//*****************************************************************************
+//
+int
+HtIntHash::Remove (int key)
+{
+  unsigned int i = slot (key);
+
+  if (!table[i].used)
+    return 0;
+
+  delete table[i].value;
+  HT_HASH_SHIFT_BACK (i, table[j].used, int_hash (table[j].key) & mask,
+                      table[i] = table[j]);
+  table[i].used = 0;
+  table[i].value = 0;
+  count--;
+  return 1;
+}
+
+//*****************************************************************************
+//
+Object *
+HtIntHash::Find (int key) const
+{
+  int i = slot (key);
+  return table[i].used ? table[i].value : 0;
+}
+
+//*****************************************************************************
+//
+int
+HtIntHash::Exists (int key) const
+{
+  return table[slot (key)].used;
+}
+
+//*****************************************************************************
+//
+int
+HtIntHash::Get_Next (HtHashCursor & cursor, int &key) const
+{
+  while (++cursor.index <= (int) mask)
+  {
+    if (table[cursor.index].used)
+    {
+      key = table[cursor.index].key;
+      return 1;
+    }
+  }
+  cursor.index = mask;
+  return 0;
+}
+
+//*****************************************************************************
+//
+Object *
+HtIntHash::Get_NextElement (HtHashCursor & cursor) const
+{
+  int key;
+  return Get_Next (cursor, key) ? table[cursor.index].value : 0;
+}
+
+//*****************************************************************************
+//
+void
+HtIntHash::Release ()
+{
+  memset (table, 0, (mask + 1) * sizeof (Entry));
+  count = 0;
+}
+
+//*****************************************************************************
+//
+void
+HtIntHash::Destroy ()
+{
+  for (unsigned int i = 0; count > 0 && i <= mask; i++)
+  {
+    if (table[i].used)
+    {
+      delete table[i].value;
+      count--;
+    }
+  }
+  Release ();
+}
+
+
+//*****************************************************************************
+// HtStringHash::HtStringHash(int initialCapacity)
+//
+HtStringHash::HtStringHash (int initialCapacity)
+{
+  init (initialCapacity);
+}
+
+//*****************************************************************************
+// HtStringHash::HtStringHash(const HtStringHash &other)
+//   Like Dictionary, the copy shares the values of the original.
+//
+HtStringHash::HtStringHash (const HtStringHash & other)
+{
+  init (other.count);
+
+  HtHashCursor c;
+  for (other.Start_Get (c); other.Get_Next (c);)
+  {
+    const Entry & e = other.table[c.index];
+    String key (e.key, e.length);
+    Add (key, e.value);
+  }
+}
+
+//*****************************************************************************
+//
+HtStringHash::~HtStringHash ()
+{
+  Destroy ();
+  delete[]table;
+}
+
+//*****************************************************************************
+//
+void
+HtStringHash::init (int initialCapacity)
+{
+  unsigned int capacity = capacity_for (initialCapacity);
+
+  table = new Entry[capacity];
+  memset (table, 0, capacity * sizeof (Entry));
+  mask = capacity - 1;
+  count = 0;
+}
+
+//*****************************************************************************
+// int HtStringHash::slot(const char *key, int length, unsigned int hash)
+//   Index of the entry for key, or of the empty slot where it belongs.
+//
+int
+HtStringHash::slot (const char *key, int length, unsigned int hash) const
+{
+  unsigned int i = hash & mask;
+
+  while (table[i].key
+         && (table[i].hash != hash || table[i].length != length
+             || memcmp (table[i].key, key, length) != 0))
+    i = (i + 1) & mask;
+  return i;
+}
+
+//*****************************************************************************
+//
+void
+HtStringHash::grow ()
+{
+  Entry *old = table;
+  unsigned int old_capacity = mask + 1;
+  unsigned int capacity = old_capacity * 2;
+
+  table = new Entry[capacity];
+  memset (table, 0, capacity * sizeof (Entry));
+  mask = capacity - 1;
+
+  for (unsigned int i = 0; i < old_capacity; i++)
+  {
+    if (old[i].key)
+    {
+      unsigned int j = old[i].hash & mask;
+      while (table[j].key)
+        j = (j + 1) & mask;
+      table[j] = old[i];
+    }
+  }
+  delete[]old;
+}
+
+//*****************************************************************************
+// void HtStringHash::Add(const String &key, Object *obj)
+//   Replaces (and deletes) the value of an existing key.
+//
+void
+HtStringHash::Add (const String & key, Object * obj)
+{
+  int length = key.length ();
+  unsigned int hash = HtHashBytes (key.get (), length);
+  int i = slot (key.get (), length, hash);
+
+  if (table[i].key)
+  {
+    if (table[i].value != obj)
+      delete table[i].value;
+    table[i].value = obj;
+    return;
+  }
+
+  if ((unsigned int) (count + 1) * 4 > (mask + 1) * 3)
+  {
+    grow ();
+    i = slot (key.get (), length, hash);
+  }
+  table[i].key = (char *) malloc (length + 1);
+  memcpy (table[i].key, key.get (), length);
+  table[i].key[length] = '\0';
+  table[i].length = length;
+  table[i].hash = hash;
+  table[i].value = obj;
+  count++;
+}
+
+//*****************************************************************************
+//
+int
+HtStringHash::Remove (const String & key)
+{
+  unsigned int i =
+    slot (key.get (), key.length (), HtHashBytes (key.get (), key.length ()));
+
+  if (!table[i].key)
+    return 0;
+
+  free (table[i].key);
+  delete table[i].value;
+  HT_HASH_SHIFT_BACK (i, table[j].key, table[j].hash & mask,
+                      table[i] = table[j]);
+  table[i].key = 0;
+  table[i].value = 0;
+  count--;
+  return 1;
+}
+
+//*****************************************************************************
+//
+Object *
+HtStringHash::Find (const char *key, int length) const
+{
+  int i = slot (key, length, HtHashBytes (key, length));
+  return table[i].key ? table[i].value : 0;
+}
+
+//*****************************************************************************
+//
+int
+HtStringHash::Exists (const char *key, int length) const
+{
+  return table[slot (key, length, HtHashBytes (key, length))].key != 0;
+}
+
+//*****************************************************************************
+//
+const char *
+HtStringHash::Get_Next (HtHashCursor & cursor) const
+{
+  while (++cursor.index <= (int) mask)
+  {
+    if (table[cursor.index].key)
+      return table[cursor.index].key;
+  }
+  cursor.index = mask;
+  return 0;
+}
+
+//*****************************************************************************
+//
+Object *
+HtStringHash::Get_NextElement (HtHashCursor & cursor) const
+{
+  return Get_Next (cursor) ? table[cursor.index].value : 0;
+}
+
+//*****************************************************************************
+//
+void
+HtStringHash::Release ()
+{
+  for (unsigned int i = 0; count > 0 && i <= mask; i++)
+  {
+    if (table[i].key)
+    {
+      free (table[i].key);
+      table[i].key = 0;
+      table[i].value = 0;
+      count--;
+    }
+  }
+  count = 0;
+}
+
+//*****************************************************************************
+//
+void
+HtStringHash::Destroy ()
+{
+  for (unsigned int i = 0; i <= mask; i++)
+  {
+    if (table[i].key)
+    {
+      delete table[i].value;
+      table[i].value = 0;
+    }
+  }
+  Release ();
+}
@@ -0,0 +1,217 @@
+//
+// HtHash.h
+//
+// HtHash: Open-addressing hash tables for hot lookups.  HtIntHash is
+//         indexed with an integer (typically a DocID) and HtStringHash
+//         with a string.  Neither allocates anything to look a key up;
+//         otherwise they behave like Dictionary: the values are Objects
+//         owned by the table, Add() replaces (and deletes) an existing
+//         value and Release() forgets the values without deleting them.
+//
+//         Removing an entry while a cursor is walking the table may
+//         cause the cursor to skip another entry.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifndef  _HtHash_h_
+#define  _HtHash_h_
+
+#include "Object.h"
+#include "htString.h"
+
+#include <string.h>
+
+//
+// Hash of an arbitrary byte string, computed eight bytes at a time.
+//
+unsigned int HtHashBytes (const char *key, int length);
+
+class HtHashCursor
+{
+public:
+  int index;
+};
+
+class HtIntHash:public Object
+{
+public:
+  //
+  // Construction/Destruction
+  //
+  HtIntHash (int initialCapacity = 0);
+  HtIntHash (const HtIntHash & other);
+  ~HtIntHash ();
+
+  //
+  // Adding and deleting items
+  //
+  void Add (int key, Object * obj);
+  int Remove (int key);
+
+  //
+  // Searching
+  //
+  Object *Find (int key) const;
+  Object *operator[] (int key) const
+  {
+    return Find (key);
+  }
+  int Exists (int key) const;
+
+  //
+  // Traversal.  Get_Next() returns 0 at the end of the table, otherwise
+  // it sets key and returns 1.  Get_NextElement() returns the values
+  // and so cannot tell a NULL value from the end of the table.
+  //
+  void Start_Get ()
+  {
+    Start_Get (cursor);
+  }
+  void Start_Get (HtHashCursor & cursor) const
+  {
+    cursor.index = -1;
+  }
+  int Get_Next (int &key)
+  {
+    return Get_Next (cursor, key);
+  }
+  int Get_Next (HtHashCursor & cursor, int &key) const;
+  Object *Get_NextElement ()
+  {
+    return Get_NextElement (cursor);
+  }
+  Object *Get_NextElement (HtHashCursor & cursor) const;
+
+  void Release ();
+  void Destroy ();
+  int Count () const
+  {
+    return count;
+  }
+
+private:
+  struct Entry
+  {
+    int key;
+    int used;
+    Object *value;
+  };
+
+  Entry *table;
+  unsigned int mask;
+  int count;
+
+  HtHashCursor cursor;
+
+  void init (int);
+  void grow ();
+  int slot (int key) const;
+};
+
+class HtStringHash:public Object
+{
+public:
+  //
+  // Construction/Destruction
+  //
+  HtStringHash (int initialCapacity = 0);
+  HtStringHash (const HtStringHash & other);
+  ~HtStringHash ();
+
+  //
+  // Adding and deleting items
+  //
+  void Add (const String & key, Object * obj);
+  int Remove (const String & key);
+
+  //
+  // Searching
+  //
+  Object *Find (const String & key) const
+  {
+    return Find (key.get (), key.length ());
+  }
+  Object *Find (const char *key) const
+  {
+    return Find (key, strlen (key));
+  }
+  Object *Find (const char *key, int length) const;
+  Object *operator[] (const String & key) const
+  {
+    return Find (key);
+  }
+  int Exists (const String & key) const
+  {
+    return Exists (key.get (), key.length ());
+  }
+  int Exists (const char *key) const
+  {
+    return Exists (key, strlen (key));
+  }
+  int Exists (const char *key, int length) const;
+
+  //
+  // Traversal, with the same interface as Dictionary
+  //
+  void Start_Get ()
+  {
+    Start_Get (cursor);
+  }
+  void Start_Get (HtHashCursor & cursor) const
+  {
+    cursor.index = -1;
+  }
+  const char *Get_Next ()
+  {
+    return Get_Next (cursor);
+  }
+  const char *Get_Next (HtHashCursor & cursor) const;
+  Object *Get_NextElement ()
+  {
+    return Get_NextElement (cursor);
+  }
+  Object *Get_NextElement (HtHashCursor & cursor) const;
+
+  //
+  // Value of the entry the cursor was last moved to
+  //
+  Object *Get_Current (const HtHashCursor & cursor) const
+  {
+    return table[cursor.index].value;
+  }
+
+  void Release ();
+  void Destroy ();
+  int Count () const
+  {
+    return count;
+  }
+
+private:
+  struct Entry
+  {
+    char *key;
+    int length;
+    unsigned int hash;
+    Object *value;
+  };
+
+  Entry *table;
+  unsigned int mask;
+  int count;
+
+  HtHashCursor cursor;
+
+  void init (int);
+  void grow ();
+  int slot (const char *key, int length, unsigned int hash) const;
+};
+
+#endif
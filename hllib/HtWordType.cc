@@ -19,18 +19,6 @@
 #include "HtWordType.h"
 #include "WordType.h"
 
-int
-HtIsWordChar (char c)
-{
-  return WordType::Instance ()->IsChar (c);
-}
-
-int
-HtIsStrictWordChar (char c)
-{
-  return WordType::Instance ()->IsStrictChar (c);
-}
-
 int
 HtWordNormalize (String & w)
 {
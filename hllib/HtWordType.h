@@ -15,9 +15,21 @@
 #define _HtWordType_h
 
 #include "htString.h"
+#include "WordType.h"
+
+// The tokenizers call these for every character, so they are inline.
+inline int
+HtIsWordChar (char c)
+{
+  return WordType::Instance ()->IsChar (c);
+}
+
+inline int
+HtIsStrictWordChar (char c)
+{
+  return WordType::Instance ()->IsStrictChar (c);
+}
 
-extern int HtIsWordChar (char c);
-extern int HtIsStrictWordChar (char c);
 extern int HtWordNormalize (String & w);
 extern int HtStripPunctuation (String & w);
 
@@ -68,7 +68,7 @@ ParsedString::set (const String & str)
 //
 //   The filename can also contain variables
 //
-const String
+String
 ParsedString::get (const Dictionary & dict) const
 {
   String variable;
@@ -31,7 +31,7 @@ public:
   ~ParsedString ();
 
   void set (const String & s);
-  const String get (const Dictionary & d) const;
+  String get (const Dictionary & d) const;
 private:
     String value;
 
@@ -35,6 +35,7 @@ using namespace std;
 #endif /* HAVE_STD */
 
 #include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -44,22 +45,25 @@ const int MinimumAllocationSize = 4;    // Should be power of two.
 #ifdef NOINLINE
 String::String ()
 {
-  Length = Allocated = 0;
-  Data = 0;
+  Length = 0;
+  Allocated = InlineSize;
+  Heap = 0;
 }
 #endif
 
 String::String (int init)
 {
   Length = 0;
-  Allocated = init >= MinimumAllocationSize ? init : MinimumAllocationSize;
-  Data = new char[Allocated];
+  Allocated = InlineSize;
+  Heap = 0;
+  allocate_fix_space (init);
 }
 
 String::String (const char *s)
 {
-  Allocated = Length = 0;
-  Data = 0;
+  Length = 0;
+  Allocated = InlineSize;
+  Heap = 0;
 
   int len;
   if (s)
@@ -71,19 +75,21 @@ String::String (const char *s)
 
 String::String (const char *s, int len)
 {
-  Allocated = Length = 0;
-  Data = 0;
+  Length = 0;
+  Allocated = InlineSize;
+  Heap = 0;
   if (s && len > 0)
     copy (s, len, len);
 }
 
 String::String (const String & s)
 {
-  Allocated = Length = 0;
-  Data = 0;
+  Length = 0;
+  Allocated = InlineSize;
+  Heap = 0;
 
   if (s.length () > 0)
-    copy (s.Data, s.length (), s.length ());
+    copy (s.data (), s.length (), s.length ());
 }
 
 //
@@ -92,21 +98,22 @@ String::String (const String & s)
 //
 String::String (const String & s, int allocation_hint)
 {
-  Allocated = Length = 0;
-  Data = 0;
+  Length = 0;
+  Allocated = InlineSize;
+  Heap = 0;
 
   if (s.length () != 0)
   {
     if (allocation_hint < s.length ())
       allocation_hint = s.length ();
-    copy (s.Data, s.length (), allocation_hint);
+    copy (s.data (), s.length (), allocation_hint);
   }
 }
 
 String::~String ()
 {
-  if (Allocated)
-    delete[]Data;
+  if (Heap)
+    delete[]Heap;
 }
 
 void
@@ -116,7 +123,7 @@ String::operator = (const String & s)
   {
     allocate_space (s.length ());
     Length = s.length ();
-    copy_data_from (s.Data, Length);
+    copy_data_from (s.data (), Length);
   }
   else
   {
@@ -146,7 +153,7 @@ String::append (const String & s)
   int new_len = Length + s.length ();
 
   reallocate_space (new_len);
-  copy_data_from (s.Data, s.length (), Length);
+  copy_data_from (s.data (), s.length (), Length);
   Length = new_len;
 }
 
@@ -184,17 +191,36 @@ String::append (char ch)
   int new_len = Length + 1;
   if (new_len + 1 > Allocated)
     reallocate_space (new_len);
-  Data[Length] = ch;
+  data ()[Length] = ch;
   Length = new_len;
 }
 
+char *
+String::append_space (int n)
+{
+  reallocate_space (Length + n);
+  return data () + Length;
+}
+
+void
+String::swap (String & s)
+{
+  if (&s == this)
+    return;
+
+  String tmp;
+  tmp.take (s);
+  s.take (*this);
+  take (tmp);
+}
+
 int
 String::compare (const String & obj) const
 {
   int len;
   int result;
-  const char *p1 = Data;
-  const char *p2 = obj.Data;
+  const char *p1 = data ();
+  const char *p2 = obj.data ();
 
   len = Length;
   result = 0;
@@ -237,7 +263,7 @@ int
 String::Write (int fd) const
 {
   int left = Length;
-  char *wptr = Data;
+  char *wptr = data ();
 
   while (left)
   {
@@ -252,41 +278,56 @@ String::Write (int fd) const
   return left;
 }
 
+int
+String::Read (int fd, int length)
+{
+  int total = 0;
+
+  while (total < length)
+  {
+    if (Length + 1 >= Allocated)
+      reallocate_space (Length + 8192);
+
+    int room = Allocated - 1 - Length;
+    if (room > length - total)
+      room = length - total;
+
+    int result = read (fd, data () + Length, room);
+
+    if (result < 0 && errno == EINTR)
+      continue;
+    if (result < 0)
+      return result;
+    if (result == 0)
+      break;
+
+    Length += result;
+    total += result;
+  }
+  return total;
+}
+
 const char *
 String::get () const
 {
-  static const char *null = "";
-  if (!Allocated)
-    return null;
-  Data[Length] = '\0';          // We always leave room for this.
-  return Data;
+  data ()[Length] = '\0';       // We always leave room for this.
+  return data ();
 }
 
 char *
 String::get ()
 {
-  if (!Allocated)
-  {
-    static char null[] = { "" };
-    return null;
-  }
-  Data[Length] = '\0';          // We always leave room for this.
-  return Data;
+  data ()[Length] = '\0';       // We always leave room for this.
+  return data ();
 }
 
 char *
 String::new_char () const
 {
   char *r;
-  if (!Allocated)
-  {
-    r = new char[1];
-    *r = '\0';
-    return r;
-  }
-  Data[Length] = '\0';          // We always leave room for this.
+  data ()[Length] = '\0';       // We always leave room for this.
   r = new char[Length + 1];
-  strcpy (r, Data);
+  strcpy (r, data ());
   return r;
 }
 
@@ -296,8 +337,8 @@ String::as_integer (int def) const
 {
   if (Length <= 0)
     return def;
-  Data[Length] = '\0';
-  return atoi (Data);
+  data ()[Length] = '\0';
+  return atoi (data ());
 }
 
 double
@@ -305,8 +346,8 @@ String::as_double (double def) const
 {
   if (Length <= 0)
     return def;
-  Data[Length] = '\0';
-  return atof (Data);
+  data ()[Length] = '\0';
+  return atof (data ());
 }
 
 String
@@ -318,7 +359,7 @@ String::sub (int start, int len) const
   if (len > Length - start)
     len = Length - start;
 
-  return String (Data + start, len);
+  return String (data () + start, len);
 }
 
 String
@@ -335,20 +376,18 @@ String::indexOf (const char *str) const
   // Set the first char after string end to zero to prevent finding
   // substrings including symbols after actual end of string
   //
-  if (!Allocated)
-    return -1;
-  Data[Length] = '\0';
+  data ()[Length] = '\0';
 
   /* OLD CODE: for (i = 0; i < Length; i++) */
 #ifdef HAVE_STRSTR
-  if ((c = strstr (Data, str)) != NULL)
-    return (c - Data);
+  if ((c = strstr (data (), str)) != NULL)
+    return (c - data ());
 #else
   int len = strlen (str);
   int i;
   for (i = 0; i <= Length - len; i++)
   {
-    if (strncmp (&Data[i], str, len) == 0)
+    if (strncmp (&data ()[i], str, len) == 0)
       return i;
   }
 #endif
@@ -358,10 +397,11 @@ String::indexOf (const char *str) const
 int
 String::indexOf (char ch) const
 {
+  const char *p = data ();
   int i;
   for (i = 0; i < Length; i++)
   {
-    if (Data[i] == ch)
+    if (p[i] == ch)
       return i;
   }
   return -1;
@@ -372,9 +412,10 @@ String::indexOf (char ch, int pos) const
 {
   if (pos >= Length)
     return -1;
+  const char *p = data ();
   for (int i = pos; i < Length; i++)
   {
-    if (Data[i] == ch)
+    if (p[i] == ch)
       return i;
   }
   return -1;
@@ -385,9 +426,10 @@ String::lastIndexOf (char ch, int pos) const
 {
   if (pos >= Length)
     return -1;
+  const char *p = data ();
   while (pos >= 0)
   {
-    if (Data[pos] == ch)
+    if (p[pos] == ch)
       return pos;
     pos--;
   }
@@ -452,10 +494,10 @@ String::operator >> (char c)
 {
   c = '\0';
 
-  if (Allocated && Length)
+  if (Length)
   {
-    c = Data[Length - 1];
-    Data[Length - 1] = '\0';
+    c = data ()[Length - 1];
+    data ()[Length - 1] = '\0';
     Length--;
   }
 
@@ -465,12 +507,13 @@ String::operator >> (char c)
 int
 String::lowercase ()
 {
+  char *p = data ();
   int converted = 0;
   for (int i = 0; i < Length; i++)
   {
-    if (isupper ((unsigned char) Data[i]))
+    if (isupper ((unsigned char) p[i]))
     {
-      Data[i] = tolower ((unsigned char) Data[i]);
+      p[i] = tolower ((unsigned char) p[i]);
       converted++;
     }
   }
@@ -481,12 +524,13 @@ String::lowercase ()
 int
 String::uppercase ()
 {
+  char *p = data ();
   int converted = 0;
   for (int i = 0; i < Length; i++)
   {
-    if (islower ((unsigned char) Data[i]))
+    if (islower ((unsigned char) p[i]))
     {
-      Data[i] = toupper ((unsigned char) Data[i]);
+      p[i] = toupper ((unsigned char) p[i]);
       converted++;
     }
   }
@@ -497,9 +541,10 @@ String::uppercase ()
 void
 String::replace (char c1, char c2)
 {
+  char *p = data ();
   for (int i = 0; i < Length; i++)
-    if (Data[i] == c1)
-      Data[i] = c2;
+    if (p[i] == c1)
+      p[i] = c2;
 }
 
 
@@ -512,7 +557,7 @@ String::remove (const char *chars)
   char *good, *bad;
   int skipped = 0;
 
-  good = bad = Data;
+  good = bad = data ();
   for (int i = 0; i < Length; i++)
   {
     if (strchr (chars, *bad))
@@ -537,7 +582,7 @@ String & String::chop (int n)
 
 String & String::chop (char ch)
 {
-  while (Length > 0 && Data[Length - 1] == ch)
+  while (Length > 0 && data ()[Length - 1] == ch)
     Length--;
   return *this;
 }
@@ -545,7 +590,7 @@ String & String::chop (char ch)
 
 String & String::chop (const char *str)
 {
-  while (Length > 0 && strchr (str, Data[Length - 1]))
+  while (Length > 0 && strchr (str, data ()[Length - 1]))
     Length--;
   return *this;
 }
@@ -624,7 +669,7 @@ operator >= (const String & a, const String & b)
 #ifndef NOSTREAM
 ostream & operator << (ostream & o, const String & s)
 {
-  o.write (s.Data, s.length ());
+  o.write (s.data (), s.length ());
   return o;
 }
 #endif /* NOSTREAM */
@@ -636,7 +681,7 @@ ostream & operator << (ostream & o, const String & s)
 void
 String::copy_data_from (const char *s, int len, int dest_offset)
 {
-  memcpy (Data + dest_offset, s, len);
+  memcpy (data () + dest_offset, s, len);
 }
 
 void
@@ -647,14 +692,14 @@ String::allocate_space (int len)
   if (len <= Allocated)
     return;
 
-  if (Allocated)
-    delete[]Data;
+  if (Heap)
+    delete[]Heap;
 
   Allocated = MinimumAllocationSize;
   while (Allocated < len)
     Allocated <<= 1;
 
-  Data = new char[Allocated];
+  Heap = new char[Allocated];
 }
 
 void
@@ -665,33 +710,33 @@ String::allocate_fix_space (int len)
   if (len <= Allocated)
     return;
 
-  if (Allocated)
-    delete[]Data;
+  if (Heap)
+    delete[]Heap;
 
   Allocated = len;
   if (Allocated < MinimumAllocationSize)
     Allocated = MinimumAllocationSize;
-  Data = new char[Allocated];
+  Heap = new char[Allocated];
 }
 
 void
 String::reallocate_space (int len)
 {
-  char *old_data = 0;
-  int old_data_len = 0;
+  char *old_data = data ();
+  char *old_heap = Heap;
 
-  if (Allocated)
-  {
-    old_data = Data;
-    old_data_len = Length;
-    Allocated = 0;
-  }
+  if (len + 1 <= Allocated)
+    return;
+
+  //
+  // Make allocate_space() forget the old buffer rather than free it.
+  //
+  Heap = 0;
+  Allocated = 0;
   allocate_space (len);
-  if (old_data)
-  {
-    copy_data_from (old_data, old_data_len);
-    delete[]old_data;
-  }
+  copy_data_from (old_data, Length);
+  if (old_heap)
+    delete[]old_heap;
 }
 
 void
@@ -709,7 +754,7 @@ void
 String::debug (ostream & o)
 {
   o << "Length: " << Length << " Allocated: " << Allocated <<
-    " Data: " << ((void *) Data) << " '" << *this << "'\n";
+    " Data: " << ((void *) data ()) << " '" << *this << "'\n";
 }
 #endif /* NOSTREAM */
 
@@ -719,12 +764,12 @@ String::readLine (FILE * in)
   Length = 0;
   allocate_fix_space (2048);
 
-  while (fgets (Data + Length, Allocated - Length, in))
+  while (fgets (data () + Length, Allocated - Length, in))
   {
-    Length += strlen (Data + Length);
+    Length += strlen (data () + Length);
     if (Length == 0)
       continue;
-    if (Data[Length - 1] == '\n')
+    if (data ()[Length - 1] == '\n')
     {
       //
       // A full line has been read.  Return it.
@@ -759,8 +804,8 @@ istream & operator >> (istream & in, String & line)
   for (;;)
   {
     in.clear ();
-    in.getline (line.Data + line.Length, line.Allocated - line.Length);
-    line.Length += strlen (line.Data + line.Length);
+    in.getline (line.data () + line.Length, line.Allocated - line.Length);
+    line.Length += strlen (line.data () + line.Length);
     // if read whole line, or eof, or read fewer chars than the max...
     if (!in.fail () || in.eof () || line.Length + 1 < line.Allocated)
       break;
@@ -34,13 +34,19 @@ public:
   String ()
   {
     Length = 0;
-    Allocated = 0;
-    Data = 0;
+    Allocated = InlineSize;
+    Heap = 0;
   }                             // Create an empty string
   String (int init);            // initial allocated length
   String (const char *s);       // from null terminated s
   String (const char *s, int len);      // from s with length len
   String (const String & s);    // Copy constructor
+#if __cplusplus >= 201103L
+  String (String && s)          // Move constructor
+  {
+    take (s);
+  }
+#endif
 
   //
   // This can be used for performance reasons if it is known the
@@ -103,6 +109,17 @@ public:
   }
   void operator = (const String & s);
   void operator = (const char *s);
+#if __cplusplus >= 201103L
+  void operator = (String && s)
+  {
+    if (&s != this)
+    {
+      if (Heap)
+        delete[]Heap;
+      take (s);
+    }
+  }
+#endif
   inline void operator += (const String & s)
   {
     append (s);
@@ -145,7 +162,7 @@ public:
   }
   inline char last () const
   {
-    return Length > 0 ? Data[Length - 1] : '\0';
+    return Length > 0 ? data ()[Length - 1] : '\0';
   }
 
   //
@@ -185,6 +202,22 @@ public:
   void append (const char *s, int n);
   void append (char ch);
 
+  //
+  // Filling in place: append_space() makes room for n more characters
+  // and returns where they go, append_length() then accounts for the
+  // number actually written there.
+  //
+  char *append_space (int n);
+  void append_length (int n)
+  {
+    Length += n;
+  }
+
+  //
+  // Exchange the contents of two Strings without copying them
+  //
+  void swap (String & s);
+
   inline String & trunc ()
   {
     Length = 0;
@@ -206,6 +239,10 @@ public:
   // IO
   //
   int Write (int fd) const;
+  // Append at most length characters read from fd, growing only when
+  // the space already allocated is full.  Returns the number of
+  // characters appended, or -1 on a read error.
+  int Read (int fd, int length);
 
 #ifndef NOSTREAM
   void debug (ostream & o);
@@ -248,20 +285,51 @@ public:
   void Deserialize (String &, int &);
 
 private:
+  //
+  // Strings shorter than InlineSize are kept in the object itself and
+  // only longer ones are allocated on the heap.  No pointer into the
+  // object is kept: arrays of structures holding Strings are sorted by
+  // swapping their bytes (see myqsort), which must not leave a String
+  // pointing into another element.
+  //
+  enum
+  { InlineSize = 24 };
+
   int Length;                   // Current Length
   int Allocated;                // Total space allocated
-  char *Data;                   // The actual contents
+  char *Heap;                   // The contents if allocated, else 0
+  char Inline[InlineSize];      // The contents otherwise
+
+  char *data () const
+  {
+    return Heap ? Heap : (char *) Inline;
+  }
+
+  //
+  // Steal the contents of s, leaving it empty.
+  //
+  void take (String & s)
+  {
+    Length = s.Length;
+    Allocated = s.Allocated;
+    Heap = s.Heap;
+    if (!Heap)
+      memcpy (Inline, s.Inline, Length);
+    s.Allocated = InlineSize;
+    s.Heap = 0;
+    s.Length = 0;
+  }
 
   void copy_data_from (const char *s, int len, int dest_offset = 0);
   void copy (const char *s, int len, int allocation_hint);
 
   //
-  // Possibly make Data bigger.
+  // Possibly make room for more data.
   //
   void reallocate_space (int len);
 
   //
-  // Allocate some space for the data.  Delete Data if it
+  // Allocate some space for the data.  Delete Heap if it
   // has been allocated.
   //
   void allocate_space (int len);
@@ -308,7 +376,7 @@ String::operator [] (int n)
            '\0';
 
        return
-         Data[n];
+         data ()[n];
      }
 
      static char
@@ -322,7 +390,7 @@ String::operator [] (int n)
   if (n >= Length || n < 0)
     return null;
 
-  return Data[n];
+  return data ()[n];
 }
 
 //
@@ -43,6 +43,7 @@ using namespace std;
 
 #include <stdio.h>              // for sscanf
 #include <sys/stat.h>
+#include <fcntl.h>
 
 #ifndef _MSC_VER                /* _WIN32 */
 #include <unistd.h>
@@ -322,24 +323,18 @@ HtFile::DocStatus HtFile::Request ()
 
   _response._modification_time = new HtDateTime (stat_buf.st_mtime);
 
-  FILE *
-    f = fopen ((const char *) path.get (), "r");
-  if (f == NULL)
+  int
+    fd = open ((const char *) path.get (), O_RDONLY);
+  if (fd < 0)
     return Document_not_found;
 
-  char
-    docBuffer[8192];
-  int
-    bytesRead;
-  while ((bytesRead = fread (docBuffer, 1, sizeof (docBuffer), f)) > 0)
-  {
-    if (_response._contents.length () + bytesRead > _max_document_size)
-      bytesRead = _max_document_size - _response._contents.length ();
-    _response._contents.append (docBuffer, bytesRead);
-    if (_response._contents.length () >= _max_document_size)
-      break;
-  }
-  fclose (f);
+  // Read the file straight into the contents, sized after the file
+  if (stat_buf.st_size < _max_document_size)
+    _response._contents.allocate (stat_buf.st_size);
+  else
+    _response._contents.allocate (_max_document_size);
+  _response._contents.Read (fd, _max_document_size);
+  close (fd);
 
   _response._content_length = stat_buf.st_size;
   _response._document_length = _response._contents.length ();
@@ -28,6 +28,11 @@
 #include <sys/types.h>
 #include <ctype.h>
 #include <stdio.h>              // for sscanf
+#include <limits.h>
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+#include <zlib.h>
+#endif
 
 // for setw()
 #ifdef HAVE_STD
@@ -56,11 +61,21 @@ int
   HtHTTP::_tot_requests = 0;
 int
   HtHTTP::_tot_bytes = 0;
+double
+  HtHTTP::_tot_encoded_bytes = 0;
+double
+  HtHTTP::_tot_decoded_bytes = 0;
+int
+  HtHTTP::_tot_pipelined = 0;
 
    // flag that manage the option of 'HEAD' before 'GET'
 bool
   HtHTTP::_head_before_get = true;
 
+   // flag that manage the request of compressed bodies
+bool
+  HtHTTP::_accept_compression = true;
+
    // Handler of the CanParse function
 
 int (*HtHTTP::CanBeParsed) (char *) = 0;
@@ -80,7 +95,8 @@ HtCookieJar *
 
 HtHTTP_Response::HtHTTP_Response ():_version (0),
 _transfer_encoding (0),
-_server (0), _hdrconnection (0), _content_language (0)
+_server (0), _hdrconnection (0), _content_language (0),
+_content_encoding (0), _etag (0)
 {
 }
 
@@ -107,6 +123,8 @@ HtHTTP_Response::Reset ()
   _hdrconnection.trunc ();
   _server.trunc ();
   _content_language.trunc ();
+  _content_encoding.trunc ();
+  _etag.trunc ();
 
 }
 
@@ -125,9 +143,12 @@ HtHTTP_Response::Reset ()
 HtHTTP::HtHTTP (Connection & connection):Transport (&connection), _Method (Method_GET),
                                                 // Default Method Request
   _bytes_read (0),
-_accept_language (0),
+_request_etag (0), _accept_language (0),
 _persistent_connection_allowed (true),
-_persistent_connection_possible (false), _send_cookies (true)
+_persistent_connection_possible (false), _send_cookies (true),
+_inflater (0), _inflater_done (false), _encoded_length (0),
+_response_pipelined (false), _pipeline_answered (false),
+_pipeline_failed (false)
 {
 }
 
@@ -135,6 +156,13 @@ _persistent_connection_possible (false), _send_cookies (true)
 
 HtHTTP::~HtHTTP ()
 {
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  if (_inflater)
+  {
+    inflateEnd (_inflater);
+    delete _inflater;
+  }
+#endif
 }
 
 
@@ -167,9 +195,33 @@ Transport::DocStatus HtHTTP::Request ()
     _Method = Method_GET;
   }
 
+  _pipeline_failed = false;
+
   if (result == Document_ok)
+  {
     result = HTTPRequest ();
 
+    // The response to a request sent ahead of its turn may never come,
+    // as servers close idle or worn out connections; and a server which
+    // does not really support pipelining may drop the connection before
+    // any such response, or answer anything at all. Either way we ask
+    // again, this time on its own.
+    if (_response_pipelined && (result == Document_connection_down
+                                || result == Document_no_header))
+    {
+      if (result == Document_no_header || !_pipeline_answered)
+        _pipeline_failed = true;
+
+      DropPipeline ();
+
+      if (debug > 0)
+        cout << "! Pipelined request failed." << endl
+          << "  Connection closed. Try to get it again." << endl;
+
+      result = HTTPRequest ();
+    }
+  }
+
   if (result == Document_no_header && isPersistentConnectionAllowed ())
   {
 
@@ -214,8 +266,43 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
   // Reset the response
   _response.Reset ();
 
-  // Flush the connection
-  FlushConnection ();
+  String
+    command;
+
+  switch (_Method)
+  {
+  case Method_GET:
+    command = "GET ";
+    break;
+  case Method_HEAD:
+    command = "HEAD ";
+    ShouldTheBodyBeRead = false;
+    break;
+  }
+
+  // Set the request command
+
+  SetRequestCommand (command);
+
+  // If this very request was sent ahead with a previous one, its
+  // response is on the way. Any other request breaks the order.
+  _response_pipelined = false;
+
+  if (_pipelined.Count ())
+  {
+    if (isPersistentConnectionUp () && !strcmp (command.get (), _pipelined[0]))
+    {
+      _pipelined.Remove (0);
+      _response_pipelined = true;
+      _tot_pipelined++;
+    }
+    else
+      DropPipeline ();
+  }
+
+  // Flush the connection (unless it holds the pipelined responses)
+  if (!_response_pipelined)
+    FlushConnection ();
 
   _bytes_read = 0;
 
@@ -240,6 +327,9 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
 
   result = EstablishConnection ();
 
+  if (result != Connection_already_up)
+    _pipeline_answered = false;
+
   if (result != Connection_ok && result != Connection_already_up)
   {
 
@@ -312,29 +402,23 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
       break;
     }
 
-  String
-    command;
-
-  switch (_Method)
+  if (_response_pipelined)
   {
-  case Method_GET:
-    command = "GET ";
-    break;
-  case Method_HEAD:
-    command = "HEAD ";
-    ShouldTheBodyBeRead = false;
-    break;
+    if (debug > 6)
+      cout << "Request (pipelined)\n" << command;
   }
+  else
+  {
+    if (debug > 6)
+      cout << "Request\n" << command;
 
-  // Set the request command
-
-  SetRequestCommand (command);
-
-  if (debug > 6)
-    cout << "Request\n" << command;
+    // Writes the command
+    ConnectionWrite (command);
+  }
 
-  // Writes the command
-  ConnectionWrite (command);
+  // A connection kept alive for us lets the next requests go as well
+  if (result == Connection_already_up && _Method == Method_GET)
+    SendNextRequests ();
 
   // Parse the header
   if (ParseHeader () == -1)     // Connection down
@@ -361,6 +445,9 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
     return FinishRequest (Document_no_header);
   }
 
+  if (_response_pipelined)
+    _pipeline_answered = true;
+
 
   if (debug > 3)
   {
@@ -386,6 +473,9 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
     if (_response._transfer_encoding.length ())
       cout << "Transfer-encoding : " << _response._transfer_encoding << endl;
 
+    if (_response._content_encoding.length ())
+      cout << "Content-encoding  : " << _response._content_encoding << endl;
+
     if (_response._content_language.length ())
       cout << "Content-Language : " << _response._content_language << endl;
 
@@ -404,12 +494,42 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
 
   DocumentStatus = GetDocumentStatus (_response);
 
+  // A body we are unable to decode is of no use to the parsers
+  if (DocumentStatus == Document_ok
+      && !CanDecode (_response._content_encoding))
+  {
+    if (debug > 4)
+      cout << "Unknown content-encoding: " << _response._content_encoding
+        << endl;
+    DocumentStatus = Document_not_parsable;
+  }
+
   // We read the body only if the document has been found
   if (DocumentStatus != Document_ok)
   {
     ShouldTheBodyBeRead = false;
   }
 
+  // With more responses to come on the connection, a body of no use
+  // has still to be got out of their way (unless we close it anyway).
+  // 1xx, 204 and 304 responses never have one, whatever their headers
+  // say (RFC 7230, 3.3.3).
+  bool
+    DiscardTheBody = false;
+  int
+    status = _response.GetStatusCode ();
+
+  if (!ShouldTheBodyBeRead && _Method == Method_GET && _pipelined.Count ()
+      && DocumentStatus != Document_not_parsable
+      && status >= 200 && status != 204 && status != 304
+      && (_response._content_length > 0
+          || mystrncasecmp ((char *) _response._transfer_encoding,
+                            "chunked", 7) == 0))
+  {
+    ShouldTheBodyBeRead = true;
+    DiscardTheBody = true;
+  }
+
   // For now a chunked response MUST BE retrieved
   if (mystrncasecmp ((char *) _response._transfer_encoding, "chunked", 7) ==
       0)
@@ -427,8 +547,14 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
     if (debug > 4)
       cout << "Reading the body of the response" << endl;
 
+    StartDecoding ();
+
     // We use a int (HtHTTP::*)() function pointer
-    if ((this->*_readbody) () == -1)
+    int read_result = (this->*_readbody) ();
+
+    FinishDecoding ();
+
+    if (read_result == -1)
     {
       // The connection probably fell down !?!
       if (debug > 4)
@@ -477,6 +603,12 @@ Transport::DocStatus HtHTTP::HTTPRequest ()
     if (_response._content_length < _response._document_length)
       _response._content_length = _response._document_length;
 
+    if (DiscardTheBody)
+    {
+      _response._contents.trunc ();
+      _response._document_length = 0;
+    }
+
   }
   else if (debug > 4)
     cout << "Body not retrieved" << endl;
@@ -617,11 +749,16 @@ HtHTTP::SetRequestCommand (String & cmd)
   if (_useproxy && _proxy_credentials.length ())
     cmd << "Proxy-Authorization: Basic " << _proxy_credentials << "\r\n";
 
-  // Accept-Encoding: waiting to handle the gzip and compress formats, we
-  // just send an empty header which, according to the HTTP 1/1 standard,
-  // should let the server know that we only accept the 'identity' case
-  // (no encoding of the document)
-  cmd << "Accept-Encoding: \r\n";
+  // Accept-Encoding: gzip and deflate are decoded while the body is
+  // read. Otherwise we send an empty header which, according to the
+  // HTTP 1/1 standard, should let the server know that we only accept
+  // the 'identity' case (no encoding of the document)
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  if (_accept_compression)
+    cmd << "Accept-Encoding: gzip, deflate\r\n";
+  else
+#endif
+    cmd << "Accept-Encoding: \r\n";
 
   // A date has been passed to check if the server one is newer than
   // the one we already own.
@@ -633,6 +770,10 @@ HtHTTP::SetRequestCommand (String & cmd)
       GetRFC1123 () << "\r\n";
   }
 
+  // The same for the entity tag the server gave us last time
+  if (_request_etag.length ())
+    cmd << "If-None-Match: " << _request_etag << "\r\n";
+
 ///////
   //    Cookies! Let's go eat them! ;-)
 ///////
@@ -649,6 +790,81 @@ HtHTTP::SetRequestCommand (String & cmd)
 }
 
 
+//*****************************************************************************
+// void HtHTTP::AddNextRequest(const URL &url, const URL &referer,
+//                             HtDateTime &modtime, const String &etag)
+//   The request is built right away, with everything else as it is set
+//   for the current one.
+//
+void
+HtHTTP::AddNextRequest (const URL & url, const URL & referer,
+                        HtDateTime & modtime, const String & etag)
+{
+  URL current_url = _url;
+  URL current_referer = _referer;
+  HtDateTime *current_modtime = _modification_time;
+  String current_etag = _request_etag;
+
+  _url = url;
+  _referer = referer;
+  _modification_time = &modtime;
+  _request_etag = etag;
+
+  String *command = new String ("GET ");
+  SetRequestCommand (*command);
+  _next_requests.Add (command);
+
+  _url = current_url;
+  _referer = current_referer;
+  _modification_time = current_modtime;
+  _request_etag = current_etag;
+}
+
+
+//*****************************************************************************
+// void HtHTTP::SendNextRequests()
+//   Write the next requests that have not been sent yet, all at once
+//
+void
+HtHTTP::SendNextRequests ()
+{
+  String commands;
+
+  for (int i = _pipelined.Count (); i < _next_requests.Count (); i++)
+  {
+    if (debug > 6)
+      cout << "Pipelined request\n" << _next_requests[i];
+
+    commands << _next_requests[i];
+    _pipelined.Add (_next_requests[i]);
+  }
+
+  if (commands.length ())
+    ConnectionWrite (commands);
+}
+
+
+//*****************************************************************************
+// void HtHTTP::DropPipeline()
+//   The responses to the requests sent ahead will not be read: the
+//   connection has to go with them
+//
+void
+HtHTTP::DropPipeline ()
+{
+  if (!_pipelined.Count ())
+    return;
+
+  if (debug > 4)
+    cout << setw (5) << Transport::GetTotOpen () << " - "
+      << "Pipelined requests dropped ... let's close the connection" << endl;
+
+  CloseConnection ();
+  FlushConnection ();
+  _pipelined.Destroy ();
+}
+
+
 
 
 //*****************************************************************************
@@ -771,6 +987,29 @@ HtHTTP::ParseHeader ()
         if (token && *token)
           _response._transfer_encoding = token;
 
+      }
+      else if (!mystrncasecmp ((char *) line, "content-encoding:", 17))
+      {
+        // Content-encoding
+
+        token = strtok (token, "\n\t");
+
+        if (token && *token)
+        {
+          _response._content_encoding = token;
+          _response._content_encoding.chop (" \r");
+        }
+
+      }
+      else if (!mystrncasecmp ((char *) line, "etag:", 5))
+      {
+        // Entity tag of the document
+
+        token = strtok (token, "\n\t");
+
+        if (token && *token)
+          _response._etag = token;
+
       }
       else if (!mystrncasecmp ((char *) line, "location:", 9))
       {
@@ -978,19 +1217,42 @@ HtHTTP::ReadBody ()
   int bytesRead = 0;
   int bytesToGo = _response._content_length;
 
-  if (bytesToGo < 0 || bytesToGo > _max_document_size)
+  // An encoded body is read until the decoded contents are full, so
+  // its length on the wire is no limit (and may be unknown)
+  if (_inflater)
+  {
+    if (bytesToGo < 0)
+      bytesToGo = INT_MAX;
+  }
+  else if (bytesToGo < 0 || bytesToGo > _max_document_size)
     bytesToGo = _max_document_size;
 
-  while (bytesToGo > 0)
+  // Otherwise the body is read straight into the contents, in one go
+  // when its length is known
+  if (!_inflater && _response._content_length >= 0)
+    _response._contents.allocate (bytesToGo);
+
+  while (bytesToGo > 0 && _response._contents.length () < _max_document_size)
   {
-    int len =
-      bytesToGo <
-      (int) sizeof (docBuffer) ? bytesToGo : (int) sizeof (docBuffer);
-    bytesRead = _connection->Read (docBuffer, len);
+    int len = bytesToGo;
+    char *buffer = docBuffer;
+
+    if (_inflater || _response._content_length < 0)
+    {
+      if (len > (int) sizeof (docBuffer))
+        len = sizeof (docBuffer);
+    }
+    if (!_inflater)
+      buffer = _response._contents.append_space (len);
+
+    bytesRead = _connection->Read (buffer, len);
     if (bytesRead <= 0)
       break;
 
-    _response._contents.append (docBuffer, bytesRead);
+    if (_inflater)
+      AppendBody (docBuffer, bytesRead);
+    else
+      _response._contents.append_length (bytesRead);
 
     bytesToGo -= bytesRead;
 
@@ -1049,19 +1311,27 @@ HtHTTP::ReadChunkedBody ()
       }
       chunk -= rsize;
 
-      // Read Chunk data
-      if (_connection->Read (buffer, rsize) == -1)
-        return -1;
+      // Read Chunk data, straight into the contents of the response
+      // while it fits, but not more than _max_document_size...
+      if (!_inflater
+          && rsize <= _max_document_size - _response._contents.length ())
+      {
+        int got =
+          _connection->Read (_response._contents.append_space (rsize), rsize);
+        if (got == -1)
+          return -1;
+        _response._contents.append_length (got);
+      }
+      else
+      {
+        if (_connection->Read (buffer, rsize) == -1)
+          return -1;
+
+        AppendBody (buffer, rsize);
+      }
 
       length += rsize;
 
-      // Append the chunk-data to the contents of the response
-      // ... but not more than _max_document_size...
-      if (rsize > _max_document_size - _response._contents.length ())
-        rsize = _max_document_size - _response._contents.length ();
-      buffer[rsize] = 0;
-      _response._contents.append (buffer, rsize);
-
     }
     while (chunk);
 
@@ -1098,6 +1368,161 @@ HtHTTP::ReadChunkedBody ()
 }
 
 
+///////
+   //    Content-encoding of the body
+///////
+
+bool
+HtHTTP::CanDecode (const String & encoding)
+{
+  if (encoding.length () == 0 || mystrcasecmp (encoding, "identity") == 0)
+    return true;
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  if (mystrcasecmp (encoding, "gzip") == 0
+      || mystrcasecmp (encoding, "x-gzip") == 0
+      || mystrcasecmp (encoding, "deflate") == 0)
+    return true;
+#endif
+
+  return false;
+}
+
+
+void
+HtHTTP::StartDecoding ()
+{
+  _inflater_done = false;
+  _encoded_length = 0;
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  if (_inflater)
+  {
+    inflateEnd (_inflater);
+    delete _inflater;
+    _inflater = 0;
+  }
+
+  const String & encoding = _response._content_encoding;
+  if (encoding.length () == 0 || mystrcasecmp (encoding, "identity") == 0)
+    return;
+
+  // The decoder itself is set up with the first bytes of the body,
+  // as 'deflate' is sent both with and without the zlib header
+  _inflater = new z_stream;
+  memset (_inflater, 0, sizeof (z_stream));
+#endif
+}
+
+
+void
+HtHTTP::AppendBody (const char *buffer, int length)
+{
+  if (!_inflater)
+  {
+    if (length > _max_document_size - _response._contents.length ())
+      length = _max_document_size - _response._contents.length ();
+    if (length > 0)
+      _response._contents.append (buffer, length);
+    return;
+  }
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  if (_inflater_done)
+    return;
+
+  if (_encoded_length == 0)
+  {
+    // gzip, or deflate with or without its zlib header
+    int window = 15 + 32;
+    if (mystrcasecmp (_response._content_encoding, "deflate") == 0
+        && (length < 2
+            || (buffer[0] & 0x0f) != Z_DEFLATED
+            || (((unsigned char) buffer[0] << 8)
+                | (unsigned char) buffer[1]) % 31 != 0))
+      window = -15;
+
+    if (inflateInit2 (_inflater, window) != Z_OK)
+    {
+      if (debug > 0)
+        cout << "Unable to decode the body: " << _inflater->msg << endl;
+      _inflater_done = true;
+      return;
+    }
+  }
+
+  _encoded_length += length;
+
+  char out[8192];
+  _inflater->next_in = (Bytef *) buffer;
+  _inflater->avail_in = length;
+
+  while (_response._contents.length () < _max_document_size)
+  {
+    _inflater->next_out = (Bytef *) out;
+    _inflater->avail_out = sizeof (out);
+
+    int status = inflate (_inflater, Z_NO_FLUSH);
+    if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+    {
+      if (debug > 0)
+        cout << "Error while decoding the body: "
+          << (_inflater->msg ? _inflater->msg : "corrupt data") << endl;
+      _inflater_done = true;
+      break;
+    }
+
+    int decoded = sizeof (out) - _inflater->avail_out;
+    if (decoded > _max_document_size - _response._contents.length ())
+      decoded = _max_document_size - _response._contents.length ();
+    _response._contents.append (out, decoded);
+
+    if (status == Z_STREAM_END)
+    {
+      _inflater_done = true;
+      break;
+    }
+
+    // Everything we were given has been decoded
+    if (status == Z_BUF_ERROR
+        || (_inflater->avail_in == 0 && _inflater->avail_out != 0))
+      break;
+  }
+#endif
+}
+
+
+void
+HtHTTP::FinishDecoding ()
+{
+  if (!_inflater)
+    return;
+
+  int decoded = _response._contents.length ();
+
+  _tot_encoded_bytes += _encoded_length;
+  _tot_decoded_bytes += decoded;
+
+  if (debug > 4)
+    cout << "Decoded " << _encoded_length << " " <<
+      _response._content_encoding << " bytes to " << decoded << endl;
+
+  // From now on the lengths are those of the decoded document. As long
+  // as the stream has not been completely decoded its length is unknown.
+  _response._document_length = decoded;
+  if (_inflater_done && decoded < _max_document_size)
+    _response._content_length = decoded;
+  else
+    _response._content_length = -1;
+
+#if defined(HAVE_LIBZ) && defined(HAVE_ZLIB_H)
+  inflateEnd (_inflater);
+  delete _inflater;
+#endif
+  _inflater = 0;
+}
+
+
 ///////
    //    Show the statistics
 ///////
@@ -1115,5 +1540,16 @@ ostream & HtHTTP::ShowStatistics (ostream & out)
   out << " HTTP Average speed        : " << GetAverageSpeed () / 1024
     << " KBytes/secs" << endl;
 
+  if (GetTotPipelined () > 0)
+    out << " HTTP Pipelined requests   : " << GetTotPipelined () << endl;
+
+  if (GetTotEncodedBytes () > 0)
+  {
+    out << " HTTP Encoded KBytes       : " << GetTotEncodedBytes () /
+      1024 << endl;
+    out << " HTTP Decoded KBytes       : " << GetTotDecodedBytes () /
+      1024 << endl;
+  }
+
   return out;
 }
@@ -22,6 +22,9 @@
 //
 // Now cookies management is enabled.
 //
+// Bodies sent with a gzip or deflate Content-Encoding are decoded
+// while they are read.
+//
 ///////
 //
 // Part of the ht://Dig package   <http://www.htdig.org/>
@@ -48,6 +51,7 @@
 
 #include "URL.h"
 #include "htString.h"
+#include "StringList.h"
 
 // for HtHTTP::ShowStatistics#ifdef HAVE_STD
 #ifdef HAVE_STD
@@ -62,6 +66,7 @@ using namespace std;
 // In advance declarations
 
 class HtHTTP;
+struct z_stream_s;
 
 
 class HtHTTP_Response:public Transport_Response
@@ -115,6 +120,18 @@ public:
     return _content_language;
   }
 
+  // Get the Content-encoding
+  const String & GetContentEncoding () const
+  {
+    return _content_encoding;
+  }
+
+  // Get the entity tag
+  const String & GetETag () const
+  {
+    return _etag;
+  }
+
 
 protected:
 
@@ -128,6 +145,8 @@ protected:
   String _server;               // Server string returned
   String _hdrconnection;        // Connection header
   String _content_language;     // Content-language
+  String _content_encoding;     // Content-encoding
+  String _etag;                 // ETag
 
 };
 
@@ -213,6 +232,12 @@ public:
     return _referer;
   }
 
+  // Set the entity tag of the copy we own, for If-None-Match
+  void SetRequestETag (const String & etag)
+  {
+    _request_etag = etag;
+  }
+
   // Set and get the accept-language string
   void SetAcceptLanguage (const String & al)
   {
@@ -234,6 +259,25 @@ public:
     return _user_agent;
   }
 
+  // Requests expected to follow the current one. On a persistent
+  // connection they are sent ahead of their turn (pipelined), so that
+  // the server can answer them without waiting for us. A response is
+  // only used if the request then made is exactly the one sent.
+  void ClearNextRequests ()
+  {
+    _next_requests.Destroy ();
+  }
+  void AddNextRequest (const URL & url, const URL & referer,
+                       HtDateTime & modtime, const String & etag);
+
+  // Did the server answer a pipelined request with something that
+  // could not be parsed as an HTTP response, or drop the connection
+  // before answering any?
+  bool PipelineFailed () const
+  {
+    return _pipeline_failed;
+  }
+
   // Set (Basic) Authentication Credentials
   virtual void SetCredentials (const String & s);
 
@@ -358,11 +402,31 @@ public:
     return _tot_bytes ? (((double) _tot_bytes) / _tot_seconds) : 0;
   }
 
+  // Bytes of encoded bodies as received and once decoded
+  static double GetTotEncodedBytes ()
+  {
+    return _tot_encoded_bytes;
+  }
+
+  static double GetTotDecodedBytes ()
+  {
+    return _tot_decoded_bytes;
+  }
+
+  // Requests whose response was read from the pipeline
+  static int GetTotPipelined ()
+  {
+    return _tot_pipelined;
+  }
+
   static void ResetStatistics ()
   {
     _tot_seconds = 0;
     _tot_requests = 0;
     _tot_bytes = 0;
+    _tot_encoded_bytes = 0;
+    _tot_decoded_bytes = 0;
+    _tot_pipelined = 0;
   }
 
   // Show stats
@@ -391,6 +455,26 @@ public:
   }
 
 
+///////
+  //    Set the _accept_compression option: ask for gzip or deflate
+  //    encoded bodies (only honoured when built with zlib)
+///////
+
+  static void EnableCompression ()
+  {
+    _accept_compression = true;
+  }
+  static void DisableCompression ()
+  {
+    _accept_compression = false;
+  }
+
+  static bool AcceptCompression ()
+  {
+    return _accept_compression;
+  }
+
+
 ///////
   //    Set the controller for the parsing check. That is to say
   //    that External function that checks if a document is parsable or not.
@@ -418,6 +502,7 @@ protected:
   int _bytes_read;              // Bytes read
   URL _url;                     // URL to retrieve
   URL _referer;                 // Referring URL
+  String _request_etag;         // Entity tag of the copy we own
 
   String _accept_language;      // accept-language directive
 
@@ -463,6 +548,31 @@ protected:
 
   static bool _head_before_get;
 
+  ///////
+  //    Option that, if set to true, asks for compressed bodies
+  ///////
+
+  static bool _accept_compression;
+
+  ///////
+  //    Decoder of the current body (0 if it is not encoded)
+  ///////
+
+  struct z_stream_s *_inflater;
+  bool _inflater_done;          // End of the stream (or an error) reached
+  int _encoded_length;          // Encoded bytes fed to the decoder
+
+  ///////
+  //    Pipelining: requests that may follow the current one, and
+  //    those already sent whose responses are still to be read
+  ///////
+
+  StringList _next_requests;
+  StringList _pipelined;
+  bool _response_pipelined;     // The current request was one of them
+  bool _pipeline_answered;      // One of them was answered on this connection
+  bool _pipeline_failed;        // A pipelined response was unreadable
+
 ///////
   //    Manager of the body reading
 ///////
@@ -529,6 +639,24 @@ protected:
   int ReadBody ();
   int ReadChunkedBody ();       // Read the body of a chunked encoded-response
 
+  ///////
+  //    Pipelining: send the next requests not yet sent, or forget
+  //    those whose responses will no longer be read
+  ///////
+
+  void SendNextRequests ();
+  void DropPipeline ();
+
+  ///////
+  //    Content-encoding of the body: decoded as it is appended to the
+  //    contents, which never grow beyond _max_document_size
+  ///////
+
+  static bool CanDecode (const String & encoding);
+  void StartDecoding ();
+  void AppendBody (const char *buffer, int length);
+  void FinishDecoding ();
+
 
   // Finish the request and return a DocStatus value;
 
@@ -545,6 +673,9 @@ protected:
   static int _tot_seconds;      // Requests last (in seconds)
   static int _tot_requests;     // Number of requests
   static int _tot_bytes;        // Number of bytes read
+  static double _tot_encoded_bytes;     // Encoded body bytes read
+  static double _tot_decoded_bytes;     // ... and what they decoded to
+  static int _tot_pipelined;    // Responses read from the pipeline
 
   // This is a pointer to function that check if a ContentType
   // is parsable or less.
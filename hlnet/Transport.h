@@ -63,6 +63,13 @@ public:
     return _contents;
   }
 
+  // Hand the contents over to s without copying them
+  // (s gets the old buffer back, to be reused for the next response)
+  void SwapContents (String & s)
+  {
+    _contents.swap (s);
+  }
+
   // Get the modification time object pointer
   virtual HtDateTime *GetModificationTime () const
   {
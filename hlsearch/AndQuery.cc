@@ -107,7 +107,7 @@ ResultList *
 AndQuery::Intersection (const ResultList & shorter, const List & lists)
 {
   ResultList *result = 0;
-  DictionaryCursor c;
+  HtHashCursor c;
   shorter.Start_Get (c);
   DocMatch *match = (DocMatch *) shorter.Get_NextElement (c);
   while (match)
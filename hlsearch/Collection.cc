@@ -36,6 +36,7 @@ using namespace std;
 
 #include <stdio.h>
 #include <ctype.h>
+#include <sys/stat.h>
 
 #ifndef _MSC_VER                /* _WIN32 */
 #include <syslog.h>
@@ -57,10 +58,22 @@ Collection::Collection (const char *name, const char *word_file,
   matches = NULL;
   searchWords = NULL;
   searchWordsPattern = NULL;
+  words = NULL;
+  generation = NULL;
   isopen = 0;
+  stamp = filesStamp ();
 }
 
 Collection::~Collection ()
+{
+  Reset ();
+  Close ();
+  if (generation)
+    delete generation;
+}
+
+void
+Collection::Reset ()
 {
   if (matches)
     delete matches;
@@ -68,7 +81,9 @@ Collection::~Collection ()
     delete searchWords;
   if (searchWordsPattern)
     delete searchWordsPattern;
-  Close ();
+  matches = NULL;
+  searchWords = NULL;
+  searchWordsPattern = NULL;
 }
 
 void
@@ -89,6 +104,70 @@ Collection::Close ()
     docDB.Close ();
   }
   isopen = 0;
+  CloseWordList ();
+}
+
+void
+Collection::CloseWordList ()
+{
+  if (words)
+  {
+    words->Close ();
+    delete words;
+    words = NULL;
+  }
+}
+
+//*****************************************************************************
+// int Collection::Changed()
+//   True when the database files were rebuilt or written to since the
+//   collection was created, so that what it keeps open is stale.
+//
+int
+Collection::Changed ()
+{
+  return filesStamp () != stamp;
+}
+
+//*****************************************************************************
+// String Collection::filesStamp()
+//   Inode, size and modification time of each database file, including
+//   the side files of a compressed word database.
+//
+String
+Collection::filesStamp ()
+{
+  String stamp;
+  String word_extent = wordFile;
+  word_extent << "_extent";
+  String word_weakcmpr = wordFile;
+  word_weakcmpr << "_weakcmpr";
+  const char *files[] = {
+    wordFile.get (), word_extent.get (), word_weakcmpr.get (),
+    indexFile.get (), docFile.get (), docExcerpt.get (), 0
+  };
+
+  for (int i = 0; files[i]; i++)
+  {
+    struct stat st;
+    if (stat (files[i], &st) < 0)
+      stamp << "- ";
+    else
+      stamp << (long) st.st_ino << ':' << (long) st.st_size
+        << ':' << (long) st.st_mtime << ' ';
+  }
+  return stamp;
+}
+
+HtWordList *
+Collection::getWordList ()
+{
+  if (!words)
+  {
+    words = new HtWordList (*(HtConfiguration::config ()));
+    words->Open (wordFile, O_RDONLY);
+  }
+  return words;
 }
 
 DocumentRef *
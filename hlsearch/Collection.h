@@ -24,6 +24,8 @@
 #include "DocumentDB.h"
 #include "Database.h"
 #include "Dictionary.h"
+#include "HtWordList.h"
+#include "HtGeneration.h"
 
 class Collection:public Object
 {
@@ -40,10 +42,18 @@ public:
 
   void Close ();
 
+  //
+  // Drop the results of the previous query but keep the databases open,
+  // so the collection can be reused by the next query.
+  //
+  void Reset ();
+
   char *getWordFile ()
   {
     return wordFile.get ();
   }
+  HtWordList *getWordList ();
+  void CloseWordList ();
   DocumentRef *getDocumentRef (int id);
   ResultList *getResultList ()
   {
@@ -72,9 +82,30 @@ public:
     searchWordsPattern = smatch;
   }
 
+  //
+  // The database generation the collection was opened on, if any.  The
+  // collection owns it and releases it when deleted.
+  //
+  HtGeneration *getGeneration ()
+  {
+    return generation;
+  }
+  void setGeneration (HtGeneration * g)
+  {
+    generation = g;
+  }
+
   int ReadExcerpt (DocumentRef & ref);
 
+  //
+  // True when the database files were rebuilt or written to since the
+  // collection was created.
+  //
+  int Changed ();
+
 protected:
+  String filesStamp ();
+
   String collectionName;
   String wordFile;
   String indexFile;
@@ -85,6 +116,9 @@ protected:
   StringMatch *searchWordsPattern;
 
   DocumentDB docDB;
+  HtWordList *words;
+  HtGeneration *generation;
+  String stamp;                 // filesStamp() when created
   // Database         *docIndex;     
 
   int isopen;
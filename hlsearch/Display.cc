@@ -82,6 +82,7 @@ Display::Display (Dictionary * collections)
   maxStars = config->Value ("max_stars");
   maxScore = -DBL_MAX;
   minScore = DBL_MAX;
+  sortLimit = 0;
   setupImages ();
   setupTemplates ();
 
@@ -144,7 +145,6 @@ Display::display (int pageNumber)
     return;
   }
 
-  List *matches = buildMatchList ();
   int currentMatch = 0;
   int numberDisplayed = 0;
   ResultMatch *match = 0;
@@ -154,6 +154,11 @@ Display::display (int pageNumber)
     number = 10;
   int startAt = (pageNumber - 1) * number;
 
+  // Matches after the current page are counted but never shown.
+  if (startAt >= 0)
+    sortLimit = startAt + number;
+  List *matches = buildMatchList ();
+
   if (config->Boolean ("logging"))
   {
     logSearch (pageNumber, matches);
@@ -1227,7 +1232,7 @@ List *
 Display::buildMatchList ()
 {
   HtConfiguration *config = HtConfiguration::config ();
-  char *cpid;
+  int id;
   String url;
   ResultMatch *thisMatch;
   SplitMatches matches (*config);
@@ -1493,13 +1498,11 @@ Display::buildMatchList ()
       continue;
 
     results->Start_Get ();
-    while ((cpid = results->Get_Next ()))
+    while (results->Get_Next (id))
     {
-      int id = atoi (cpid);
-
       // DocumentRef *thisRef = docDB[id];
 
-      DocMatch *dm = results->find (cpid);
+      DocMatch *dm = results->find (id);
       Collection *collection = NULL;
       if (dm)
         collection = dm->collection;
@@ -1546,7 +1549,7 @@ Display::buildMatchList ()
       // so this still needs to be done.
       //
 
-      // Moved up: DocMatch  *dm = results->find(cpid);
+      // Moved up: DocMatch  *dm = results->find(id);
       double score = dm->score;
 
       // We need to scale based on date relevance and backlinks
@@ -1913,6 +1916,64 @@ String
   return result;
 }
 
+//
+// Sort entries remember the position of each match in the unsorted list,
+// so that matches comparing equal always come out in the same order,
+// whichever part of the list is sorted.
+//
+struct SortEntry
+{
+  ResultMatch *match;           // must be first: passed to the sort function
+  int position;
+};
+
+static ResultMatch::CmpFun sort_function;
+
+static int
+compare_entries (const void *a, const void *b)
+{
+  int result = sort_function (a, b);
+  if (result == 0)
+    result = ((const SortEntry *) a)->position
+      - ((const SortEntry *) b)->position;
+  return result;
+}
+
+//
+// Partition array so that its first k entries are the k smallest
+// (quickselect).
+//
+static void
+select_entries (SortEntry * array, int n, int k)
+{
+  int left = 0, right = n - 1;
+
+  while (left < right)
+  {
+    SortEntry pivot = array[left + (right - left) / 2];
+    int i = left, j = right;
+    while (i <= j)
+    {
+      while (compare_entries (&array[i], &pivot) < 0)
+        i++;
+      while (compare_entries (&array[j], &pivot) > 0)
+        j--;
+      if (i <= j)
+      {
+        SortEntry t = array[i];
+        array[i++] = array[j];
+        array[j--] = t;
+      }
+    }
+    if (k <= j)
+      right = j;
+    else if (k >= i)
+      left = i;
+    else
+      break;
+  }
+}
+
 //*****************************************************************************
 void
 Display::sort (List * matches)
@@ -1924,26 +1985,51 @@ Display::sort (List * matches)
   if (numberOfMatches <= 1)
     return;
 
-  ResultMatch **array = new ResultMatch *[numberOfMatches];
-  for (i = 0; i < numberOfMatches; i++)
+  SortEntry *array = new SortEntry[numberOfMatches];
+  ResultMatch *match;
+  i = 0;
+  matches->Start_Get ();
+  while ((match = (ResultMatch *) matches->Get_Next ()))
   {
-    array[i] = (ResultMatch *) (*matches)[i];
+    array[i].match = match;
+    array[i].position = i;
+    i++;
   }
   matches->Release ();
 
-  qsort ((char *) array, numberOfMatches, sizeof (ResultMatch *),
-         array[0]->getSortFun ());
-
+  sort_function = array[0].match->getSortFun ();
   const String st = config->Find ("sort");
-  if (!st.empty () && mystrncasecmp ("rev", st, 3) == 0)
+  int reverse = !st.empty () && mystrncasecmp ("rev", st, 3) == 0;
+
+  //
+  // When only the first sortLimit matches will be shown, move them to
+  // the front (or, reversed, to the back) of the array and sort just
+  // those.  The rest stay unordered behind them.
+  //
+  SortEntry *sorted = array;
+  int sortCount = numberOfMatches;
+  if (sortLimit > 0 && sortLimit < numberOfMatches)
+  {
+    sortCount = sortLimit;
+    if (reverse)
+    {
+      sorted = array + numberOfMatches - sortLimit;
+      select_entries (array, numberOfMatches, numberOfMatches - sortLimit);
+    }
+    else
+      select_entries (array, numberOfMatches, sortLimit);
+  }
+  qsort ((char *) sorted, sortCount, sizeof (SortEntry), compare_entries);
+
+  if (reverse)
   {
     for (i = numberOfMatches; --i >= 0;)
-      matches->Add (array[i]);
+      matches->Add (array[i].match);
   }
   else
   {
     for (i = 0; i < numberOfMatches; i++)
-      matches->Add (array[i]);
+      matches->Add (array[i].match);
   }
   delete[]array;
 }
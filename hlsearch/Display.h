@@ -139,6 +139,12 @@ protected:
   double maxScore;
   double minScore;
 
+  //
+  // Only the first sortLimit matches of each list need to be in order
+  // (0 means sort everything).
+  //
+  int sortLimit;
+
   //
   // For display, we have different versions of the list of words.
   //
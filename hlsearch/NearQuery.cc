@@ -72,7 +72,7 @@ ResultList *
 NearQuery::Near (const ResultList & l, const ResultList & r)
 {
   ResultList *result = 0;
-  DictionaryCursor c;
+  HtHashCursor c;
   l.Start_Get (c);
   DocMatch *match = (DocMatch *) l.Get_NextElement (c);
   while (match)
@@ -79,7 +79,7 @@ ResultList *
 NotQuery::Subtract (const ResultList & positive, const List & negatives)
 {
   ResultList *result = 0;
-  DictionaryCursor pc;
+  HtHashCursor pc;
   positive.Start_Get (pc);
   DocMatch *match = (DocMatch *) positive.Get_NextElement (pc);
   while (match)
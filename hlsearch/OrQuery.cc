@@ -103,7 +103,7 @@ OrQuery::Union (const ResultList & longer, const List & lists)
   ResultList *current = (ResultList *) lists.Get_Next (lc);
   while (current)
   {
-    DictionaryCursor c;
+    HtHashCursor c;
     current->Start_Get (c);
     DocMatch *match = (DocMatch *) current->Get_NextElement (c);
     while (match)
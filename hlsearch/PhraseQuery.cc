@@ -98,7 +98,7 @@ ResultList *
 PhraseQuery::Near (const ResultList & l, const ResultList & r)
 {
   ResultList *result = 0;
-  DictionaryCursor c;
+  HtHashCursor c;
   l.Start_Get (c);
   DocMatch *match = (DocMatch *) l.Get_NextElement (c);
   while (match)
@@ -44,9 +44,7 @@ ResultList::~ResultList ()
 void
 ResultList::add (DocMatch * dm)
 {
-  String t;
-  t << dm->GetId ();
-  Add (t, dm);
+  Add (dm->GetId (), dm);
 }
 
 
@@ -54,17 +52,6 @@ ResultList::add (DocMatch * dm)
 //
 DocMatch *
 ResultList::find (int id) const
-{
-  String t;
-  t << id;
-  return (DocMatch *) Find (t);
-}
-
-
-//*****************************************************************************
-//
-DocMatch *
-ResultList::find (char *id) const
 {
   return (DocMatch *) Find (id);
 }
@@ -75,9 +62,7 @@ ResultList::find (char *id) const
 void
 ResultList::remove (int id)
 {
-  String t;
-  t << id;
-  Remove (t);
+  Remove (id);
 }
 
 
@@ -86,9 +71,7 @@ ResultList::remove (int id)
 int
 ResultList::exists (int id) const
 {
-  String t;
-  t << id;
-  return Exists (t);
+  return Exists (id);
 }
 
 
@@ -98,12 +81,13 @@ HtVector *
 ResultList::elements ()
 {
   HtVector *list = new HtVector (Count () + 1);
-  char *id;
+  HtHashCursor c;
+  Object *match;
 
-  Start_Get ();
-  while ((id = Get_Next ()))
+  Start_Get (c);
+  while ((match = Get_NextElement (c)))
   {
-    list->Add (Find (id));
+    list->Add (match);
   }
   return list;
 }
@@ -123,7 +107,7 @@ ResultList::SetWeight (double weight)
 
 ResultList::ResultList (const ResultList & other)
 {
-  DictionaryCursor c;
+  HtHashCursor c;
   isIgnore = other.isIgnore;
   other.Start_Get (c);
   DocMatch *match = (DocMatch *) other.Get_NextElement (c);
@@ -139,7 +123,7 @@ ResultList::Dump () const
 {
   cerr << "ResultList {" << endl;
   cerr << "Ignore: " << isIgnore << " Count: " << Count () << endl;
-  DictionaryCursor c;
+  HtHashCursor c;
   Start_Get (c);
   DocMatch *match = (DocMatch *) Get_NextElement (c);
   while (match)
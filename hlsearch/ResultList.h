@@ -1,7 +1,7 @@
 //
 // ResultList.h
 //
-// ResultList: A Dictionary indexed on the document id that holds
+// ResultList: A hash table indexed on the document id that holds
 //             documents found for a search.
 //
 // Part of the ht://Dig package   <http://www.htdig.org/>
@@ -16,11 +16,11 @@
 #ifndef _ResultList_h_
 #define _ResultList_h_
 
-#include "Dictionary.h"
+#include "HtHash.h"
 #include "DocMatch.h"
 #include "HtVector.h"
 
-class ResultList:public Dictionary
+class ResultList:public HtIntHash
 {
 public:
   ResultList ();
@@ -30,7 +30,6 @@ public:
   void add (DocMatch *);
   void remove (int id);
   DocMatch *find (int id) const;
-  DocMatch *find (char *id) const;
   int exists (int id) const;
 
   HtVector *elements ();
@@ -0,0 +1,354 @@
+//
+// SearchServer.cc
+//
+// SearchServer: Runs hlsearch as a long-lived local HTTP server.  A fixed
+//               number of pre-forked workers accept connections on one
+//               listening socket (UNIX domain or TCP) and serve one query
+//               per connection, keeping their collections, word databases
+//               and fuzzy indexes open between queries.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifdef HAVE_CONFIG_H
+#include "hlconfig.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "SearchServer.h"
+#include "lib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+
+#ifndef _MSC_VER                /* _WIN32 */
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#ifdef HAVE_STD
+#include <iostream>
+#ifdef HAVE_NAMESPACES
+using namespace std;
+#endif
+#else
+#include <iostream.h>
+#endif /* HAVE_STD */
+
+//
+// Longest request line plus headers we are willing to read.
+//
+#define SEARCH_SERVER_MAX_HEADER 8192
+
+int SearchServer::in_worker = 0;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void
+stop_server (int)
+{
+  stopping = 1;
+}
+
+//*****************************************************************************
+//
+SearchServer::SearchServer ()
+{
+  sock = -1;
+  pids = 0;
+  npids = 0;
+}
+
+//*****************************************************************************
+//
+SearchServer::~SearchServer ()
+{
+  if (sock >= 0)
+    close (sock);
+  if (!in_worker && unix_path.length ())
+    unlink (unix_path.get ());
+  delete[]pids;
+}
+
+//*****************************************************************************
+// int SearchServer::Open(const String &address)
+//
+int
+SearchServer::Open (const String & address)
+{
+  int on = 1;
+
+  if (strchr (address.get (), '/'))
+  {
+    struct sockaddr_un sun;
+
+    if (address.length () >= (int) sizeof (sun.sun_path))
+    {
+      cerr << "hlsearch: socket path too long: " << address << endl;
+      return NOTOK;
+    }
+    memset (&sun, 0, sizeof (sun));
+    sun.sun_family = AF_UNIX;
+    strcpy (sun.sun_path, address.get ());
+    unlink (sun.sun_path);
+
+    if ((sock = socket (AF_UNIX, SOCK_STREAM, 0)) < 0
+        || bind (sock, (struct sockaddr *) &sun, sizeof (sun)) < 0)
+    {
+      perror ("hlsearch: bind");
+      return NOTOK;
+    }
+    unix_path = address;
+  }
+  else
+  {
+    struct sockaddr_in sin;
+    String host = "127.0.0.1";
+    const char *port = address.get ();
+    const char *colon = strrchr (port, ':');
+
+    if (colon)
+    {
+      host = 0;
+      host.append (port, colon - port);
+      port = colon + 1;
+    }
+    memset (&sin, 0, sizeof (sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons (atoi (port));
+    if (atoi (port) <= 0 || inet_aton (host.get (), &sin.sin_addr) == 0)
+    {
+      cerr << "hlsearch: invalid server address: " << address << endl;
+      return NOTOK;
+    }
+
+    if ((sock = socket (AF_INET, SOCK_STREAM, 0)) < 0
+        || setsockopt (sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof (on)) < 0
+        || bind (sock, (struct sockaddr *) &sin, sizeof (sin)) < 0)
+    {
+      perror ("hlsearch: bind");
+      return NOTOK;
+    }
+  }
+
+  if (listen (sock, 128) < 0)
+  {
+    perror ("hlsearch: listen");
+    return NOTOK;
+  }
+  fcntl (sock, F_SETFD, FD_CLOEXEC);
+  return OK;
+}
+
+//*****************************************************************************
+// void SearchServer::Run(SEARCH_HANDLER handler, int workers, int max_requests)
+//   The parent only supervises: it never opens a database, so each worker
+//   builds its own warm state and a crashed or recycled worker takes
+//   nothing down with it.
+//
+void
+SearchServer::Run (SEARCH_HANDLER handler, int workers, int max_requests)
+{
+  int i, status;
+
+  if (workers <= 0)
+    workers = 1;
+  delete[]pids;
+  pids = new int[workers];
+  npids = workers;
+
+  //
+  // Without SA_RESTART, wait() below returns when a signal stops the
+  // server instead of going on waiting for a worker to exit.
+  //
+  struct sigaction action;
+  action.sa_handler = stop_server;
+  sigemptyset (&action.sa_mask);
+  action.sa_flags = 0;
+  sigaction (SIGTERM, &action, NULL);
+  sigaction (SIGINT, &action, NULL);
+  signal (SIGPIPE, SIG_IGN);
+
+  for (i = 0; i < npids; i++)
+    pids[i] = Spawn (handler, max_requests);
+
+  while (!stopping)
+  {
+    pid_t pid = wait (&status);
+    if (pid < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    for (i = 0; i < npids; i++)
+    {
+      if (pids[i] == pid)
+      {
+        pids[i] = stopping ? -1 : Spawn (handler, max_requests);
+        break;
+      }
+    }
+  }
+
+  for (i = 0; i < npids; i++)
+    if (pids[i] > 0)
+      kill (pids[i], SIGTERM);
+  while (wait (&status) > 0 || errno == EINTR)
+    ;
+}
+
+//*****************************************************************************
+// int SearchServer::Spawn(SEARCH_HANDLER handler, int max_requests)
+//
+int
+SearchServer::Spawn (SEARCH_HANDLER handler, int max_requests)
+{
+  pid_t pid = fork ();
+
+  if (pid < 0)
+  {
+    perror ("hlsearch: fork");
+    sleep (1);
+    return -1;
+  }
+  if (pid == 0)
+  {
+    in_worker = 1;
+    signal (SIGTERM, SIG_DFL);
+    signal (SIGINT, SIG_DFL);
+    Serve (handler, max_requests);
+    exit (0);
+  }
+  return pid;
+}
+
+//*****************************************************************************
+// void SearchServer::Serve(SEARCH_HANDLER handler, int max_requests)
+//   Worker loop.  stdin and stdout are pointed at the connection for the
+//   duration of the request, so the handler is the same code that runs
+//   when hlsearch is invoked as a CGI.
+//
+void
+SearchServer::Serve (SEARCH_HANDLER handler, int max_requests)
+{
+  int served = 0;
+  int null_fd = open ("/dev/null", O_RDWR);
+  String method, query, content_length;
+
+  while (max_requests <= 0 || served < max_requests)
+  {
+    int conn = accept (sock, 0, 0);
+    if (conn < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      perror ("hlsearch: accept");
+      exit (1);
+    }
+
+    if (ReadRequest (conn, method, query, content_length) == OK)
+    {
+      setenv ("REQUEST_METHOD", method.get (), 1);
+      setenv ("QUERY_STRING", query.get (), 1);
+      setenv ("CONTENT_LENGTH", content_length.get (), 1);
+
+      dup2 (conn, 0);
+      dup2 (conn, 1);
+      cout << "HTTP/1.0 200 OK\r\nConnection: close\r\n";
+
+      (*handler) ();
+
+      cout.flush ();
+      fflush (stdout);
+      dup2 (null_fd, 0);
+      dup2 (null_fd, 1);
+    }
+    else
+    {
+      static const char bad[] =
+        "HTTP/1.0 400 Bad Request\r\nConnection: close\r\n\r\n";
+      write (conn, bad, sizeof (bad) - 1);
+    }
+    close (conn);
+    served++;
+  }
+}
+
+//*****************************************************************************
+// int SearchServer::ReadRequest(int fd, String &method, String &query,
+//                               String &content_length)
+//   Read the request line and headers one byte at a time, so that a POST
+//   body is left unread on the socket for cgi::init().
+//
+int
+SearchServer::ReadRequest (int fd, String & method, String & query,
+                           String & content_length)
+{
+  String header;
+  char c;
+
+  while (header.length () < SEARCH_SERVER_MAX_HEADER)
+  {
+    int n = read (fd, &c, 1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return NOTOK;
+    header << c;
+    int len = header.length ();
+    if (len >= 2 && header[len - 1] == '\n'
+        && (header[len - 2] == '\n'
+            || (len >= 4 && header[len - 2] == '\r'
+                && header[len - 3] == '\n')))
+      break;
+  }
+
+  // Request line: METHOD SP URI [SP VERSION]
+  const char *s = header.get ();
+  const char *sp = strchr (s, ' ');
+  if (!sp)
+    return NOTOK;
+  method = 0;
+  method.append (s, sp - s);
+  if (strcmp (method.get (), "GET") != 0
+      && strcmp (method.get (), "POST") != 0)
+    return NOTOK;
+
+  const char *uri = sp + 1;
+  const char *end = uri + strcspn (uri, " \r\n");
+  const char *q = (const char *) memchr (uri, '?', end - uri);
+  query = 0;
+  if (q)
+    query.append (q + 1, end - q - 1);
+
+  content_length = 0;
+  const char *cl = header.get ();
+  while ((cl = strchr (cl, '\n')))
+  {
+    cl++;
+    if (mystrncasecmp (cl, "Content-Length:", 15) == 0)
+    {
+      cl += 15;
+      while (*cl == ' ' || *cl == '\t')
+        cl++;
+      content_length.append (cl, strcspn (cl, "\r\n"));
+      break;
+    }
+  }
+  return OK;
+}
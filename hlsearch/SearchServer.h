@@ -0,0 +1,73 @@
+//
+// SearchServer.h
+//
+// SearchServer: Runs hlsearch as a long-lived local HTTP server.  A fixed
+//               number of pre-forked workers accept connections on one
+//               listening socket (UNIX domain or TCP) and serve one query
+//               per connection, keeping their collections, word databases
+//               and fuzzy indexes open between queries.
+//
+// Part of the hl://Dig package <https://solbu.github.io/hldig>
+// Copyright (c) 2017 The hl://Dig Group
+// For copyright details, see the file COPYING in your distribution
+// or the GNU Library General Public License (LGPL) version 2 or later
+// <http://www.gnu.org/copyleft/lgpl.html>
+//
+//  hl://Dig is a fork of ht://Dig <https://sourceforge.net/projects/htdig/>
+//
+
+#ifndef _SearchServer_h_
+#define _SearchServer_h_
+
+#include "Object.h"
+#include "htString.h"
+
+//
+// Called once per request with stdin/stdout connected to the client and
+// REQUEST_METHOD, QUERY_STRING and CONTENT_LENGTH set as for a CGI.
+//
+typedef void (*SEARCH_HANDLER) ();
+
+class SearchServer:public Object
+{
+public:
+  SearchServer ();
+  ~SearchServer ();
+
+  //
+  // Bind the listening socket.  An address containing a '/' is a UNIX
+  // domain socket path, otherwise it is [host:]port (host defaults to
+  // 127.0.0.1).  Returns OK or NOTOK.
+  //
+  int Open (const String & address);
+
+  //
+  // Fork <workers> processes serving requests with <handler>.  A worker
+  // exits after <max_requests> requests (0 means never) and is replaced.
+  // Returns when the server receives SIGTERM or SIGINT.
+  //
+  void Run (SEARCH_HANDLER handler, int workers, int max_requests);
+
+  //
+  // Set while a worker is serving a request.
+  //
+  static int InWorker ()
+  {
+    return in_worker;
+  }
+
+protected:
+  int Spawn (SEARCH_HANDLER handler, int max_requests);
+  void Serve (SEARCH_HANDLER handler, int max_requests);
+  int ReadRequest (int fd, String & method, String & query,
+                   String & content_length);
+
+  int sock;
+  String unix_path;
+  int *pids;
+  int npids;
+
+  static int in_worker;
+};
+
+#endif
@@ -33,11 +33,18 @@
 #include "WordContext.h"
 #include "HtRegex.h"
 #include "Collection.h"
+#include "SearchServer.h"
 #include "messages.h"
 
 #include <time.h>
 #include <ctype.h>
 #include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifndef _MSC_VER                /* _WIN32 */
+#include <sys/wait.h>
+#endif
 
 
 // If we have this, we probably want it.
@@ -51,6 +58,12 @@ typedef void (*SIGNAL_HANDLER) (...);
 
 // ResultList *hlsearch(const String&, List &, Parser *);
 void htsearch (Collection *, List &, Parser *);
+int htsearch_start (Collection *, List &, Parser *, pid_t &);
+void htsearch_finish (Collection *, int, pid_t, String &);
+void search_request (const char *);
+void word_context (const String &, int);
+void serve_request ();
+int run_server (const String &);
 
 void setupWords (char *, List &, int, Parser *, String &);
 void createLogicalWords (List &, String &, String &);
@@ -66,6 +79,14 @@ StringList boolean_keywords;
 
 StringList collectionList;      // List of databases to search on
 
+static String defaultConfigFile = DEFAULT_CONFIG_FILE;
+static int override_config = 0;
+
+// In server mode, collections (and their open databases) and fuzzy
+// indexes are kept between queries, keyed by configuration file name.
+static Dictionary warm_collections;
+static Dictionary warm_algorithms;
+
 // reconised word prefixes (for field-restricted search and per-word fuzzy
 // algorithms) in *descending* alphabetical order.
 // Don't use a dictionary structure, as setup time outweights saving.
@@ -111,26 +132,12 @@ main (int ac, char **av)
 
   int c;
   extern char *optarg;
-  int override_config = 0;
-  // List    searchWords;
-  List *searchWords = NULL;
-  String configFile = DEFAULT_CONFIG_FILE;
-  int pageNumber = 1;
-  HtRegex limit_to;
-  HtRegex exclude_these;
-  String logicalWords;
-  String origPattern;
-  String logicalPattern;
-  // StringMatch    searchWordsPattern;
-  StringMatch *searchWordsPattern = NULL;
-  StringList requiredWords;
-  int i;
-  Dictionary selected_collections;      // Multiple database support
+  String server_address;
 
   //
   // Parse command line arguments
   //
-  while ((c = getopt (ac, av, "c:dv")) != -1)
+  while ((c = getopt (ac, av, "c:dvS:")) != -1)
   {
     switch (c)
     {
@@ -141,7 +148,7 @@ main (int ac, char **av)
       if (!getenv ("REQUEST_METHOD"))
       {
 #endif
-        configFile = optarg;
+        defaultConfigFile = optarg;
         override_config = 1;
 #ifndef ALLOW_INSECURE_CGI_CONFIG
       }
@@ -153,12 +160,19 @@ main (int ac, char **av)
     case 'd':
       debug++;
       break;
+    case 'S':
+      if (!getenv ("REQUEST_METHOD"))
+        server_address = optarg;
+      break;
     case '?':
       usage ();
       break;
     }
   }
 
+  if (server_address.length ())
+    return run_server (server_address);
+
   //
   // The total search can NEVER take more than 5 minutes.
   //
@@ -166,14 +180,41 @@ main (int ac, char **av)
   alarm (5 * 60);
 #endif
 
+  search_request (optind < ac ? av[optind] : "");
+  return 0;
+}
+
+//*****************************************************************************
+// void search_request(const char *query)
+//   Run one query and write the result page to stdout.  The query comes
+//   from the CGI environment, or from <query> when given on the command line.
+//
+void
+search_request (const char *query)
+{
+  // List    searchWords;
+  List *searchWords = NULL;
+  int pageNumber = 1;
+  HtRegex limit_to;
+  HtRegex exclude_these;
+  String logicalWords;
+  String origPattern;
+  String logicalPattern;
+  // StringMatch    searchWordsPattern;
+  StringMatch *searchWordsPattern = NULL;
+  StringList requiredWords;
+  int i;
+  Dictionary selected_collections;      // Multiple database support
+  String configFile = defaultConfigFile;
+
   //
   // Parse the CGI parameters.
   //
-  char none[] = "";
-  cgi input (optind < ac ? av[optind] : none);
+  cgi input (query);
 
   // Multiple databases may be specified for search.
   // Identify all databases specified with the "config=" parameter.
+  collectionList.Destroy ();
   if (input.exists ("config"))
   {
     collectionList.Create (input["config"], " \t\001|");
@@ -186,6 +227,12 @@ main (int ac, char **av)
 
   HtConfiguration *config = HtConfiguration::config ();
 
+  // Collections searched by child processes, collected after the loop.
+  int pending = 0;
+  int *pending_fd = new int[collectionList.Count ()];
+  pid_t *pending_pid = new pid_t[collectionList.Count ()];
+  Collection **pending_collection = new Collection *[collectionList.Count ()];
+
   // Iterate over all specified collections (databases)
   for (int cInd = 0; errorMsg.empty () && cInd < collectionList.Count ();
        cInd++)
@@ -235,8 +282,25 @@ main (int ac, char **av)
     }
     config->Read (configFile);
 
+    // Keep the current generation of the databases until the collection
+    // searching it goes away.
+    HtGeneration *generation = new HtGeneration;
+    if (generation->Use (*config) == NOTOK)
+      reportError (form (_("Unable to use the current database generation")));
+
+    // The server has already sent the status line.
+    if (SearchServer::InWorker ())
+      config->Add ("nph", "false");
+
+    // The databases of a generation don't change once it is committed,
+    // so hlsearch reads them as a snapshot, without locking.  Those
+    // updated in place are only read so if asked to.
+    if (generation->Number () > 0)
+      config->Add ("wordlist_snapshot", "true");
+    Database::SetSnapshot (config->Boolean ("wordlist_snapshot"));
+
     // Initialize htword library (key description + wordtype...)
-    WordContext::Initialize (*config);
+    word_context (configFile, 0);
 
     if (input.exists ("method"))
       config->Add ("match_method", input["method"]);
@@ -395,6 +459,23 @@ main (int ac, char **av)
     }
     // ResultList  *results = htsearch((char*)word_db, searchWords, parser);
 
+    //
+    // A word database that cannot be mapped is read through the cache, as
+    // if wordlist_mmap_size was not set: say so rather than search it
+    // more slowly than configured.
+    //
+    double mmap_size = config->Double ("wordlist_mmap_size", 0);
+    if (mmap_size > 0)
+    {
+      struct stat st;
+      if (config->Boolean ("wordlist_compress"))
+        reportError (_("wordlist_mmap_size is set, but compressed word databases cannot be mapped"));
+      if (stat (word_db, &st) == 0 && (double) st.st_size >= mmap_size)
+        reportError (form
+                     (_("Word database '%s' is larger than wordlist_mmap_size and cannot be mapped"),
+                      word_db.get ()));
+    }
+
     String doc_index = config->Find ("doc_index");
     if (access ((char *) doc_index, R_OK) < 0)
     {
@@ -420,14 +501,58 @@ main (int ac, char **av)
     }
 
     // Multiple database support
-    Collection *collection = new Collection ((char *) configFile,
-                                             word_db.get (), doc_index.get (),
-                                             doc_db.get (),
-                                             doc_excerpt.get ());
+    Collection *collection =
+      (Collection *) warm_collections.Find (configFile);
+    if (collection
+        && (collection->getGeneration ()->Number () != generation->Number ()
+            || collection->Changed ())
+        && !selected_collections.Exists (configFile))
+    {
+      // A new generation was committed, or the databases were rebuilt
+      // in place: the next query uses them.  Pages of the old word
+      // database may still be in the cache, which goes with the word
+      // context.
+      warm_collections.Remove (configFile);
+      collection = NULL;
+      word_context (configFile, 1);
+    }
+    if (collection)
+    {
+      collection->Reset ();
+      delete generation;
+    }
+    else
+    {
+      collection = new Collection ((char *) configFile,
+                                   word_db.get (), doc_index.get (),
+                                   doc_db.get (), doc_excerpt.get ());
+      collection->setGeneration (generation);
+      if (SearchServer::InWorker ())
+        warm_collections.Add (configFile, collection);
+    }
 
     // Perform search within the collection. Each collection stores its
-    // own result list.
-    htsearch (collection, *searchWords, parser);
+    // own result list.  With several collections, each one is searched
+    // by its own child process while the next one is being set up.
+    // Server workers stay in-process to keep their databases warm.
+    int fd = -1;
+    pid_t pid = 0;
+    if (collectionList.Count () > 1 && !SearchServer::InWorker ()
+        && config->Boolean ("search_parallel_collections")
+        && !config->Boolean ("wordlist_env_share"))
+      fd = htsearch_start (collection, *searchWords, parser, pid);
+    if (fd >= 0)
+    {
+      pending_fd[pending] = fd;
+      pending_pid[pending] = pid;
+      pending_collection[pending++] = collection;
+    }
+    else
+    {
+      htsearch (collection, *searchWords, parser);
+      if (!SearchServer::InWorker ())
+        collection->CloseWordList ();
+    }
     collection->setSearchWords (searchWords);
     collection->setSearchWordsPattern (searchWordsPattern);
     selected_collections.Add (configFile, collection);
@@ -438,13 +563,20 @@ main (int ac, char **av)
     delete parser;
   }
 
+  for (i = 0; i < pending; i++)
+    htsearch_finish (pending_collection[i], pending_fd[i], pending_pid[i],
+                     errorMsg);
+  delete[]pending_fd;
+  delete[]pending_pid;
+  delete[]pending_collection;
+
   // Display  display(doc_db, 0, doc_excerpt);
   Display display (&selected_collections);
   if (display.hasTemplateError ())
   {
     reportError (form (_("Unable to read template file '%s'\nDoes it exist?"),
                        (const char *) config->Find ("template_name")));
-    return 0;
+    return;
   }
   display.setOriginalWords (originalWords);
   // display.setResults(results);
@@ -459,8 +591,89 @@ main (int ac, char **av)
   else
     display.display (pageNumber);
 
+  // Warm collections outlive the query.
+  if (SearchServer::InWorker ())
+    selected_collections.Release ();
+
   // delete results;
   // delete parser;
+}
+
+//*****************************************************************************
+// void word_context(const String &configFile, int rebuild)
+//   Set up the word library for configFile, from the configuration just
+//   read.  A server worker keeps it between queries, to keep its word
+//   databases open, and sets it up again only for another configuration
+//   file or snapshot mode, or when <rebuild> is set.  That tears down the database
+//   environment: the word databases the warm collections have open in it
+//   are closed first, and opened again when they are next searched.
+//
+void
+word_context (const String & configFile, int rebuild)
+{
+  static String current;
+
+  // The same configuration may or may not read a snapshot
+  String key = configFile;
+  if (HtConfiguration::config ()->Boolean ("wordlist_snapshot"))
+    key << " (snapshot)";
+
+  if (SearchServer::InWorker () && !rebuild && key == current)
+    return;
+
+  Collection *collection;
+  warm_collections.Start_Get ();
+  while ((collection = (Collection *) warm_collections.Get_NextElement ()))
+    collection->CloseWordList ();
+
+  WordContext::Initialize (*HtConfiguration::config ());
+  current = key;
+}
+
+//*****************************************************************************
+// void serve_request()
+//   Request handler for server mode: the CGI environment and stdin/stdout
+//   have been set up by SearchServer.
+//
+void
+serve_request ()
+{
+#ifndef _MSC_VER                /* _WIN32 */
+  alarm (5 * 60);
+#endif
+  search_request ("");
+#ifndef _MSC_VER                /* _WIN32 */
+  alarm (0);
+#endif
+}
+
+//*****************************************************************************
+// int run_server(const String &address)
+//   Serve queries from a pool of long-lived worker processes instead of
+//   exiting after one query.
+//
+int
+run_server (const String & address)
+{
+  HtConfiguration *config = HtConfiguration::config ();
+  SearchServer server;
+
+  config->Defaults (&defaults[0]);
+  if (access ((char *) defaultConfigFile, R_OK) < 0)
+  {
+    cerr << form (_("Unable to read configuration file")) << ": "
+      << defaultConfigFile << endl;
+    return 1;
+  }
+  config->Read (defaultConfigFile);
+
+  if (server.Open (address) == NOTOK)
+    return 1;
+  if (debug)
+    cerr << "hlsearch: serving on " << address << endl;
+
+  server.Run (serve_request, config->Value ("search_server_workers", 4),
+              config->Value ("search_server_max_requests", 0));
   return 0;
 }
 
@@ -702,36 +915,51 @@ setupWords (char *allWords, List & searchWords, int boolean, Parser * parser,
   // For algorithms other than exact, we need to also do word lookups.
   //
   StringList algs (config->Find ("search_algorithm"), " \t");
-  List algorithms;
   String name, weight;
   double fweight;
   Fuzzy *fuzzy = 0;
 
   //
-  // Generate the list of algorithms to use and associate the given
-  // weights with them.
+  // In server mode the algorithms, with their fuzzy indexes open, are
+  // reused by later queries with the same configuration.
   //
-  for (i = 0; i < algs.Count (); i++)
-  {
-    name = strtok (algs[i], ":");
-    weight = strtok (0, ":");
-    if (name.length () == 0)
-      name = "exact";
-    if (weight.length () == 0)
-      weight = "1";
-    fweight = atof ((char *) weight);
-
-    fuzzy = Fuzzy::getFuzzyByName (name, *config);
-    if (fuzzy)
+  String algorithms_key = config->getFileName ();
+  algorithms_key << '\001' << config->Find ("search_algorithm");
+  List *algorithms = (List *) warm_algorithms.Find (algorithms_key);
+
+  if (!algorithms)
+  {
+    algorithms = new List;
+
+    //
+    // Generate the list of algorithms to use and associate the given
+    // weights with them.
+    //
+    for (i = 0; i < algs.Count (); i++)
     {
-      if (debug > 1)
-        cerr << "Adding algorithm " << name.get () << endl;
-      fuzzy->setWeight (fweight);
-      fuzzy->openIndex ();
-      algorithms.Add (fuzzy);
+      name = strtok (algs[i], ":");
+      weight = strtok (0, ":");
+      if (name.length () == 0)
+        name = "exact";
+      if (weight.length () == 0)
+        weight = "1";
+      fweight = atof ((char *) weight);
+
+      fuzzy = Fuzzy::getFuzzyByName (name, *config);
+      if (fuzzy)
+      {
+        if (debug > 1)
+          cerr << "Adding algorithm " << name.get () << endl;
+        fuzzy->setWeight (fweight);
+        fuzzy->openIndex ();
+        algorithms->Add (fuzzy);
+      }
+      else if (debug)
+        cerr << "Unknown fuzzy search algorithm " << name.get () << endl;
     }
-    else if (debug)
-      cerr << "Unknown fuzzy search algorithm " << name.get () << endl;
+
+    if (SearchServer::InWorker ())
+      warm_algorithms.Add (algorithms_key, algorithms);
   }
 
   dumpWords (searchWords, "initial");
@@ -752,7 +980,7 @@ setupWords (char *allWords, List & searchWords, int boolean, Parser * parser,
       //
       if (debug)
         cerr << "Fuzzy on: " << ww->word << endl;
-      doFuzzy (ww, searchWords, algorithms);
+      doFuzzy (ww, searchWords, *algorithms);
       delete ww;
     }
     else if (ww->word.length () == 1 && ww->word[0] == '"')
@@ -775,6 +1003,8 @@ setupWords (char *allWords, List & searchWords, int boolean, Parser * parser,
     dumpWords (searchWords, "searchWords");
   }
   tempWords.Release ();
+  if (!SearchServer::InWorker ())
+    delete algorithms;
 }
 
 
@@ -904,6 +1134,181 @@ htsearch (Collection * collection, List & searchWords, Parser * parser)
 }
 
 
+//
+// Record sent back by a child searching one collection.  Display only
+// needs the id, the word score and the anchor of each match.
+//
+struct htsearch_match
+{
+  int id;
+  int anchor;
+  double score;
+};
+
+//
+// Longest error message a child may send back.
+//
+#define HTSEARCH_MAX_ERROR 65536
+
+static int
+write_all (int fd, const void *buf, int len)
+{
+  const char *p = (const char *) buf;
+  while (len > 0)
+  {
+    int n = write (fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return NOTOK;
+    p += n;
+    len -= n;
+  }
+  return OK;
+}
+
+static int
+read_all (int fd, void *buf, int len)
+{
+  char *p = (char *) buf;
+  while (len > 0)
+  {
+    int n = read (fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return NOTOK;
+    p += n;
+    len -= n;
+  }
+  return OK;
+}
+
+//*****************************************************************************
+// int htsearch_start(Collection *collection, List &searchWords, Parser *parser,
+//                     pid_t &pid)
+//   Fork a child that runs htsearch() on the collection and writes the
+//   matches to a pipe.  Returns the read end of the pipe and sets pid to
+//   the child's, or returns -1 if the search could not be started, in
+//   which case the caller searches inline.
+//
+int
+htsearch_start (Collection * collection, List & searchWords, Parser * parser,
+                pid_t & pid)
+{
+  int fds[2];
+
+  if (pipe (fds) < 0)
+    return -1;
+
+  // Nothing buffered may be written twice by the child.
+  cout.flush ();
+  fflush (stdout);
+
+  pid = fork ();
+  if (pid < 0)
+  {
+    close (fds[0]);
+    close (fds[1]);
+    return -1;
+  }
+  if (pid > 0)
+  {
+    close (fds[1]);
+    return fds[0];
+  }
+
+  close (fds[0]);
+  htsearch (collection, searchWords, parser);
+
+  String error;
+  if (parser->hadError ())
+    error = parser->getErrorMessage ();
+  int length = error.length ();
+  ResultList *matches = collection->getResultList ();
+  int count = matches->Count ();
+
+  int status = write_all (fds[1], &length, sizeof (length));
+  if (status == OK)
+    status = write_all (fds[1], error.get (), length);
+  if (status == OK)
+    status = write_all (fds[1], &count, sizeof (count));
+
+  DocMatch *dm;
+  htsearch_match match;
+  matches->Start_Get ();
+  while (status == OK && (dm = (DocMatch *) matches->Get_NextElement ()))
+  {
+    match.id = dm->GetId ();
+    match.anchor = dm->anchor;
+    match.score = dm->score;
+    status = write_all (fds[1], &match, sizeof (match));
+  }
+  _exit (status == OK ? 0 : 1);
+  return -1;
+}
+
+//*****************************************************************************
+// void htsearch_finish(Collection *collection, int fd, pid_t pid,
+//                      String &errorMsg)
+//   Read the matches of a collection searched by htsearch_start() and
+//   rebuild its result list, then reap the child that searched it.  If
+//   the child failed or its reply is cut short, the matches are not all
+//   there: the query fails with errorMsg rather than show them.  It is
+//   not searched again here, as the configuration and the word library
+//   have been set up for another collection since.
+//
+void
+htsearch_finish (Collection * collection, int fd, pid_t pid,
+                 String & errorMsg)
+{
+  ResultList *matches = new ResultList;
+  htsearch_match match;
+  int length = 0, count = 0, status;
+
+  status = read_all (fd, &length, sizeof (length));
+  if (status == OK && (length < 0 || length > HTSEARCH_MAX_ERROR))
+    status = NOTOK;
+  if (status == OK && length > 0)
+  {
+    char *error = new char[length + 1];
+    status = read_all (fd, error, length);
+    error[status == OK ? length : 0] = '\0';
+    if (errorMsg.empty ())
+      errorMsg = error;
+    delete[]error;
+  }
+  if (status == OK)
+    status = read_all (fd, &count, sizeof (count));
+  if (status == OK && count < 0)
+    status = NOTOK;
+  while (status == OK && count-- > 0
+         && (status = read_all (fd, &match, sizeof (match))) == OK)
+  {
+    DocMatch *dm = new DocMatch;
+    dm->SetId (match.id);
+    dm->anchor = match.anchor;
+    dm->score = match.score;
+    dm->collection = collection;
+    matches->add (dm);
+  }
+  close (fd);
+
+  int child_status = 0;
+  pid_t reaped;
+  while ((reaped = waitpid (pid, &child_status, 0)) < 0 && errno == EINTR)
+    ;
+  if (reaped == pid
+      && (!WIFEXITED (child_status) || WEXITSTATUS (child_status) != 0))
+    status = NOTOK;
+
+  if (status != OK && errorMsg.empty ())
+    errorMsg = form (_("Unable to search the word database '%s'"),
+                     collection->getWordFile ());
+  collection->setResultList (matches);
+}
+
+
 //*****************************************************************************
 // Modify the search words list to include the required words as well.
 // This is done by putting the existing search words in parenthesis and
@@ -973,13 +1378,19 @@ usage ()
 {
   Usage help;
   cout << _("usage:");
-  cout << " hlsearch [-v][-d][-c configfile] [query_string]\n";
+  cout << " hlsearch [-v][-d][-c configfile][-S address] [query_string]\n";
   printf (_("This program is part of hl://Dig %s\n\n"), VERSION);
   cout << _("Options:\n");
 
   help.verbose ();
   help.config ();
 
+  cout << _("\
+ -S address\n\
+\tRun as a local HTTP server instead of a CGI, listening on a\n\
+\tUNIX socket path or [host:]port.  Queries are served by\n\
+\tsearch_server_workers processes that keep their databases\n\
+\topen between queries.\n\n");
   cout << _("\
  query_string\n\
 \tA CGI-style query string can be given as a single\n\
@@ -31,9 +31,10 @@ enum ErrorIndices
 { EXPECTED, SEARCH_WORD, AT_END, INSTEAD_OF, END_OF_EXPR, QUOTE };
 
 //*****************************************************************************
-Parser::Parser ():
-words (*(HtConfiguration::config ()))
+Parser::Parser ()
 {
+  words = 0;
+  collection = 0;
   tokens = 0;
   result = 0;
   current = 0;
@@ -408,7 +409,7 @@ Parser::perform_push ()
   if (temp.length () > maximum_word_length)
     p[maximum_word_length] = '\0';
 
-  List *result = words[p];
+  List *result = (*words)[p];
   score (result, current->weight, current->flags);
   delete result;
 }
@@ -457,7 +458,7 @@ Parser::perform_phrase (List * &oldWords)
   if (temp.length () > maximum_word_length)
     p[maximum_word_length] = '\0';
 
-  newWords = words[p];
+  newWords = (*words)[p];
   if (debug)
     cerr << "new words count: " << newWords->Count () << endl;
 
@@ -975,7 +976,6 @@ Parser::parse (List * tokenList, ResultList & resultMatches)
 void
 Parser::setCollection (Collection * coll)
 {
-  if (coll)
-    words.Open (coll->getWordFile (), O_RDONLY);
+  words = coll ? coll->getWordList () : 0;
   collection = coll;
 }
@@ -73,7 +73,7 @@ protected:
   String error;
   Collection *collection;       // Multiple database support
 
-  HtWordList words;
+  HtWordList *words;            // owned by the collection
 };
 
 extern StringList boolean_keywords;
@@ -21,6 +21,7 @@
 #include "WordContext.h"
 #include "HtURLCodec.h"
 #include "HtWordList.h"
+#include "HtGeneration.h"
 #include "HtConfiguration.h"
 #include "DocumentDB.h"
 #include "defaults.h"
@@ -103,6 +104,17 @@ main (int ac, char **av)
                        url_part_errors.get ()));
 
 
+  //
+  // With database generations, load into a copy of the current generation
+  // rather than the .work files, and make it the current one when done.
+  //
+  HtGeneration generation;
+  int generation_number = generation.Create (*config, 0);
+  if (generation_number == NOTOK)
+    reportError (_("Unable to create a new database generation"));
+  if (generation_number > 0)
+    alt_work_area = 0;
+
   // We may need these through the methods we call
   if (alt_work_area != 0)
   {
@@ -163,6 +175,9 @@ main (int ac, char **av)
     }
   }
 
+  if (generation_number > 0 && generation.Commit () != OK)
+    reportError (_("Unable to commit the new database generation"));
+
   return 0;
 }
 
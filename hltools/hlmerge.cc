@@ -25,6 +25,8 @@
 #include "HtURLCodec.h"
 #include "HtWordList.h"
 #include "HtWordReference.h"
+#include "HtGeneration.h"
+#include "HtHash.h"
 #include "htString.h"
 #include "messages.h"
 
@@ -146,6 +148,25 @@ main (int ac, char **av)
     merge_config.Read (merge_configfile);
   }
 
+  //
+  // With database generations, merge into a copy of the current
+  // generation rather than into .work files, from the current generation
+  // of the databases merged.
+  //
+  HtGeneration generation, merge_generation;
+  int generation_number = 0;
+  if (merge_configfile.length ())
+  {
+    generation_number = generation.Create (*config, 0);
+    if (generation_number == NOTOK)
+      reportError (_("Unable to create a new database generation"));
+    if (generation_number > 0)
+      alt_work_area = 0;
+    if (merge_generation.Use (merge_config) == NOTOK)
+      reportError (form (_("Unable to use the database generation of '%s'"),
+                         merge_configfile.get ()));
+  }
+
   if (alt_work_area != 0)
   {
     String configValue;
@@ -188,6 +209,9 @@ main (int ac, char **av)
     // Note: We don't have to specify anything, it's all in the config vars
 
     mergeDB ();
+
+    if (generation_number > 0 && generation.Commit () != OK)
+      reportError (_("Unable to commit the new database generation"));
   }
 
   return 0;
@@ -202,7 +226,7 @@ mergeDB ()
   HtConfiguration *config = HtConfiguration::config ();
   DocumentDB merge_db, db;
   List *urls;
-  Dictionary merge_dup_ids, db_dup_ids; // Lists of DocIds to ignore
+  HtIntHash merge_dup_ids, db_dup_ids;  // Lists of DocIds to ignore
   int docIDOffset;
 
   const String doc_index = config->Find ("doc_index");
@@ -274,9 +298,7 @@ mergeDB ()
       if (old_ref->DocTime () >= ref->DocTime ())
       {
         // Cool, the ref we're merging is too old, just ignore it
-        char str[20];
-        sprintf (str, "%d", ref->DocID ());
-        merge_dup_ids.Add (str, 0);
+        merge_dup_ids.Add (ref->DocID (), 0);
 
         if (verbose > 1)
         {
@@ -288,9 +310,7 @@ mergeDB ()
       else
       {
         // The ref we're merging is newer, delete the old one and add
-        char str[20];
-        sprintf (str, "%d", old_ref->DocID ());
-        db_dup_ids.Add (str, 0);
+        db_dup_ids.Add (old_ref->DocID (), 0);
         db.Delete (old_ref->DocID ());
         ref->DocID (ref->DocID () + docIDOffset);
         db.Add (*ref);
@@ -328,7 +348,6 @@ mergeDB ()
   // OK, after merging the doc DBs, we do the same for the words
   HtWordList mergeWordDB (*config), wordDB (*config);
   List *words;
-  String docIDKey;
 
   if (wordDB.Open (config->Find ("word_db"), O_RDWR) < 0)
   {
@@ -351,8 +370,7 @@ mergeDB ()
   HtWordReference *word;
   while ((word = (HtWordReference *) words->Get_Next ()))
   {
-    docIDKey = word->DocID ();
-    if (merge_dup_ids.Exists (docIDKey))
+    if (merge_dup_ids.Exists (word->DocID ()))
       continue;
 
     word->DocID (word->DocID () + docIDOffset);
@@ -364,8 +382,7 @@ mergeDB ()
   words->Start_Get ();
   while ((word = (HtWordReference *) words->Get_Next ()))
   {
-    docIDKey = word->DocID ();
-    if (db_dup_ids.Exists (docIDKey))
+    if (db_dup_ids.Exists (word->DocID ()))
       wordDB.Delete (*word);
   }
   delete words;
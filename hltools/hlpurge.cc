@@ -26,6 +26,8 @@
 #include "DocumentRef.h"
 #include "defaults.h"
 #include "HtURLCodec.h"
+#include "HtHash.h"
+#include "HtGeneration.h"
 #include "messages.h"
 
 #include <errno.h>
@@ -43,8 +45,8 @@
 
 int verbose = 0;
 
-Dictionary *purgeDocs (Dictionary *);
-void purgeWords (Dictionary *);
+HtIntHash *purgeDocs (HtStringHash *);
+void purgeWords (HtIntHash *);
 void usage ();
 void reportError (const char *msg);
 
@@ -58,8 +60,8 @@ main (int ac, char **av)
   String configfile = DEFAULT_CONFIG_FILE;
   int c;
   extern char *optarg;
-  Dictionary *discard_ids = 0;
-  Dictionary *discard_urls = new Dictionary;
+  HtIntHash *discard_ids = 0;
+  HtStringHash *discard_urls = new HtStringHash;
 
   while ((c = getopt (ac, av, "vc:au:")) != -1)
   {
@@ -103,6 +105,17 @@ main (int ac, char **av)
     reportError (form (_("Invalid url_part_aliases or common_url_parts: %s"),
                        url_part_errors.get ()));
 
+  //
+  // With database generations, purge a copy of the current generation
+  // rather than the .work files, and make it the current one when done.
+  //
+  HtGeneration generation;
+  int generation_number = generation.Create (*config, 0);
+  if (generation_number == NOTOK)
+    reportError (_("Unable to create a new database generation"));
+  if (generation_number > 0)
+    alt_work_area = 0;
+
   if (alt_work_area != 0)
   {
     String configValue;
@@ -161,16 +174,19 @@ main (int ac, char **av)
   delete discard_ids;
   discard_ids = 0;
 
+  if (generation_number > 0 && generation.Commit () != OK)
+    reportError (_("Unable to commit the new database generation"));
+
   return 0;
 }
 
 //*****************************************************************************
-// Dictionary purgeDocs(Dictionary &purgeURLs)
+// HtIntHash *purgeDocs(HtStringHash *purgeURLs)
 // Pass in a hash of the URLs to delete (it could be empty)
 // Return a hash of the IDs deleted from the doc DB
 //
-Dictionary *
-purgeDocs (Dictionary * purgeURLs)
+HtIntHash *
+purgeDocs (HtStringHash * purgeURLs)
 {
   HtConfiguration *config = HtConfiguration::config ();
   const String doc_db = config->Find ("doc_db");
@@ -181,7 +197,7 @@ purgeDocs (Dictionary * purgeURLs)
   DocumentDB db;
   List *IDs;
   int document_count = 0;
-  Dictionary *discard_list = new Dictionary;
+  HtIntHash *discard_list = new HtIntHash;
 
   //
   // Start the conversion by going through all the URLs that are in
@@ -225,7 +241,7 @@ purgeDocs (Dictionary * purgeURLs)
       db.Delete (ref->DocID ());
       if (verbose)
         cout << _("Deleted, noindex: ID: ") << idStr << " URL: " << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else if (ref->DocState () == Reference_obsolete)
     {
@@ -233,7 +249,7 @@ purgeDocs (Dictionary * purgeURLs)
       db.Delete (ref->DocID ());
       if (verbose)
         cout << _("Deleted, obsolete: ID: ") << idStr << " URL: " << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else if (remove_unused && ref->DocState () == Reference_not_found)
     {
@@ -242,7 +258,7 @@ purgeDocs (Dictionary * purgeURLs)
       if (verbose)
         cout << "Deleted, not found: ID: " << idStr << " URL: "
           << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else if (remove_unused && strlen (ref->DocHead ()) == 0
              && ref->DocAccessed () != 0)
@@ -253,7 +269,7 @@ purgeDocs (Dictionary * purgeURLs)
       if (verbose)
         cout << _("Deleted, no excerpt: ID: ") << idStr << " URL:  "
           << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else if (remove_unretrieved && ref->DocAccessed () == 0)
     {
@@ -262,7 +278,7 @@ purgeDocs (Dictionary * purgeURLs)
       if (verbose)
         cout << _("Deleted, never retrieved: ID: ") << idStr << " URL:  "
           << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else if (purgeURLs->Exists (url))
     {
@@ -271,7 +287,7 @@ purgeDocs (Dictionary * purgeURLs)
       if (verbose)
         cout << _("Deleted, marked by user input: ID: ") << idStr << " URL: "
           << url << endl;
-      discard_list->Add (idStr.get (), NULL);
+      discard_list->Add (id->Value (), NULL);
     }
     else
     {
@@ -303,12 +319,12 @@ purgeDocs (Dictionary * purgeURLs)
 class DeleteWordData:public Object
 {
 public:
-  DeleteWordData (const Dictionary & discard_arg):discard (discard_arg)
+  DeleteWordData (const HtIntHash & discard_arg):discard (discard_arg)
   {
     deleted = remains = 0;
   }
 
-  const Dictionary & discard;
+  const HtIntHash & discard;
   int deleted;
   int remains;
 };
@@ -322,12 +338,8 @@ delete_word (WordList * words, WordDBCursor & cursor,
 {
   const HtWordReference *word = (const HtWordReference *) word_arg;
   DeleteWordData & d = (DeleteWordData &) data;
-  static String docIDStr;
-
-  docIDStr = 0;
-  docIDStr << word->DocID ();
 
-  if (d.discard.Exists (docIDStr))
+  if (d.discard.Exists (word->DocID ()))
   {
     if (words->Delete (cursor) != 0)
     {
@@ -356,10 +368,10 @@ delete_word (WordList * words, WordDBCursor & cursor,
 }
 
 //*****************************************************************************
-// void purgeWords(Dictionary *discard_list)
+// void purgeWords(HtIntHash *discard_list)
 //
 void
-purgeWords (Dictionary * discard_list)
+purgeWords (HtIntHash * discard_list)
 {
   HtConfiguration *config = HtConfiguration::config ();
   HtWordList words (*config);
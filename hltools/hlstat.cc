@@ -20,6 +20,7 @@
 #include "HtWordList.h"
 #include "HtConfiguration.h"
 #include "DocumentDB.h"
+#include "HtGeneration.h"
 #include "defaults.h"
 #include "messages.h"
 
@@ -95,6 +96,9 @@ main (int ac, char **av)
     reportError (form (_("Invalid url_part_aliases or common_url_parts: %s"),
                        url_part_errors.get ()));
 
+  HtGeneration generation;
+  if (generation.Use (*config) == NOTOK)
+    reportError (_("Unable to use the current database generation"));
 
   // We may need these through the methods we call
   if (alt_work_area != 0)
@@ -196,7 +196,7 @@ public:
     if ((ret = wordRef.Pack (key, record)) != OK)
       return DB_RUNRECOVERY;
 
-    return Put (0, key, record, flags);
+    return Put (Txn (), key, record, flags);
   }
 
   inline int Del (const WordReference & wordRef)
@@ -205,7 +205,7 @@ public:
 
     wordRef.Key ().Pack (key);
 
-    return Del (0, key);
+    return Del (Txn (), key);
   }
 
   //
@@ -224,7 +224,7 @@ public:
       return DB_RUNRECOVERY;
 
     int ret;
-    if ((ret = Get (0, key, data, 0)) != 0)
+    if ((ret = Get (Txn (), key, data, 0)) != 0)
       return ret;
 
     return wordRef.Unpack (key, data) == OK ? 0 : DB_RUNRECOVERY;
@@ -246,7 +246,7 @@ public:
     if (wordRef.Key ().Pack (key) != OK)
       return DB_RUNRECOVERY;
 
-    return Get (0, key, data, 0);
+    return Get (Txn (), key, data, 0);
   }
 
   //
@@ -262,6 +262,14 @@ public:
     return db->set_pagesize (db, pagesize);
   }
 
+  //
+  // Current transaction, if any; see WordDBInfo::Begin
+  //
+  inline DB_TXN *Txn () const
+  {
+    return WordDBInfo::Instance ()->txn;
+  }
+
   //
   // Accessors for description of the compression scheme
   //
@@ -297,7 +305,7 @@ public:
   inline int Open (DB * db)
   {
     Close ();
-    return db->cursor (db, 0, &cursor, 0);
+    return db->cursor (db, WordDBInfo::Instance ()->txn, &cursor, 0);
   }
 
   inline int Close ()
@@ -17,6 +17,8 @@
 
 #include "db.h"
 #include "WordDBInfo.h"
+#include "WordDBCompress.h"
+#include "Database.h"
 
 //
 // WordDBInfo implementation
@@ -37,6 +39,15 @@ message (const char *errpfx, char *msg)
 WordDBInfo::WordDBInfo (const Configuration & config)
 {
   dbenv = 0;
+  compressor = 0;
+  cmpr_info = 0;
+  txn = 0;
+  transactions = 0;
+  txn_group = config.Value ("wordlist_txn_group", 100);
+  if (txn_group < 1)
+    txn_group = 1;
+  txn_pending = 0;
+  txn_checkpoint = config.Value ("wordlist_txn_checkpoint", 65536);
 
   if (config.Boolean ("wordlist_env_skip"))
     return;
@@ -50,34 +61,176 @@ WordDBInfo::WordDBInfo (const Configuration & config)
   }
   dbenv->set_errpfx (dbenv, "WordDB");
   dbenv->set_errcall (dbenv, message);
-  if (dbenv->set_verbose (dbenv, DB_VERB_CHKPOINT, 1) != 0)
+  //
+  // Checkpoints and recoveries are routine with transactions.
+  //
+  int verbose = config.Value ("wordlist_verbose") > 0;
+  if (dbenv->set_verbose (dbenv, DB_VERB_CHKPOINT, verbose) != 0)
     return;
   if (dbenv->set_verbose (dbenv, DB_VERB_DEADLOCK, 1) != 0)
     return;
-  if (dbenv->set_verbose (dbenv, DB_VERB_RECOVERY, 1) != 0)
+  if (dbenv->set_verbose (dbenv, DB_VERB_RECOVERY, verbose) != 0)
     return;
   if (dbenv->set_verbose (dbenv, DB_VERB_WAITSFOR, 1) != 0)
     return;
   int cache_size = config.Value ("wordlist_cache_size", 10 * 1024 * 1024);
   if (cache_size > 0)
   {
-    if (dbenv->set_cachesize (dbenv, 0, cache_size, 1) != 0)
+    //
+    // Each partition of the cache has its own lock; see NCACHE in
+    // db/mp.h.
+    //
+    int partitions = config.Value ("wordlist_cache_partitions", 1);
+    if (partitions < 1)
+      partitions = 1;
+    if (dbenv->set_cachesize (dbenv, 0, cache_size, partitions) != 0)
+      return;
+  }
+  //
+  // The 2q policy keeps scans from evicting the internal pages of
+  // the tree; see MCACHE in db/mp.h.
+  //
+  const String & policy = config["wordlist_cache_policy"];
+  if (!mystrcasecmp (policy, "2q"))
+  {
+    if (dbenv->set_mp_policy (dbenv, DB_MPOOL_2Q) != 0)
+      return;
+  }
+  else if (!policy.empty () && mystrcasecmp (policy, "lru"))
+  {
+    fprintf (stderr,
+             "WordDBInfo: wordlist_cache_policy %s unknown, using lru\n",
+             policy.get ());
+  }
+  //
+  // A background thread keeps part of the cache clean, so that the
+  // indexer seldom has to compress and write a page to make room for
+  // another.  The cache is then shared between threads, which the
+  // environment must know about.
+  //
+  int flush = config.Value ("wordlist_cache_flush", 0);
+  if (flush > 0)
+  {
+    int period = config.Value ("wordlist_cache_flush_period", 250);
+    if (dbenv->set_mp_flusher (dbenv, (u_int32_t) flush,
+                               (u_int32_t) (period > 0 ? period : 0) *
+                               1000) != 0)
+      return;
+  }
+  //
+  // New compressed files may pack their pages in an extent instead of
+  // fixed size slots; see mp_cmpr.c.
+  //
+  const String & layout = config["wordlist_compress_layout"];
+  if (!mystrcasecmp (layout, "packed"))
+  {
+    if (dbenv->set_mp_cmpr_layout (dbenv, DB_CMPR_PACKED) != 0)
+      return;
+  }
+  else if (!layout.empty () && mystrcasecmp (layout, "chained"))
+  {
+    fprintf (stderr,
+             "WordDBInfo: wordlist_compress_layout %s unknown, using chained\n",
+             layout.get ());
+  }
+  //
+  // Pages written in batches are compressed on several threads.
+  //
+  int cmpr_threads = config.Value ("wordlist_compress_threads", 1);
+  if (cmpr_threads > 1)
+  {
+    if (dbenv->set_mp_cmpr_threads (dbenv, (u_int32_t) cmpr_threads) != 0)
+      return;
+  }
+  //
+  // Batched and direct I/O, where the system has them; see os_uring.c.
+  //
+  u_int32_t mp_io = 0;
+  if (config.Boolean ("wordlist_io_uring"))
+    mp_io |= DB_MPIO_URING;
+  if (config.Boolean ("wordlist_direct_io"))
+    mp_io |= DB_MPIO_DIRECT;
+  if (mp_io != 0)
+  {
+    if (dbenv->set_mp_io (dbenv, mp_io) != 0)
+      return;
+  }
+  //
+  // Read-only databases up to this size are mapped rather than read
+  // into the cache.  Read as a double because an index may well be
+  // larger than an int.
+  //
+  double mmap_size = config.Double ("wordlist_mmap_size", 0);
+  if (mmap_size > 0)
+  {
+    //
+    // The largest size_t rounds up when made a double: anything that
+    // large is clamped without converting it back.
+    //
+    size_t size = mmap_size >= (double) ((size_t) - 1) ?
+      (size_t) - 1 : (size_t) mmap_size;
+    if (dbenv->set_mp_mmapsize (dbenv, size) != 0)
       return;
   }
 
+  //
+  // Nothing changes in a read-only snapshot, so nothing needs locking,
+  // and the query threads share the environment.
+  //
+  int snapshot = config.Boolean ("wordlist_snapshot");
+
+  //
+  // Transactions are for the one process that updates the databases.
+  // Without locking, which it does not need, what it reads or writes
+  // outside of a transaction never waits for what it does in one.
+  //
+  transactions = !snapshot && config.Boolean ("wordlist_env_txn");
+
   char *dir = 0;
   int flags = DB_CREATE;
-  if (config.Boolean ("wordlist_env_share"))
+  if (transactions)
   {
+    //
+    // Recovery reads and writes the compressed word databases before
+    // any WordList gives them a compressor.  Their pages must be written
+    // in one piece, which only the packed layout does.
+    //
+    if (config.Boolean ("wordlist_compress"))
+    {
+      compressor =
+        new WordDBCompress (config.Boolean ("wordlist_compress_zlib", 0),
+                            config.Value ("compression_level", 0));
+      cmpr_info = compressor->CmprInfo ();
+      dbenv->mp_cmpr_info = cmpr_info;
+      if (dbenv->set_mp_cmpr_layout (dbenv, DB_CMPR_PACKED) != 0)
+        return;
+    }
+
     const String & env_dir = config["wordlist_env_dir"];
     if (env_dir.empty ())
     {
       fprintf (stderr, "WordDB: wordlist_env_dir not specified\n");
+      transactions = 0;
       return;
     }
     dir = strdup ((const char *) env_dir);
 
-    if (config.Boolean ("wordlist_env_cdb"))
+    flags |= DB_PRIVATE | DB_INIT_MPOOL | DB_INIT_LOG | DB_INIT_TXN |
+      DB_RECOVER;
+  }
+  else if (config.Boolean ("wordlist_env_share"))
+  {
+    const String & env_dir = config["wordlist_env_dir"];
+    if (env_dir.empty ())
+    {
+      fprintf (stderr, "WordDB: wordlist_env_dir not specified\n");
+      return;
+    }
+    dir = strdup ((const char *) env_dir);
+
+    if (snapshot)
+      flags |= DB_INIT_MPOOL;
+    else if (config.Boolean ("wordlist_env_cdb"))
       flags |= DB_INIT_CDB;
     else
       flags |= DB_INIT_LOCK | DB_INIT_MPOOL;
@@ -85,12 +238,32 @@ WordDBInfo::WordDBInfo (const Configuration & config)
   }
   else
   {
-    flags |= DB_PRIVATE | DB_INIT_LOCK | DB_INIT_MPOOL;
+    flags |= DB_PRIVATE | DB_INIT_MPOOL;
+    if (!snapshot)
+      flags |= DB_INIT_LOCK;
   }
 
+  if (snapshot)
+    flags |= DB_RDONLY_SNAPSHOT | DB_THREAD;
+
+  if (flush > 0)
+    flags |= DB_THREAD;
+
   if ((error =
        dbenv->open (dbenv, (const char *) dir, NULL, flags, 0666)) != 0)
+  {
     dbenv->err (dbenv, error, "open %s", (dir ? dir : ""));
+    transactions = 0;
+  }
+  else if (transactions)
+  {
+    //
+    // What recovery replayed is now in the databases: the log it came
+    // from is no longer needed.
+    //
+    Sync ();
+    Database::SetEnvironment (dbenv, &txn);
+  }
   if (dir)
     free (dir);
 }
@@ -98,7 +271,135 @@ WordDBInfo::WordDBInfo (const Configuration & config)
 WordDBInfo::~WordDBInfo ()
 {
   if (dbenv)
+  {
+    char **logs = 0;
+    if (transactions)
+    {
+      if (txn)
+        CDB_txn_abort (txn);
+      txn = 0;
+      //
+      // Once everything is in the databases, there is nothing left to
+      // recover: the log goes away with the environment.
+      //
+      if (Sync () != OK ||
+          CDB_log_archive (dbenv, &logs, DB_ARCH_ABS | DB_ARCH_LOG, NULL) != 0)
+        logs = 0;
+      Database::SetEnvironment (0, 0);
+    }
     dbenv->close (dbenv, 0);
+    if (logs)
+    {
+      for (char **log = logs; *log; log++)
+        remove (*log);
+      free (logs);
+    }
+  }
+  delete cmpr_info;
+  delete compressor;
+}
+
+int
+WordDBInfo::Begin ()
+{
+  if (!transactions || txn)
+    return OK;
+
+  int error;
+  if ((error = CDB_txn_begin (dbenv, NULL, &txn, DB_TXN_NOSYNC)) != 0)
+  {
+    dbenv->err (dbenv, error, "txn_begin");
+    txn = 0;
+    return NOTOK;
+  }
+  return OK;
+}
+
+int
+WordDBInfo::Commit ()
+{
+  if (!txn)
+    return OK;
+
+  int error = CDB_txn_commit (txn, DB_TXN_NOSYNC);
+  txn = 0;
+  if (error != 0)
+  {
+    dbenv->err (dbenv, error, "txn_commit");
+    return NOTOK;
+  }
+
+  //
+  // Group commit: one write and sync of the log makes a whole group of
+  // transactions durable at once.
+  //
+  if (++txn_pending < txn_group)
+    return OK;
+  if ((error = CDB_log_flush (dbenv, NULL)) != 0)
+  {
+    dbenv->err (dbenv, error, "log_flush");
+    return NOTOK;
+  }
+  txn_pending = 0;
+  return Checkpoint (txn_checkpoint);
+}
+
+int
+WordDBInfo::Sync ()
+{
+  if (!transactions)
+    return OK;
+
+  int error;
+  if ((error = CDB_log_flush (dbenv, NULL)) != 0)
+  {
+    dbenv->err (dbenv, error, "log_flush");
+    return NOTOK;
+  }
+  txn_pending = 0;
+
+  //
+  // Recovery starts from the checkpoint before the last one: a second
+  // checkpoint, with nothing in between, lets the log up to the first be
+  // removed.
+  //
+  if (Checkpoint (0) != OK)
+    return NOTOK;
+  return Checkpoint (0);
+}
+
+//
+// Write the modified pages once <kbyte> of log, if not 0, were written
+// since the last checkpoint, which bounds the time the next recovery
+// takes, and remove the log files the recovery no longer needs.  Pages
+// in use are not written, and the checkpoint is then tried again after
+// the next group.
+//
+int
+WordDBInfo::Checkpoint (int kbyte)
+{
+  int error = CDB_txn_checkpoint (dbenv, (u_int32_t) kbyte, 0);
+  if (error == DB_INCOMPLETE)
+    return OK;
+  if (error != 0)
+  {
+    dbenv->err (dbenv, error, "txn_checkpoint");
+    return NOTOK;
+  }
+
+  char **logs = 0;
+  if ((error = CDB_log_archive (dbenv, &logs, DB_ARCH_ABS, NULL)) != 0)
+  {
+    dbenv->err (dbenv, error, "log_archive");
+    return NOTOK;
+  }
+  if (logs)
+  {
+    for (char **log = logs; *log; log++)
+      remove (*log);
+    free (logs);
+  }
+  return OK;
 }
 
 void
@@ -34,6 +34,14 @@
 //   inverted indexes specified with a non-absolute pathname will be
 //   created relative to this directory.
 //
+// wordlist_env_txn {true,false} (default false)
+//   If true the changes are logged in <i>wordlist_env_dir</i> and made
+//   in transactions, and the environment is recovered when opened.
+//   The databases of <i>Database</i> objects opened read/write share
+//   it. The log is only flushed to disk every <i>wordlist_txn_group</i>
+//   commits, and checkpointed every <i>wordlist_txn_checkpoint</i>
+//   kilobytes of log.
+//
 // 
 // END
 //
@@ -51,6 +59,9 @@
 #include "Configuration.h"
 
 struct __db_env;
+struct __db_txn;
+struct __db_cmpr_info;
+class WordDBCompress;
 
 class WordDBInfo
 {
@@ -70,15 +81,42 @@ public:
     return 0;
   }
 
+  //
+  // Transactions, when wordlist_env_txn is set, and otherwise no-ops
+  // returning OK.  Begin() starts the current transaction, in which all
+  // the changes are made until Commit().  The commits are only durable
+  // once the log is flushed, which Commit() does for a group of them at
+  // a time, and Sync() for all those so far.
+  //
+  int Begin ();
+  int Commit ();
+  int Sync ();
+
   //
   // Berkeley DB environment
   //
   struct __db_env *dbenv;
 
+  //
+  // Current transaction, if any
+  //
+  struct __db_txn *txn;
+
   //
   // Unique instance pointer
   //
   static WordDBInfo *instance;
+
+protected:
+  int Checkpoint (int kbyte);
+
+  WordDBCompress *compressor;   // Of the word databases, for recovery
+  struct __db_cmpr_info *cmpr_info;
+
+  int transactions;             // wordlist_env_txn
+  int txn_group;                // Commits per log flush
+  int txn_pending;              // Commits not flushed yet
+  int txn_checkpoint;           // Kilobytes of log per checkpoint
 };
 
 #endif
@@ -157,6 +157,14 @@ WordList::Put (const WordReference & arg, int flags)
     return NOTOK;
   wordRef.Key ().SetWord (word);
 
+  return PutNormalized (wordRef, flags);
+}
+
+// *****************************************************************************
+//
+int
+WordList::PutNormalized (const WordReference & wordRef, int flags)
+{
   //
   // The two case could be grouped in a more compact way.
   // However, the resources consumption difference between
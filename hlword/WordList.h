@@ -124,6 +124,11 @@ public:
   }
 #ifndef SWIG
   int Put (const WordReference & wordRef, int flags);
+  //-
+  // Same as Put for a <b>wordRef</b> that is known to be complete
+  // and whose word has already been through <i>WordType::Normalize</i>.
+  //
+  int PutNormalized (const WordReference & wordRef, int flags);
 #endif /* SWIG */
 
   //-
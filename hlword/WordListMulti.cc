@@ -28,6 +28,54 @@
 #include <unistd.h>
 #endif
 
+//
+// Companion files of a compressed index: the free pages of the chained
+// layout or the extent of the packed layout (see db/mp_cmpr.c). An index
+// has one or the other.
+//
+static const char *cmpr_suffixes[] = { "_weakcmpr", "_extent", 0 };
+
+static int
+cmpr_unlink (const String & filename)
+{
+  for (int i = 0; cmpr_suffixes[i]; i++)
+  {
+    const String side = filename + String (cmpr_suffixes[i]);
+    if (unlink (side.get ()) != 0 && errno != ENOENT)
+    {
+      const String message = String ("WordListMulti::Merge: unlink ") + side;
+      perror ((const char *) message);
+      return NOTOK;
+    }
+  }
+  return OK;
+}
+
+static int
+cmpr_rename (const String & from, const String & to)
+{
+  for (int i = 0; cmpr_suffixes[i]; i++)
+  {
+    const String side_from = from + String (cmpr_suffixes[i]);
+    const String side_to = to + String (cmpr_suffixes[i]);
+    //
+    // A companion file of the other layout left at the destination
+    // would be taken for this index's.
+    //
+    if (rename (side_from.get (), side_to.get ()) != 0 &&
+        (errno != ENOENT ||
+         (unlink (side_to.get ()) != 0 && errno != ENOENT)))
+    {
+      const String message =
+        String ("WordListMulti::Merge: rename ") + side_from +
+        String (" ") + side_to;
+      perror ((const char *) message);
+      return NOTOK;
+    }
+  }
+  return OK;
+}
+
 class WordDBMulti:public Object
 {
 public:
@@ -370,17 +418,8 @@ WordListMulti::Merge ()
       perror ((const char *) message);
       return NOTOK;
     }
-    if (use_compress)
-    {
-      if (unlink ((char *) (a->filename + String ("_weakcmpr"))) != 0)
-      {
-        const String message =
-          String ("WordListMulti::Merge: unlink ") + a->filename +
-          String ("_weakcmpr");
-        perror ((const char *) message);
-        return NOTOK;
-      }
-    }
+    if (use_compress && cmpr_unlink (a->filename) != OK)
+      return NOTOK;
 
     //
     // Remove file b
@@ -392,17 +431,8 @@ WordListMulti::Merge ()
       perror ((const char *) message);
       return NOTOK;
     }
-    if (use_compress)
-    {
-      if (unlink ((char *) (b->filename + String ("_weakcmpr"))) != 0)
-      {
-        const String message =
-          String ("WordListMulti::Merge: unlink ") + b->filename +
-          String ("_weakcmpr");
-        perror ((const char *) message);
-        return NOTOK;
-      }
-    }
+    if (use_compress && cmpr_unlink (b->filename) != OK)
+      return NOTOK;
 
     //
     // Rename tmp file into file b
@@ -415,19 +445,8 @@ WordListMulti::Merge ()
       perror ((const char *) message);
       return NOTOK;
     }
-    if (use_compress)
-    {
-      if (rename
-          ((char *) (tmpname + String ("_weakcmpr")),
-           (char *) (b->filename + String ("_weakcmpr"))) != 0)
-      {
-        const String message =
-          String ("WordListMulti::Merge: rename ") + tmpname +
-          String ("_weakcmpr ") + b->filename + String ("_weakcmpr");
-        perror ((const char *) message);
-        return NOTOK;
-      }
-    }
+    if (use_compress && cmpr_rename (tmpname, b->filename) != OK)
+      return NOTOK;
 
     //
     // Update b file size. The size need not be accurate number as long
@@ -481,19 +500,8 @@ WordListMulti::Merge ()
         perror ((const char *) message);
         return NOTOK;
       }
-      if (use_compress)
-      {
-        if (rename
-            ((char *) (db->filename + String ("_weakcmpr")),
-             (char *) (newname + String ("_weakcmpr"))) != 0)
-        {
-          const String message =
-            String ("WordListMulti::Merge: rename ") + db->filename +
-            String ("_weakcmpr ") + newname + String ("_weakcmpr");
-          perror ((const char *) message);
-          return NOTOK;
-        }
-      }
+      if (use_compress && cmpr_rename (db->filename, newname) != OK)
+        return NOTOK;
 
       db->filename = newname;
     }
@@ -67,6 +67,23 @@ WordType::WordType (const Configuration & config)
       chrtypes[i] |= WORD_TYPE_VALIDPUNCT;
   }
 
+  // What Normalize() does with each character: lowercase it, then strip
+  // it if it is punctuation, then look at what is left.
+  for (int i = 0; i < 256; i++)
+  {
+    lowercase[i] = isupper (i) ? tolower (i) : i;
+    normtypes[i] = 0;
+    if (isupper (i))
+      normtypes[i] |= WORD_NORMTYPE_UPPER;
+    int c = lowercase[i];
+    if (c == 0 || (chrtypes[c] & WORD_TYPE_VALIDPUNCT))
+      normtypes[i] |= WORD_NORMTYPE_STRIP;
+    else if (IsStrictChar (c) && (allow_numbers || !IsDigit (c)))
+      normtypes[i] |= WORD_NORMTYPE_ALPHA;
+    else if (IsControl (c))
+      normtypes[i] |= WORD_NORMTYPE_CONTROL;
+  }
+
   {
     const String filename = config["bad_word_list"];
     FILE *fl = fopen (filename, "r");
@@ -114,69 +131,83 @@ WordType::~WordType ()
 //
 int
 WordType::Normalize (String & word) const
+{
+  int length = word.length ();
+  int status = Normalize (word.get (), length);
+  word.chop (word.length () - length);
+  return status;
+}
+
+//
+// The work of Normalize(String &), done with a lookup table for each
+// character rather than with a pass over the word for each step.
+//
+int
+WordType::Normalize (char *word, int &length) const
 {
   int status = WORD_NORMALIZE_GOOD;
 
   //
   // Reject empty strings, always
   //
-  if (word.empty ())
+  if (length <= 0)
     return status | WORD_NORMALIZE_NULL;
 
   //
-  // Always convert to lowercase
+  // Always convert to lowercase, and remove punctuation characters
+  // according to configuration
   //
-  if (word.lowercase ())
+  int found = 0;                // Types of all the characters
+  int kept_found = 0;           // Types of the ones within maximum_length
+  int kept = 0;
+  for (int i = 0; i < length; i++)
+  {
+    unsigned char c = word[i];
+    int type = normtypes[c];
+    found |= type;
+    if (type & WORD_NORMTYPE_STRIP)
+      continue;
+    if (kept < maximum_length)
+      kept_found |= type;
+    word[kept++] = lowercase[c];
+  }
+  if (found & WORD_NORMTYPE_UPPER)
     status |= WORD_NORMALIZE_CAPITAL;
-
-  //
-  // Remove punctuation characters according to configuration
-  //
-  if (StripPunctuation (word))
+  if (found & WORD_NORMTYPE_STRIP)
     status |= WORD_NORMALIZE_PUNCTUATION;
 
   //
   // Truncate words too long according to configuration
   //
-  if (word.length () > maximum_length)
+  if (kept > maximum_length)
   {
-    word.chop (word.length () - maximum_length);
+    kept = maximum_length > 0 ? maximum_length : 0;
     status |= WORD_NORMALIZE_TOOLONG;
   }
+  length = kept;
 
   //
   // Reject words too short according to configuration
   //
-  if (word.length () < minimum_length)
+  if (length < minimum_length)
     return status | WORD_NORMALIZE_TOOSHORT;
 
   //
   // Reject if contains control characters
   //
-  int alpha = 0;
-  for (const unsigned char *p =
-       (const unsigned char *)(const char *)(char *)word; *p; p++)
-  {
-    if (IsStrictChar (*p) && (allow_numbers || !IsDigit (*p)))
-    {
-      alpha = 1;
-    }
-    else if (IsControl (*p))
-    {
-      return status | WORD_NORMALIZE_CONTROL;
-    }
-  }
+  if (kept_found & WORD_NORMTYPE_CONTROL)
+    return status | WORD_NORMALIZE_CONTROL;
 
   //
   // Reject if contains no alpha characters (according to configuration)
   //
-  if (!alpha)
+  if (!(kept_found & WORD_NORMTYPE_ALPHA))
     return status | WORD_NORMALIZE_NOALPHA;
 
   //
   // Reject if listed in config[bad_word_list]
   //
-  if (badwords.Exists (word))
+  if (badwords.Exists (word, length))
     return status | WORD_NORMALIZE_BAD;
 
   //
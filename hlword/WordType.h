@@ -19,6 +19,7 @@
 
 #include "htString.h"
 #include "Configuration.h"
+#include "HtHash.h"
 //
 // Return values of Normalize, to get them in string form use NormalizeStatus
 //
@@ -83,6 +84,12 @@ public:
   //
   virtual int StripPunctuation (String & s) const;
   virtual int Normalize (String & s) const;
+  //
+  // Normalize the length bytes of word in place, in a single pass,
+  // and set length to that of the result.  Same result and return
+  // value as Normalize(String &).
+  //
+  int Normalize (char *word, int &length) const;
 
   //
   // Splitting
@@ -101,10 +108,12 @@ private:
   String other_chars_in_word;   // Attribute "valid_punctuation" plus
   // "extra_word_characters".
   char chrtypes[256];           // quick lookup table for types
+  unsigned char lowercase[256]; // Likewise for what Normalize() does
+  char normtypes[256];          // with each character
   int minimum_length;           // Minimum word length
   int maximum_length;           // Maximum word length
   int allow_numbers;            // True if a word may contain numbers
-  Dictionary badwords;          // List of excluded words
+  HtStringHash badwords;        // List of excluded words
 
   //
   // Unique instance pointer
@@ -119,6 +128,12 @@ private:
 #define WORD_TYPE_VALIDPUNCT  0x08
 #define WORD_TYPE_CONTROL  0x10
 
+// Bits to set in normtypes[], for what Normalize() makes of a character:
+#define WORD_NORMTYPE_UPPER  0x01      // Lowercased
+#define WORD_NORMTYPE_STRIP  0x02      // Removed as punctuation
+#define WORD_NORMTYPE_ALPHA  0x04      // Makes the word acceptable
+#define WORD_NORMTYPE_CONTROL  0x08    // Makes the word unacceptable
+
 // One for characters that when put together are a word
 // (including punctuation).
 inline int
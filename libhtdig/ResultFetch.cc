@@ -1165,7 +1165,7 @@ List *
 ResultFetch::buildMatchList ()
 {
   HtConfiguration *config = HtConfiguration::config ();
-  char *cpid;
+  int id;
   String url;
   ResultMatch *thisMatch;
   SplitMatches matches (*config);
@@ -1369,13 +1369,11 @@ ResultFetch::buildMatchList ()
       continue;
 
     results->Start_Get ();
-    while ((cpid = results->Get_Next ()))
+    while (results->Get_Next (id))
     {
-      int id = atoi (cpid);
-
       // DocumentRef *thisRef = docDB[id];
 
-      DocMatch *dm = results->find (cpid);
+      DocMatch *dm = results->find (id);
       Collection *collection = NULL;
       if (dm)
         collection = dm->collection;
@@ -1420,7 +1418,7 @@ ResultFetch::buildMatchList ()
       // so this still needs to be done.
       //
 
-      // Moved up: DocMatch    *dm = results->find(cpid);
+      // Moved up: DocMatch    *dm = results->find(id);
       double score = dm->score;
 
       // We need to scale based on date relevance and backlinks
@@ -124,6 +124,7 @@
 #define  HTDIG_ERROR_TESTURL_SRCH_EXCLUDE      -116
 #define  HTDIG_ERROR_TESTURL_REWRITE_EMPTY     -117
 #define  HTDIG_ERROR_TESTURL_ROBOT_FORBID      -118
+#define  HTDIG_ERROR_GENERATION                -119
 
 #define  HTSEARCH_ERROR_NO_MATCH               -201
 #define  HTSEARCH_ERROR_BAD_MATCH_INDEX        -202
@@ -146,6 +147,7 @@
 #define  HTMERGE_ERROR_DOCINDEX_READ           -306
 #define  HTMERGE_ERROR_DOCDB_READ              -307
 #define  HTMERGE_ERROR_EXCERPTDB_READ          -308
+#define  HTMERGE_ERROR_GENERATION              -309
 
 #define  PHP_HTDIG_CONFIGFILE_PARM              "configFile"
 #define  PHP_HTDIG_URL_PARM                     "URL"
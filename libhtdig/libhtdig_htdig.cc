@@ -50,6 +50,7 @@ extern "C"
 #include "defaults.h"
 #include "HtURLCodec.h"
 #include "WordContext.h"
+#include "HtGeneration.h"
 #include "HtDateTime.h"
 #include "HtURLRewriter.h"
 #include "URL.h"
@@ -98,6 +99,8 @@ static WordContext *wc = NULL;
 static int create_text_database = 0;
 static int alt_work_area = 0;
 static int initial = 0;
+static HtGeneration *generation = NULL;
+static int generation_number = 0;
 
 int htdig_index_open_flag = FALSE;
 
@@ -304,6 +307,22 @@ htdig_index_open (htdig_parameters_struct * htdig_parms)
     return (HTDIG_ERROR_URL_REWRITE);
   }
 
+  //
+  // With database generations, dig into a new generation rather than
+  // into .work files, and make it the current one in htdig_index_close().
+  //
+  generation = new HtGeneration;
+  generation_number = generation->Create (*config, initial);
+  if (generation_number == NOTOK)
+  {
+    delete generation;
+    generation = NULL;
+    reportError ("[HTDIG] Unable to create a new database generation");
+    return (HTDIG_ERROR_GENERATION);
+  }
+  if (generation_number > 0)
+    alt_work_area = 0;
+
   //
   // If indicated, change the database file names to have the .work
   // extension
@@ -663,6 +682,18 @@ htdig_index_close (void)
       fclose (urls_seen);
 
     htdig_index_open_flag = FALSE;
+
+    if (generation)
+    {
+      ret = generation_number > 0 ? generation->Commit () : OK;
+      delete generation;
+      generation = NULL;
+      if (ret != OK)
+      {
+        reportError ("[HTDIG] Unable to commit the new database generation");
+        return (HTDIG_ERROR_GENERATION);
+      }
+    }
   }
 
   return (TRUE);
@@ -40,6 +40,7 @@ extern "C"
 #include "HtURLCodec.h"
 #include "HtWordList.h"
 #include "HtWordReference.h"
+#include "HtGeneration.h"
 #include "htString.h"
 
 #ifdef HAVE_STD
@@ -159,6 +160,32 @@ htmerge_index_merge (htmerge_parameters_struct * htmerge_parms)
     merge_config.Read (merge_configFile);
   }
 
+  //
+  // With database generations, merge into a copy of the current
+  // generation rather than into .work files, from the current generation
+  // of the databases merged.
+  //
+  HtGeneration generation, merge_generation;
+  int generation_number = 0;
+  if (merge_configFile.length ())
+  {
+    generation_number = generation.Create (*config, 0);
+    if (generation_number == NOTOK)
+    {
+      reportError ("[HTMERGE] Unable to create a new database generation");
+      return (HTMERGE_ERROR_GENERATION);
+    }
+    if (generation_number > 0)
+      alt_work_area = 0;
+    if (merge_generation.Use (merge_config) == NOTOK)
+    {
+      reportError (form
+                   ("[HTMERGE] Unable to use the database generation of '%s'",
+                    merge_configFile.get ()));
+      return (HTMERGE_ERROR_GENERATION);
+    }
+  }
+
   if (alt_work_area != 0)
   {
     String configValue;
@@ -201,6 +228,14 @@ htmerge_index_merge (htmerge_parameters_struct * htmerge_parms)
     // Note: We don't have to specify anything, it's all in the config vars
 
     merge_ret = mergeDB ();
+    merge_generation.Release ();
+
+    if (merge_ret == TRUE && generation_number > 0
+        && generation.Commit () != OK)
+    {
+      reportError ("[HTMERGE] Unable to commit the new database generation");
+      merge_ret = HTMERGE_ERROR_GENERATION;
+    }
   }
 
   //call destructors here
@@ -220,6 +255,9 @@ htmerge_index_merge (htmerge_parameters_struct * htmerge_parms)
     }
   }
 
+  if (merge_ret == HTMERGE_ERROR_GENERATION)
+    return (merge_ret);
+
   return (TRUE);
 }
 
@@ -251,6 +251,9 @@ htsearch_open (htsearch_parameters_struct * htsearch_parms)
 
   //-------------------------------------------------------------------
 
+  // The databases are only read as a snapshot, without locking, if
+  // asked to: hldig may be updating them in place.
+  Database::SetSnapshot (config->Boolean ("wordlist_snapshot"));
 
   // Initialize htword library (key description + wordtype...)
   WordContext::Initialize (*config);
@@ -462,6 +465,18 @@ htsearch_query (htsearch_query_struct * htseach_query)
     addRequiredWords (*searchWords, requiredWords);
   }
 
+  //
+  // Use the generation of the databases that is current now; the
+  // collection keeps it until it goes away.
+  //
+  HtGeneration *generation = new HtGeneration;
+  if (generation->Use (*config) == NOTOK)
+  {
+    delete generation;
+    reportError ("Unable to use the current database generation");
+    return (HTSEARCH_ERROR_WORDDB_READ);
+  }
+
   //
   // Perform the actual search.  The function htsearch() is used for this.
   // The Dictionary it returns is then passed on to the Display object to
@@ -470,6 +485,7 @@ htsearch_query (htsearch_query_struct * htseach_query)
   const String word_db = config->Find ("word_db");
   if (access (word_db, R_OK) < 0)
   {
+    delete generation;
     reportError (form
                  ("Unable to read word database file '%s'\nDid you run htdig?",
                   word_db.get ()));
@@ -480,6 +496,7 @@ htsearch_query (htsearch_query_struct * htseach_query)
   String doc_index = config->Find ("doc_index");
   if (access ((char *) doc_index, R_OK) < 0)
   {
+    delete generation;
     reportError (form
                  ("Unable to read document index file '%s'\nDid you run htdig?",
                   doc_index.get ()));
@@ -489,6 +506,7 @@ htsearch_query (htsearch_query_struct * htseach_query)
   const String doc_db = config->Find ("doc_db");
   if (access (doc_db, R_OK) < 0)
   {
+    delete generation;
     reportError (form
                  ("Unable to read document database file '%s'\nDid you run htdig?",
                   doc_db.get ()));
@@ -498,6 +516,7 @@ htsearch_query (htsearch_query_struct * htseach_query)
   const String doc_excerpt = config->Find ("doc_excerpt");
   if (access (doc_excerpt, R_OK) < 0)
   {
+    delete generation;
     reportError (form
                  ("Unable to read document excerpts '%s'\nDid you run htdig?",
                   doc_excerpt.get ()));
@@ -508,6 +527,7 @@ htsearch_query (htsearch_query_struct * htseach_query)
   collection = new Collection ((char *) configFile,
                                word_db.get (), doc_index.get (),
                                doc_db.get (), doc_excerpt.get ());
+  collection->setGeneration (generation);
 
   // Perform search within the collection. Each collection stores its
   // own result list.
@@ -30,6 +30,7 @@
 #include <malloc.h>
 #endif /* HAVE_MALLOC_H */
 #include <stdlib.h>
+#include <pthread.h>
 
 /* AIX requires this to be the first thing in the file.  */
 //#ifndef __GNUC__  // Why not if g++?  Needed by g++ on Solaris 2.8
@@ -80,6 +81,16 @@ public:
     int count;
     int monitor;
     int random;
+    int threads;
+    int partitions;
+    int gets;
+    int policy;
+    int scan;
+    int flush;
+    int cmpr_threads;
+    int packed;
+    int io;
+    int snapshot;
     void show()
     {
   printf("wordsfile:: %s\n", wordsfile);
@@ -99,6 +110,16 @@ public:
   printf("remove:: %d\n", remove);
   printf("count:: %d\n", count);
   printf("monitor:: %d\n", monitor);
+  printf("threads:: %d\n", threads);
+  printf("partitions:: %d\n", partitions);
+  printf("gets:: %d\n", gets);
+  printf("policy:: %d\n", policy);
+  printf("scan:: %d\n", scan);
+  printf("flush:: %d\n", flush);
+  printf("cmpr_threads:: %d\n", cmpr_threads);
+  printf("packed:: %d\n", packed);
+  printf("io:: %d\n", io);
+  printf("snapshot:: %d\n", snapshot);
    }
 };
 
@@ -127,6 +148,7 @@ public:
   virtual void fill_one(String& line, int count) = 0;
   virtual void find() = 0;
   virtual void remove() = 0;
+  virtual void readers();
 
 protected:
   params_t* params;
@@ -139,7 +161,9 @@ void Dbase::dobench()
 {
   dbinit();
 
-  if(params->find) {
+  if(params->threads) {
+    readers();
+  } else if(params->find) {
     find();
   } else if(params->remove) {
     remove();
@@ -192,13 +216,19 @@ void Dbase::fill() {
   fprintf(stderr, "pushed %d words\n", count);
 }
 
+void Dbase::readers()
+{
+  fprintf(stderr, "concurrent readers are only implemented for raw Berkeley DB\n");
+  exit(1);
+}
+
 // *****************************************************************
 // Test Berkeley DB alone
 //
 class Dsimple : public Dbase {
 public:
-  Dsimple(params_t* nparams) : Dbase(nparams) { pad = 0; }
-  virtual ~Dsimple() { if(pad) free(pad); }
+  Dsimple(params_t* nparams) : Dbase(nparams) { pad = 0; keys = 0; keys_length = 0; }
+  virtual ~Dsimple();
 
   virtual void dbinit();
   void dbinit_env();
@@ -208,13 +238,22 @@ public:
   virtual void fill_one(String& line, int count);
   virtual void find();
   virtual void remove();
+  virtual void readers();
 
   void dbput(const String& key, const String& data);
 
 protected:
+  static void* reader(void* arg);
+
   DB_ENV* dbenv;
   DB* db;
   char* pad;
+
+  //
+  // Keys of the database, looked up at random by the readers
+  //
+  String** keys;
+  int keys_length;
 };
 
 /*
@@ -303,10 +342,38 @@ void Dsimple::dbinit_env()
   dbenv->set_errfile(dbenv, stderr);
   dbenv->set_errpfx(dbenv, progname);
   if(params->cache_size > 500 * 1024)
-    dbenv->set_cachesize(dbenv, 0, params->cache_size, 0);
-  int flags = DB_CREATE | DB_INIT_MPOOL | DB_INIT_LOCK | DB_NOMMAP;
+    dbenv->set_cachesize(dbenv, 0, params->cache_size, params->partitions);
+  dbenv->set_mp_policy(dbenv, params->policy);
+  if(params->flush)
+    dbenv->set_mp_flusher(dbenv, params->flush, 0);
+  if(params->cmpr_threads)
+    dbenv->set_mp_cmpr_threads(dbenv, params->cmpr_threads);
+  if(params->packed)
+    dbenv->set_mp_cmpr_layout(dbenv, DB_CMPR_PACKED);
+  if(params->io)
+    dbenv->set_mp_io(dbenv, params->io);
+  int flags = DB_CREATE | DB_INIT_MPOOL | DB_NOMMAP;
   if(!params->pool)
     flags |= DB_PRIVATE;
+  //
+  // Concurrent readers of a read-only database need no page locks,
+  // which leaves the memory pool as the only thing they share.
+  //
+  if(params->threads)
+    flags |= DB_THREAD;
+  else if(!params->snapshot)
+    flags |= DB_INIT_LOCK;
+  //
+  // A snapshot also lets the readers pin the internal pages of the tree
+  // without locking the cache.
+  //
+  if(params->snapshot)
+    flags |= DB_RDONLY_SNAPSHOT;
+  //
+  // The background flusher shares the memory pool with this thread.
+  //
+  if(params->flush)
+    flags |= DB_THREAD;
 
   dbenv->open(dbenv, NULL, NULL, flags, 0666);
 }
@@ -325,11 +392,15 @@ void Dsimple::dbopen()
 
   if(params->page_size) db->set_pagesize(db, params->page_size);
 
-  int flags = DB_CREATE | DB_NOMMAP;
+  int flags = DB_NOMMAP;
   if(params->compress)
     flags |= DB_COMPRESS;
-  if(params->find)
+  if(params->find || params->threads)
     flags |= DB_RDONLY;
+  else
+    flags |= DB_CREATE;
+  if(params->threads)
+    flags |= DB_THREAD;
 
   if(db->open(db, params->dbfile, NULL, params->type, flags, 0666) != 0)
     exit(1);
@@ -340,6 +411,16 @@ void Dsimple::dbopen()
  */
 void Dsimple::dbfinish()
 {
+  //
+  // Show who wrote the pages evicted from the cache: the inserting
+  // thread itself or the background flusher.
+  //
+  DB_MPOOL_STAT* stat;
+  if(params->flush && CDB_memp_stat(dbenv, &stat, NULL, NULL) == 0) {
+    printf("pages written: %lu on eviction, %lu by the flusher\n",
+     (unsigned long)stat->st_rw_evict, (unsigned long)stat->st_page_trickle);
+    free(stat);
+  }
   (void)db->close(db, 0);
   (void)dbenv->close(dbenv, 0);
   WordContext::Finish();
@@ -412,6 +493,162 @@ void Dsimple::find()
   cursor->c_close(cursor);
 }
 
+Dsimple::~Dsimple()
+{
+  if(pad) free(pad);
+  for(int i = 0; i < keys_length; i++)
+    delete keys[i];
+  if(keys) free(keys);
+}
+
+/*
+ * State of one reader thread
+ */
+typedef struct {
+  Dsimple* bench;
+  pthread_t thread;
+  unsigned int seed;
+  int found;
+} reader_t;
+
+/*
+ * Look up params->gets keys picked at random, from several threads
+ * sharing the database handle, and report the throughput.
+ */
+void Dsimple::readers()
+{
+  DBC* cursor;
+  DBT key;
+  DBT data;
+  int keys_size = 0;
+
+  //
+  // Collect the keys, the readers only know where to look afterwards.
+  //
+  if(db->cursor(db, NULL, &cursor, 0) != 0)
+    abort();
+
+  memset(&key, '\0', sizeof(DBT));
+  memset(&data, '\0', sizeof(DBT));
+  key.flags = DB_DBT_MALLOC;
+  data.flags = DB_DBT_MALLOC;
+
+  while(cursor->c_get(cursor, &key, &data, DB_NEXT) == 0) {
+    if(keys_length >= keys_size) {
+      keys_size = keys_size ? keys_size * 2 : 1024;
+      keys = (String**)realloc(keys, keys_size * sizeof(String*));
+    }
+    keys[keys_length++] = new String((const char*)key.data, (int)key.size);
+    free(key.data);
+    free(data.data);
+    if(params->nwords > 0 && keys_length >= params->nwords) break;
+  }
+
+  cursor->c_close(cursor);
+
+  if(keys_length == 0) {
+    fprintf(stderr, "%s: no keys to look up\n", params->dbfile);
+    exit(1);
+  }
+
+  reader_t* threads = new reader_t[params->threads];
+  double start = HtTime::DTime();
+  int i;
+
+  for(i = 0; i < params->threads; i++) {
+    threads[i].bench = this;
+    threads[i].seed = i + 1;
+    threads[i].found = 0;
+    if(pthread_create(&threads[i].thread, NULL, reader, &threads[i]) != 0) {
+      perror("pthread_create");
+      exit(1);
+    }
+  }
+
+  int found = 0;
+  for(i = 0; i < params->threads; i++) {
+    pthread_join(threads[i].thread, NULL);
+    found += threads[i].found;
+  }
+
+  double elapsed = HtTime::DTime(start);
+  double total = (double)params->gets * params->threads;
+
+  printf("%d threads, %d partitions: %.0f gets in %.3f seconds, %.0f gets/second\n",
+   params->threads, params->partitions ? params->partitions : 1,
+   total, elapsed, elapsed > 0 ? total / elapsed : 0.0);
+
+  DB_MPOOL_STAT* stat;
+  if(CDB_memp_stat(dbenv, &stat, NULL, NULL) == 0) {
+    printf("internal pages: %lu hits, %lu misses; leaf pages: %lu hits, %lu misses\n",
+     (unsigned long)stat->st_internal_hit, (unsigned long)stat->st_internal_miss,
+     (unsigned long)stat->st_leaf_hit, (unsigned long)stat->st_leaf_miss);
+    if(params->snapshot)
+      printf("snapshot pages: %lu hits without locking the cache\n",
+       (unsigned long)stat->st_snap_hit);
+    free(stat);
+  }
+
+  if(found != total) {
+    fprintf(stderr, "found %d keys out of %.0f\n", found, total);
+    exit(1);
+  }
+
+  delete [] threads;
+}
+
+void* Dsimple::reader(void* arg)
+{
+  reader_t* state = (reader_t*)arg;
+  Dsimple* bench = state->bench;
+  DB* db = bench->db;
+  DBT key;
+  DBT data;
+  DBC* cursor = 0;
+  DBT skey;
+  DBT sdata;
+
+  if(bench->params->scan > 0 && db->cursor(db, NULL, &cursor, 0) != 0)
+    abort();
+  memset(&skey, '\0', sizeof(DBT));
+  memset(&sdata, '\0', sizeof(DBT));
+  skey.flags = DB_DBT_REALLOC;
+  sdata.flags = DB_DBT_REALLOC;
+
+  for(int i = 0; i < bench->params->gets; i++) {
+    String* k = bench->keys[rand_r(&state->seed) % bench->keys_length];
+
+    memset(&key, '\0', sizeof(DBT));
+    memset(&data, '\0', sizeof(DBT));
+    key.data = k->get();
+    key.size = k->length();
+    data.flags = DB_DBT_MALLOC;
+
+    if(db->get(db, NULL, &key, &data, 0) == 0) {
+      state->found++;
+      free(data.data);
+    }
+
+    //
+    // Walk on through the whole database, the way a dump or a
+    // search on a short prefix would, wrapping around at the end.
+    //
+    for(int j = 0; cursor && j < bench->params->scan; j++) {
+      if(cursor->c_get(cursor, &skey, &sdata, DB_NEXT) != 0 &&
+         cursor->c_get(cursor, &skey, &sdata, DB_FIRST) != 0)
+        break;
+    }
+  }
+
+  if(cursor) {
+    cursor->c_close(cursor);
+    if(skey.data) free(skey.data);
+    if(sdata.data) free(sdata.data);
+  }
+
+  return 0;
+}
+
 /*
  * Delete keys
  */
@@ -525,6 +762,24 @@ void Dwordlist::dbinit()
   config->Add("wordlist_compress", "true");
     if(params->monitor)
       config->Add("wordlist_monitor", "true");
+    if(params->flush) {
+      String str;
+      str << params->flush;
+      config->Add("wordlist_cache_flush", str);
+    }
+    if(params->cmpr_threads) {
+      String str;
+      str << params->cmpr_threads;
+      config->Add("wordlist_compress_threads", str);
+    }
+    if(params->packed)
+      config->Add("wordlist_compress_layout", "packed");
+    if(params->io & DB_MPIO_URING)
+      config->Add("wordlist_io_uring", "true");
+    if(params->io & DB_MPIO_DIRECT)
+      config->Add("wordlist_direct_io", "true");
+    if(params->snapshot)
+      config->Add("wordlist_snapshot", "true");
 
     WordContext::Initialize(*config);
 
@@ -626,8 +881,18 @@ int main(int ac, char **av)
   params.count = 0;
   params.monitor = 0;
   params.random = 0;
-
-  while ((c = getopt(ac, av, "vB:T:C:S:MZf:l:w:k:n:zWp:ur:c:mR")) != -1)
+  params.threads = 0;
+  params.partitions = 0;
+  params.gets = 100000;
+  params.policy = DB_MPOOL_LRU;
+  params.scan = 0;
+  params.flush = 0;
+  params.cmpr_threads = 0;
+  params.packed = 0;
+  params.io = 0;
+  params.snapshot = 0;
+
+  while ((c = getopt(ac, av, "vB:T:C:S:MZf:l:w:k:n:zWp:ur:c:mRt:P:g:Qs:F:J:KUDO")) != -1)
     {
       switch (c)
   {
@@ -698,6 +963,39 @@ int main(int ac, char **av)
   case 'R':
     params.random = 1;
     break;
+  case 't':
+    params.threads = atoi(optarg);
+    break;
+  case 'P':
+    params.partitions = atoi(optarg);
+    break;
+  case 'g':
+    params.gets = atoi(optarg);
+    break;
+  case 'Q':
+    params.policy = DB_MPOOL_2Q;
+    break;
+  case 's':
+    params.scan = atoi(optarg);
+    break;
+  case 'F':
+    params.flush = atoi(optarg);
+    break;
+  case 'J':
+    params.cmpr_threads = atoi(optarg);
+    break;
+  case 'K':
+    params.packed = 1;
+    break;
+  case 'U':
+    params.io |= DB_MPIO_URING;
+    break;
+  case 'D':
+    params.io |= DB_MPIO_DIRECT;
+    break;
+  case 'O':
+    params.snapshot = 1;
+    break;
   case '?':
     usage();
     break;
@@ -744,6 +1042,11 @@ static void usage()
     printf("\t-M\t\tuse shared memory pool (default do not use).\n");
     printf("\t-z\t\tSet DB_COMPRESS flag\n");
     printf("\t-R\t\tUse random number for numerical values\n");
+    printf("\t-F pct\t\tkeep <pct> percent of the cache clean from a background thread.\n");
+    printf("\t-J n\t\tcompress the pages written in batches on <n> threads.\n");
+    printf("\t-K\t\tpack compressed pages in an extent file.\n");
+    printf("\t-U\t\tbatch writes and readahead through io_uring.\n");
+    printf("\t-D\t\tbypass the system's buffers (direct I/O).\n");
 
     printf("\n");
     printf("\t-W\t\tuse WordList instead of raw Berkeley DB\n");
@@ -762,6 +1065,14 @@ static void usage()
     printf("\t-k n\t\tcreate <n> entries for each word (default 1).\n");
     printf("\t-n limit\tRead at most <limit> words (default read all).\n");
     printf("\t-c count\tStart serial count at <count> (default 0).\n");
+    printf("\n");
+    printf("\t-t n\t\tlook up random keys of dbfile from <n> threads.\n");
+    printf("\t-g n\t\teach thread looks up <n> keys (default 100000).\n");
+    printf("\t-P n\t\tsplit the -C cache in <n> separately locked parts.\n");
+    printf("\t-Q\t\tuse the scan resistant 2Q cache replacement policy.\n");
+    printf("\t-s n\t\teach thread also reads <n> entries of a scan after each look up.\n");
+    printf("\t-O\t\topen dbfile as a read-only snapshot, without locks (with -t or -f).\n");
+    printf("\t\t\t-n limits the number of keys looked up.\n");
     exit(0);
 }
 
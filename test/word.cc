@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <locale.h>
 
 // If we have this, we probably want it.
 #ifdef HAVE_GETOPT_H
@@ -30,6 +31,8 @@
 #include "WordKey.h"
 #include "WordList.h"
 #include "WordContext.h"
+#include "WordType.h"
+#include "myqsort.h"
 #include "Configuration.h"
 
 static ConfigDefaults config_defaults[] = {
@@ -46,6 +49,8 @@ typedef struct
     int skip;
     int compress;
     int env;
+    int normalize;
+    int sort;
 } params_t;
 
 static void usage();
@@ -54,6 +59,8 @@ static void dolist(params_t* params);
 static void dokey(params_t* params);
 static void doskip(params_t* params);
 static void doenv(params_t* params);
+static void donormalize(params_t* params);
+static void dosort(params_t* params);
 static void pack_show_wordreference(const WordReference& wordRef);
 static void pack_show_key(const String& key);
 
@@ -73,8 +80,10 @@ int main(int ac, char **av)
   params.skip = 0;
   params.env = 0;
   params.compress = 0;
+  params.normalize = 0;
+  params.sort = 0;
 
-  while ((c = getopt(ac, av, "ve:klbszw:")) != -1)
+  while ((c = getopt(ac, av, "ve:klbsznqw:")) != -1)
     {
       switch (c)
   {
@@ -96,6 +105,12 @@ int main(int ac, char **av)
   case 'z':
     params.compress = 1;
     break;
+  case 'n':
+    params.normalize = 1;
+    break;
+  case 'q':
+    params.sort = 1;
+    break;
   case '?':
     usage();
     break;
@@ -154,6 +169,16 @@ static void doword(params_t* params)
     if(verbose) fprintf(stderr, "Test WordList with shared env\n");
     doenv(params);
   }
+
+  if(params->normalize) {
+    if(verbose) fprintf(stderr, "Test WordType::Normalize\n");
+    donormalize(params);
+  }
+
+  if(params->sort) {
+    if(verbose) fprintf(stderr, "Test sorting arrays of Strings\n");
+    dosort(params);
+  }
 }
 
 static void dolist(params_t*)
@@ -1057,6 +1082,253 @@ static void doenv(params_t* params)
   words.Close();
 }
 
+//*****************************************************************************
+// void donormalize()
+//   Check WordType::Normalize against the step by step implementation
+//   it replaced, for every character with the configured character sets.
+//
+
+static const char* normalize_bad_words = "word_normalize.bad";
+
+//
+// The step by step implementation
+//
+static int normalize_reference(const WordType& type, const Configuration& config, const Dictionary& badwords, String& word)
+{
+  int status = WORD_NORMALIZE_GOOD;
+  int minimum_length = config.Value("minimum_word_length", 3);
+  int maximum_length = config.Value("maximum_word_length", 12);
+  int allow_numbers = config.Boolean("allow_numbers", 0);
+
+  if(word.empty())
+    return status | WORD_NORMALIZE_NULL;
+
+  if(word.lowercase())
+    status |= WORD_NORMALIZE_CAPITAL;
+
+  if(word.remove(config["valid_punctuation"]))
+    status |= WORD_NORMALIZE_PUNCTUATION;
+
+  if(word.length() > maximum_length) {
+    word.chop(word.length() - maximum_length);
+    status |= WORD_NORMALIZE_TOOLONG;
+  }
+
+  if(word.length() < minimum_length)
+    return status | WORD_NORMALIZE_TOOSHORT;
+
+  int alpha = 0;
+  for(const unsigned char *p = (const unsigned char *)word.get(); *p; p++) {
+    if(type.IsStrictChar(*p) && (allow_numbers || !type.IsDigit(*p)))
+      alpha = 1;
+    else if(type.IsControl(*p))
+      return status | WORD_NORMALIZE_CONTROL;
+  }
+
+  if(!alpha)
+    return status | WORD_NORMALIZE_NOALPHA;
+
+  if(badwords.Exists(word))
+    return status | WORD_NORMALIZE_BAD;
+
+  return status;
+}
+
+static int normalize_try(const WordType& type, const Configuration& config, const Dictionary& badwords, const String& word)
+{
+  String expected = word;
+  int expected_status = normalize_reference(type, config, badwords, expected);
+  String found = word;
+  int found_status = type.Normalize(found);
+
+  if(found_status != expected_status || found != expected) {
+    fprintf(stderr, "donormalize: ");
+    for(int i = 0; i < word.length(); i++)
+      fprintf(stderr, "%02x", word[i] & 0xff);
+    fprintf(stderr, " gives %s (%s), expected %s (%s)\n",
+      (char*)found, (char*)WordType::NormalizeStatus(found_status),
+      (char*)expected, (char*)WordType::NormalizeStatus(expected_status));
+    return NOTOK;
+  }
+  return OK;
+}
+
+static void donormalize(params_t*)
+{
+  static const char* configs[][5] = {
+    // valid_punctuation, extra_word_characters, minimum_word_length, maximum_word_length, allow_numbers
+    { "-_/.,'", "", "3", "12", "false" },
+    { "", "&", "1", "5", "true" },
+    { "-\t\001", "\002", "2", "4", "false" },
+    { "aeiou", "", "0", "1", "true" },
+    { "'", "$#", "3", "100", "false" },
+    { 0 }
+  };
+  static const char* bad_words[] = { "the", "AND", "clock's", "x-ray", "bad", 0 };
+  static const char sample[] = "aZ5-.'_&$#\t\001\002 \300\377";
+
+  //
+  // Upper case letters beyond ASCII, where the system has them
+  //
+  if(!setlocale(LC_CTYPE, "en_US.ISO-8859-1"))
+    setlocale(LC_CTYPE, "fr_FR.ISO-8859-1");
+
+  FILE* f = fopen(normalize_bad_words, "w");
+  if(!f) {
+    perror(normalize_bad_words);
+    exit(1);
+  }
+  for(int i = 0; bad_words[i]; i++)
+    fprintf(f, "%s\n", bad_words[i]);
+  fclose(f);
+
+  int errors = 0;
+  for(int c = 0; configs[c][0]; c++) {
+    Configuration config;
+    config.Add("valid_punctuation", configs[c][0]);
+    config.Add("extra_word_characters", configs[c][1]);
+    config.Add("minimum_word_length", configs[c][2]);
+    config.Add("maximum_word_length", configs[c][3]);
+    config.Add("allow_numbers", configs[c][4]);
+    config.Add("bad_word_list", normalize_bad_words);
+    WordType type(config);
+
+    Dictionary badwords;
+    for(int i = 0; bad_words[i]; i++) {
+      String word = bad_words[i];
+      if(!(normalize_reference(type, config, badwords, word) & WORD_NORMALIZE_NOTOK))
+  badwords.Add(word, 0);
+    }
+
+    if(verbose) fprintf(stderr, "donormalize: valid_punctuation %s\n", configs[c][0]);
+
+    String word;
+    int i, j, k;
+    //
+    // Every word of one and two characters
+    //
+    errors += normalize_try(type, config, badwords, word) != OK;
+    for(i = 1; i < 256; i++) {
+      word.trunc();
+      word << (char)i;
+      errors += normalize_try(type, config, badwords, word) != OK;
+      for(j = 1; j < 256; j++) {
+  word.trunc();
+  word << (char)i << (char)j;
+  errors += normalize_try(type, config, badwords, word) != OK;
+      }
+    }
+    //
+    // Every word of three characters of each type
+    //
+    int n = sizeof(sample) - 1;
+    for(i = 0; i < n; i++)
+      for(j = 0; j < n; j++)
+  for(k = 0; k < n; k++) {
+    word.trunc();
+    word << sample[i] << sample[j] << sample[k];
+    errors += normalize_try(type, config, badwords, word) != OK;
+  }
+    //
+    // Every character at every place of a word too long
+    //
+    for(i = 1; i < 256; i++)
+      for(j = 0; j < 16; j++) {
+  word = "AbCdEfGhIjKlMnOp";
+  word[j] = (char)i;
+  errors += normalize_try(type, config, badwords, word) != OK;
+      }
+    //
+    // The bad words, hidden by case and punctuation
+    //
+    for(i = 0; bad_words[i]; i++) {
+      word = bad_words[i];
+      errors += normalize_try(type, config, badwords, word) != OK;
+      word.uppercase();
+      errors += normalize_try(type, config, badwords, word) != OK;
+      word << "-";
+      errors += normalize_try(type, config, badwords, word) != OK;
+    }
+  }
+
+  unlink(normalize_bad_words);
+
+  if(errors) {
+    fprintf(stderr, "donormalize: %d errors\n", errors);
+    exit(1);
+  }
+}
+
+//*****************************************************************************
+// void dosort(params_t* params)
+//   WordDBCaches and WordListMulti sort their files with myqsort, which
+//   swaps the WordDBCacheFile and WordDBMulti structures byte by byte:
+//   their filename must follow.
+//
+
+//
+// Same layout as WordDBCacheFile and WordDBMulti
+//
+class SortFile
+{
+public:
+  SortFile() { size = 0; }
+
+  String filename;
+  unsigned int size;
+};
+
+static int dosort_cmp(void*, SortFile* a, SortFile* b)
+{
+  return (int)a->size - (int)b->size;
+}
+
+static void dosort(params_t*)
+{
+  static const int count = 64;
+  int errors = 0;
+
+  for(int round = 0; round < 3; round++) {
+    SortFile* files = new SortFile[count];
+    int i;
+    //
+    // Names short enough to be kept inline and names that are not,
+    // in the reverse order of the sizes
+    //
+    for(i = 0; i < count; i++) {
+      files[i].size = count - i;
+      files[i].filename << "db.C" << (int)files[i].size;
+      if(i % 2 || round == 1)
+        files[i].filename << "/a/name/longer/than/any/inline/buffer";
+    }
+
+    myqsort((void*)files, count, sizeof(SortFile), (myqsort_cmp)dosort_cmp, 0);
+
+    for(i = 0; i < count; i++) {
+      String expected;
+      expected << "db.C" << (int)files[i].size;
+      if(files[i].size != (unsigned int)(i + 1) ||
+         strncmp(files[i].filename.get(), expected.get(), expected.length()) ||
+         (files[i].filename.length() != expected.length() &&
+          files[i].filename[expected.length()] != '/')) {
+        fprintf(stderr, "dosort: size %d has name %s\n", files[i].size, files[i].filename.get());
+        errors++;
+      }
+      //
+      // The sorted names must still be usable
+      //
+      files[i].filename << "x";
+    }
+
+    delete [] files;
+  }
+
+  if(errors) {
+    fprintf(stderr, "dosort: %d errors\n", errors);
+    exit(1);
+  }
+}
+
 //*****************************************************************************
 // void usage()
 //   Display program usage information
@@ -1071,5 +1343,7 @@ static void usage()
     printf("\t-e n\t\tTest WordList with shared environnement, process number <n>\n");
     printf("\t-s\t\tTest WordList::SkipUselessSequentialWalking\n");
     printf("\t-z\t\tActivate compression test (use with -s, -b or -l)\n");
+    printf("\t-n\t\tTest WordType::Normalize\n");
+    printf("\t-q\t\tTest sorting arrays of Strings with myqsort\n");
     exit(0);
 }